@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    xpd_adc_filter.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers ADC Decimation Filters Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_ADC_FILTER_H_
+#define __XPD_ADC_FILTER_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_common.h>
+
+/** @ingroup ADC
+ * @defgroup ADC_Filter ADC Decimation Filters
+ * @brief    Fixed-point decimation of oversampled conversion data streams.
+ *           The kernels use the DSP instructions when available, and give
+ *           bit-exact results with the portable implementation.
+ * @{ */
+
+/** @defgroup ADC_Filter_Exported_Macros ADC Decimation Filters Exported Macros
+ * @{ */
+
+/** @brief Maximal number of CIC integrator and comb stages */
+#define ADCFILT_CIC_MAX_ORDER       4
+
+/** @brief Required size of the FIR delay line for the number of taps */
+#define ADCFILT_FIR_STATE_SIZE(TAPS)    (2 * (TAPS))
+
+/** @} */
+
+/** @defgroup ADC_Filter_Exported_Types ADC Decimation Filters Exported Types
+ * @{ */
+
+/** @brief Moving average decimator structure */
+typedef struct
+{
+    uint16_t Ratio;                         /*!< Decimation ratio: number of averaged samples */
+    uint8_t Shift;                          /*!< Right shift of the sum to produce the output */
+    uint16_t Count;                         /*!< [Internal] Number of accumulated samples */
+    uint32_t Sum;                           /*!< [Internal] Sum of the accumulated samples */
+}ADCFILT_AverageType;
+
+/** @brief CIC decimator structure */
+typedef struct
+{
+    uint16_t Ratio;                         /*!< Decimation ratio */
+    uint8_t Order;                          /*!< Number of stages [1 .. ADCFILT_CIC_MAX_ORDER] */
+    uint8_t Shift;                          /*!< Right shift of the comb output to produce the output,
+                                                 Order * log2(Ratio) for unity gain */
+    uint16_t Count;                         /*!< [Internal] Number of inputs since the last output */
+    uint32_t Integrator[ADCFILT_CIC_MAX_ORDER]; /*!< [Internal] Integrator stages */
+    uint32_t Comb[ADCFILT_CIC_MAX_ORDER];   /*!< [Internal] Delayed inputs of the comb stages */
+}ADCFILT_CICType;
+
+/** @brief FIR decimator structure */
+typedef struct
+{
+    const int16_t * Coeffs;                 /*!< Q15 coefficients in time reversed order
+                                                 (the first is applied to the oldest sample) */
+    uint16_t * State;                       /*!< Delay line of ADCFILT_FIR_STATE_SIZE(Taps) samples */
+    uint16_t Taps;                          /*!< Number of coefficients */
+    uint16_t Ratio;                         /*!< Decimation ratio */
+    uint16_t Index;                         /*!< [Internal] Write position of the delay line */
+    uint16_t Count;                         /*!< [Internal] Number of inputs since the last output */
+}ADCFILT_FIRType;
+
+/** @} */
+
+/** @defgroup ADC_Filter_Exported_Functions ADC Decimation Filters Exported Functions
+ * @{ */
+void            ADCFILT_vAverageInit    (ADCFILT_AverageType * pxAvg);
+uint16_t        ADCFILT_usAverage       (ADCFILT_AverageType * pxAvg, const uint16_t * pusInput,
+                                         uint16_t usLength, uint16_t * pusOutput);
+
+void            ADCFILT_vCICInit        (ADCFILT_CICType * pxCIC);
+uint16_t        ADCFILT_usCIC           (ADCFILT_CICType * pxCIC, const uint16_t * pusInput,
+                                         uint16_t usLength, uint16_t * pusOutput);
+
+void            ADCFILT_vFIRInit        (ADCFILT_FIRType * pxFIR);
+uint16_t        ADCFILT_usFIR           (ADCFILT_FIRType * pxFIR, const uint16_t * pusInput,
+                                         uint16_t usLength, uint16_t * pusOutput);
+/** @} */
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_ADC_FILTER_H_ */
@@ -0,0 +1,144 @@
+/**
+  ******************************************************************************
+  * @file    xpd_can_tp.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers CAN Transport Protocol Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_CAN_TP_H_
+#define __XPD_CAN_TP_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_can.h>
+
+#if defined(CAN) || defined(CAN1)
+
+/** @ingroup CAN
+ * @defgroup CAN_TP CAN Transport Protocol
+ * @brief    ISO 15765-2 transport layer with normal addressing over classic CAN frames
+ * @{ */
+
+/** @defgroup CAN_TP_Exported_Types CAN Transport Protocol Exported Types
+ * @{ */
+
+/** @brief CAN transport protocol error types */
+typedef enum
+{
+    CANTP_ERROR_NONE        = 0, /*!< No error */
+    CANTP_ERROR_TIMEOUT_BS  = 1, /*!< Flow control frame was not received in time */
+    CANTP_ERROR_TIMEOUT_CR  = 2, /*!< Consecutive frame was not received in time */
+    CANTP_ERROR_WRONG_SN    = 3, /*!< Consecutive frame sequence number mismatch */
+    CANTP_ERROR_UNEXP_PDU   = 4, /*!< New message reception interrupted the ongoing one */
+    CANTP_ERROR_OVERFLOW    = 5, /*!< Message does not fit in the receive buffer */
+    CANTP_ERROR_INVALID_FS  = 6, /*!< Flow control frame with invalid flow status */
+    CANTP_ERROR_TIMEOUT_AS  = 7, /*!< Last frame of the message was not transmitted in time */
+    CANTP_ERROR_WRONG_DL    = 8, /*!< Consecutive frame is shorter than the remaining data */
+}CANTP_ErrorType;
+
+/** @brief CAN transport protocol session structure */
+typedef struct
+{
+    CAN_IdentifierFieldType TxId;   /*!< Identifier of the transmitted frames */
+    CAN_IdentifierFieldType RxId;   /*!< Identifier of the received frames */
+    uint8_t BlockSize;              /*!< Number of consecutive frames the sender may send
+                                         without waiting for flow control, 0 for unlimited */
+    uint8_t STmin;                  /*!< Minimum separation time requested from the sender
+                                         in ISO 15765-2 encoding: @arg 0x00 .. 0x7F: [ms]
+                                         @arg 0xF1 .. 0xF9: 100 .. 900 [us] */
+    struct {
+        XPD_HandleCallbackType Transmit;    /*!< Message transmission complete callback */
+        XPD_HandleCallbackType Receive;     /*!< Message reception complete callback */
+        XPD_HandleCallbackType Error;       /*!< Message transfer aborted callback */
+    }Callbacks;                             /*   Session Callbacks (receive the session pointer) */
+    struct {
+        const uint8_t * Buffer;             /*!< [Internal] The message to transmit */
+        uint16_t Length;                    /*!< [Internal] The message length */
+        uint16_t Index;                     /*!< [Internal] The next byte to transmit */
+        uint16_t Timer;                     /*!< [Internal] Flow control timeout or separation time [ticks] */
+        uint16_t STminTicks;                /*!< [Internal] Separation time requested by the receiver [ticks] */
+        uint8_t  BlockCount;                /*!< [Internal] Remaining frames of the block */
+        uint8_t  BlockSize;                 /*!< [Internal] Block size requested by the receiver */
+        uint8_t  SN;                        /*!< [Internal] Next sequence number */
+        volatile uint8_t State;             /*!< [Internal] Transmitter state */
+    }Tx;
+    struct {
+        uint8_t * Buffer;                   /*!< Reception buffer */
+        uint16_t Size;                      /*!< Reception buffer size */
+        uint16_t Length;                    /*!< The length of the message being or last received */
+        uint16_t Index;                     /*!< [Internal] The next byte to receive */
+        uint16_t Timer;                     /*!< [Internal] Consecutive frame timeout [ticks] */
+        uint8_t  BlockCount;                /*!< [Internal] Remaining frames of the block */
+        uint8_t  SN;                        /*!< [Internal] Next sequence number */
+        uint8_t  FlowStatus;                /*!< [Internal] Pending flow control frame status */
+        volatile uint8_t State;             /*!< [Internal] Receiver state */
+    }Rx;
+    CANTP_ErrorType Error;                  /*!< The last error of the session */
+}CANTP_SessionType;
+
+/** @brief CAN transport protocol handle structure */
+typedef struct
+{
+    CAN_HandleType *    Link;               /*!< The CAN handle with attached transmit queue */
+    CANTP_SessionType * Sessions;           /*!< The array of sessions */
+    uint8_t             SessionCount;       /*!< The number of sessions */
+    FunctionalState     Padding;            /*!< Transmit all frames with 8 data bytes */
+    uint8_t             PadValue;           /*!< The value of the padding bytes */
+    uint16_t            TickPeriod_us;      /*!< The period of @ref CANTP_vTick calls */
+    uint16_t            Timeout_ms;         /*!< The timeout of flow control, consecutive frames
+                                                 and the transmission of the last frame */
+    uint16_t            TimeoutTicks;       /*!< [Internal] The timeout converted to ticks */
+}CANTP_HandleType;
+
+/** @} */
+
+/** @defgroup CAN_TP_Exported_Functions CAN Transport Protocol Exported Functions
+ * @{ */
+XPD_ReturnType  CANTP_eInit             (CANTP_HandleType * pxTP);
+
+XPD_ReturnType  CANTP_eSend             (CANTP_HandleType * pxTP, CANTP_SessionType * pxSession,
+                                         const uint8_t * pucData, uint16_t usLength);
+void            CANTP_vAbort            (CANTP_SessionType * pxSession);
+
+void            CANTP_vReceive          (CANTP_HandleType * pxTP, const CAN_FrameType * pxFrame);
+void            CANTP_vProcess          (CANTP_HandleType * pxTP);
+void            CANTP_vTick             (CANTP_HandleType * pxTP);
+
+/**
+ * @brief Determines if the session has a message transmission in progress.
+ * @param pxSession: pointer to the CAN transport protocol session
+ * @return TRUE if the transmitter is busy, FALSE otherwise
+ */
+__STATIC_INLINE boolean_t CANTP_bTxBusy(CANTP_SessionType * pxSession)
+{
+    return pxSession->Tx.State != 0;
+}
+/** @} */
+
+/** @} */
+
+#endif /* defined(CAN) || defined(CAN1) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_CAN_TP_H_ */
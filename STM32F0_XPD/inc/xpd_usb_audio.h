@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_audio.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB Isochronous Audio Stream Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_USB_AUDIO_H_
+#define __XPD_USB_AUDIO_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_usb.h>
+#include <xpd_dma.h>
+
+#if defined(USB) || defined(USB_OTG_FS)
+
+/** @ingroup USB
+ * @defgroup USB_Audio USB Isochronous Audio Stream
+ * @brief    Asynchronous isochronous OUT audio stream played from a circular DMA ring,
+ *           with explicit rate feedback to the host
+ * @{ */
+
+/** @defgroup USB_Audio_Exported_Types USB Isochronous Audio Stream Exported Types
+ * @{ */
+
+/** @brief USB isochronous audio stream handle structure */
+typedef struct
+{
+    USB_HandleType * Link;                  /*!< The USB handle of the endpoints */
+    DMA_HandleType * DMA;                   /*!< The circular DMA stream feeding the audio interface
+                                                 (I2S / SPI / SAI) from the ring */
+    uint8_t DataEpAddress;                  /*!< Address of the isochronous OUT data endpoint */
+    uint8_t FeedbackEpAddress;              /*!< Address of the isochronous IN feedback endpoint */
+    uint8_t Refresh;                        /*!< The feedback is updated every 2^Refresh (micro)frames
+                                                 (bRefresh of the feedback endpoint descriptor) */
+    uint8_t ClockShift;                     /*!< The measured clock is 2^ClockShift times the sample rate
+                                                 (e.g. 8 when counting MCLK = 256 * Fs) */
+    uint8_t FrameSize;                      /*!< Size of an audio frame (a sample of all channels) [bytes] */
+    uint8_t TransferSize;                   /*!< Size of a DMA transfer [bytes] */
+    uint8_t CorrectionShift;                /*!< The feedback is corrected by 2^(16 - CorrectionShift)
+                                                 samples per frame for each audio frame of fill level error */
+    uint32_t SampleRate;                    /*!< Nominal sample rate [Hz] */
+    struct {
+        uint8_t * Buffer;                   /*!< Audio ring buffer, circularly read by the DMA */
+        uint16_t Size;                      /*!< Audio ring buffer size, a multiple of FrameSize [bytes] */
+        volatile uint16_t Head;             /*!< [Internal] Write index of the USB data */
+        uint16_t Read;                      /*!< [Internal] DMA read index at the last fill level check */
+        uint16_t Level;                     /*!< [Internal] Fill level at the last check, including
+                                                 the data written since [bytes] */
+    }Ring;
+    uint8_t * Packet;                       /*!< Reception buffer of a max size data packet
+                                                 (word aligned if the USB uses DMA) */
+    struct {
+        uint32_t Nominal;                   /*!< [Internal] Nominal samples per (micro)frame [16.16] */
+        uint32_t Measured;                  /*!< Measured samples per (micro)frame [16.16] */
+        uint32_t Value;                     /*!< Fill level corrected feedback [16.16] */
+        uint32_t Capture;                   /*!< [Internal] Clock capture of the last measurement */
+        uint8_t  Data[4];                   /*!< [Internal] Feedback endpoint data (word aligned for DMA) */
+        uint16_t Frames;                    /*!< [Internal] (Micro)frames since the last measurement */
+        volatile uint8_t Busy;              /*!< [Internal] Feedback transfer in progress */
+        uint8_t  Valid;                     /*!< [Internal] The clock capture is valid */
+    }Feedback;
+    uint32_t Underruns;                     /*!< Number of times the DMA passed the written data */
+    uint32_t Overruns;                      /*!< Number of packets dropped due to a full ring */
+    volatile uint8_t Active;                /*!< [Internal] The endpoints are open */
+}USBAUDIO_HandleType;
+
+/** @} */
+
+/** @defgroup USB_Audio_Exported_Functions USB Isochronous Audio Stream Exported Functions
+ * @{ */
+void            USBAUDIO_vStart         (USBAUDIO_HandleType * pxAudio);
+void            USBAUDIO_vStop          (USBAUDIO_HandleType * pxAudio);
+
+uint16_t        USBAUDIO_usFillLevel    (USBAUDIO_HandleType * pxAudio);
+
+void            USBAUDIO_vSOF           (USBAUDIO_HandleType * pxAudio, uint32_t ulClockCapture);
+
+void            USBAUDIO_vDataIn        (USBAUDIO_HandleType * pxAudio);
+void            USBAUDIO_vDataOut       (USBAUDIO_HandleType * pxAudio);
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB) || defined(USB_OTG_FS) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_USB_AUDIO_H_ */
@@ -507,19 +507,21 @@ void ADC_vIRQHandler(ADC_HandleType * pxADC)
 }
 
 /**
- * @brief Sets up and enables a DMA transfer for the ADC regular conversions.
+ * @brief Sets up and enables a DMA transfer of the given number of ADC regular conversions.
+ *        With a circular DMA the conversion data storage can hold multiple sequences.
  * @param pxADC: pointer to the ADC handle structure
  * @param pvAddress: memory address to the conversion data storage
+ * @param usLength: the number of conversions to transfer
  * @return BUSY if the DMA is used by other peripheral, OK otherwise
  */
-XPD_ReturnType ADC_eStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
+XPD_ReturnType ADC_eStartBuffer_DMA(ADC_HandleType * pxADC, void * pvAddress, uint16_t usLength)
 {
     XPD_ReturnType eResult = XPD_ERROR;
 
     {
         /* Set up DMA for transfer */
         eResult = DMA_eStart_IT(pxADC->DMA.Conversion,
-                (void *)&pxADC->Inst->DR, pvAddress, pxADC->ConversionCount);
+                (void *)&pxADC->Inst->DR, pvAddress, usLength);
 
         /* If the DMA is currently used, return with error */
         if (eResult == XPD_OK)
@@ -548,6 +550,17 @@ XPD_ReturnType ADC_eStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
     return eResult;
 }
 
+/**
+ * @brief Sets up and enables a DMA transfer for the ADC regular conversions.
+ * @param pxADC: pointer to the ADC handle structure
+ * @param pvAddress: memory address to the conversion data storage
+ * @return BUSY if the DMA is used by other peripheral, OK otherwise
+ */
+XPD_ReturnType ADC_eStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
+{
+    return ADC_eStartBuffer_DMA(pxADC, pvAddress, pxADC->ConversionCount);
+}
+
 /**
  * @brief Disables the ADC and its DMA transfer.
  * @param pxADC: pointer to the ADC handle structure
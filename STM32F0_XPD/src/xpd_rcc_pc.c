@@ -26,6 +26,7 @@
 #include <xpd_i2c.h>
 #include <xpd_pwr.h>
 #include <xpd_rtc.h>
+#include <xpd_spi.h>
 #include <xpd_tim.h>
 #include <xpd_usart.h>
 #include <xpd_usb.h>
@@ -297,6 +298,22 @@ uint32_t RTC_ulClockFreq_Hz(void)
 
 /** @} */
 
+/** @ingroup SPI_Clock_Source
+ * @defgroup SPI_Clock_Source_Exported_Functions SPI Clock Source Exported Functions
+ * @{ */
+
+/**
+ * @brief Returns the input clock frequency of the SPI.
+ * @param pxSPI: pointer to the SPI handle structure
+ * @return The clock frequency of the SPI in Hz
+ */
+uint32_t SPI_ulClockFreq_Hz(SPI_HandleType * pxSPI)
+{
+    return RCC_ulClockFreq_Hz(PCLK1);
+}
+
+/** @} */
+
 /** @ingroup TIM_Clock_Source
  * @defgroup TIM_Clock_Source_Exported_Functions TIM Clock Source Exported Functions
  * @{ */
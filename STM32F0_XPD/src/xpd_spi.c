@@ -225,6 +225,41 @@ void SPI_prvDisable(SPI_HandleType * pxSPI)
     SPI_REG_BIT(pxSPI, CR1, SPE) = 0;
 }
 
+/* Starts the slave DMA transfers on the currently selected buffer pair */
+static XPD_ReturnType SPI_prvSlaveArm(SPI_HandleType * pxSPI)
+{
+    XPD_ReturnType eResult;
+
+    /* Reception has to be ready before the first clock edge */
+    SPI_REG_BIT(pxSPI, CR2, RXDMAEN) = 1;
+
+    eResult = DMA_eStart(pxSPI->DMA.Receive, (void*)&pxSPI->Inst->DR,
+            pxSPI->Slave.RxBuffer[pxSPI->Slave.RxIndex], pxSPI->Slave.Length);
+
+    if (eResult == XPD_OK)
+    {
+        eResult = DMA_eStart(pxSPI->DMA.Transmit, (void*)&pxSPI->Inst->DR,
+                pxSPI->Slave.TxBuffer[pxSPI->Slave.TxIndex], pxSPI->Slave.Length);
+
+        if (eResult == XPD_OK)
+        {
+            /* The transmit DMA preloads the data register (and FIFO) immediately */
+            SPI_REG_BIT(pxSPI, CR2, TXDMAEN) = 1;
+
+            SPI_prvEnable(pxSPI);
+        }
+        else
+        {
+            DMA_vStop(pxSPI->DMA.Receive);
+        }
+    }
+    if (eResult != XPD_OK)
+    {
+        SPI_REG_BIT(pxSPI, CR2, RXDMAEN) = 0;
+    }
+    return eResult;
+}
+
 /** @defgroup SPI_Exported_Functions SPI Exported Functions
  * @{ */
 
@@ -251,7 +286,14 @@ void SPI_vInit(SPI_HandleType * pxSPI, const SPI_InitType * pxConfig)
     SPI_REG_BIT(pxSPI, CR1, CPHA)     = pxConfig->Clock.Phase;
     SPI_REG_BIT(pxSPI, CR1, LSBFIRST) = pxConfig->Format;
 
-    pxSPI->Inst->CR1.b.BR = pxConfig->Clock.Prescaler - 1;
+    if (pxConfig->Clock.MaxFreq_Hz != 0)
+    {
+        (void) SPI_eSetMaxFrequency(pxSPI, pxConfig->Clock.MaxFreq_Hz);
+    }
+    else
+    {
+        pxSPI->Inst->CR1.b.BR = pxConfig->Clock.Prescaler - 1;
+    }
 
 #ifdef __XPD_SPI_ERROR_DETECT
     /* Disable CRC by setting 0 length */
@@ -329,6 +371,59 @@ void SPI_vDeinit(SPI_HandleType * pxSPI)
     RCC_vClockDisable(pxSPI->CtrlPos);
 }
 
+/**
+ * @brief Calculates the smallest SCK prescaler which keeps the SCK frequency
+ *        at or below the target, based on the current peripheral clock.
+ * @param pxSPI: pointer to the SPI handle structure
+ * @param ulMaxFreq_Hz: the maximum allowed SCK frequency in Hz
+ * @return The calculated prescaler, saturated at @ref ClockDividerType::CLK_DIV256
+ */
+ClockDividerType SPI_eCalcPrescaler(SPI_HandleType * pxSPI, uint32_t ulMaxFreq_Hz)
+{
+    ClockDividerType ePrescaler = CLK_DIV256;
+
+    if (ulMaxFreq_Hz > 0)
+    {
+        /* Required division rounded up, so the target is never exceeded */
+        uint32_t ulDiv = (SPI_ulClockFreq_Hz(pxSPI) + ulMaxFreq_Hz - 1) / ulMaxFreq_Hz;
+
+        for (ePrescaler = CLK_DIV2; ePrescaler < CLK_DIV256; ePrescaler++)
+        {
+            if ((1UL << ePrescaler) >= ulDiv)
+            {
+                break;
+            }
+        }
+    }
+    return ePrescaler;
+}
+
+/**
+ * @brief Sets the fastest SCK prescaler which keeps the SCK frequency
+ *        at or below the target, based on the current peripheral clock.
+ * @note  Call this function again after the peripheral clock has been changed,
+ *        when no transfer is in progress.
+ * @param pxSPI: pointer to the SPI handle structure
+ * @param ulMaxFreq_Hz: the maximum allowed SCK frequency in Hz
+ * @return ERROR if the target is below the slowest possible SCK frequency, OK otherwise
+ */
+XPD_ReturnType SPI_eSetMaxFrequency(SPI_HandleType * pxSPI, uint32_t ulMaxFreq_Hz)
+{
+    XPD_ReturnType eResult = XPD_OK;
+    ClockDividerType ePrescaler = SPI_eCalcPrescaler(pxSPI, ulMaxFreq_Hz);
+
+    /* The slowest setting is applied even if it is still too fast */
+    if ((ulMaxFreq_Hz == 0) ||
+        ((SPI_ulClockFreq_Hz(pxSPI) >> ePrescaler) > ulMaxFreq_Hz))
+    {
+        eResult = XPD_ERROR;
+    }
+
+    pxSPI->Inst->CR1.b.BR = ePrescaler - 1;
+
+    return eResult;
+}
+
 /**
  * @brief Determines the current status of SPI peripheral.
  * @param pxSPI: pointer to the SPI handle structure
@@ -1185,6 +1280,114 @@ void SPI_vStop_DMA(SPI_HandleType * pxSPI)
     }
 }
 
+/**
+ * @brief Starts double-buffered DMA-managed slave transfers over SPI.
+ * @note  The master can clock out the served response as soon as it selects the slave,
+ *        as the transmit DMA is armed in advance. The transfers are closed by
+ *        @ref SPI_vSlaveNssHandler, which has to be called when NSS is deasserted
+ *        (e.g. from the EXTI rising edge callback of the NSS pin).
+ * @param pxSPI: pointer to the SPI handle structure
+ * @param apvTxBuffers: the two response buffers, the first one is served initially
+ * @param apvRxBuffers: the two reception buffers, the first one is filled initially
+ * @param usLength: capacity of each buffer in data transfers
+ * @return ERROR if the SPI is not in slave mode, BUSY if DMA is in use, OK if transfers are armed
+ */
+XPD_ReturnType SPI_eSlaveStart_DMA(
+        SPI_HandleType *    pxSPI,
+        void *              apvTxBuffers[2],
+        void *              apvRxBuffers[2],
+        uint16_t            usLength)
+{
+    XPD_ReturnType eResult = XPD_ERROR;
+
+    if (SPI_REG_BIT(pxSPI, CR1, MSTR) == 0)
+    {
+        pxSPI->Slave.TxBuffer[0] = apvTxBuffers[0];
+        pxSPI->Slave.TxBuffer[1] = apvTxBuffers[1];
+        pxSPI->Slave.RxBuffer[0] = apvRxBuffers[0];
+        pxSPI->Slave.RxBuffer[1] = apvRxBuffers[1];
+        pxSPI->Slave.Length   = usLength;
+        pxSPI->Slave.RxCount  = 0;
+        pxSPI->Slave.TxIndex  = 0;
+        pxSPI->Slave.RxIndex  = 0;
+        pxSPI->Slave.TxCommit = 0;
+        SPI_RESET_ERRORS(pxSPI);
+
+        /* Transfer completion is determined by NSS, not by the DMA */
+        pxSPI->DMA.Transmit->Owner = pxSPI;
+        pxSPI->DMA.Receive->Owner  = pxSPI;
+
+        eResult = SPI_prvSlaveArm(pxSPI);
+    }
+    return eResult;
+}
+
+/**
+ * @brief Marks the buffer provided by @ref SPI_pvSlaveGetResponse as loaded,
+ *        so it is served from the next slave frame on.
+ * @note  The buffer must not be modified after this call until it is returned again
+ *        by @ref SPI_pvSlaveGetResponse.
+ * @param pxSPI: pointer to the SPI handle structure
+ */
+void SPI_vSlaveCommitResponse(SPI_HandleType * pxSPI)
+{
+    pxSPI->Slave.TxCommit = 1;
+}
+
+/**
+ * @brief Closes the current double-buffered slave frame and rearms the DMAs.
+ *        The served response buffer is swapped if a new one has been committed,
+ *        otherwise the previous response is served again. The reception buffers
+ *        are swapped on each call, and the Receive callback is provided with
+ *        the completed frame.
+ * @note  This function has to be called when NSS is deasserted (e.g. EXTI rising edge).
+ * @param pxSPI: pointer to the SPI handle structure
+ */
+void SPI_vSlaveNssHandler(SPI_HandleType * pxSPI)
+{
+    uint32_t ulCR1 = pxSPI->Inst->CR1.w & ~SPI_CR1_SPE;
+    uint32_t ulCR2 = pxSPI->Inst->CR2.w & ~(SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+#ifdef __XPD_SPI_ERROR_DETECT
+    uint32_t ulCRCPR = pxSPI->Inst->CRCPR;
+#endif
+
+    /* Read the received amount before the stream is stopped */
+    pxSPI->Slave.RxCount = pxSPI->Slave.Length - DMA_usGetStatus(pxSPI->DMA.Receive);
+
+    DMA_vStop(pxSPI->DMA.Transmit);
+    DMA_vStop(pxSPI->DMA.Receive);
+
+    /* Peripheral reset drops the unsent data from the transmit buffer */
+    RCC_vReset(pxSPI->CtrlPos);
+
+#ifdef __XPD_SPI_ERROR_DETECT
+    pxSPI->Inst->CRCPR = ulCRCPR;
+#endif
+    pxSPI->Inst->CR2.w = ulCR2;
+    pxSPI->Inst->CR1.w = ulCR1;
+
+    /* Swap to the committed response */
+    if (pxSPI->Slave.TxCommit != 0)
+    {
+        pxSPI->Slave.TxCommit = 0;
+        pxSPI->Slave.TxIndex ^= 1;
+    }
+    pxSPI->Slave.RxIndex ^= 1;
+
+#ifdef __XPD_DMA_ERROR_DETECT
+    if (SPI_prvSlaveArm(pxSPI) != XPD_OK)
+    {
+        pxSPI->Errors |= SPI_ERROR_DMA;
+
+        XPD_SAFE_CALLBACK(pxSPI->Callbacks.Error, pxSPI);
+    }
+#else
+    (void) SPI_prvSlaveArm(pxSPI);
+#endif
+
+    XPD_SAFE_CALLBACK(pxSPI->Callbacks.Receive, pxSPI);
+}
+
 /** @} */
 
 /** @} */
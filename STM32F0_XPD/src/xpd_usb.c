@@ -59,6 +59,13 @@ typedef uint32_t USB_PacketAddressType;
 #define USB_EP_BDT ((USB_BufferDescriptorType *)(USB_PMAADDR + USB->BTABLE))
 #endif
 
+/* Packet memory size, the 2x16 access scheme devices have half the size */
+#ifdef USB_LPMCSR_LPMEN
+#define USB_PMA_SIZE                1024
+#else
+#define USB_PMA_SIZE                512
+#endif
+
 #define USB_RXCNT_NUM_BLOCK_Pos     10U
 #define USB_RXCNT_NUM_BLOCK_Msk     (0x1FU << USB_RXCNT_NUM_BLOCK_Pos)
 #define USB_RXCNT_BL_SIZE           0x8000
@@ -87,7 +94,11 @@ do { if (USB_REG_BIT(pxUSB,EPR[EP_ID],BIT_NAME) != 0) USB_TOGGLE(EP_ID, BIT_NAME
         (&(HANDLE)->EP.IN[(NUMBER) & 0xF]) :                            \
         (&(HANDLE)->EP.OUT[NUMBER]))
 
-#define USB_EP_DOUBLE_BUFFERED(ENDPOINT)  ((ENDPOINT)->Type == USB_EP_TYPE_ISOCHRONOUS)
+#define USB_EP_DOUBLE_BULK(ENDPOINT)      \
+    (((ENDPOINT)->Type == USB_EP_TYPE_BULK) && ((ENDPOINT)->DoubleBuffer != 0))
+
+#define USB_EP_DOUBLE_BUFFERED(ENDPOINT)  \
+    (((ENDPOINT)->Type == USB_EP_TYPE_ISOCHRONOUS) || USB_EP_DOUBLE_BULK(ENDPOINT))
 
 static const uint16_t usb_ausEpTypeRemap[4] = {
     USB_EP_CONTROL,
@@ -100,14 +111,48 @@ static const uint16_t usb_ausEpTypeRemap[4] = {
 static void USB_prvWritePMA(uint8_t * pucSrcBuf, uint16_t usPmaAddress, uint16_t usDataCount)
 {
     USB_PacketAddressType * pxDst = (USB_PacketAddressType *)USB_PMAADDR + (usPmaAddress / 2);
-    uint16_t usWCount;
+    uint16_t usWCount = usDataCount / 2;
+
+    if (((uint32_t)pucSrcBuf & 3) == 0)
+    {
+        /* Word aligned source, split each word to two halfwords */
+        const uint32_t * pulSrc = (const uint32_t *)pucSrcBuf;
+
+        for (; usWCount >= 4; usWCount -= 4, pxDst += 4, pulSrc += 2)
+        {
+            uint32_t ulW0 = pulSrc[0], ulW1 = pulSrc[1];
 
-    /* Assemble halfwords and copy them to packet memory */
-    for (usWCount = (usDataCount + 1) / 2; usWCount > 0; usWCount--)
+            pxDst[0] = (uint16_t)ulW0;
+            pxDst[1] = (uint16_t)(ulW0 >> 16);
+            pxDst[2] = (uint16_t)ulW1;
+            pxDst[3] = (uint16_t)(ulW1 >> 16);
+        }
+        pucSrcBuf = (uint8_t *)pulSrc;
+    }
+    if (((uint32_t)pucSrcBuf & 1) == 0)
     {
-        *pxDst = ((uint16_t)(pucSrcBuf[1]) << 8) | (uint16_t)(pucSrcBuf[0]);
-        pxDst++;
-        pucSrcBuf += 2;
+        /* Halfword aligned source, direct halfword access */
+        const uint16_t * pusSrc = (const uint16_t *)pucSrcBuf;
+
+        for (; usWCount > 0; usWCount--)
+        {
+            *pxDst++ = *pusSrc++;
+        }
+        pucSrcBuf = (uint8_t *)pusSrc;
+    }
+    else
+    {
+        /* Assemble halfwords and copy them to packet memory */
+        for (; usWCount > 0; usWCount--, pucSrcBuf += 2)
+        {
+            *pxDst++ = ((uint16_t)(pucSrcBuf[1]) << 8) | (uint16_t)(pucSrcBuf[0]);
+        }
+    }
+
+    /* The last, unaligned byte is written without reading past the buffer */
+    if ((usDataCount & 1) != 0)
+    {
+        *pxDst = (uint16_t)(pucSrcBuf[0]);
     }
 }
 
@@ -115,17 +160,46 @@ static void USB_prvWritePMA(uint8_t * pucSrcBuf, uint16_t usPmaAddress, uint16_t
 static void USB_prvReadPMA(uint8_t * pucDstBuf, uint16_t usPmaAddress, uint16_t usDataCount)
 {
     USB_PacketAddressType * pxSrc = (USB_PacketAddressType *)USB_PMAADDR + (usPmaAddress / 2);
-    uint16_t usWCount;
+    uint16_t usWCount = usDataCount / 2;
 
-    /* Copy each halfword into the byte buffer */
-    for (usWCount = usDataCount / 2; usWCount > 0; usWCount--)
+    if (((uint32_t)pucDstBuf & 3) == 0)
     {
-        uint16_t usData = *pxSrc;
-        *pucDstBuf = usData;
-        pucDstBuf++;
-        *pucDstBuf = usData >> 8;
-        pucDstBuf++;
-        pxSrc++;
+        /* Word aligned destination, merge two halfwords to each word */
+        uint32_t * pulDst = (uint32_t *)pucDstBuf;
+
+        for (; usWCount >= 4; usWCount -= 4, pxSrc += 4, pulDst += 2)
+        {
+            uint32_t ulW0 = (uint16_t)pxSrc[0] | ((uint32_t)(uint16_t)pxSrc[1] << 16);
+            uint32_t ulW1 = (uint16_t)pxSrc[2] | ((uint32_t)(uint16_t)pxSrc[3] << 16);
+
+            pulDst[0] = ulW0;
+            pulDst[1] = ulW1;
+        }
+        pucDstBuf = (uint8_t *)pulDst;
+    }
+    if (((uint32_t)pucDstBuf & 1) == 0)
+    {
+        /* Halfword aligned destination, direct halfword access */
+        uint16_t * pusDst = (uint16_t *)pucDstBuf;
+
+        for (; usWCount > 0; usWCount--)
+        {
+            *pusDst++ = (uint16_t)*pxSrc++;
+        }
+        pucDstBuf = (uint8_t *)pusDst;
+    }
+    else
+    {
+        /* Copy each halfword into the byte buffer */
+        for (; usWCount > 0; usWCount--)
+        {
+            uint16_t usData = *pxSrc;
+            *pucDstBuf = usData;
+            pucDstBuf++;
+            *pucDstBuf = usData >> 8;
+            pucDstBuf++;
+            pxSrc++;
+        }
     }
 
     /* The last, unaligned byte is filled if exists */
@@ -135,6 +209,22 @@ static void USB_prvReadPMA(uint8_t * pucDstBuf, uint16_t usPmaAddress, uint16_t
     }
 }
 
+/* Determines the packet memory size available for USB */
+static uint16_t USB_prvPmaSize(void)
+{
+    uint16_t usSize = USB_PMA_SIZE;
+
+#if defined(USB_LPMCSR_LPMEN) && defined(RCC_APB1ENR_CANEN)
+    /* The last 256 bytes are used by CAN when it is clocked
+     * (on 2x16 access scheme devices USB and CAN cannot be used concurrently) */
+    if ((RCC->APB1ENR.w & RCC_APB1ENR_CANEN) != 0)
+    {
+        usSize -= 256;
+    }
+#endif
+    return usSize;
+}
+
 /* Setting RX_COUNT requires special conversion */
 static uint16_t USB_prvConvertRxCount(uint16_t usRxCount)
 {
@@ -191,45 +281,101 @@ static void USB_prvReceivePacket(USB_HandleType * pxUSB, USB_EndPointHandleType
         USB_EP_BDT[pxEP->RegId].RX_COUNT = usPacketLength;
     }
 
+    /* Release the buffer if the peripheral is blocked on it (DTOG == SW_BUF) */
+    if (USB_EP_DOUBLE_BULK(pxEP) &&
+        (USB->EPR[pxEP->RegId].b.DTOG_RX == USB->EPR[pxEP->RegId].b.DTOG_TX))
+    {
+        USB_TOGGLE(pxEP->RegId, DTOG_TX);
+    }
+
     USB_EP_SET_STATUS(pxEP->RegId, RX, VALID);
 }
 
-/* Handle IN EP transfer */
-static void USB_prvTransmitPacket(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP)
+/* Write the next packet to the application's buffer of a double buffered bulk IN EP */
+static void USB_prvStageDoubleBuffer(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP)
 {
-    uint16_t usPmaAddress = USB_EP_BDT[pxEP->RegId].TX_ADDR;
+    uint16_t usPmaAddress;
     uint16_t usPacketLength = USB_prvNextPacketSize(pxEP);
 
-    if (!USB_EP_DOUBLE_BUFFERED(pxEP))
+    /* The application uses buffer 1 when SW_BUF == 1 */
+    if (USB->EPR[pxEP->RegId].b.DTOG_RX != 0)
+    {
+        USB_EP_BDT[pxEP->RegId].RX_COUNT = usPacketLength;
+        usPmaAddress = USB_EP_BDT[pxEP->RegId].RX_ADDR;
+    }
+    else
     {
         USB_EP_BDT[pxEP->RegId].TX_COUNT = usPacketLength;
+        usPmaAddress = USB_EP_BDT[pxEP->RegId].TX_ADDR;
+    }
 
-        /* Write the data to the packet memory */
-        USB_prvWritePMA(pxEP->Transfer.Data, usPmaAddress, usPacketLength);
+    /* Write the data to the packet memory */
+    USB_prvWritePMA(pxEP->Transfer.Data, usPmaAddress, usPacketLength);
+    pxEP->Transfer.Data += usPacketLength;
+    pxEP->Staged = 1;
+}
 
-        /* Validate Tx endpoint */
-        USB_EP_SET_STATUS(pxEP->RegId, TX, VALID);
+/* Pass the staged packet to the peripheral, and stage the next one */
+static void USB_prvReleaseDoubleBuffer(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP)
+{
+    /* Toggling SW_BUF makes DTOG != SW_BUF, so the peripheral sends the staged buffer.
+     * Only one buffer is passed at a time: toggling again before it is sent
+     * would make DTOG == SW_BUF, which NAKs both buffers */
+    USB_TOGGLE(pxEP->RegId, DTOG_RX);
+    pxEP->Staged = 0;
+
+    /* Prepare the next packet while this one is being sent */
+    if (pxEP->Transfer.Progress > 0)
+    {
+        USB_prvStageDoubleBuffer(pxUSB, pxEP);
     }
-    else /* Double buffered endpoint */
+}
+
+/* Handle IN EP transfer */
+static void USB_prvTransmitPacket(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP)
+{
+    if (USB_EP_DOUBLE_BULK(pxEP))
     {
-        /* Use buffer 1 when DTOG == 1 */
-        if ((USB->EPR[pxEP->RegId].w & USB_EP_DTOG_TX) != 0)
-        {
-            USB_EP_BDT[pxEP->RegId].RX_COUNT = usPacketLength;
-            usPmaAddress = USB_EP_BDT[pxEP->RegId].RX_ADDR;
-        }
-        else
+        /* Both buffers are free when the transfer is started */
+        USB_prvStageDoubleBuffer(pxUSB, pxEP);
+        USB_prvReleaseDoubleBuffer(pxUSB, pxEP);
+    }
+    else
+    {
+        uint16_t usPmaAddress = USB_EP_BDT[pxEP->RegId].TX_ADDR;
+        uint16_t usPacketLength = USB_prvNextPacketSize(pxEP);
+
+        if (!USB_EP_DOUBLE_BUFFERED(pxEP))
         {
             USB_EP_BDT[pxEP->RegId].TX_COUNT = usPacketLength;
-        }
 
-        /* Write the data to the packet memory */
-        USB_prvWritePMA(pxEP->Transfer.Data, usPmaAddress, usPacketLength);
+            /* Write the data to the packet memory */
+            USB_prvWritePMA(pxEP->Transfer.Data, usPmaAddress, usPacketLength);
 
-        /* Toggle SW_BUF flag to clear NAK status (DTOG == SW_BUF) */
-        if (USB->EPR[pxEP->RegId].b.DTOG_TX == USB->EPR[pxEP->RegId].b.DTOG_RX)
+            /* Validate Tx endpoint */
+            USB_EP_SET_STATUS(pxEP->RegId, TX, VALID);
+        }
+        else /* Double buffered endpoint */
         {
-            USB_TOGGLE(pxEP->RegId, DTOG_RX);
+            /* Use buffer 1 when DTOG == 1 */
+            if ((USB->EPR[pxEP->RegId].w & USB_EP_DTOG_TX) != 0)
+            {
+                USB_EP_BDT[pxEP->RegId].RX_COUNT = usPacketLength;
+                usPmaAddress = USB_EP_BDT[pxEP->RegId].RX_ADDR;
+            }
+            else
+            {
+                USB_EP_BDT[pxEP->RegId].TX_COUNT = usPacketLength;
+            }
+
+            /* Write the data to the packet memory */
+            USB_prvWritePMA(pxEP->Transfer.Data, usPmaAddress, usPacketLength);
+
+            /* Toggle SW_BUF flag to clear NAK status (DTOG == SW_BUF) */
+            if (USB->EPR[pxEP->RegId].b.DTOG_TX == USB->EPR[pxEP->RegId].b.DTOG_RX)
+            {
+                USB_TOGGLE(pxEP->RegId, DTOG_RX);
+            }
         }
     }
 }
@@ -410,71 +556,92 @@ void USB_vCtrlEpOpen(USB_HandleType * pxUSB)
  * @param ucEpAddress: endpoint address
  * @param eType: endpoint type
  * @param usMaxPacketSize: endpoint maximum data packet size
+ * @return ERROR if the endpoint has no packet memory allocated for this packet size,
+ *         OK if the endpoint is opened
  */
-void USB_vEpOpen(
+XPD_ReturnType USB_eEpOpen(
         USB_HandleType *    pxUSB,
         uint8_t             ucEpAddress,
         USB_EndPointType    eType,
         uint16_t            usMaxPacketSize)
 {
+    XPD_ReturnType eResult = XPD_OK;
     USB_EndPointHandleType * pxEP = USB_GET_EP_AT(pxUSB, ucEpAddress);
     uint8_t ucEpNum = ucEpAddress & 0xF;
 
-    pxEP->MaxPacketSize = usMaxPacketSize;
-    pxEP->Type          = eType;
-
-    /* Configure EP type */
-    USB->EPR[pxEP->RegId].w = (USB->EPR[pxEP->RegId].w & USB_EP_T_MASK)
-            | usb_ausEpTypeRemap[pxEP->Type];
+    /* The endpoint is left disabled if it has no packet memory,
+     * or its packets would overflow the packet memory reserved by the allocation */
+    if ((pxEP->PmaSize == 0) || (usMaxPacketSize > pxEP->PmaSize))
+    {
+        eResult = XPD_ERROR;
+    }
+    else
+    {
+        pxEP->MaxPacketSize = usMaxPacketSize;
+        pxEP->Type          = eType;
 
-    /* Configure EP address */
-    USB->EPR[pxEP->RegId].w = (USB->EPR[pxEP->RegId].w & USB_EPREG_MASK)
-            | USB_EP_CTR_RX | USB_EP_CTR_TX | ucEpNum;
+        /* Configure EP type */
+        USB->EPR[pxEP->RegId].w = (USB->EPR[pxEP->RegId].w & USB_EP_T_MASK)
+                | usb_ausEpTypeRemap[pxEP->Type];
 
-    /* Double buffer */
-    if (USB_EP_DOUBLE_BUFFERED(pxEP))
-    {
-        /* Set the endpoint as double buffered */
+        /* Configure EP address */
         USB->EPR[pxEP->RegId].w = (USB->EPR[pxEP->RegId].w & USB_EPREG_MASK)
-            | USB_EP_CTR_RX | USB_EP_CTR_TX | USB_EP_KIND;
+                | USB_EP_CTR_RX | USB_EP_CTR_TX | ucEpNum;
+
+        /* Double buffer */
+        if (USB_EP_DOUBLE_BUFFERED(pxEP))
+        {
+            /* Set the endpoint as double buffered */
+            USB->EPR[pxEP->RegId].w = (USB->EPR[pxEP->RegId].w & USB_EPREG_MASK)
+                | USB_EP_CTR_RX | USB_EP_CTR_TX | USB_EP_KIND;
 
-        /* Clear the data toggle bits for the endpoint IN/OUT */
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
+            /* Clear the data toggle bits for the endpoint IN/OUT */
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
 
-        /* Initially no data */
-        USB_EP_BDT[pxEP->RegId].TX_COUNT =
-        USB_EP_BDT[pxEP->RegId].RX_COUNT = 0;
+            /* Initially no data */
+            USB_EP_BDT[pxEP->RegId].TX_COUNT =
+            USB_EP_BDT[pxEP->RegId].RX_COUNT = 0;
 
-        if (ucEpAddress > 0x7F)
+            if (ucEpAddress > 0x7F)
+            {
+                /* DTOG == SW_BUF == 0 result in NAK */
+                USB_EP_SET_STATUS(pxEP->RegId, TX, VALID);
+                /* Disable unused direction */
+                USB_EP_SET_STATUS(pxEP->RegId, RX, DIS);
+            }
+            else
+            {
+                /* Set SW_BUF flag */
+                USB_TOGGLE(pxEP->RegId, DTOG_TX);
+
+                if (USB_EP_DOUBLE_BULK(pxEP))
+                {
+                    /* Bulk data is only accepted when a reception is started */
+                    USB_EP_SET_STATUS(pxEP->RegId, RX, NAK);
+                }
+                else
+                {
+                    /* Configure VALID status for the Endpoint */
+                    USB_EP_SET_STATUS(pxEP->RegId, RX, VALID);
+                }
+                /* Disable unused direction */
+                USB_EP_SET_STATUS(pxEP->RegId, TX, DIS);
+            }
+        }
+        /* Configure NAK status for the Endpoint */
+        else if (ucEpAddress > 0x7F)
         {
-            /* DTOG == SW_BUF == 0 result in NAK */
-            USB_EP_SET_STATUS(pxEP->RegId, TX, VALID);
-            /* Disable unused direction */
-            USB_EP_SET_STATUS(pxEP->RegId, RX, DIS);
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
+            USB_EP_SET_STATUS(pxEP->RegId, TX, NAK);
         }
         else
         {
-            /* Set SW_BUF flag */
-            USB_TOGGLE(pxEP->RegId, DTOG_TX);
-
-            /* Configure VALID status for the Endpoint */
-            USB_EP_SET_STATUS(pxEP->RegId, RX, VALID);
-            /* Disable unused direction */
-            USB_EP_SET_STATUS(pxEP->RegId, TX, DIS);
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
+            USB_EP_SET_STATUS(pxEP->RegId, RX, NAK);
         }
     }
-    /* Configure NAK status for the Endpoint */
-    else if (ucEpAddress > 0x7F)
-    {
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
-        USB_EP_SET_STATUS(pxEP->RegId, TX, NAK);
-    }
-    else
-    {
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
-        USB_EP_SET_STATUS(pxEP->RegId, RX, NAK);
-    }
+    return eResult;
 }
 
 /**
@@ -486,32 +653,36 @@ void USB_vEpClose(USB_HandleType * pxUSB, uint8_t ucEpAddress)
 {
     USB_EndPointHandleType * pxEP = USB_GET_EP_AT(pxUSB, ucEpAddress);
 
-    if (ucEpAddress > 0x7F)
+    /* Endpoints without packet memory are never opened */
+    if (pxEP->PmaSize > 0)
     {
-        /* Configure DISABLE status for the Endpoint*/
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
-        USB_EP_SET_STATUS(pxEP->RegId, TX, DIS);
+        if (ucEpAddress > 0x7F)
+        {
+            /* Configure DISABLE status for the Endpoint*/
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
+            USB_EP_SET_STATUS(pxEP->RegId, TX, DIS);
 
-        if (USB_EP_DOUBLE_BUFFERED(pxEP))
+            if (USB_EP_DOUBLE_BUFFERED(pxEP))
+            {
+                /* Disable other half of EPnR as well */
+                USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
+                USB_TOGGLE(pxEP->RegId, DTOG_RX);
+                USB_EP_SET_STATUS(pxEP->RegId, RX, DIS);
+            }
+        }
+        else
         {
-            /* Disable other half of EPnR as well */
+            /* Configure DISABLE status for the Endpoint*/
             USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
-            USB_TOGGLE(pxEP->RegId, DTOG_RX);
             USB_EP_SET_STATUS(pxEP->RegId, RX, DIS);
-        }
-    }
-    else
-    {
-        /* Configure DISABLE status for the Endpoint*/
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
-        USB_EP_SET_STATUS(pxEP->RegId, RX, DIS);
 
-        if (USB_EP_DOUBLE_BUFFERED(pxEP))
-        {
-            /* Disable other half of EPnR as well */
-            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
-            USB_TOGGLE(pxEP->RegId, DTOG_TX);
-            USB_EP_SET_STATUS(pxEP->RegId, TX, DIS);
+            if (USB_EP_DOUBLE_BUFFERED(pxEP))
+            {
+                /* Disable other half of EPnR as well */
+                USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
+                USB_TOGGLE(pxEP->RegId, DTOG_TX);
+                USB_EP_SET_STATUS(pxEP->RegId, TX, DIS);
+            }
         }
     }
 }
@@ -525,13 +696,17 @@ void USB_vEpSetStall(USB_HandleType * pxUSB, uint8_t ucEpAddress)
 {
     USB_EndPointHandleType * pxEP = USB_GET_EP_AT(pxUSB, ucEpAddress);
 
-    if (ucEpAddress > 0x7F)
-    {
-        USB_EP_SET_STATUS(pxEP->RegId, TX, STALL);
-    }
-    else
+    /* Endpoints without packet memory are never opened */
+    if (pxEP->PmaSize > 0)
     {
-        USB_EP_SET_STATUS(pxEP->RegId, RX, STALL);
+        if (ucEpAddress > 0x7F)
+        {
+            USB_EP_SET_STATUS(pxEP->RegId, TX, STALL);
+        }
+        else
+        {
+            USB_EP_SET_STATUS(pxEP->RegId, RX, STALL);
+        }
     }
 }
 
@@ -544,15 +719,19 @@ void USB_vEpClearStall(USB_HandleType * pxUSB, uint8_t ucEpAddress)
 {
     USB_EndPointHandleType * pxEP = USB_GET_EP_AT(pxUSB, ucEpAddress);
 
-    if (ucEpAddress > 0x7F)
+    /* Endpoints without packet memory are never opened */
+    if (pxEP->PmaSize > 0)
     {
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
-        USB_EP_SET_STATUS(pxEP->RegId, TX, NAK);
-    }
-    else
-    {
-        USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
-        USB_EP_SET_STATUS(pxEP->RegId, RX, VALID);
+        if (ucEpAddress > 0x7F)
+        {
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_TX);
+            USB_EP_SET_STATUS(pxEP->RegId, TX, NAK);
+        }
+        else
+        {
+            USB_TOGGLE_CLEAR(pxEP->RegId, DTOG_RX);
+            USB_EP_SET_STATUS(pxEP->RegId, RX, VALID);
+        }
     }
 }
 
@@ -562,21 +741,32 @@ void USB_vEpClearStall(USB_HandleType * pxUSB, uint8_t ucEpAddress)
  * @param ucEpAddress: endpoint address
  * @param pucData: pointer to the data buffer
  * @param usLength: amount of data bytes to transfer
+ * @return ERROR if the endpoint has no packet memory, OK if the transmission is started
  */
-void USB_vEpSend(
+XPD_ReturnType USB_eEpSend(
         USB_HandleType *    pxUSB,
         uint8_t             ucEpAddress,
         const uint8_t *     pucData,
         uint16_t            usLength)
 {
+    XPD_ReturnType eResult = XPD_OK;
     USB_EndPointHandleType * pxEP = &pxUSB->EP.IN[ucEpAddress & 0xF];
 
-    /* setup the transfer */
-    pxEP->Transfer.Data       = (uint8_t*)pucData;
-    pxEP->Transfer.Progress   = usLength;
-    pxEP->Transfer.Length     = usLength;
+    /* Endpoints without packet memory cannot be used */
+    if (pxEP->PmaSize == 0)
+    {
+        eResult = XPD_ERROR;
+    }
+    else
+    {
+        /* setup the transfer */
+        pxEP->Transfer.Data       = (uint8_t*)pucData;
+        pxEP->Transfer.Progress   = usLength;
+        pxEP->Transfer.Length     = usLength;
 
-    USB_prvTransmitPacket(pxUSB, pxEP);
+        USB_prvTransmitPacket(pxUSB, pxEP);
+    }
+    return eResult;
 }
 
 /**
@@ -585,21 +775,32 @@ void USB_vEpSend(
  * @param ucEpAddress: endpoint address
  * @param pucData: pointer to the data buffer
  * @param usLength: amount of data bytes to transfer
+ * @return ERROR if the endpoint has no packet memory, OK if the reception is started
  */
-void USB_vEpReceive(
+XPD_ReturnType USB_eEpReceive(
         USB_HandleType *    pxUSB,
         uint8_t             ucEpAddress,
         uint8_t *           pucData,
         uint16_t            usLength)
 {
+    XPD_ReturnType eResult = XPD_OK;
     USB_EndPointHandleType * pxEP = &pxUSB->EP.OUT[ucEpAddress];
 
-    /* setup transfer */
-    pxEP->Transfer.Data       = pucData;
-    pxEP->Transfer.Progress   = usLength;
-    pxEP->Transfer.Length     = 0;
+    /* Endpoints without packet memory cannot be used */
+    if (pxEP->PmaSize == 0)
+    {
+        eResult = XPD_ERROR;
+    }
+    else
+    {
+        /* setup transfer */
+        pxEP->Transfer.Data       = pucData;
+        pxEP->Transfer.Progress   = usLength;
+        pxEP->Transfer.Length     = 0;
 
-    USB_prvReceivePacket(pxUSB, pxEP);
+        USB_prvReceivePacket(pxUSB, pxEP);
+    }
+    return eResult;
 }
 
 /**
@@ -675,6 +876,7 @@ void USB_vIRQHandler(USB_HandleType * pxUSB)
             {
                 /* Get Data packet */
                 uint16_t usPmaAddress = USB_EP_BDT[usEpId].RX_ADDR;
+                uint16_t usRemaining = pxEP->Transfer.Progress;
                 usDataCount = USB_EP_BDT[usEpId].RX_COUNT & 0x3FF;
 
                 /* Clear RX complete flag */
@@ -690,8 +892,18 @@ void USB_vIRQHandler(USB_HandleType * pxUSB)
                         usDataCount  = USB_EP_BDT[usEpId].TX_COUNT & 0x3FF;
                     }
 
-                    /* Switch the reception buffer by toggling SW_BUF flag */
-                    USB_TOGGLE(usEpId, DTOG_TX);
+                    if (!USB_EP_DOUBLE_BULK(pxEP))
+                    {
+                        /* Switch the reception buffer by toggling SW_BUF flag */
+                        USB_TOGGLE(usEpId, DTOG_TX);
+                    }
+                    else if ((usDataCount == pxEP->MaxPacketSize) &&
+                             (usRemaining > 0))
+                    {
+                        /* Release the other buffer for the next packet
+                         * while this one is being read */
+                        USB_prvReceivePacket(pxUSB, pxEP);
+                    }
                 }
 
                 USB_prvReadPMA(pxEP->Transfer.Data, usPmaAddress, usDataCount);
@@ -700,8 +912,9 @@ void USB_vIRQHandler(USB_HandleType * pxUSB)
                 pxEP->Transfer.Data += usDataCount;
 
                 /* If the last packet of the data, transfer is complete
+                 * (the remaining length is taken before the next packet is requested)
                  * TODO if Length % MaxPacketSize == 0 the transfer will hang without ZLP */
-                if ((pxEP->Transfer.Progress == 0) ||
+                if ((usRemaining == 0) ||
                     (usDataCount < pxEP->MaxPacketSize))
                 {
                     /* Reception finished */
@@ -715,7 +928,7 @@ void USB_vIRQHandler(USB_HandleType * pxUSB)
                         USB_EP_SET_STATUS(0, RX, VALID);
                     }
                 }
-                else
+                else if (!USB_EP_DOUBLE_BULK(pxEP))
                 {
                     /* Continue data reception */
                     USB_prvReceivePacket(pxUSB, pxEP);
@@ -731,29 +944,46 @@ void USB_vIRQHandler(USB_HandleType * pxUSB)
             /* Clear TX complete flag */
             USB_EP_FLAG_CLEAR(usEpId, CTR_TX);
 
-            /* Double buffering */
-            if ((USB_EP_DOUBLE_BUFFERED(pxEP)) && ((usEpReg & USB_EP_DTOG_TX) == 0))
+            if (USB_EP_DOUBLE_BULK(pxEP))
             {
-                /* written from endpoint 1 buffer */
-                usDataCount = USB_EP_BDT[usEpId].RX_COUNT & 0x3FF;
+                /* The sent buffer is returned to the application (DTOG == SW_BUF) */
+                if (pxEP->Staged != 0)
+                {
+                    /* Continue with the prepared packet */
+                    USB_prvReleaseDoubleBuffer(pxUSB, pxEP);
+                }
+                else
+                {
+                    /* Transmission complete */
+                    USB_vDataInCallback(pxUSB, pxEP);
+                }
             }
             else
             {
-                /* written from endpoint 0 (Tx) buffer */
-                usDataCount = USB_EP_BDT[usEpId].TX_COUNT & 0x3FF;
-            }
-            pxEP->Transfer.Data += usDataCount;
+                /* Double buffering */
+                if ((USB_EP_DOUBLE_BUFFERED(pxEP)) && ((usEpReg & USB_EP_DTOG_TX) == 0))
+                {
+                    /* written from endpoint 1 buffer */
+                    usDataCount = USB_EP_BDT[usEpId].RX_COUNT & 0x3FF;
+                }
+                else
+                {
+                    /* written from endpoint 0 (Tx) buffer */
+                    usDataCount = USB_EP_BDT[usEpId].TX_COUNT & 0x3FF;
+                }
+                pxEP->Transfer.Data += usDataCount;
 
-            /* If the last packet of the data */
-            if (pxEP->Transfer.Progress == 0)
-            {
-                /* Transmission complete */
-                USB_vDataInCallback(pxUSB, pxEP);
-            }
-            else
-            {
-                /* Continue data transmission */
-                USB_prvTransmitPacket(pxUSB, pxEP);
+                /* If the last packet of the data */
+                if (pxEP->Transfer.Progress == 0)
+                {
+                    /* Transmission complete */
+                    USB_vDataInCallback(pxUSB, pxEP);
+                }
+                else
+                {
+                    /* Continue data transmission */
+                    USB_prvTransmitPacket(pxUSB, pxEP);
+                }
             }
         }
     }
@@ -905,30 +1135,42 @@ USB_ChargerType USB_eChargerDetect(USB_HandleType * pxUSB)
 }
 
 /**
- * @brief Configure EPnR assignment and packet memory allocation for all endpoints
- *        based on the handle's Endpoint setup.
+ * @brief Assigns the endpoint registers and allocates the packet memory for all endpoints
+ *        based on the handle's endpoint setup (types and maximum packet sizes).
+ *        The buffers are packed in endpoint number order after the buffer descriptor table.
+ *        Each endpoint keeps its reserved buffer, so endpoints can be opened and closed
+ *        at runtime (e.g. when switching alternate settings) without moving
+ *        or fragmenting the packet memory.
+ * @note  The maximum packet size of each endpoint shall be set to the largest one
+ *        of its alternate settings before the allocation. The reserved buffer size
+ *        of an endpoint never shrinks, so a smaller alternate setting that is active
+ *        at a bus reset doesn't take away space from the larger one.
  * @param pxUSB: pointer to the USB handle structure
+ * @param pxLayout: pointer to the layout report (optional, can be NULL)
+ * @return ERROR if the endpoints don't fit in the endpoint registers or the packet memory
+ *         (in this case only the control endpoint is allocated), OK otherwise
  */
-__weak void USB_vAllocateEPs(USB_HandleType * pxUSB)
+XPD_ReturnType USB_ePmaAllocate(USB_HandleType * pxUSB, USB_PmaLayoutType * pxLayout)
 {
-    XPD_ReturnType eResult = XPD_ERROR;
+    XPD_ReturnType eResult = XPD_OK;
+    USB_PmaLayoutType xLayout;
     USB_EndPointHandleType *pxEP, *pxEP2;
-    uint32_t ulEpNum;
-    uint16_t usPmaTail;
+    uint8_t  ucEpNum;
     uint8_t  ucRegId = 0;
+    uint16_t usPmaTail;
 
     /* Init endpoints structures */
-    for (ulEpNum = 0; ulEpNum < USBD_MAX_EP_COUNT; ulEpNum++)
+    for (ucEpNum = 0; ucEpNum < USBD_MAX_EP_COUNT; ucEpNum++)
     {
-        pxEP = &pxUSB->EP.OUT[ulEpNum];
-        pxEP2 = &pxUSB->EP.IN[ulEpNum];
+        pxEP = &pxUSB->EP.OUT[ucEpNum];
+        pxEP2 = &pxUSB->EP.IN[ucEpNum];
 
         /* Only consider used EPs */
-        if (pxEP->MaxPacketSize > 0)
+        if ((pxEP->MaxPacketSize > 0) || (pxEP->PmaSize > 0))
         {
             pxEP->RegId = ucRegId++;
 
-            if (pxEP2->MaxPacketSize > 0)
+            if ((pxEP2->MaxPacketSize > 0) || (pxEP2->PmaSize > 0))
             {
                 /* If IN-OUT endpoints with the same address and type
                  * are both single buffer, one EPnR can manage both */
@@ -944,83 +1186,129 @@ __weak void USB_vAllocateEPs(USB_HandleType * pxUSB)
                 }
             }
         }
-        else if (pxEP2->MaxPacketSize > 0)
+        else if ((pxEP2->MaxPacketSize > 0) || (pxEP2->PmaSize > 0))
         {
             pxEP2->RegId = ucRegId++;
         }
     }
+    xLayout.RegCount  = ucRegId;
+    xLayout.Available = USB_prvPmaSize();
 
-    /* Ensure that endpoints can be fitted in EP regs */
-    if (ucRegId < USBD_MAX_EP_COUNT)
+    /* Reserve place for BTABLE */
+    xLayout.TableSize = ucRegId * sizeof(USB_BufferDescriptorType);
+    usPmaTail = xLayout.TableSize;
+
+    /* Allocate packet memory for all endpoints (unused ones' MPS = 0) */
+    for (ucEpNum = 0; ucEpNum < USBD_MAX_EP_COUNT; ucEpNum++)
     {
-        /* Reserve place for BTABLE */
-        usPmaTail = ucRegId * sizeof(USB_BufferDescriptorType);
+        pxEP  = &pxUSB->EP.IN[ucEpNum];
+        pxEP2 = &pxUSB->EP.OUT[ucEpNum];
+
+        /* The PMA allocation must be 16 bit aligned */
+        xLayout.InSize[ucEpNum]  = (pxEP->MaxPacketSize + 1) & (~1);
+        xLayout.OutSize[ucEpNum] = (pxEP2->MaxPacketSize + 1) & (~1);
 
-        /* EP0 is half-duplex, IN and OUT can share the memory */
-        pxEP = &pxUSB->EP.IN[0];
-        USB_EP_BDT[pxEP->RegId].TX_ADDR = usPmaTail;
-        USB_EP_BDT[pxEP->RegId].RX_ADDR = usPmaTail;
-        usPmaTail += (pxEP->MaxPacketSize + 1) & (~1);
+        /* Keep the previously reserved size */
+        if (xLayout.InSize[ucEpNum] < pxEP->PmaSize)
+        {   xLayout.InSize[ucEpNum] = pxEP->PmaSize; }
+        if (xLayout.OutSize[ucEpNum] < pxEP2->PmaSize)
+        {   xLayout.OutSize[ucEpNum] = pxEP2->PmaSize; }
 
-        /* Allocate packet memory for all endpoints (unused ones' MPS = 0) */
-        for (ulEpNum = 1; ulEpNum < USBD_MAX_EP_COUNT; ulEpNum++)
+        xLayout.InAddress[ucEpNum] = usPmaTail;
+
+        if (ucEpNum == 0)
         {
-            pxEP = &pxUSB->EP.IN[ulEpNum];
-            if (pxEP->MaxPacketSize > 0)
-            {
-                /* The PMA allocation must be 16 bit aligned */
-                uint16_t usMPS = (pxEP->MaxPacketSize + 1) & (~1);
+            /* EP0 is half-duplex, IN and OUT can share the memory */
+            if (xLayout.InSize[0] < xLayout.OutSize[0])
+            {   xLayout.InSize[0] = xLayout.OutSize[0]; }
+            xLayout.OutSize[0] = xLayout.InSize[0];
+            xLayout.OutAddress[0] = usPmaTail;
+            usPmaTail += xLayout.InSize[0];
+        }
+        else
+        {
+            /* Allocate double buffer */
+            usPmaTail += xLayout.InSize[ucEpNum] * (USB_EP_DOUBLE_BUFFERED(pxEP) ? 2 : 1);
 
-                /* Set TX_ADDR or RX_ADDR depending on direction */
-                USB_EP_BDT[pxEP->RegId].TX_ADDR = usPmaTail;
-                usPmaTail += usMPS;
+            xLayout.OutAddress[ucEpNum] = usPmaTail;
+            usPmaTail += xLayout.OutSize[ucEpNum] * (USB_EP_DOUBLE_BUFFERED(pxEP2) ? 2 : 1);
+        }
+    }
+    xLayout.Used = usPmaTail;
 
-                /* Allocate double buffer */
-                if (USB_EP_DOUBLE_BUFFERED(pxEP))
+    /* Ensure that endpoints can be fitted in EP regs and the packet memory */
+    if ((xLayout.RegCount <= USBD_MAX_EP_COUNT) && (xLayout.Used <= xLayout.Available))
+    {
+        for (ucEpNum = 0; ucEpNum < USBD_MAX_EP_COUNT; ucEpNum++)
+        {
+            pxEP = &pxUSB->EP.IN[ucEpNum];
+            pxEP->PmaSize = xLayout.InSize[ucEpNum];
+            if (pxEP->PmaSize > 0)
+            {
+                /* Set TX_ADDR, and RX_ADDR as well if double buffered */
+                USB_EP_BDT[pxEP->RegId].TX_ADDR = xLayout.InAddress[ucEpNum];
+                if ((ucEpNum > 0) && USB_EP_DOUBLE_BUFFERED(pxEP))
                 {
-                    /* Set RX_ADDR or TX_ADDR as well */
-                    USB_EP_BDT[pxEP->RegId].RX_ADDR = usPmaTail;
-                    usPmaTail += usMPS;
+                    USB_EP_BDT[pxEP->RegId].RX_ADDR =
+                            xLayout.InAddress[ucEpNum] + pxEP->PmaSize;
                 }
             }
 
-            pxEP = &pxUSB->EP.OUT[ulEpNum];
-            if (pxEP->MaxPacketSize > 0)
+            pxEP = &pxUSB->EP.OUT[ucEpNum];
+            pxEP->PmaSize = xLayout.OutSize[ucEpNum];
+            if (pxEP->PmaSize > 0)
             {
-                /* The PMA allocation must be 16 bit aligned */
-                uint16_t usMPS = (pxEP->MaxPacketSize + 1) & (~1);
-
-                /* Set TX_ADDR or RX_ADDR depending on direction */
-                USB_EP_BDT[pxEP->RegId].RX_ADDR = usPmaTail;
-                usPmaTail += usMPS;
-
-                /* Allocate double buffer */
-                if (USB_EP_DOUBLE_BUFFERED(pxEP))
+                /* Set RX_ADDR, and TX_ADDR as well if double buffered */
+                USB_EP_BDT[pxEP->RegId].RX_ADDR = xLayout.OutAddress[ucEpNum];
+                if ((ucEpNum > 0) && USB_EP_DOUBLE_BUFFERED(pxEP))
                 {
-                    /* Set RX_ADDR or TX_ADDR as well */
-                    USB_EP_BDT[pxEP->RegId].TX_ADDR = usPmaTail;
-                    usPmaTail += usMPS;
+                    USB_EP_BDT[pxEP->RegId].TX_ADDR =
+                            xLayout.OutAddress[ucEpNum] + pxEP->PmaSize;
                 }
             }
         }
-
-#ifdef USB_LPMCSR_LPMEN
-        /* TODO: usPmaTail shall not exceed 1024 (or 768 if CAN is enabled) */
-#else
-        /* TODO: usPmaTail shall not exceed 512 */
-#endif
-        {
-            eResult = XPD_OK;
-        }
     }
     else
     {
         /* If the EP needs were more than what can be provided
-         * by the peripheral, return error */
+         * by the peripheral, only the control endpoint is allocated */
         eResult = XPD_ERROR;
+
+        for (ucEpNum = 1; ucEpNum < USBD_MAX_EP_COUNT; ucEpNum++)
+        {
+            /* The other endpoints have no packet memory,
+             * they are rejected by the endpoint functions */
+            pxUSB->EP.IN [ucEpNum].RegId   =
+            pxUSB->EP.OUT[ucEpNum].RegId   = USBD_MAX_EP_COUNT - 1;
+            pxUSB->EP.IN [ucEpNum].PmaSize =
+            pxUSB->EP.OUT[ucEpNum].PmaSize = 0;
+        }
+        pxUSB->EP.IN [0].RegId   =
+        pxUSB->EP.OUT[0].RegId   = 0;
+        pxUSB->EP.IN [0].PmaSize =
+        pxUSB->EP.OUT[0].PmaSize = xLayout.InSize[0];
+
+        USB_EP_BDT[0].TX_ADDR =
+        USB_EP_BDT[0].RX_ADDR = sizeof(USB_BufferDescriptorType);
     }
 
-    (void) eResult;
+    if (pxLayout != NULL)
+    {
+        *pxLayout = xLayout;
+    }
+    return eResult;
+}
+
+/**
+ * @brief Configure EPnR assignment and packet memory allocation for all endpoints
+ *        based on the handle's Endpoint setup.
+ *        The default implementation uses @ref USB_ePmaAllocate,
+ *        override it to handle the allocation result.
+ * @param pxUSB: pointer to the USB handle structure
+ */
+__weak void USB_vAllocateEPs(USB_HandleType * pxUSB)
+{
+    (void) USB_ePmaAllocate(pxUSB, NULL);
 }
 
 /** @} */
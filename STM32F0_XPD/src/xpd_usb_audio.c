@@ -0,0 +1,335 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_audio.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB Isochronous Audio Stream Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_usb_audio.h>
+#include <xpd_utils.h>
+
+#if defined(USB) || defined(USB_OTG_FS)
+
+/** @addtogroup USB_Audio
+ * @{ */
+
+/* Feedback limits relative to the nominal rate */
+#define USBAUDIO_MEASURE_TOLERANCE_SHIFT    3   /* 1/8 */
+#define USBAUDIO_CORRECTION_LIMIT           0x10000 /* 1 sample per (micro)frame */
+
+/** @defgroup USB_Audio_Private_Functions USB Isochronous Audio Stream Private Functions
+ * @{ */
+
+/**
+ * @brief Determines the ring index the DMA is reading.
+ * @param pxAudio: pointer to the USB audio stream handle
+ * @return The read index in the ring
+ */
+static uint16_t USBAUDIO_prvReadIndex(USBAUDIO_HandleType * pxAudio)
+{
+    uint16_t usRemaining = DMA_usGetStatus(pxAudio->DMA) * pxAudio->TransferSize;
+
+    if ((usRemaining == 0) || (usRemaining > pxAudio->Ring.Size))
+    {
+        usRemaining = pxAudio->Ring.Size;
+    }
+    return pxAudio->Ring.Size - usRemaining;
+}
+
+/**
+ * @brief Places the write index half of the ring ahead of the DMA.
+ * @param pxAudio: pointer to the USB audio stream handle
+ * @param usRead: the read index of the DMA
+ */
+static void USBAUDIO_prvCenterHead(USBAUDIO_HandleType * pxAudio, uint16_t usRead)
+{
+    uint16_t usHead = usRead + pxAudio->Ring.Size / 2;
+
+    usHead -= usHead % pxAudio->FrameSize;
+    if (usHead >= pxAudio->Ring.Size)
+    {
+        usHead -= pxAudio->Ring.Size;
+    }
+    pxAudio->Ring.Head  = usHead;
+    pxAudio->Ring.Read  = usRead;
+    pxAudio->Ring.Level = ((usHead >= usRead) ? 0 : pxAudio->Ring.Size) + usHead - usRead;
+}
+
+/**
+ * @brief Applies the fill level correction to the measured rate,
+ *        and encodes the feedback value for the endpoint.
+ * @param pxAudio: pointer to the USB audio stream handle
+ */
+static void USBAUDIO_prvUpdateFeedback(USBAUDIO_HandleType * pxAudio)
+{
+    uint32_t ulValue;
+    int32_t lError, lCorrection;
+
+    /* Fill level error in audio frames, the target is half of the ring */
+    lError = ((int32_t)(pxAudio->Ring.Size / 2) - (int32_t)USBAUDIO_usFillLevel(pxAudio))
+            / (int32_t)pxAudio->FrameSize;
+
+    /* Less data than the target -> request more samples */
+    lCorrection = (lError * 0x10000) / (1 << pxAudio->CorrectionShift);
+    if (lCorrection > USBAUDIO_CORRECTION_LIMIT)
+    {
+        lCorrection = USBAUDIO_CORRECTION_LIMIT;
+    }
+    else if (lCorrection < -USBAUDIO_CORRECTION_LIMIT)
+    {
+        lCorrection = -USBAUDIO_CORRECTION_LIMIT;
+    }
+    ulValue = pxAudio->Feedback.Measured + lCorrection;
+    pxAudio->Feedback.Value = ulValue;
+
+    if (pxAudio->Link->Speed == USB_SPEED_HIGH)
+    {
+        /* 16.16 format in 4 bytes */
+        pxAudio->Feedback.Data[3] = ulValue >> 24;
+    }
+    else
+    {
+        /* 10.14 format in 3 bytes */
+        ulValue >>= 2;
+    }
+    pxAudio->Feedback.Data[0] = ulValue;
+    pxAudio->Feedback.Data[1] = ulValue >> 8;
+    pxAudio->Feedback.Data[2] = ulValue >> 16;
+}
+
+/**
+ * @brief Loads the feedback endpoint with the current feedback value.
+ * @param pxAudio: pointer to the USB audio stream handle
+ */
+static void USBAUDIO_prvSendFeedback(USBAUDIO_HandleType * pxAudio)
+{
+    if (pxAudio->Feedback.Busy == 0)
+    {
+        pxAudio->Feedback.Busy = 1;
+
+        if (USB_eEpSend(pxAudio->Link, pxAudio->FeedbackEpAddress, pxAudio->Feedback.Data,
+                (pxAudio->Link->Speed == USB_SPEED_HIGH) ? 4 : 3) != XPD_OK)
+        {
+            pxAudio->Feedback.Busy = 0;
+        }
+    }
+}
+
+/** @} */
+
+/** @defgroup USB_Audio_Exported_Functions USB Isochronous Audio Stream Exported Functions
+ * @{ */
+
+/**
+ * @brief Starts the audio stream with a half filled ring of silence,
+ *        and primes the data endpoint.
+ *        Shall be called after the endpoints are opened (when the streaming
+ *        alternate setting is selected) and the circular DMA is started.
+ * @param pxAudio: pointer to the USB audio stream handle
+ */
+void USBAUDIO_vStart(USBAUDIO_HandleType * pxAudio)
+{
+    uint32_t ulFrameRate = (pxAudio->Link->Speed == USB_SPEED_HIGH) ? 8000 : 1000;
+    uint16_t usIndex;
+
+    for (usIndex = 0; usIndex < pxAudio->Ring.Size; usIndex++)
+    {
+        pxAudio->Ring.Buffer[usIndex] = 0;
+    }
+
+    /* Keep half of the ring ahead of the DMA */
+    USBAUDIO_prvCenterHead(pxAudio, USBAUDIO_prvReadIndex(pxAudio));
+
+    pxAudio->Feedback.Nominal  = ((uint64_t)pxAudio->SampleRate << 16) / ulFrameRate;
+    pxAudio->Feedback.Measured = pxAudio->Feedback.Nominal;
+    pxAudio->Feedback.Frames   = 0;
+    pxAudio->Feedback.Valid    = 0;
+    pxAudio->Feedback.Busy     = 0;
+    USBAUDIO_prvUpdateFeedback(pxAudio);
+
+    pxAudio->Underruns = 0;
+    pxAudio->Overruns  = 0;
+    pxAudio->Active    = 1;
+
+    if (USB_eEpReceive(pxAudio->Link, pxAudio->DataEpAddress, pxAudio->Packet,
+            pxAudio->Link->EP.OUT[pxAudio->DataEpAddress & 0xF].MaxPacketSize) != XPD_OK)
+    {
+        /* The stream stays inactive if the endpoint cannot receive */
+        pxAudio->Active = 0;
+    }
+}
+
+/**
+ * @brief Stops the audio stream processing.
+ *        Shall be called when the endpoints are closed.
+ * @param pxAudio: pointer to the USB audio stream handle
+ */
+void USBAUDIO_vStop(USBAUDIO_HandleType * pxAudio)
+{
+    pxAudio->Active = 0;
+    pxAudio->Feedback.Busy = 0;
+}
+
+/**
+ * @brief Determines the amount of audio data in the ring that is yet to be played.
+ *        If the DMA has read past the written data since the last check,
+ *        the write index is placed half of the ring ahead of the DMA again,
+ *        and the skipped part of the ring is filled with silence.
+ * @note  Shall be called from the USB interrupt context, at least once per ring period
+ *        (which is ensured by @ref USBAUDIO_vSOF).
+ * @param pxAudio: pointer to the USB audio stream handle
+ * @return The fill level of the ring [bytes]
+ */
+uint16_t USBAUDIO_usFillLevel(USBAUDIO_HandleType * pxAudio)
+{
+    uint16_t usRead = USBAUDIO_prvReadIndex(pxAudio);
+    uint16_t usPlayed = ((usRead >= pxAudio->Ring.Read) ? 0 : pxAudio->Ring.Size)
+            + usRead - pxAudio->Ring.Read;
+
+    if (usPlayed > pxAudio->Ring.Level)
+    {
+        uint16_t usIndex;
+
+        /* The DMA has crossed the head, it is playing stale data */
+        pxAudio->Underruns++;
+        USBAUDIO_prvCenterHead(pxAudio, usRead);
+
+        for (usIndex = usRead; usIndex != pxAudio->Ring.Head; )
+        {
+            pxAudio->Ring.Buffer[usIndex] = 0;
+
+            if (++usIndex >= pxAudio->Ring.Size)
+            {
+                usIndex = 0;
+            }
+        }
+    }
+    else
+    {
+        pxAudio->Ring.Read   = usRead;
+        pxAudio->Ring.Level -= usPlayed;
+    }
+    return pxAudio->Ring.Level;
+}
+
+/**
+ * @brief Measures the sample clock against the USB (micro)frames, and serves the
+ *        feedback endpoint. Shall be called from the USB SOF callback.
+ * @note  The sample clock (or its multiple, see ClockShift) shall be counted by a
+ *        32 bit timer, which captures its counter on SOF (e.g. TIM2 ITR1 on OTG_FS SOF).
+ * @param pxAudio: pointer to the USB audio stream handle
+ * @param ulClockCapture: the timer capture of the last SOF
+ */
+void USBAUDIO_vSOF(USBAUDIO_HandleType * pxAudio, uint32_t ulClockCapture)
+{
+    if (pxAudio->Active != 0)
+    {
+        /* Check the fill level every (micro)frame, so the DMA crossing the head is detected */
+        (void)USBAUDIO_usFillLevel(pxAudio);
+
+        if (pxAudio->Feedback.Valid == 0)
+        {
+            /* First reference point */
+            pxAudio->Feedback.Capture = ulClockCapture;
+            pxAudio->Feedback.Frames  = 0;
+            pxAudio->Feedback.Valid   = 1;
+        }
+        else if (++pxAudio->Feedback.Frames >= (1 << pxAudio->Refresh))
+        {
+            uint32_t ulClocks = ulClockCapture - pxAudio->Feedback.Capture;
+            uint32_t ulTolerance = pxAudio->Feedback.Nominal >> USBAUDIO_MEASURE_TOLERANCE_SHIFT;
+            int8_t   cShift = 16 - pxAudio->ClockShift - pxAudio->Refresh;
+
+            /* Clocks over 2^Refresh frames -> samples per frame in 16.16 */
+            ulClocks = (cShift >= 0) ? (ulClocks << cShift) : (ulClocks >> -cShift);
+
+            /* Discard measurements distorted by missed SOFs */
+            if ((ulClocks > (pxAudio->Feedback.Nominal - ulTolerance)) &&
+                (ulClocks < (pxAudio->Feedback.Nominal + ulTolerance)))
+            {
+                pxAudio->Feedback.Measured = ulClocks;
+            }
+            pxAudio->Feedback.Capture = ulClockCapture;
+            pxAudio->Feedback.Frames  = 0;
+
+            USBAUDIO_prvUpdateFeedback(pxAudio);
+        }
+
+        USBAUDIO_prvSendFeedback(pxAudio);
+    }
+}
+
+/**
+ * @brief Processes the completion of a feedback transfer.
+ *        Shall be called from the data IN callback of the feedback endpoint.
+ * @param pxAudio: pointer to the USB audio stream handle
+ */
+void USBAUDIO_vDataIn(USBAUDIO_HandleType * pxAudio)
+{
+    pxAudio->Feedback.Busy = 0;
+}
+
+/**
+ * @brief Copies the received audio packet to the ring, and primes the data endpoint again.
+ *        Shall be called from the data OUT callback of the data endpoint.
+ * @param pxAudio: pointer to the USB audio stream handle
+ */
+void USBAUDIO_vDataOut(USBAUDIO_HandleType * pxAudio)
+{
+    USB_EndPointHandleType * pxEP = &pxAudio->Link->EP.OUT[pxAudio->DataEpAddress & 0xF];
+    uint16_t usLength = pxEP->Transfer.Length;
+
+    if (pxAudio->Active != 0)
+    {
+        uint16_t usLevel = USBAUDIO_usFillLevel(pxAudio);
+        uint16_t usHead  = pxAudio->Ring.Head;
+        uint16_t usIndex;
+
+        /* Keep a frame gap, so the head doesn't reach the DMA */
+        if ((usLevel + usLength + pxAudio->FrameSize) > pxAudio->Ring.Size)
+        {
+            pxAudio->Overruns++;
+        }
+        else
+        {
+            for (usIndex = 0; usIndex < usLength; usIndex++)
+            {
+                pxAudio->Ring.Buffer[usHead] = pxAudio->Packet[usIndex];
+
+                if (++usHead >= pxAudio->Ring.Size)
+                {
+                    usHead = 0;
+                }
+            }
+            pxAudio->Ring.Head   = usHead;
+            pxAudio->Ring.Level += usLength;
+        }
+
+        if (USB_eEpReceive(pxAudio->Link, pxAudio->DataEpAddress, pxAudio->Packet,
+                pxEP->MaxPacketSize) != XPD_OK)
+        {
+            pxAudio->Active = 0;
+        }
+    }
+}
+
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB) || defined(USB_OTG_FS) */
@@ -0,0 +1,339 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_stream.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB Bulk Stream Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_usb_stream.h>
+#include <xpd_utils.h>
+
+#if defined(USB) || defined(USB_OTG_FS)
+
+/** @addtogroup USB_Stream
+ * @{ */
+
+/** @defgroup USB_Stream_Private_Functions USB Bulk Stream Private Functions
+ * @{ */
+
+/**
+ * @brief Starts the transmission of the contiguous data of the transmit ring,
+ *        if the IN endpoint is idle.
+ * @param pxStream: pointer to the USB bulk stream handle
+ */
+static void USBSTREAM_prvTxStart(USBSTREAM_HandleType * pxStream)
+{
+    uint16_t usHead = pxStream->Tx.Head;
+    uint16_t usTail = pxStream->Tx.Tail;
+
+    if ((pxStream->Active != 0) && (pxStream->Tx.Busy == 0) && (usHead != usTail))
+    {
+        /* All data that was written during the previous transfer
+         * is sent in a single transfer, up to the end of the ring */
+        pxStream->Tx.Length = ((usHead > usTail) ? usHead : pxStream->Tx.Size) - usTail;
+        pxStream->Tx.Busy = 1;
+
+        if (USB_eEpSend(pxStream->Link, pxStream->InEpAddress,
+                &pxStream->Tx.Buffer[usTail], pxStream->Tx.Length) != XPD_OK)
+        {
+            pxStream->Tx.Busy = 0;
+        }
+    }
+}
+
+/**
+ * @brief Primes the OUT endpoint with the contiguous free space of the receive ring,
+ *        if there is space for at least a max size packet.
+ * @param pxStream: pointer to the USB bulk stream handle
+ */
+static void USBSTREAM_prvRxStart(USBSTREAM_HandleType * pxStream)
+{
+    uint16_t usMPS  = pxStream->Link->EP.OUT[pxStream->OutEpAddress & 0xF].MaxPacketSize;
+    uint16_t usHead = pxStream->Rx.Head;
+    uint16_t usTail = pxStream->Rx.Tail;
+    uint16_t usFree;
+
+    if ((pxStream->Active != 0) && (pxStream->Rx.Busy == 0))
+    {
+        if (usHead < usTail)
+        {
+            /* The head may not catch up with the tail */
+            usFree = usTail - usHead - 1;
+        }
+        else if (usTail == 0)
+        {
+            /* The head may not wrap to the tail */
+            usFree = pxStream->Rx.Size - usHead - 1;
+        }
+        else if (((pxStream->Rx.Size - usHead) < usMPS) && (usTail > usMPS))
+        {
+            /* No space for a packet at the end, the valid data ends here,
+             * continue from the start of the ring */
+            pxStream->Rx.End  = usHead;
+            pxStream->Rx.Head = usHead = 0;
+            usFree = usTail - 1;
+        }
+        else
+        {
+            usFree = pxStream->Rx.Size - usHead;
+        }
+
+        /* Only whole packets can be received */
+        usFree -= usFree % usMPS;
+
+        if (usFree > 0)
+        {
+            pxStream->Rx.Busy = 1;
+
+            if (USB_eEpReceive(pxStream->Link, pxStream->OutEpAddress,
+                    &pxStream->Rx.Buffer[usHead], usFree) != XPD_OK)
+            {
+                pxStream->Rx.Busy = 0;
+            }
+        }
+    }
+}
+
+/** @} */
+
+/** @defgroup USB_Stream_Exported_Functions USB Bulk Stream Exported Functions
+ * @{ */
+
+/**
+ * @brief Resets the stream rings and primes the OUT endpoint.
+ *        Shall be called after the endpoints are opened (when the configuration is set).
+ * @param pxStream: pointer to the USB bulk stream handle
+ */
+void USBSTREAM_vStart(USBSTREAM_HandleType * pxStream)
+{
+    pxStream->Tx.Head   = 0;
+    pxStream->Tx.Tail   = 0;
+    pxStream->Tx.Length = 0;
+    pxStream->Tx.Busy   = 0;
+
+    pxStream->Rx.Head   = 0;
+    pxStream->Rx.Tail   = 0;
+    pxStream->Rx.End    = pxStream->Rx.Size;
+    pxStream->Rx.Busy   = 0;
+
+    pxStream->Active    = 1;
+
+    USBSTREAM_prvRxStart(pxStream);
+}
+
+/**
+ * @brief Stops the stream operation, the buffered data is discarded.
+ *        Shall be called when the endpoints are closed.
+ * @param pxStream: pointer to the USB bulk stream handle
+ */
+void USBSTREAM_vStop(USBSTREAM_HandleType * pxStream)
+{
+    pxStream->Active  = 0;
+    pxStream->Tx.Busy = 0;
+    pxStream->Rx.Busy = 0;
+}
+
+/**
+ * @brief Determines the free space in the transmit ring.
+ * @param pxStream: pointer to the USB bulk stream handle
+ * @return The number of bytes that can be written
+ */
+uint16_t USBSTREAM_usWritable(USBSTREAM_HandleType * pxStream)
+{
+    uint16_t usHead = pxStream->Tx.Head;
+    uint16_t usTail = pxStream->Tx.Tail;
+
+    return ((usHead >= usTail) ? pxStream->Tx.Size : 0) + usTail - usHead - 1;
+}
+
+/**
+ * @brief Determines the amount of received data in the receive ring.
+ * @param pxStream: pointer to the USB bulk stream handle
+ * @return The number of bytes that can be read
+ */
+uint16_t USBSTREAM_usReadable(USBSTREAM_HandleType * pxStream)
+{
+    uint16_t usHead = pxStream->Rx.Head;
+    uint16_t usTail = pxStream->Rx.Tail;
+
+    return (usHead >= usTail) ? (usHead - usTail) : (pxStream->Rx.End - usTail + usHead);
+}
+
+/**
+ * @brief Copies data to the transmit ring, and starts its transmission
+ *        if the IN endpoint is idle. The data written while a transfer is ongoing
+ *        is sent in the next transfer, so small writes are batched into
+ *        transfers of multiple max size packets.
+ * @param pxStream: pointer to the USB bulk stream handle
+ * @param pucData: pointer to the data to send (e.g. a section of a DMA ring)
+ * @param usLength: the length of the data
+ * @return The number of bytes written, less than the length if the ring is full
+ */
+uint16_t USBSTREAM_usWrite(
+        USBSTREAM_HandleType *  pxStream,
+        const uint8_t *         pucData,
+        uint16_t                usLength)
+{
+    uint16_t usHead = pxStream->Tx.Head;
+    uint16_t usCount;
+    uint16_t usFree = USBSTREAM_usWritable(pxStream);
+
+    if (usLength > usFree)
+    {
+        usLength = usFree;
+    }
+
+    for (usCount = 0; usCount < usLength; usCount++)
+    {
+        pxStream->Tx.Buffer[usHead] = pucData[usCount];
+
+        if (++usHead >= pxStream->Tx.Size)
+        {
+            usHead = 0;
+        }
+    }
+    pxStream->Tx.Head = usHead;
+
+    XPD_ENTER_CRITICAL(pxStream);
+
+    USBSTREAM_prvTxStart(pxStream);
+
+    XPD_EXIT_CRITICAL(pxStream);
+
+    return usLength;
+}
+
+/**
+ * @brief Copies the received data from the receive ring, and primes the OUT endpoint
+ *        if it has been waiting for free space.
+ * @param pxStream: pointer to the USB bulk stream handle
+ * @param pucData: pointer to the destination buffer
+ * @param usLength: the size of the destination buffer
+ * @return The number of bytes read
+ */
+uint16_t USBSTREAM_usRead(
+        USBSTREAM_HandleType *  pxStream,
+        uint8_t *               pucData,
+        uint16_t                usLength)
+{
+    uint16_t usCount = 0;
+
+    while (usCount < usLength)
+    {
+        uint16_t usHead = pxStream->Rx.Head;
+        uint16_t usTail = pxStream->Rx.Tail;
+        uint16_t usEnd  = (usHead >= usTail) ? usHead : pxStream->Rx.End;
+
+        if (usTail < usEnd)
+        {
+            for (; (usTail < usEnd) && (usCount < usLength); usTail++, usCount++)
+            {
+                pucData[usCount] = pxStream->Rx.Buffer[usTail];
+            }
+            pxStream->Rx.Tail = usTail;
+        }
+        else if (usHead < usTail)
+        {
+            /* Data continues at the start of the ring */
+            pxStream->Rx.Tail = 0;
+        }
+        else
+        {
+            /* No more data */
+            break;
+        }
+    }
+
+    XPD_ENTER_CRITICAL(pxStream);
+
+    USBSTREAM_prvRxStart(pxStream);
+
+    XPD_EXIT_CRITICAL(pxStream);
+
+    return usCount;
+}
+
+/**
+ * @brief Processes the completion of an IN transfer.
+ *        Shall be called from the data IN callback of the stream's IN endpoint.
+ * @param pxStream: pointer to the USB bulk stream handle
+ */
+void USBSTREAM_vDataIn(USBSTREAM_HandleType * pxStream)
+{
+    uint16_t usMPS    = pxStream->Link->EP.IN[pxStream->InEpAddress & 0xF].MaxPacketSize;
+    uint16_t usLength = pxStream->Tx.Length;
+    uint16_t usTail   = pxStream->Tx.Tail + usLength;
+
+    if (usTail >= pxStream->Tx.Size)
+    {
+        usTail = 0;
+    }
+    pxStream->Tx.Tail = usTail;
+    pxStream->Tx.Busy = 0;
+
+    if ((usLength > 0) && ((usLength % usMPS) == 0) && (usTail == pxStream->Tx.Head))
+    {
+        /* The host only completes the transfer on a short packet,
+         * send a zero length packet if no more data follows */
+        pxStream->Tx.Length = 0;
+        pxStream->Tx.Busy = 1;
+
+        if (USB_eEpSend(pxStream->Link, pxStream->InEpAddress,
+                &pxStream->Tx.Buffer[usTail], 0) != XPD_OK)
+        {
+            pxStream->Tx.Busy = 0;
+        }
+    }
+    else
+    {
+        /* Continue with the data written in the meantime */
+        USBSTREAM_prvTxStart(pxStream);
+    }
+
+    if (usLength > 0)
+    {
+        XPD_SAFE_CALLBACK(pxStream->Callbacks.Transmit, pxStream);
+    }
+}
+
+/**
+ * @brief Processes the completion of an OUT transfer, and primes the OUT endpoint again.
+ *        Shall be called from the data OUT callback of the stream's OUT endpoint.
+ * @param pxStream: pointer to the USB bulk stream handle
+ */
+void USBSTREAM_vDataOut(USBSTREAM_HandleType * pxStream)
+{
+    uint16_t usLength = pxStream->Link->EP.OUT[pxStream->OutEpAddress & 0xF].Transfer.Length;
+
+    pxStream->Rx.Head += usLength;
+    pxStream->Rx.Busy = 0;
+
+    /* Keep the endpoint receiving while there is space */
+    USBSTREAM_prvRxStart(pxStream);
+
+    if (usLength > 0)
+    {
+        XPD_SAFE_CALLBACK(pxStream->Callbacks.Receive, pxStream);
+    }
+}
+
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB) || defined(USB_OTG_FS) */
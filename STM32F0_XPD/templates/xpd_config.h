@@ -28,6 +28,7 @@
 
 /* TODO step 2: enable desired used XPD modules error handling */
 /* #define __XPD_DMA_ERROR_DETECT */
+/* #define __XPD_CAN_TIMESTAMP */      /* CAN frame timestamps, requires TTCM */
 
 /* TODO step 3: specify power supplies */
 #define VDD_VALUE_mV                   3000 /* Value of VDD in mV */
@@ -105,6 +105,22 @@ typedef struct
     USB_EndPointType    Type;           /*!< Endpoint type */
 #ifdef USB
     uint8_t             RegId;          /*!< Endpoint register ID */
+    uint8_t             DoubleBuffer;   /*!< Double buffering of a bulk endpoint,
+                                             shall be set before the packet memory allocation
+                                             (isochronous endpoints are always double buffered) */
+    uint16_t            PmaSize;        /*!< [Internal] Allocated packet memory size of a buffer */
+    uint8_t             Staged;         /*!< [Internal] A double buffered bulk IN packet is written
+                                             to the packet memory, but not yet passed to the peripheral */
+#endif
+#if defined(USB_OTG_GAHBCFG_DMAEN)
+    struct {
+        uint8_t *Buffer;                /*!< Word aligned bounce buffer for DMA transfers
+                                             of unaligned data or OUT lengths which aren't
+                                             a multiple of MaxPacketSize (optional) */
+        uint16_t Size;                  /*!< Bounce buffer size, at least MaxPacketSize */
+        uint16_t Chunk;                 /*!< [Internal] Length of the ongoing DMA transfer */
+        uint8_t  Bounced;               /*!< [Internal] The ongoing DMA transfer uses the bounce buffer */
+    }Dma;                               /*!< Endpoint DMA context */
 #endif
 }USB_EndPointHandleType;
 
@@ -124,7 +140,12 @@ typedef struct
         XPD_CtrlCallbackType   ConnectCtrl; /*!< Callback to set USB device bus line connection state */
 #endif
     }Callbacks;                                         /*   Handle Callbacks */
+#if defined(USB_OTG_GAHBCFG_DMAEN)
+    uint8_t                     Setup[3 * 8];           /*!< Setup packet buffer, DMA can store
+                                                             up to 3 back-to-back packets */
+#else
     uint8_t                     Setup[8];               /*!< Setup packet buffer */
+#endif
     struct {
         USB_EndPointHandleType  IN[USBD_MAX_EP_COUNT];  /*!< IN endpoint status */
         USB_EndPointHandleType  OUT[USBD_MAX_EP_COUNT]; /*!< OUT endpoint status */
@@ -456,6 +456,8 @@ void            ADC_vStop_IT            (ADC_HandleType * pxADC);
 void            ADC_vIRQHandler         (ADC_HandleType * pxADC);
 
 XPD_ReturnType  ADC_eStart_DMA          (ADC_HandleType * pxADC, void * pvAddress);
+XPD_ReturnType  ADC_eStartBuffer_DMA    (ADC_HandleType * pxADC, void * pvAddress,
+                                         uint16_t usLength);
 void            ADC_vStop_DMA           (ADC_HandleType * pxADC);
 
 void            ADC_vWatchdogConfig     (ADC_HandleType * pxADC, ADC_WatchdogType eWatchdog,
@@ -653,6 +655,8 @@ typedef struct
 void            ADC_vMultiModeInit          (ADC_HandleType * pxADC,
                                              const ADC_MultiModeInitType * pxConfig);
 XPD_ReturnType  ADC_eMultiModeStart_DMA     (ADC_HandleType * pxADC, void * pvAddress);
+XPD_ReturnType  ADC_eMultiModeStartBuffer_DMA(ADC_HandleType * pxADC, void * pvAddress,
+                                             uint16_t usLength);
 void            ADC_vMultiModeStop_DMA      (ADC_HandleType * pxADC);
 
 /**
@@ -230,6 +230,19 @@ uint32_t        SDADC_ulClockFreq_Hz    (void);
 
 /** @} */
 
+#elif defined(XPD_SPI_API)
+
+/** @ingroup SPI
+ * @defgroup SPI_Clock_Source SPI Clock Source
+ * @{ */
+
+/** @addtogroup SPI_Clock_Source_Exported_Functions
+ * @{ */
+uint32_t        SPI_ulClockFreq_Hz      (SPI_HandleType * pxSPI);
+/** @} */
+
+/** @} */
+
 #elif defined(XPD_TIM_API)
 
 /** @ingroup TIM
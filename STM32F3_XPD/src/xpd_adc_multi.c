@@ -0,0 +1,199 @@
+/**
+  ******************************************************************************
+  * @file    xpd_adc_multi.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers ADC Interleaved Capture Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_adc_multi.h>
+
+#ifdef ADC12_COMMON
+
+/** @addtogroup ADC_Interleaved
+ * @{ */
+
+/* Inter-sampling delay limits [ADC clock cycles] */
+#define ADCMULTI_MIN_DELAY      1
+#define ADCMULTI_MAX_DELAY      12
+
+/** @defgroup ADC_Interleaved_Private_Functions ADC Interleaved Capture Private Functions
+ * @{ */
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+
+/**
+ * @brief Splits the samples of two interleaved ADCs, two groups at a time.
+ * @param pusInput: the time ordered samples
+ * @param usLength: the number of samples per ADC
+ * @param apusOutput: the per ADC sample arrays
+ */
+static void ADCMULTI_prvDeinterleave2(const uint16_t * pusInput, uint16_t usLength,
+        uint16_t * const apusOutput[])
+{
+    uint16_t * pusA = apusOutput[0];
+    uint16_t * pusB = apusOutput[1];
+
+    for (; usLength > 1; usLength -= 2, pusInput += 4, pusA += 2, pusB += 2)
+    {
+        /* [A0 B0] [A1 B1] -> [A0 A1] [B0 B1] */
+        uint32_t ulW0 = __UNALIGNED_UINT32_READ(&pusInput[0]);
+        uint32_t ulW1 = __UNALIGNED_UINT32_READ(&pusInput[2]);
+
+        __UNALIGNED_UINT32_WRITE(pusA, __PKHBT(ulW0, ulW1, 16));
+        __UNALIGNED_UINT32_WRITE(pusB, __PKHTB(ulW1, ulW0, 16));
+    }
+    if (usLength > 0)
+    {
+        *pusA = pusInput[0];
+        *pusB = pusInput[1];
+    }
+}
+
+/**
+ * @brief Splits the samples of three interleaved ADCs, two groups at a time.
+ * @param pusInput: the time ordered samples
+ * @param usLength: the number of samples per ADC
+ * @param apusOutput: the per ADC sample arrays
+ */
+static void ADCMULTI_prvDeinterleave3(const uint16_t * pusInput, uint16_t usLength,
+        uint16_t * const apusOutput[])
+{
+    uint16_t * pusA = apusOutput[0];
+    uint16_t * pusB = apusOutput[1];
+    uint16_t * pusC = apusOutput[2];
+
+    for (; usLength > 1; usLength -= 2, pusInput += 6, pusA += 2, pusB += 2, pusC += 2)
+    {
+        /* [A0 B0] [C0 A1] [B1 C1] -> [A0 A1] [B0 B1] [C0 C1] */
+        uint32_t ulW0 = __UNALIGNED_UINT32_READ(&pusInput[0]);
+        uint32_t ulW1 = __UNALIGNED_UINT32_READ(&pusInput[2]);
+        uint32_t ulW2 = __UNALIGNED_UINT32_READ(&pusInput[4]);
+
+        __UNALIGNED_UINT32_WRITE(pusA, __PKHTB(ulW1, ulW0, 0));
+        __UNALIGNED_UINT32_WRITE(pusB, __PKHBT(ulW0 >> 16, ulW2, 16));
+        __UNALIGNED_UINT32_WRITE(pusC, __PKHTB(ulW2, ulW1, 0));
+    }
+    if (usLength > 0)
+    {
+        *pusA = pusInput[0];
+        *pusB = pusInput[1];
+        *pusC = pusInput[2];
+    }
+}
+
+#endif /* __ARM_FEATURE_DSP */
+
+/** @} */
+
+/** @defgroup ADC_Interleaved_Exported_Functions ADC Interleaved Capture Exported Functions
+ * @{ */
+
+/**
+ * @brief Configures the ADC pair for interleaved conversions with evenly spaced samples.
+ *        The ADCs shall be initialized with the same resolution (12 or 10 bits), channel
+ *        and sample time, and the common DMA shall be set up for word transfers.
+ *        Both ADCs shall be disabled.
+ * @param pxADC: pointer to the master (ADC1 or ADC3) handle structure
+ * @param ucConversionCycles: sampling time + resolution of each conversion [ADC clock cycles]
+ *        (e.g. 14 for 1.5 + 12.5)
+ */
+void ADCMULTI_vInit(ADC_HandleType * pxADC, uint8_t ucConversionCycles)
+{
+    ADC_MultiModeInitType xConfig;
+    uint8_t ucDelay = (ucConversionCycles + 1) / 2;
+
+    if (ucDelay < ADCMULTI_MIN_DELAY)
+    {
+        ucDelay = ADCMULTI_MIN_DELAY;
+    }
+    else if (ucDelay > ADCMULTI_MAX_DELAY)
+    {
+        ucDelay = ADCMULTI_MAX_DELAY;
+    }
+
+    xConfig.Mode = ADC_MULTIMODE_DUAL_INTERLEAVED;
+    xConfig.DMAAccessMode = ADC_DMAACCESSMODE_12_10_BITS;
+    xConfig.InterSamplingDelay = ucDelay;
+
+    ADC_vMultiModeInit(pxADC, &xConfig);
+}
+
+/**
+ * @brief Starts the interleaved capture into the buffer.
+ *        The ADC conversion complete callback is called when the buffer is filled.
+ * @param pxADC: pointer to the master (ADC1 or ADC3) handle structure
+ * @param pusBuffer: the word aligned capture buffer
+ * @param usSamples: the number of samples to capture, shall be a multiple of
+ *        2 (to keep the sample pairs word aligned)
+ * @return BUSY if the DMA is used by other peripheral, OK otherwise
+ */
+XPD_ReturnType ADCMULTI_eStart_DMA(ADC_HandleType * pxADC, uint16_t * pusBuffer, uint16_t usSamples)
+{
+    /* Each DMA transfer carries two samples */
+    return ADC_eMultiModeStartBuffer_DMA(pxADC, pusBuffer, usSamples / 2);
+}
+
+/**
+ * @brief Stops the interleaved capture.
+ * @param pxADC: pointer to the master (ADC1 or ADC3) handle structure
+ */
+void ADCMULTI_vStop_DMA(ADC_HandleType * pxADC)
+{
+    ADC_vMultiModeStop_DMA(pxADC);
+}
+
+/**
+ * @brief Splits the time ordered samples to per ADC (or per channel) sample arrays.
+ * @param pusInput: the time ordered samples
+ * @param usLength: the number of samples per stream
+ * @param ucStreams: the number of interleaved streams
+ * @param apusOutput: the array of the stream outputs, each usLength long
+ */
+void ADCMULTI_vDeinterleave(const uint16_t * pusInput, uint16_t usLength,
+        uint8_t ucStreams, uint16_t * const apusOutput[])
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    if (ucStreams == 2)
+    {
+        ADCMULTI_prvDeinterleave2(pusInput, usLength, apusOutput);
+    }
+    else if (ucStreams == 3)
+    {
+        ADCMULTI_prvDeinterleave3(pusInput, usLength, apusOutput);
+    }
+    else
+#endif
+    {
+        uint16_t usIndex;
+        uint8_t ucStream;
+
+        for (usIndex = 0; usIndex < usLength; usIndex++)
+        {
+            for (ucStream = 0; ucStream < ucStreams; ucStream++)
+            {
+                apusOutput[ucStream][usIndex] = *pusInput++;
+            }
+        }
+    }
+}
+
+/** @} */
+
+/** @} */
+
+#endif /* ADC12_COMMON */
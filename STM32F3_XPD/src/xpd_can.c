@@ -93,6 +93,20 @@
 #define CAN_INPUT_CLOCK_RATE    \
     (RCC_ulClockFreq_Hz(PCLK1))
 
+/* Bit timing targets of CAN_eBitrateConfig */
+#define CAN_DEFAULT_SAMPLE_POINT            875
+#define CAN_DEFAULT_SAMPLE_POINT_TOLERANCE  25
+#define CAN_DEFAULT_BITRATE_TOLERANCE       1000
+
+/* Statistics identifier table */
+#define CAN_STATS_KEY_EXT       0x80000000
+#define CAN_STATS_KEY_EMPTY     0xFFFFFFFF
+#define CAN_STATS_MAX_PROBES    8
+
+/* Frame lengths without data and bit stuffing, with interframe space [bits] */
+#define CAN_STD_FRAME_BITS      47
+#define CAN_EXT_FRAME_BITS      67
+
 /* Filter types */
 #define FILTER_SIZE_FLAG_Pos    2
 #define FILTER_SIZE_FLAG        4
@@ -125,6 +139,46 @@ __STATIC_INLINE XPD_ReturnType CAN_prvGetEmptyMailbox(CAN_HandleType * pxCAN, ui
     return eResult;
 }
 
+/**
+ * @brief Calculates the arbitration key of a frame. The key is the layout
+ *        of the identifier register, so the lower key wins the bus arbitration.
+ * @param pxFrame: pointer to the frame
+ * @return The arbitration key of the frame
+ */
+__STATIC_INLINE uint32_t CAN_prvArbitrationKey(const CAN_FrameType * pxFrame)
+{
+    uint8_t ucOffset = 3;
+
+    if ((pxFrame->Id.Type & CAN_IDTYPE_EXT_DATA) == CAN_IDTYPE_STD_DATA)
+    {
+        ucOffset = 21;
+    }
+    return (pxFrame->Id.Value << ucOffset) | (uint32_t)pxFrame->Id.Type;
+}
+
+/**
+ * @brief Puts the frame data in the selected empty transmit mailbox, and requests transmission.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ucMb: the empty mailbox index
+ * @param pxFrame: pointer to the frame to transmit
+ */
+static void CAN_prvMailboxLoad(CAN_HandleType * pxCAN, uint8_t ucMb, const CAN_FrameType * pxFrame)
+{
+    /* set up the Id */
+    pxCAN->Inst->sTxMailBox[ucMb].TIR.w = CAN_prvArbitrationKey(pxFrame);
+
+    /* set up the DLC */
+    pxCAN->Inst->sTxMailBox[ucMb].TDTR.w =
+            ((uint32_t)pxFrame->DLC << CAN_TDT0R_DLC_Pos) & CAN_TDT0R_DLC_Msk;
+
+    /* set up the data field */
+    pxCAN->Inst->sTxMailBox[ucMb].TDLR.w = pxFrame->Data.Word[0];
+    pxCAN->Inst->sTxMailBox[ucMb].TDHR.w = pxFrame->Data.Word[1];
+
+    /* request transmission */
+    CAN_REG_BIT(pxCAN,sTxMailBox[ucMb].TIR,TXRQ) = 1;
+}
+
 /**
  * @brief Puts the frame data in an empty transmit mailbox, and requests transmission.
  * @param pxCAN: pointer to the CAN handle structure
@@ -138,69 +192,632 @@ static XPD_ReturnType CAN_prvFrameTransmit(CAN_HandleType * pxCAN, CAN_FrameType
 
     if (eResult == XPD_OK)
     {
-        uint8_t ucOffset = 3;
+        CAN_prvMailboxLoad(pxCAN, pxFrame->Index, pxFrame);
+    }
+
+    return eResult;
+}
+
+/**
+ * @brief Determines the transmission order of two transmit queue entries.
+ * @param pxA: pointer to the first entry
+ * @param pxB: pointer to the second entry
+ * @return TRUE if the first entry has to be sent before the second one
+ */
+__STATIC_INLINE boolean_t CAN_prvEntryPrecedes(const CAN_TxEntryType * pxA, const CAN_TxEntryType * pxB)
+{
+    return (pxA->Key < pxB->Key) ||
+          ((pxA->Key == pxB->Key) && ((int16_t)(pxA->Seq - pxB->Seq) < 0));
+}
+
+/**
+ * @brief Masks the interrupts while the transmit queue, the transmit mailboxes
+ *        or the timestamp time base is updated. These are accessed from thread context
+ *        and from the interrupts (transmit refill, receive gateways, frame timestamps),
+ *        so the update cannot rely on the @ref XPD_ENTER_CRITICAL macro,
+ *        which is empty by default.
+ * @return The previous interrupt mask state, to be restored by @ref CAN_prvQueueUnlock
+ */
+__STATIC_INLINE uint32_t CAN_prvQueueLock(void)
+{
+    uint32_t ulPrimask = __get_PRIMASK();
+
+    __disable_irq();
+    return ulPrimask;
+}
+
+/**
+ * @brief Restores the interrupt mask state after the transmit queue or time base update.
+ * @param ulPrimask: the interrupt mask state returned by @ref CAN_prvQueueLock
+ */
+__STATIC_INLINE void CAN_prvQueueUnlock(uint32_t ulPrimask)
+{
+    __set_PRIMASK(ulPrimask);
+}
+
+/**
+ * @brief Inserts an entry to the transmit queue heap.
+ * @param pxQueue: pointer to the transmit priority queue
+ * @param pxEntry: pointer to the new entry
+ */
+static void CAN_prvHeapPush(CAN_TxQueueType * pxQueue, const CAN_TxEntryType * pxEntry)
+{
+    uint16_t usPos = pxQueue->Count++;
+
+    /* move the less urgent parents down until the entry's place is found */
+    while (usPos > 0)
+    {
+        uint16_t usParent = (usPos - 1) / 2;
 
-        /* set up the Id */
-        if ((pxFrame->Id.Type & CAN_IDTYPE_EXT_DATA) == CAN_IDTYPE_STD_DATA)
+        if (!CAN_prvEntryPrecedes(pxEntry, &pxQueue->Entries[usParent]))
         {
-            ucOffset = 21;
+            break;
         }
-        pxCAN->Inst->sTxMailBox[pxFrame->Index].TIR.w =
-                ((pxFrame->Id.Value << ucOffset) | (uint32_t)pxFrame->Id.Type);
+        pxQueue->Entries[usPos] = pxQueue->Entries[usParent];
+        usPos = usParent;
+    }
+    pxQueue->Entries[usPos] = *pxEntry;
+}
+
+/**
+ * @brief Removes the most urgent entry from the transmit queue heap.
+ * @param pxQueue: pointer to the transmit priority queue
+ * @param pxEntry: pointer to the entry to copy the removed entry to
+ */
+static void CAN_prvHeapPop(CAN_TxQueueType * pxQueue, CAN_TxEntryType * pxEntry)
+{
+    CAN_TxEntryType * pxLast;
+    uint16_t usPos = 0;
 
-        /* set up the DLC */
-        pxCAN->Inst->sTxMailBox[pxFrame->Index].TDTR.w =
-                ((uint32_t)pxFrame->DLC << CAN_TDT0R_DLC_Pos) & CAN_TDT0R_DLC_Msk;
+    *pxEntry = pxQueue->Entries[0];
+    pxLast = &pxQueue->Entries[--pxQueue->Count];
 
-        /* set up the data field */
-        pxCAN->Inst->sTxMailBox[pxFrame->Index].TDLR.w = pxFrame->Data.Word[0];
-        pxCAN->Inst->sTxMailBox[pxFrame->Index].TDHR.w = pxFrame->Data.Word[1];
+    /* move the more urgent children up until the last entry's place is found */
+    while (1)
+    {
+        uint16_t usChild = 2 * usPos + 1;
 
-        /* request transmission */
-        CAN_REG_BIT(pxCAN,sTxMailBox[pxFrame->Index].TIR,TXRQ) = 1;
+        if (usChild >= pxQueue->Count)
+        {
+            break;
+        }
+        if (((usChild + 1) < pxQueue->Count) &&
+            CAN_prvEntryPrecedes(&pxQueue->Entries[usChild + 1], &pxQueue->Entries[usChild]))
+        {
+            usChild++;
+        }
+        if (!CAN_prvEntryPrecedes(&pxQueue->Entries[usChild], pxLast))
+        {
+            break;
+        }
+        pxQueue->Entries[usPos] = pxQueue->Entries[usChild];
+        usPos = usChild;
     }
+    pxQueue->Entries[usPos] = *pxLast;
+}
 
-    return eResult;
+/**
+ * @brief Loads the empty transmit mailboxes from the transmit queue,
+ *        and aborts the least urgent mailbox if a more urgent frame is waiting.
+ * @param pxCAN: pointer to the CAN handle structure
+ */
+static void CAN_prvQueueTransmit(CAN_HandleType * pxCAN)
+{
+    CAN_TxQueueType * pxQueue = pxCAN->TxQueue;
+    uint8_t ucMb;
+
+    while ((pxQueue->Count > 0) && (CAN_prvGetEmptyMailbox(pxCAN, &ucMb) == XPD_OK))
+    {
+        uint8_t ucLoaded;
+
+        /* completion of this mailbox is not processed yet */
+        if ((pxQueue->Loaded & (1 << ucMb)) != 0)
+        {
+            break;
+        }
+
+        /* frames with identical keys are sent one at a time,
+         * as the hardware would order them by mailbox number */
+        for (ucLoaded = 0; ucLoaded < 3; ucLoaded++)
+        {
+            if (((pxQueue->Loaded & (1 << ucLoaded)) != 0) &&
+                (pxQueue->Mailbox[ucLoaded].Key == pxQueue->Entries[0].Key))
+            {
+                break;
+            }
+        }
+        if (ucLoaded < 3)
+        {
+            break;
+        }
+
+        CAN_prvHeapPop(pxQueue, &pxQueue->Mailbox[ucMb]);
+        pxQueue->Mailbox[ucMb].Frame.Index = ucMb;
+        SET_BIT(pxQueue->Loaded, 1 << ucMb);
+
+        CAN_TXFLAG_CLEAR(pxCAN, ucMb, RQCP);
+        CAN_prvMailboxLoad(pxCAN, ucMb, &pxQueue->Mailbox[ucMb].Frame);
+    }
+
+    /* all mailboxes are busy, check for priority inversion */
+    if ((pxQueue->Count > 0) && (pxQueue->Loaded == 0x7) && (pxQueue->Aborting == 0))
+    {
+        uint8_t ucLast = 0;
+
+        for (ucMb = 1; ucMb < 3; ucMb++)
+        {
+            if (CAN_prvEntryPrecedes(&pxQueue->Mailbox[ucLast], &pxQueue->Mailbox[ucMb]))
+            {
+                ucLast = ucMb;
+            }
+        }
+
+        /* abort the least urgent mailbox, it is requeued on completion */
+        if (pxQueue->Entries[0].Key < pxQueue->Mailbox[ucLast].Key)
+        {
+            SET_BIT(pxQueue->Aborting, 1 << ucLast);
+            CAN_TXFLAG_CLEAR(pxCAN, ucLast, ABRQ);
+        }
+    }
+}
+
+/**
+ * @brief Calculates the bus time of a frame without bit stuffing.
+ * @param ulIR: the identifier register of the frame's mailbox
+ * @param ulDTR: the data length and time stamp register of the frame's mailbox
+ * @return The frame length with interframe space [bits]
+ */
+static uint32_t CAN_prvFrameBits(uint32_t ulIR, uint32_t ulDTR)
+{
+    uint32_t ulBits = ((ulIR & CAN_TI0R_IDE) != 0) ? CAN_EXT_FRAME_BITS : CAN_STD_FRAME_BITS;
+    uint32_t ulBytes = ulDTR & 0xF;
+
+    /* Remote frames have no data field */
+    if ((ulIR & CAN_TI0R_RTR) != 0)
+    {
+        ulBytes = 0;
+    }
+    else if (ulBytes > 8)
+    {
+        ulBytes = 8;
+    }
+    return ulBits + 8 * ulBytes;
+}
+
+/**
+ * @brief Accounts a frame transferred on the bus in the statistics.
+ * @param pxStats: pointer to the CAN statistics
+ * @param ulIR: the identifier register of the frame's mailbox
+ * @param ulDTR: the data length and time stamp register of the frame's mailbox
+ */
+static void CAN_prvStatsFrame(CAN_StatsType * pxStats, uint32_t ulIR, uint32_t ulDTR)
+{
+    uint32_t ulKey, ulIndex;
+    uint8_t i;
+
+    if ((ulIR & CAN_TI0R_IDE) != 0)
+    {
+        ulKey = (ulIR >> 3) | CAN_STATS_KEY_EXT;
+    }
+    else
+    {
+        ulKey = ulIR >> 21;
+    }
+    pxStats->WindowBits += CAN_prvFrameBits(ulIR, ulDTR);
+
+    /* Multiplicative hashing with bounded linear probing */
+    ulIndex = (ulKey * 0x9E3779B1UL) >> 16;
+    for (i = 0; i < CAN_STATS_MAX_PROBES; i++, ulIndex++)
+    {
+        CAN_StatsEntryType * pxEntry = &pxStats->Entries[ulIndex & (pxStats->Size - 1)];
+
+        if (pxEntry->Key == CAN_STATS_KEY_EMPTY)
+        {
+            pxEntry->Key = ulKey;
+        }
+        if (pxEntry->Key == ulKey)
+        {
+            pxEntry->Frames++;
+            pxEntry->WindowFrames++;
+            return;
+        }
+    }
+    pxStats->Untracked++;
+}
+
+/**
+ * @brief Updates the bus state and error counter statistics.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @return The current value of the error status register
+ */
+static uint32_t CAN_prvStatsState(CAN_HandleType * pxCAN)
+{
+    CAN_StatsType * pxStats = pxCAN->Stats;
+    uint32_t ulESR = pxCAN->Inst->ESR.w;
+    uint8_t ucTEC = (ulESR & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+    uint8_t ucREC = (ulESR & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+    CAN_BusStateType eState;
+
+    if ((ulESR & CAN_ESR_BOFF) != 0)
+    {
+        eState = CAN_BUSSTATE_OFF;
+    }
+    else if ((ulESR & CAN_ESR_EPVF) != 0)
+    {
+        eState = CAN_BUSSTATE_PASSIVE;
+    }
+    else if ((ulESR & CAN_ESR_EWGF) != 0)
+    {
+        eState = CAN_BUSSTATE_WARNING;
+    }
+    else
+    {
+        eState = CAN_BUSSTATE_ACTIVE;
+    }
+
+    if (eState != pxStats->BusState)
+    {
+        pxStats->BusState = eState;
+        pxStats->StateTicks[eState] = pxStats->Ticks;
+        pxStats->StateChanges++;
+    }
+    if (ucTEC > pxStats->PeakTEC)
+    {
+        pxStats->PeakTEC = ucTEC;
+    }
+    if (ucREC > pxStats->PeakREC)
+    {
+        pxStats->PeakREC = ucREC;
+    }
+
+    return ulESR;
+}
+
+/**
+ * @brief Accounts a successfully transmitted mailbox in the statistics.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ucMb: the transmit mailbox index
+ */
+__STATIC_INLINE void CAN_prvStatsTransmit(CAN_HandleType * pxCAN, uint8_t ucMb)
+{
+    if (pxCAN->Stats != NULL)
+    {
+        pxCAN->Stats->TxFrames++;
+        CAN_prvStatsFrame(pxCAN->Stats,
+                pxCAN->Inst->sTxMailBox[ucMb].TIR.w, pxCAN->Inst->sTxMailBox[ucMb].TDTR.w);
+    }
+}
+
+#ifdef __XPD_CAN_TIMESTAMP
+/**
+ * @brief Extends the 16 bit time stamp of a frame to the 64 bit time base.
+ *        The result is the nearest time to the current time estimate
+ *        that matches the captured counter value.
+ *        Has to be called with the interrupts masked by @ref CAN_prvQueueLock.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ulIR: the identifier register of the frame's mailbox
+ * @param ulDTR: the data length and time stamp register of the frame's mailbox
+ * @return The start of frame time [bit times]
+ */
+static uint64_t CAN_prvTimestamp(CAN_HandleType * pxCAN, uint32_t ulIR, uint32_t ulDTR)
+{
+    CAN_TimebaseType * pxTimebase = &pxCAN->Timebase;
+    uint16_t usCapture = ulDTR >> CAN_RDT0R_TIME_Pos;
+    uint64_t ullEstimate = pxTimebase->Time;
+#ifdef DWT
+    uint32_t ulCycles = DWT->CYCCNT;
+    uint32_t ulBits = CAN_prvFrameBits(ulIR, ulDTR);
+
+    /* advance the last timestamp by the elapsed CPU time,
+     * and step back to the start of the frame */
+    ullEstimate += ((uint64_t)(ulCycles - pxTimebase->Cycles) * pxTimebase->BitsPerCycle) >> 32;
+    ullEstimate -= ulBits;
+    pxTimebase->Cycles = ulCycles - (uint32_t)(((uint64_t)ulBits * pxTimebase->CyclesPerBit) >> 16);
+#else
+    (void)ulIR;
+#endif
+    /* the signed distance resolves the counter overflows */
+    pxTimebase->Time = ullEstimate + (int16_t)(usCapture - (uint16_t)ullEstimate);
+
+    return pxTimebase->Time;
+}
+
+/**
+ * @brief Extends the time stamp of a completed transmission
+ *        and stores it as the mailbox's last transmission time.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ucMb: the transmit mailbox index [0 .. 2]
+ * @return The start of frame time [bit times]
+ */
+static uint64_t CAN_prvTxTimestamp(CAN_HandleType * pxCAN, uint8_t ucMb)
+{
+    uint32_t ulPrimask = CAN_prvQueueLock();
+    uint64_t ullTime = CAN_prvTimestamp(pxCAN,
+            pxCAN->Inst->sTxMailBox[ucMb].TIR.w, pxCAN->Inst->sTxMailBox[ucMb].TDTR.w);
+
+    pxCAN->Timebase.TxTime[ucMb] = ullTime;
+    CAN_prvQueueUnlock(ulPrimask);
+
+    return ullTime;
 }
+#endif /* __XPD_CAN_TIMESTAMP */
 
 /**
- * @brief Gets the data from the receive FIFO to the receive frame pointer of the handle
+ * @brief Gets the data from the receive FIFO to the target frame
  *        and flushes the frame from the FIFO.
  * @param pxCAN: pointer to the CAN handle structure
  * @param ucFIFONumber: the selected receive FIFO [0 .. 1]
+ * @param pxFrame: pointer to the frame to put the received frame data to
  */
-static void CAN_prvFrameReceive(CAN_HandleType * pxCAN, uint8_t ucFIFONumber)
+static void CAN_prvFrameReceive(CAN_HandleType * pxCAN, uint8_t ucFIFONumber, CAN_FrameType * pxFrame)
 {
     uint32_t ulRIR  = pxCAN->Inst->sFIFOMailBox[ucFIFONumber].RIR.w;
     uint32_t ulRDTR = pxCAN->Inst->sFIFOMailBox[ucFIFONumber].RDTR.w;
 
     /* Get the Id */
-    pxCAN->RxFrame[ucFIFONumber]->Id.Type = ulRIR & CAN_IDTYPE_EXT_RTR;
+    pxFrame->Id.Type = ulRIR & CAN_IDTYPE_EXT_RTR;
 
-    if ((pxCAN->RxFrame[ucFIFONumber]->Id.Type & CAN_IDTYPE_EXT_DATA) == CAN_IDTYPE_STD_DATA)
+    if ((pxFrame->Id.Type & CAN_IDTYPE_EXT_DATA) == CAN_IDTYPE_STD_DATA)
     {
-        pxCAN->RxFrame[ucFIFONumber]->Id.Value = ulRIR >> 21;
+        pxFrame->Id.Value = ulRIR >> 21;
     }
     else
     {
-        pxCAN->RxFrame[ucFIFONumber]->Id.Value = ulRIR >> 3;
+        pxFrame->Id.Value = ulRIR >> 3;
     }
 
     /* Get the DLC */
-    pxCAN->RxFrame[ucFIFONumber]->DLC = ulRDTR & 0xF;
+    pxFrame->DLC = ulRDTR & 0xF;
     /* Get the FMI */
-    pxCAN->RxFrame[ucFIFONumber]->Index = ulRDTR >> 4;
+    pxFrame->Index = (ulRDTR & CAN_RDT0R_FMI) >> CAN_RDT0R_FMI_Pos;
+#ifdef __XPD_CAN_TIMESTAMP
+    {
+        uint32_t ulPrimask = CAN_prvQueueLock();
+
+        pxFrame->Timestamp = CAN_prvTimestamp(pxCAN, ulRIR, ulRDTR);
+        CAN_prvQueueUnlock(ulPrimask);
+    }
+#endif
 
     /* Get the data field */
-    pxCAN->RxFrame[ucFIFONumber]->Data.Word[0] =
-            pxCAN->Inst->sFIFOMailBox[ucFIFONumber].RDLR.w;
-    pxCAN->RxFrame[ucFIFONumber]->Data.Word[1] =
-            pxCAN->Inst->sFIFOMailBox[ucFIFONumber].RDHR.w;
+    pxFrame->Data.Word[0] = pxCAN->Inst->sFIFOMailBox[ucFIFONumber].RDLR.w;
+    pxFrame->Data.Word[1] = pxCAN->Inst->sFIFOMailBox[ucFIFONumber].RDHR.w;
+
+    if (pxCAN->Stats != NULL)
+    {
+        pxCAN->Stats->RxFrames++;
+        CAN_prvStatsFrame(pxCAN->Stats, ulRIR, ulRDTR);
+    }
 
     /* Release the FIFO */
     CAN_RXFLAG_CLEAR(pxCAN, ucFIFONumber, RFOM);
 }
 
+/**
+ * @brief Moves the frame at the output of the hardware receive FIFO
+ *        into the attached software FIFO, without publishing it.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ucFIFONumber: the selected receive FIFO [0 .. 1]
+ * @param usHead: the software FIFO position to write the frame to
+ * @return The next software FIFO write position
+ */
+static uint16_t CAN_prvQueueFrame(CAN_HandleType * pxCAN, uint8_t ucFIFONumber, uint16_t usHead)
+{
+    CAN_RxQueueType * pxQueue = pxCAN->RxQueue[ucFIFONumber];
+
+    if ((uint16_t)(usHead - pxQueue->Tail) < pxQueue->Size)
+    {
+        CAN_prvFrameReceive(pxCAN, ucFIFONumber,
+                &pxQueue->Frames[usHead & (pxQueue->Size - 1)]);
+        usHead++;
+    }
+    else
+    {
+        /* Software FIFO is full, drop the frame to keep the hardware FIFO flowing */
+        CAN_RXFLAG_CLEAR(pxCAN, ucFIFONumber, RFOM);
+        pxQueue->Overruns++;
+    }
+    return usHead;
+}
+
+/**
+ * @brief Drains the hardware receive FIFO into the attached software FIFO.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ucFIFONumber: the selected receive FIFO [0 .. 1]
+ * @return TRUE if new frames are published, FALSE otherwise
+ */
+static boolean_t CAN_prvQueueReceive(CAN_HandleType * pxCAN, uint8_t ucFIFONumber)
+{
+    CAN_RxQueueType * pxQueue = pxCAN->RxQueue[ucFIFONumber];
+    uint16_t usHead = pxQueue->Head;
+    boolean_t bResult = TRUE;
+
+    /* Frames lost in hardware are only counted */
+    if (CAN_RXFLAG_STATUS(pxCAN, ucFIFONumber, FOVR) != 0)
+    {
+        CAN_RXFLAG_CLEAR(pxCAN, ucFIFONumber, FOVR);
+        pxQueue->HwOverruns++;
+    }
+
+    while ((pxCAN->Inst->RFR[ucFIFONumber].w & CAN_RF0R_FMP0) != 0)
+    {
+        usHead = CAN_prvQueueFrame(pxCAN, ucFIFONumber, usHead);
+    }
+
+    if (usHead == pxQueue->Head)
+    {
+        bResult = FALSE;
+    }
+    else
+    {
+        /* Publish the new frames at once */
+        pxQueue->Head = usHead;
+    }
+    return bResult;
+}
+
+/**
+ * @brief Forwards the frame at the output of a receive FIFO through a gateway route.
+ *        Without an attached transmit queue the frame registers are copied
+ *        directly to an empty transmit mailbox of the output controller.
+ * @param pxRoute: pointer to the matching route
+ * @param pxMailbox: pointer to the receive FIFO mailbox
+ * @param ulRIR: the identifier register of the receive FIFO mailbox
+ * @return TRUE if the frame is scheduled for transmission, FALSE if the output is full
+ */
+static boolean_t CAN_prvRouteForward(
+        CAN_RouteType *                 pxRoute,
+        CAN_FIFOMailBox_TypeDef *       pxMailbox,
+        uint32_t                        ulRIR)
+{
+    CAN_HandleType * pxOutput = pxRoute->Output;
+    uint32_t ulTIR = ulRIR & ~CAN_TI0R_TXRQ;
+    uint8_t ucOffset = ((ulRIR & CAN_RI0R_IDE) != 0) ? 3 : 21;
+    boolean_t bResult = FALSE;
+    uint8_t ucMb;
+
+    /* identifier rewrite */
+    ulTIR &= ~(pxRoute->RewriteMask << ucOffset);
+    ulTIR |= (pxRoute->RewriteValue & pxRoute->RewriteMask) << ucOffset;
+
+    if (pxOutput->TxQueue != NULL)
+    {
+        CAN_FrameType xFrame;
+
+        xFrame.Id.Type = ulTIR & CAN_IDTYPE_EXT_RTR;
+        xFrame.Id.Value = ulTIR >> ucOffset;
+        xFrame.DLC = pxMailbox->RDTR.w & 0xF;
+        xFrame.Index = 0;
+        xFrame.Data.Word[0] = pxMailbox->RDLR.w;
+        xFrame.Data.Word[1] = pxMailbox->RDHR.w;
+
+        bResult = CAN_eEnqueue(pxOutput, &xFrame) == XPD_OK;
+    }
+    else
+    {
+        /* gateways of other inputs may load the same output meanwhile */
+        uint32_t ulPrimask = CAN_prvQueueLock();
+
+        if (CAN_prvGetEmptyMailbox(pxOutput, &ucMb) == XPD_OK)
+        {
+            pxOutput->Inst->sTxMailBox[ucMb].TDTR.w = pxMailbox->RDTR.w & CAN_TDT0R_DLC;
+            pxOutput->Inst->sTxMailBox[ucMb].TDLR.w = pxMailbox->RDLR.w;
+            pxOutput->Inst->sTxMailBox[ucMb].TDHR.w = pxMailbox->RDHR.w;
+
+            /* request transmission with the identifier */
+            pxOutput->Inst->sTxMailBox[ucMb].TIR.w = ulTIR | CAN_TI0R_TXRQ;
+
+            bResult = TRUE;
+        }
+
+        CAN_prvQueueUnlock(ulPrimask);
+    }
+    return bResult;
+}
+
+/**
+ * @brief Routes the frames of a receive FIFO, and passes the frames without route
+ *        to the active local reception.
+ * @param pxGateway: pointer to the CAN gateway
+ * @param ucFIFONumber: the selected receive FIFO [0 .. 1]
+ */
+static void CAN_prvGatewayReceive(CAN_GatewayType * pxGateway, uint8_t ucFIFONumber)
+{
+    CAN_HandleType * pxCAN = pxGateway->Input;
+    CAN_FIFOMailBox_TypeDef * pxMailbox = &pxCAN->Inst->sFIFOMailBox[ucFIFONumber];
+    CAN_RxQueueType * pxQueue = pxCAN->RxQueue[ucFIFONumber];
+    uint8_t ucRecState = CAN_STATE_RECEIVE0 << ucFIFONumber;
+    uint16_t usHead = 0;
+
+    if (pxQueue != NULL)
+    {
+        usHead = pxQueue->Head;
+    }
+
+    /* Frames lost in hardware are only counted */
+    if (CAN_RXFLAG_STATUS(pxCAN, ucFIFONumber, FOVR) != 0)
+    {
+        CAN_RXFLAG_CLEAR(pxCAN, ucFIFONumber, FOVR);
+        if (pxQueue != NULL)
+        {
+            pxQueue->HwOverruns++;
+        }
+    }
+
+    while ((pxCAN->Inst->RFR[ucFIFONumber].w & CAN_RF0R_FMP0) != 0)
+    {
+        uint32_t ulRIR = pxMailbox->RIR.w;
+        uint8_t i;
+
+        for (i = 0; i < pxGateway->RouteCount; i++)
+        {
+            CAN_RouteType * pxRoute = &pxGateway->Routes[i];
+
+            if ((ulRIR & pxRoute->KeyMask) == pxRoute->Key)
+            {
+                if (CAN_prvRouteForward(pxRoute, pxMailbox, ulRIR))
+                {
+                    pxRoute->Forwarded++;
+                }
+                else
+                {
+                    pxRoute->Dropped++;
+                }
+                break;
+            }
+        }
+
+        if (i < pxGateway->RouteCount)
+        { /* Forwarded or dropped */ }
+        else if (pxQueue != NULL)
+        {
+            pxGateway->Local++;
+            usHead = CAN_prvQueueFrame(pxCAN, ucFIFONumber, usHead);
+            continue;
+        }
+        else if ((pxCAN->State & ucRecState) != 0)
+        {
+            pxGateway->Local++;
+
+            /* the receive handler completes the single frame reception,
+             * the gateway keeps the interrupt enabled */
+            if (ucFIFONumber == 0)
+            {
+                CAN_vIRQHandlerRX0(pxCAN);
+            }
+            else
+            {
+                CAN_vIRQHandlerRX1(pxCAN);
+            }
+            SET_BIT(pxCAN->Inst->IER.w,
+                    (ucFIFONumber == 0) ? CAN_RECEIVE0_INTERRUPTS : CAN_RECEIVE1_INTERRUPTS);
+            continue;
+        }
+        else
+        {
+            pxGateway->Discarded++;
+        }
+
+        if (pxCAN->Stats != NULL)
+        {
+            pxCAN->Stats->RxFrames++;
+            CAN_prvStatsFrame(pxCAN->Stats, ulRIR, pxMailbox->RDTR.w);
+        }
+
+        /* Release the FIFO */
+        CAN_RXFLAG_CLEAR(pxCAN, ucFIFONumber, RFOM);
+    }
+
+    if ((pxQueue != NULL) && (usHead != pxQueue->Head))
+    {
+        /* Publish the new frames at once */
+        pxQueue->Head = usHead;
+
+        /* receive complete callback for the batch */
+        XPD_SAFE_CALLBACK(pxCAN->Callbacks.Receive[ucFIFONumber], pxCAN);
+    }
+}
+
 /**
  * @brief Resets the receive filter bank configurations for the CAN peripheral.
  * @param pxCAN: pointer to the CAN handle structure
@@ -215,11 +832,87 @@ __STATIC_INLINE void CAN_prvFilterReset(CAN_HandleType * pxCAN)
     if (pxCAN->Inst != CAN3)
 #endif /* CAN3 */
     {
-        RCC_vClockEnable(RCC_POS_CAN1);
+        RCC_vClockEnable(RCC_POS_CAN1);
+    }
+#endif /* CAN2 */
+
+    CLEAR_BIT(CAN_MASTER(pxCAN)->FA1R, ulMask << ucFBOffset);
+}
+
+/**
+ * @brief Counts the set bits of a word.
+ * @param ulValue: the input word
+ * @return The number of set bits
+ */
+__STATIC_INLINE uint32_t CAN_prvBitCount(uint32_t ulValue)
+{
+    ulValue = ulValue - ((ulValue >> 1) & 0x55555555);
+    ulValue = (ulValue & 0x33333333) + ((ulValue >> 2) & 0x33333333);
+    ulValue = (ulValue + (ulValue >> 4)) & 0x0F0F0F0F;
+    return (ulValue * 0x01010101) >> 24;
+}
+
+/**
+ * @brief Calculates the number of identifiers accepted by a mask filter.
+ * @param ulMask: the identifier mask of the filter
+ * @param ulIdMask: the identifier field mask
+ * @return The number of accepted identifiers
+ */
+__STATIC_INLINE uint32_t CAN_prvFilterSpan(uint32_t ulMask, uint32_t ulIdMask)
+{
+    return 1UL << CAN_prvBitCount(ulIdMask & ~ulMask);
+}
+
+/**
+ * @brief Moves all identifiers of a solver group to another group.
+ * @param pxSolver: pointer to the filter solver structure
+ * @param usInto: the leader index of the remaining group
+ * @param usFrom: the leader index of the dissolved group
+ */
+static void CAN_prvGroupJoin(CAN_FilterSolverType * pxSolver, uint16_t usInto, uint16_t usFrom)
+{
+    CAN_FilterGroupType * axGroups = pxSolver->Groups;
+    uint16_t i;
+
+    for (i = 0; i < pxSolver->IdCount; i++)
+    {
+        if (axGroups[i].Leader == usFrom)
+        {
+            axGroups[i].Leader = usInto;
+        }
+    }
+    axGroups[usInto].Count += axGroups[usFrom].Count;
+}
+
+/**
+ * @brief Determines the rank order of two bit timing candidates.
+ * @param pxA: pointer to the first candidate
+ * @param pxB: pointer to the second candidate
+ * @param usSamplePoint: the target sample point
+ * @return TRUE if the first candidate ranks higher than the second one
+ */
+static boolean_t CAN_prvTimingPrecedes(
+        const CAN_TimingCandidateType * pxA,
+        const CAN_TimingCandidateType * pxB,
+        uint16_t                        usSamplePoint)
+{
+    int32_t lErrA = (pxA->BitrateError < 0) ? -pxA->BitrateError : pxA->BitrateError;
+    int32_t lErrB = (pxB->BitrateError < 0) ? -pxB->BitrateError : pxB->BitrateError;
+
+    if (lErrA != lErrB)
+    {
+        return lErrA < lErrB;
+    }
+    else if (pxA->OscTolerance != pxB->OscTolerance)
+    {
+        return pxA->OscTolerance > pxB->OscTolerance;
+    }
+    else
+    {
+        lErrA = (int32_t)pxA->SamplePoint - (int32_t)usSamplePoint;
+        lErrB = (int32_t)pxB->SamplePoint - (int32_t)usSamplePoint;
+        return ((lErrA < 0) ? -lErrA : lErrA) < ((lErrB < 0) ? -lErrB : lErrB);
     }
-#endif /* CAN2 */
-
-    CLEAR_BIT(CAN_MASTER(pxCAN)->FA1R, ulMask << ucFBOffset);
 }
 
 /** @} */
@@ -228,44 +921,138 @@ __STATIC_INLINE void CAN_prvFilterReset(CAN_HandleType * pxCAN)
  * @{ */
 
 /**
- * @brief Attempts to calculate a possible bit timing setup based on the desired bitrate.
+ * @brief Calculates a bit timing setup for the desired bitrate with the current
+ *        peripheral input clock. The sample point is targeted at 87.5% of the bit time,
+ *        the best candidate of @ref CAN_ucTimingSearch is selected.
  * @param ulBitrate: The target bitrate to achieve
- * @param pxConfig: The timing configuration to set
+ * @param pxTimingConfig: The timing configuration to set
  * @return OK if successful, ERROR if bitrate is not supported
  */
 XPD_ReturnType CAN_eBitrateConfig(uint32_t ulBitrate, CAN_TimingConfigType * pxTimingConfig)
 {
     XPD_ReturnType eResult = XPD_ERROR;
+    CAN_TimingCandidateType xCandidate;
+    CAN_TimingTargetType xTarget;
 
-    /* 1bit: 4TQ <= 1TQ sync + 2-16TQ BS1 + 1-8TQ BS2 <= 25TQ */
-    uint32_t ulOvers = CAN_INPUT_CLOCK_RATE / ulBitrate;
-    uint32_t ulTQs = 25;
-    uint32_t ulPres;
+    xTarget.ClockFreq_Hz         = CAN_INPUT_CLOCK_RATE;
+    xTarget.Bitrate              = ulBitrate;
+    xTarget.BitrateTolerance     = CAN_DEFAULT_BITRATE_TOLERANCE;
+    xTarget.SamplePoint          = CAN_DEFAULT_SAMPLE_POINT;
+    xTarget.SamplePointTolerance = CAN_DEFAULT_SAMPLE_POINT_TOLERANCE;
 
-    do{
-        ulPres = ulOvers / ulTQs;
+    if (CAN_ucTimingSearch(&xTarget, &xCandidate, 1) > 0)
+    {
+        *pxTimingConfig = xCandidate.Timing;
+        eResult = XPD_OK;
+    }
 
-        /* Division without remainder? */
-        if (0 == (ulOvers - (ulTQs * ulPres)))
-        {
-            ulTQs--;
-            pxTimingConfig->Prescaler = ulPres;
+    return eResult;
+}
 
-            /* Sample point is set at 2/3 of the bit */
-            pxTimingConfig->BS1 = (ulTQs * 2) / 3;
-            pxTimingConfig->BS2 = ulTQs - pxTimingConfig->BS1;
+/**
+ * @brief Searches the bit timing configurations over all prescaler, BS1 and BS2 values
+ *        which meet the bitrate and sample point targets. The candidates are ranked by
+ *        the bitrate error, then by the oscillator tolerance, then by the sample point error.
+ *        The SJW is set to the largest value permitted by the phase segments.
+ * @note  This function has no peripheral dependency, therefore it can be used
+ *        for host-side timing table generation as well.
+ * @param pxTarget: pointer to the bit timing target
+ * @param axCandidates: array to fill with the best candidates, in decreasing rank
+ * @param ucMaxCount: the number of elements in the candidate array
+ * @return The number of candidates found, at most ucMaxCount
+ */
+uint8_t CAN_ucTimingSearch(
+        const CAN_TimingTargetType *    pxTarget,
+        CAN_TimingCandidateType         axCandidates[],
+        uint8_t                         ucMaxCount)
+{
+    uint8_t ucCount = 0;
+    uint32_t ulTQs;
 
-            /* Simply set to valid value, not part of the bitrate */
-            pxTimingConfig->SJW = 4;
+    /* 1bit: 1TQ sync + 1-16TQ BS1 + 1-8TQ BS2 */
+    for (ulTQs = 25; (ulTQs >= 4) && (pxTarget->Bitrate > 0); ulTQs--)
+    {
+        CAN_TimingCandidateType xCand;
+        uint32_t ulPres, ulBS1, ulBS2, ulPhase, ulSJW, ulOscTol;
+        uint64_t ullActual;
+        int32_t lSPError;
+        uint8_t i;
+
+        /* Nearest prescaler for the bit length */
+        ulPres = (pxTarget->ClockFreq_Hz + (pxTarget->Bitrate * ulTQs) / 2)
+               / (pxTarget->Bitrate * ulTQs);
+        if ((ulPres < 1) || (ulPres > 1024))
+        {
+            continue;
+        }
+        ullActual = (uint64_t)ulPres * ulTQs * pxTarget->Bitrate;
+        xCand.BitrateError = (int32_t)((((int64_t)pxTarget->ClockFreq_Hz - (int64_t)ullActual)
+                * 1000000) / (int64_t)ullActual);
+        if ((uint32_t)((xCand.BitrateError < 0) ? -xCand.BitrateError : xCand.BitrateError)
+                > pxTarget->BitrateTolerance)
+        {
+            continue;
+        }
 
-            eResult = XPD_OK;
-            break;
+        /* Nearest BS2 for the sample point */
+        ulBS2 = (ulTQs * (1000 - pxTarget->SamplePoint) + 500) / 1000;
+        if (ulBS2 < 1)
+        {
+            ulBS2 = 1;
+        }
+        else if (ulBS2 > 8)
+        {
+            ulBS2 = 8;
+        }
+        ulBS1 = ulTQs - 1 - ulBS2;
+        if (ulBS1 > 16)
+        {
+            continue;
+        }
+        xCand.SamplePoint = ((1 + ulBS1) * 1000) / ulTQs;
+        lSPError = (int32_t)xCand.SamplePoint - (int32_t)pxTarget->SamplePoint;
+        if ((uint32_t)((lSPError < 0) ? -lSPError : lSPError) > pxTarget->SamplePointTolerance)
+        {
+            continue;
         }
-        ulTQs--;
 
-    }while (ulTQs >= 4);
+        /* SJW cannot exceed the phase segments */
+        ulPhase = (ulBS1 < ulBS2) ? ulBS1 : ulBS2;
+        ulSJW = (ulPhase < 4) ? ulPhase : 4;
 
-    return eResult;
+        /* Oscillator tolerance: resynchronization and error flag conditions of ISO 11898-1 */
+        ulOscTol = (ulSJW * 1000000) / (20 * ulTQs);
+        ulPhase  = (ulPhase * 1000000) / (2 * (13 * ulTQs - ulBS2));
+        xCand.OscTolerance = (ulPhase < ulOscTol) ? ulPhase : ulOscTol;
+
+        xCand.Timing.Prescaler = ulPres;
+        xCand.Timing.BS1       = ulBS1;
+        xCand.Timing.BS2       = ulBS2;
+        xCand.Timing.SJW       = ulSJW;
+
+        /* Insert to the ranked list */
+        for (i = ucCount; i > 0; i--)
+        {
+            if (!CAN_prvTimingPrecedes(&xCand, &axCandidates[i - 1], pxTarget->SamplePoint))
+            {
+                break;
+            }
+            if (i < ucMaxCount)
+            {
+                axCandidates[i] = axCandidates[i - 1];
+            }
+        }
+        if (i < ucMaxCount)
+        {
+            axCandidates[i] = xCand;
+            if (ucCount < ucMaxCount)
+            {
+                ucCount++;
+            }
+        }
+    }
+
+    return ucCount;
 }
 
 /** @defgroup CAN_Exported_Functions_State CAN State Management Functions
@@ -291,6 +1078,9 @@ XPD_ReturnType CAN_eInit(CAN_HandleType * pxCAN, const CAN_InitType * pxConfig)
 
     /* reset operation state */
     pxCAN->State = 0;
+    pxCAN->RxQueue[0] = pxCAN->RxQueue[1] = NULL;
+    pxCAN->TxQueue = NULL;
+    pxCAN->Stats = NULL;
 
     /* Dependencies initialization */
     XPD_SAFE_CALLBACK(pxCAN->Callbacks.DepInit, pxCAN);
@@ -322,6 +1112,9 @@ XPD_ReturnType CAN_eInit(CAN_HandleType * pxCAN, const CAN_InitType * pxConfig)
         eResult = XPD_eWaitForMatch(&pxCAN->Inst->MSR.w,
                 CAN_MSR_INAK, 0, &ulTimeout);
     }
+#ifdef __XPD_CAN_TIMESTAMP
+    CAN_vTimestampStart(pxCAN);
+#endif
 
     return eResult;
 }
@@ -409,9 +1202,272 @@ void CAN_vIRQHandlerSCE(CAN_HandleType * pxCAN)
         /* Clear error interrupt flag */
         CAN_FLAG_CLEAR(pxCAN, ERRI);
 
+        if (pxCAN->Stats != NULL)
+        {
+            uint32_t ulLEC = (CAN_prvStatsState(pxCAN) & CAN_ESR_LEC) >> CAN_ESR_LEC_Pos;
+
+            /* 7 is only set by software */
+            if ((ulLEC != 0) && (ulLEC != 7))
+            {
+                pxCAN->Stats->Errors[ulLEC]++;
+                pxCAN->Stats->WindowErrors++;
+            }
+        }
+
         /* call error callback function if interrupt is not by state change */
         XPD_SAFE_CALLBACK(pxCAN->Callbacks.Error, pxCAN);
+
+        /* clear the accounted error code after the callback had access to it */
+        if (pxCAN->Stats != NULL)
+        {
+            pxCAN->Inst->ESR.b.LEC = 0;
+        }
+    }
+}
+
+/**
+ * @brief Starts collecting bus statistics from the interrupt handlers.
+ *        The SCE interrupt is enabled for error accounting.
+ * @note  The Entries, Size, WindowTicks, TickPeriod_us and Bitrate fields
+ *        of the statistics have to be set beforehand.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pxStats: pointer to the CAN statistics
+ */
+void CAN_vStatsStart(CAN_HandleType * pxCAN, CAN_StatsType * pxStats)
+{
+    uint16_t i;
+
+    for (i = 0; i < pxStats->Size; i++)
+    {
+        pxStats->Entries[i].Key          = CAN_STATS_KEY_EMPTY;
+        pxStats->Entries[i].Frames       = 0;
+        pxStats->Entries[i].WindowFrames = 0;
+        pxStats->Entries[i].Rate         = 0;
+    }
+    for (i = 0; i < 8; i++)
+    {
+        pxStats->Errors[i] = 0;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        pxStats->StateTicks[i] = 0;
+    }
+    pxStats->Ticks          = 0;
+    pxStats->RxFrames       = 0;
+    pxStats->TxFrames       = 0;
+    pxStats->Untracked      = 0;
+    pxStats->BusLoad        = 0;
+    pxStats->PeakBusLoad    = 0;
+    pxStats->PeakErrorBurst = 0;
+    pxStats->StateChanges   = 0;
+    pxStats->TEC            = 0;
+    pxStats->REC            = 0;
+    pxStats->PeakTEC        = 0;
+    pxStats->PeakREC        = 0;
+    pxStats->BusState       = CAN_BUSSTATE_ACTIVE;
+    pxStats->WindowBits     = 0;
+    pxStats->WindowErrors   = 0;
+    pxStats->WindowTimer    = pxStats->WindowTicks;
+
+    /* The bus time of a window per mille */
+    pxStats->WindowCapacity = ((uint64_t)pxStats->Bitrate * pxStats->WindowTicks
+            * pxStats->TickPeriod_us) / 1000000000;
+    if (pxStats->WindowCapacity == 0)
+    {
+        pxStats->WindowCapacity = 1;
+    }
+
+    pxCAN->Stats = pxStats;
+
+    SET_BIT(pxCAN->Inst->IER.w, CAN_IER_ERRIE |
+            CAN_IER_BOFIE | CAN_IER_EPVIE | CAN_IER_EWGIE | CAN_IER_LECIE);
+}
+
+/**
+ * @brief Stops collecting bus statistics.
+ * @param pxCAN: pointer to the CAN handle structure
+ */
+void CAN_vStatsStop(CAN_HandleType * pxCAN)
+{
+    uint32_t ulIEs = CAN_IER_ERRIE;
+
+#ifdef __XPD_CAN_ERROR_DETECT
+    /* error interrupts are still used by ongoing transfers */
+    if (pxCAN->State == 0)
+#endif
+    {
+        ulIEs |= CAN_IER_BOFIE | CAN_IER_EPVIE | CAN_IER_EWGIE | CAN_IER_LECIE;
+    }
+    CLEAR_BIT(pxCAN->Inst->IER.w, ulIEs);
+
+    pxCAN->Stats = NULL;
+}
+
+/**
+ * @brief Advances the statistics time by one tick, tracks the bus state,
+ *        and evaluates the measurement window when it is completed.
+ *        Call this function periodically with TickPeriod_us period, e.g. from a TIM Update callback.
+ * @param pxCAN: pointer to the CAN handle structure
+ */
+void CAN_vStatsTick(CAN_HandleType * pxCAN)
+{
+    CAN_StatsType * pxStats = pxCAN->Stats;
+
+    if (pxStats != NULL)
+    {
+        uint32_t ulESR;
+
+        pxStats->Ticks++;
+        ulESR = CAN_prvStatsState(pxCAN);
+
+        if (--pxStats->WindowTimer == 0)
+        {
+            uint32_t ulLoad = pxStats->WindowBits / pxStats->WindowCapacity;
+            uint16_t i;
+
+            pxStats->WindowBits  = 0;
+            pxStats->WindowTimer = pxStats->WindowTicks;
+
+            pxStats->BusLoad = (ulLoad > 1000) ? 1000 : ulLoad;
+            if (pxStats->BusLoad > pxStats->PeakBusLoad)
+            {
+                pxStats->PeakBusLoad = pxStats->BusLoad;
+            }
+            if (pxStats->WindowErrors > pxStats->PeakErrorBurst)
+            {
+                pxStats->PeakErrorBurst = pxStats->WindowErrors;
+            }
+            pxStats->WindowErrors = 0;
+
+            pxStats->TEC = (ulESR & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+            pxStats->REC = (ulESR & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+
+            /* Frame rates of the completed window */
+            for (i = 0; i < pxStats->Size; i++)
+            {
+                pxStats->Entries[i].Rate         = pxStats->Entries[i].WindowFrames;
+                pxStats->Entries[i].WindowFrames = 0;
+            }
+        }
+    }
+}
+
+#ifdef __XPD_CAN_TIMESTAMP
+/**
+ * @brief Restarts the frame timestamp extension with the current bit timing.
+ *        The CPU cycle counter is enabled for the correlation when present.
+ *        Called by @ref CAN_eInit, call it again when the core clock is changed.
+ * @param pxCAN: pointer to the CAN handle structure
+ */
+void CAN_vTimestampStart(CAN_HandleType * pxCAN)
+{
+    CAN_TimebaseType * pxTimebase = &pxCAN->Timebase;
+    uint8_t ucMb;
+
+    pxTimebase->Time = 0;
+    for (ucMb = 0; ucMb < 3; ucMb++)
+    {
+        pxTimebase->TxTime[ucMb] = 0;
+    }
+#ifdef DWT
+    {
+        /* Bit time in CAN input clock cycles */
+        uint64_t ullClocksPerBit = (uint64_t)(pxCAN->Inst->BTR.b.BRP + 1)
+                * (pxCAN->Inst->BTR.b.TS1 + pxCAN->Inst->BTR.b.TS2 + 3);
+        uint32_t ulCAN_Hz  = CAN_INPUT_CLOCK_RATE;
+        uint32_t ulCore_Hz = RCC_ulClockFreq_Hz(HCLK);
+
+        pxTimebase->CyclesPerBit = ((uint64_t)ulCore_Hz * ullClocksPerBit << 16) / ulCAN_Hz;
+        pxTimebase->BitsPerCycle = ((uint64_t)ulCAN_Hz << 32) / (ulCore_Hz * ullClocksPerBit);
+
+        /* enable the CPU cycle counter */
+        CoreDebug->DEMCR.b.TRCENA = 1;
+        DWT->CTRL.b.CYCCNTENA = 1;
+        pxTimebase->Cycles = DWT->CYCCNT;
+    }
+#endif
+}
+#endif
+
+#if defined(__XPD_CAN_TIMESTAMP) && defined(DWT)
+/**
+ * @brief Estimates the current time of the frame timestamp base from the CPU cycle counter,
+ *        and updates the time base reference with it.
+ * @note  The time base has to be updated by a frame or by this function
+ *        at least once per CPU cycle counter overflow period.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @return The current time [bit times]
+ */
+uint64_t CAN_ullTimestampNow(CAN_HandleType * pxCAN)
+{
+    CAN_TimebaseType * pxTimebase = &pxCAN->Timebase;
+    uint32_t ulCycles, ulPrimask;
+    uint64_t ullTime;
+
+    ulPrimask = CAN_prvQueueLock();
+
+    ulCycles = DWT->CYCCNT;
+    ullTime = pxTimebase->Time + (((uint64_t)(ulCycles - pxTimebase->Cycles)
+            * pxTimebase->BitsPerCycle) >> 32);
+    pxTimebase->Time   = ullTime;
+    pxTimebase->Cycles = ulCycles;
+
+    CAN_prvQueueUnlock(ulPrimask);
+
+    return ullTime;
+}
+
+/**
+ * @brief Converts a frame timestamp to the corresponding CPU cycle counter value.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ullTimestamp: the frame timestamp [bit times]
+ * @return The CPU cycle counter value at the timestamp
+ */
+uint32_t CAN_ulTimestampToCycles(CAN_HandleType * pxCAN, uint64_t ullTimestamp)
+{
+    CAN_TimebaseType * pxTimebase = &pxCAN->Timebase;
+    uint32_t ulPrimask = CAN_prvQueueLock();
+    int64_t llBits = (int64_t)(ullTimestamp - pxTimebase->Time);
+    uint32_t ulCycles = pxTimebase->Cycles;
+
+    CAN_prvQueueUnlock(ulPrimask);
+
+    return ulCycles + (uint32_t)((llBits * (int64_t)pxTimebase->CyclesPerBit) >> 16);
+}
+#endif
+
+/**
+ * @brief Finds the statistics entry of an identifier.
+ * @param pxStats: pointer to the CAN statistics
+ * @param pxId: pointer to the identifier
+ * @return Pointer to the identifier's entry, or NULL if the identifier isn't tracked
+ */
+CAN_StatsEntryType * CAN_pxStatsLookup(CAN_StatsType * pxStats, const CAN_IdentifierFieldType * pxId)
+{
+    uint32_t ulKey = pxId->Value;
+    uint32_t ulIndex;
+    uint8_t i;
+
+    if ((pxId->Type & CAN_IDTYPE_EXT_DATA) != 0)
+    {
+        ulKey |= CAN_STATS_KEY_EXT;
+    }
+
+    ulIndex = (ulKey * 0x9E3779B1UL) >> 16;
+    for (i = 0; i < CAN_STATS_MAX_PROBES; i++, ulIndex++)
+    {
+        CAN_StatsEntryType * pxEntry = &pxStats->Entries[ulIndex & (pxStats->Size - 1)];
+
+        if (pxEntry->Key == ulKey)
+        {
+            return pxEntry;
+        }
+        else if (pxEntry->Key == CAN_STATS_KEY_EMPTY)
+        {
+            break;
+        }
     }
+    return NULL;
 }
 
 /** @} */
@@ -470,45 +1526,204 @@ XPD_ReturnType CAN_eSend(
 
         (void)CAN_prvFrameTransmit(pxCAN, pxFrame);
 
-        /* convert to TXOK flag for mailbox */
-        ulTXOK = CAN_TSR_TXOK0 << (pxFrame->Index * 8);
+        /* convert to TXOK flag for mailbox */
+        ulTXOK = CAN_TSR_TXOK0 << (pxFrame->Index * 8);
+
+        /* wait for TXOK with the remaining time */
+        eResult = XPD_eWaitForMatch(&pxCAN->Inst->TSR.w, ulTXOK, ulTXOK, &ulTimeout);
+
+        /* Abort frame if transmission has timed out */
+        if (eResult != XPD_OK)
+        {
+            CAN_TXFLAG_CLEAR(pxCAN, pxFrame->Index, ABRQ);
+        }
+#ifdef __XPD_CAN_TIMESTAMP
+        else
+        {
+            pxFrame->Timestamp = CAN_prvTxTimestamp(pxCAN, pxFrame->Index);
+        }
+#endif
+    }
+
+    return eResult;
+}
+
+/**
+ * @brief Sets up a frame transmission and produces completion callback using the interrupt stack.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pxFrame: pointer to the frame to transmit
+ * @return BUSY if no empty mailbox was available, OK if frame is set for transmission
+ */
+XPD_ReturnType CAN_eSend_IT(
+        CAN_HandleType *    pxCAN,
+        CAN_FrameType *     pxFrame)
+{
+    XPD_ReturnType eResult;
+
+    eResult = CAN_prvFrameTransmit(pxCAN, pxFrame);
+
+    if (eResult == XPD_OK)
+    {
+        SET_BIT(pxCAN->Inst->IER.w, CAN_ERROR_INTERRUPTS | CAN_TRANSMIT_INTERRUPTS);
+
+        /* state bit is set for the transmit mailbox */
+        SET_BIT(pxCAN->State, 1 << pxFrame->Index);
+    }
+
+    return eResult;
+}
+
+/**
+ * @brief Starts interrupt-driven transmission from a priority queue.
+ *        The queued frames are loaded to the transmit mailboxes in identifier priority
+ *        order, and a pending mailbox is aborted and requeued when a more urgent frame
+ *        is waiting for transmission. Frames with identical identifiers are
+ *        sent in the order of enqueueing.
+ * @note  The Entries and Size fields of the queue have to be set beforehand.
+ *        The TXFP setting must be disabled, and the mailboxes must not be used
+ *        through other transmit functions while the queue is attached.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pxQueue: pointer to the transmit priority queue
+ * @return BUSY if interrupt-driven transmission is already in progress, OK otherwise
+ */
+XPD_ReturnType CAN_eTransmitQueue_IT(
+        CAN_HandleType *    pxCAN,
+        CAN_TxQueueType *   pxQueue)
+{
+    XPD_ReturnType eResult = XPD_BUSY;
+
+    if ((pxCAN->State & CAN_STATE_TRANSMIT) == 0)
+    {
+        /* the queue owns all mailboxes */
+        SET_BIT(pxCAN->State, CAN_STATE_TRANSMIT);
+
+        pxQueue->Count       = 0;
+        pxQueue->NextSeq     = 0;
+        pxQueue->Loaded      = 0;
+        pxQueue->Aborting    = 0;
+        pxQueue->Preemptions = 0;
+        pxQueue->Failures    = 0;
+        pxCAN->TxQueue = pxQueue;
+
+        SET_BIT(pxCAN->Inst->IER.w, CAN_ERROR_INTERRUPTS | CAN_TRANSMIT_INTERRUPTS);
+
+        eResult = XPD_OK;
+    }
+    return eResult;
+}
+
+/**
+ * @brief Stops the priority queue transmission, aborting the pending mailboxes
+ *        and discarding the queued frames.
+ * @param pxCAN: pointer to the CAN handle structure
+ */
+void CAN_vTransmitQueueStop(CAN_HandleType * pxCAN)
+{
+    CAN_TxQueueType * pxQueue = pxCAN->TxQueue;
+
+    if (pxQueue != NULL)
+    {
+        uint32_t ulIEs = CAN_TRANSMIT_INTERRUPTS;
+        uint8_t ucMb;
+
+#ifdef __XPD_CAN_ERROR_DETECT
+        if ((pxCAN->State & CAN_STATE_RECEIVE) == 0)
+        {
+            ulIEs |= CAN_ERROR_INTERRUPTS;
+        }
+#endif
+        CLEAR_BIT(pxCAN->Inst->IER.w, ulIEs);
+
+        for (ucMb = 0; ucMb < 3; ucMb++)
+        {
+            if ((pxQueue->Loaded & (1 << ucMb)) != 0)
+            {
+                CAN_TXFLAG_CLEAR(pxCAN, ucMb, ABRQ);
+            }
+        }
+
+        pxQueue->Count  = 0;
+        pxQueue->Loaded = 0;
+        pxCAN->TxQueue  = NULL;
+        CLEAR_BIT(pxCAN->State, CAN_STATE_TRANSMIT);
+    }
+}
+
+/**
+ * @brief Adds a frame to the attached transmit priority queue.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pxFrame: pointer to the frame to transmit
+ * @return ERROR if no transmit queue is attached, BUSY if the queue is full,
+ *         OK if the frame is queued for transmission
+ */
+XPD_ReturnType CAN_eEnqueue(
+        CAN_HandleType *        pxCAN,
+        const CAN_FrameType *   pxFrame)
+{
+    XPD_ReturnType eResult = XPD_ERROR;
+    uint32_t ulPrimask = CAN_prvQueueLock();
+    CAN_TxQueueType * pxQueue = pxCAN->TxQueue;
+
+    if (pxQueue == NULL)
+    {
+        /* the queue is not (or no longer) attached */
+    }
+    /* an entry is reserved for requeueing the aborted frame */
+    else if ((pxQueue->Count + ((pxQueue->Aborting != 0) ? 1 : 0)) >= pxQueue->Size)
+    {
+        eResult = XPD_BUSY;
+    }
+    else
+    {
+        CAN_TxEntryType xEntry;
+
+        xEntry.Frame = *pxFrame;
+        xEntry.Key   = CAN_prvArbitrationKey(pxFrame);
+        xEntry.Seq   = pxQueue->NextSeq++;
+        CAN_prvHeapPush(pxQueue, &xEntry);
 
-        /* wait for TXOK with the remaining time */
-        eResult = XPD_eWaitForMatch(&pxCAN->Inst->TSR.w, ulTXOK, ulTXOK, &ulTimeout);
+        CAN_prvQueueTransmit(pxCAN);
 
-        /* Abort frame if transmission has timed out */
-        if (eResult != XPD_OK)
-        {
-            CAN_TXFLAG_CLEAR(pxCAN, pxFrame->Index, ABRQ);
-        }
+        eResult = XPD_OK;
     }
 
+    CAN_prvQueueUnlock(ulPrimask);
+
     return eResult;
 }
 
 /**
- * @brief Sets up a frame transmission and produces completion callback using the interrupt stack.
+ * @brief Determines if the attached transmit priority queue holds a frame with the identifier,
+ *        either queued or loaded in a mailbox.
  * @param pxCAN: pointer to the CAN handle structure
- * @param pxFrame: pointer to the frame to transmit
- * @return BUSY if no empty mailbox was available, OK if frame is set for transmission
+ * @param pxId: pointer to the frame identifier
+ * @return TRUE if a frame with the identifier is not yet transmitted, FALSE otherwise
  */
-XPD_ReturnType CAN_eSend_IT(
-        CAN_HandleType *    pxCAN,
-        CAN_FrameType *     pxFrame)
+boolean_t CAN_bTxPending(
+        CAN_HandleType *                pxCAN,
+        const CAN_IdentifierFieldType * pxId)
 {
-    XPD_ReturnType eResult;
-
-    eResult = CAN_prvFrameTransmit(pxCAN, pxFrame);
+    CAN_TxQueueType * pxQueue = pxCAN->TxQueue;
+    boolean_t bPending = FALSE;
+    uint32_t ulPrimask = CAN_prvQueueLock();
+    uint16_t usIndex;
+    uint8_t ucMb;
 
-    if (eResult == XPD_OK)
+    for (usIndex = 0; (usIndex < pxQueue->Count) && !bPending; usIndex++)
     {
-        SET_BIT(pxCAN->Inst->IER.w, CAN_ERROR_INTERRUPTS | CAN_TRANSMIT_INTERRUPTS);
-
-        /* state bit is set for the transmit mailbox */
-        SET_BIT(pxCAN->State, 1 << pxFrame->Index);
+        bPending = (pxQueue->Entries[usIndex].Frame.Id.Value == pxId->Value) &&
+                   (pxQueue->Entries[usIndex].Frame.Id.Type  == pxId->Type);
+    }
+    for (ucMb = 0; (ucMb < 3) && !bPending; ucMb++)
+    {
+        bPending = ((pxQueue->Loaded & (1 << ucMb)) != 0) &&
+                   (pxQueue->Mailbox[ucMb].Frame.Id.Value == pxId->Value) &&
+                   (pxQueue->Mailbox[ucMb].Frame.Id.Type  == pxId->Type);
     }
 
-    return eResult;
+    CAN_prvQueueUnlock(ulPrimask);
+
+    return bPending;
 }
 
 /**
@@ -517,8 +1732,62 @@ XPD_ReturnType CAN_eSend_IT(
  */
 void CAN_vIRQHandlerTX(CAN_HandleType * pxCAN)
 {
+    /* priority queue transmission */
+    if (pxCAN->TxQueue != NULL)
+    {
+        CAN_TxQueueType * pxQueue = pxCAN->TxQueue;
+        uint32_t ulTSR = pxCAN->Inst->TSR.w;
+        uint32_t ulPrimask;
+        uint8_t ucMb, ucSent = 0;
+
+        /* the heap and the mailboxes are updated, the refill has to complete without preemption */
+        ulPrimask = CAN_prvQueueLock();
+
+        for (ucMb = 0; ucMb < 3; ucMb++)
+        {
+            uint8_t ucMbState = 1 << ucMb;
+
+            if (((pxQueue->Loaded & ucMbState) != 0) &&
+                ((ulTSR & (CAN_TSR_RQCP0 << (8 * ucMb))) != 0))
+            {
+                CAN_TXFLAG_CLEAR(pxCAN, ucMb, RQCP);
+                CLEAR_BIT(pxQueue->Loaded, ucMbState);
+
+                if ((ulTSR & (CAN_TSR_TXOK0 << (8 * ucMb))) != 0)
+                {
+                    CAN_prvStatsTransmit(pxCAN, ucMb);
+#ifdef __XPD_CAN_TIMESTAMP
+                    (void)CAN_prvTxTimestamp(pxCAN, ucMb);
+#endif
+                    ucSent++;
+                }
+                else if ((pxQueue->Aborting & ucMbState) != 0)
+                {
+                    /* preempted frame is put back with its original order */
+                    CAN_prvHeapPush(pxQueue, &pxQueue->Mailbox[ucMb]);
+                    pxQueue->Preemptions++;
+                }
+                else
+                {
+                    pxQueue->Failures++;
+                }
+                CLEAR_BIT(pxQueue->Aborting, ucMbState);
+            }
+        }
+
+        /* refill the mailboxes */
+        CAN_prvQueueTransmit(pxCAN);
+
+        CAN_prvQueueUnlock(ulPrimask);
+
+        /* transmission complete callbacks, with the queue accessible */
+        for (; ucSent > 0; ucSent--)
+        {
+            XPD_SAFE_CALLBACK(pxCAN->Callbacks.Transmit, pxCAN);
+        }
+    }
     /* check end of transmission */
-    if (CAN_REG_BIT(pxCAN,IER,TMEIE) && ((pxCAN->State & CAN_STATE_TRANSMIT) != 0))
+    else if (CAN_REG_BIT(pxCAN,IER,TMEIE) && ((pxCAN->State & CAN_STATE_TRANSMIT) != 0))
     {
         uint32_t ulTxMB;
 
@@ -529,6 +1798,10 @@ void CAN_vIRQHandlerTX(CAN_HandleType * pxCAN)
             if (((pxCAN->State & ucMbState) != 0) && CAN_TXFLAG_STATUS(pxCAN, ulTxMB, TXOK))
             {
                 CLEAR_BIT(pxCAN->State, ucMbState);
+                CAN_prvStatsTransmit(pxCAN, ulTxMB);
+#ifdef __XPD_CAN_TIMESTAMP
+                (void)CAN_prvTxTimestamp(pxCAN, ulTxMB);
+#endif
 
                 /* transmission complete callback */
                 XPD_SAFE_CALLBACK(pxCAN->Callbacks.Transmit, pxCAN);
@@ -592,7 +1865,7 @@ XPD_ReturnType CAN_eReceive(
         if (eResult == XPD_OK)
         {
             /* frame data is extracted */
-            CAN_prvFrameReceive(pxCAN, ucFIFONumber);
+            CAN_prvFrameReceive(pxCAN, ucFIFONumber, pxCAN->RxFrame[ucFIFONumber]);
         }
     }
 
@@ -630,17 +1903,124 @@ XPD_ReturnType CAN_eReceive_IT(
     return eResult;
 }
 
+/**
+ * @brief Starts continuous interrupt-driven reception into a software FIFO.
+ *        The interrupt handler drains all pending frames of the hardware FIFO
+ *        into the software FIFO, and calls the Receive callback once per batch.
+ * @note  The Frames and Size fields of the software FIFO have to be set beforehand.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pxQueue: pointer to the receive software FIFO
+ * @param ucFIFONumber: the selected receive FIFO [0 .. 1]
+ * @return BUSY if the FIFO is already in use, OK otherwise
+ */
+XPD_ReturnType CAN_eReceiveQueue_IT(
+        CAN_HandleType *    pxCAN,
+        CAN_RxQueueType *   pxQueue,
+        uint8_t             ucFIFONumber)
+{
+    XPD_ReturnType eResult = XPD_BUSY;
+    uint8_t ucRecState = CAN_STATE_RECEIVE0 << ucFIFONumber;
+
+    /* check if FIFO is not in use */
+    if ((pxCAN->State & ucRecState) == 0)
+    {
+        SET_BIT(pxCAN->State, ucRecState);
+
+        pxQueue->Head       = 0;
+        pxQueue->Tail       = 0;
+        pxQueue->Overruns   = 0;
+        pxQueue->HwOverruns = 0;
+        pxCAN->RxQueue[ucFIFONumber] = pxQueue;
+
+        SET_BIT(pxCAN->Inst->IER.w, CAN_ERROR_INTERRUPTS | ((ucFIFONumber == 0) ?
+                (CAN_RECEIVE0_INTERRUPTS | CAN_IER_FOVIE0) :
+                (CAN_RECEIVE1_INTERRUPTS | CAN_IER_FOVIE1)));
+
+        eResult = XPD_OK;
+    }
+    return eResult;
+}
+
+/**
+ * @brief Stops the software FIFO reception on the selected receive FIFO.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param ucFIFONumber: the selected receive FIFO [0 .. 1]
+ */
+void CAN_vReceiveQueueStop(CAN_HandleType * pxCAN, uint8_t ucFIFONumber)
+{
+    if (pxCAN->RxQueue[ucFIFONumber] != NULL)
+    {
+        uint32_t ulIEs = (ucFIFONumber == 0) ?
+                (CAN_RECEIVE0_INTERRUPTS | CAN_IER_FOVIE0) :
+                (CAN_RECEIVE1_INTERRUPTS | CAN_IER_FOVIE1);
+
+#ifdef __XPD_CAN_ERROR_DETECT
+        if ((pxCAN->State & (CAN_STATE_TRANSMIT |
+                (CAN_STATE_RECEIVE1 >> ucFIFONumber))) == 0)
+        {
+            ulIEs |= CAN_ERROR_INTERRUPTS;
+        }
+#endif
+        CLEAR_BIT(pxCAN->Inst->IER.w, ulIEs);
+
+        pxCAN->RxQueue[ucFIFONumber] = NULL;
+        CLEAR_BIT(pxCAN->State, CAN_STATE_RECEIVE0 << ucFIFONumber);
+    }
+}
+
+/**
+ * @brief Removes the oldest frames from the receive software FIFO.
+ * @param pxQueue: pointer to the receive software FIFO
+ * @param axFrames: array to copy the dequeued frames to
+ * @param usMaxCount: the maximum number of frames to dequeue
+ * @return The number of frames copied to the array
+ */
+uint16_t CAN_usDequeue(
+        CAN_RxQueueType *   pxQueue,
+        CAN_FrameType       axFrames[],
+        uint16_t            usMaxCount)
+{
+    uint16_t usTail  = pxQueue->Tail;
+    uint16_t usCount = (uint16_t)(pxQueue->Head - usTail);
+    uint16_t i;
+
+    if (usCount > usMaxCount)
+    {
+        usCount = usMaxCount;
+    }
+
+    for (i = 0; i < usCount; i++, usTail++)
+    {
+        axFrames[i] = pxQueue->Frames[usTail & (pxQueue->Size - 1)];
+    }
+
+    /* Frames must be copied before their slots are released to the interrupt */
+    __DMB();
+    pxQueue->Tail = usTail;
+
+    return usCount;
+}
+
 /**
  * @brief CAN receive FIFO 0 interrupt handler that provides handle callbacks.
  * @param pxCAN: pointer to the CAN handle structure
  */
 void CAN_vIRQHandlerRX0(CAN_HandleType * pxCAN)
 {
+    /* software FIFO reception */
+    if (pxCAN->RxQueue[0] != NULL)
+    {
+        if (CAN_prvQueueReceive(pxCAN, 0))
+        {
+            /* receive complete callback for the batch */
+            XPD_SAFE_CALLBACK(pxCAN->Callbacks.Receive[0], pxCAN);
+        }
+    }
     /* check reception completion */
-    if (CAN_REG_BIT(pxCAN,IER,FMP0IE) && (CAN_REG_BIT(pxCAN,RFR[0],FMP) != 0))
+    else if (CAN_REG_BIT(pxCAN,IER,FMP0IE) && ((pxCAN->Inst->RFR[0].w & CAN_RF0R_FMP0) != 0))
     {
         /* get the FIFO contents to the requested frame structure */
-        CAN_prvFrameReceive(pxCAN, 0);
+        CAN_prvFrameReceive(pxCAN, 0, pxCAN->RxFrame[0]);
 
         /* only clear interrupt requests if they were enabled through XPD API */
         if ((pxCAN->State & CAN_STATE_RECEIVE0) != 0)
@@ -669,11 +2049,20 @@ void CAN_vIRQHandlerRX0(CAN_HandleType * pxCAN)
  */
 void CAN_vIRQHandlerRX1(CAN_HandleType * pxCAN)
 {
+    /* software FIFO reception */
+    if (pxCAN->RxQueue[1] != NULL)
+    {
+        if (CAN_prvQueueReceive(pxCAN, 1))
+        {
+            /* receive complete callback for the batch */
+            XPD_SAFE_CALLBACK(pxCAN->Callbacks.Receive[1], pxCAN);
+        }
+    }
     /* check reception completion */
-    if (CAN_REG_BIT(pxCAN,IER,FMP1IE) && (CAN_REG_BIT(pxCAN,RFR[1],FMP) != 0))
+    else if (CAN_REG_BIT(pxCAN,IER,FMP1IE) && ((pxCAN->Inst->RFR[1].w & CAN_RF0R_FMP0) != 0))
     {
         /* get the FIFO contents to the requested frame structure */
-        CAN_prvFrameReceive(pxCAN, 1);
+        CAN_prvFrameReceive(pxCAN, 1, pxCAN->RxFrame[1]);
 
         /* only clear interrupt requests if they were enabled through XPD API */
         if ((pxCAN->State & CAN_STATE_RECEIVE1) != 0)
@@ -698,6 +2087,88 @@ void CAN_vIRQHandlerRX1(CAN_HandleType * pxCAN)
 
 /** @} */
 
+/** @defgroup CAN_Exported_Functions_Gateway CAN Gateway Functions
+ *  @brief    CAN frame routing between controllers
+ *  @details  These functions forward received frames to other CAN controllers
+ *            directly from the receive interrupt, based on a routing table.
+ *            The gateway receive handlers replace the receive handlers of the input controller,
+ *            and pass the frames that match no route to the local reception.
+ *            The output controllers' mailboxes shall only be loaded by the gateway,
+ *            or an attached transmit queue shall be used, which the gateway feeds instead.
+ *            The output mailboxes and transmit queues are updated with the interrupts
+ *            masked, so thread context enqueueing and multiple gateways sharing
+ *            an output don't require @ref XPD_ENTER_CRITICAL to be defined.
+ * @{
+ */
+
+/**
+ * @brief Starts routing the received frames of the gateway input.
+ * @note  The Input, Routes and RouteCount fields of the gateway have to be set beforehand.
+ * @param pxGateway: pointer to the CAN gateway
+ */
+void CAN_vGatewayStart(CAN_GatewayType * pxGateway)
+{
+    uint8_t i;
+
+    for (i = 0; i < pxGateway->RouteCount; i++)
+    {
+        CAN_RouteType * pxRoute = &pxGateway->Routes[i];
+        uint8_t ucOffset = ((pxRoute->Id.Type & CAN_IDTYPE_EXT_DATA) != 0) ? 3 : 21;
+
+        pxRoute->KeyMask   = (pxRoute->Mask << ucOffset) | CAN_IDTYPE_EXT_RTR;
+        pxRoute->Key       = ((pxRoute->Id.Value << ucOffset) | pxRoute->Id.Type) & pxRoute->KeyMask;
+        pxRoute->Forwarded = 0;
+        pxRoute->Dropped   = 0;
+    }
+    pxGateway->Local     = 0;
+    pxGateway->Discarded = 0;
+
+    SET_BIT(pxGateway->Input->Inst->IER.w, CAN_RECEIVE0_INTERRUPTS | CAN_RECEIVE1_INTERRUPTS);
+}
+
+/**
+ * @brief Stops routing the received frames of the gateway input.
+ * @param pxGateway: pointer to the CAN gateway
+ */
+void CAN_vGatewayStop(CAN_GatewayType * pxGateway)
+{
+    CAN_HandleType * pxCAN = pxGateway->Input;
+    uint32_t ulIEs = 0;
+
+    /* keep the interrupts of the local reception */
+    if ((pxCAN->State & CAN_STATE_RECEIVE0) == 0)
+    {
+        ulIEs |= CAN_RECEIVE0_INTERRUPTS;
+    }
+    if ((pxCAN->State & CAN_STATE_RECEIVE1) == 0)
+    {
+        ulIEs |= CAN_RECEIVE1_INTERRUPTS;
+    }
+    CLEAR_BIT(pxCAN->Inst->IER.w, ulIEs);
+}
+
+/**
+ * @brief CAN receive FIFO 0 interrupt handler of the gateway input.
+ *        Forwards the routed frames, and passes the rest to the local reception.
+ * @param pxGateway: pointer to the CAN gateway
+ */
+void CAN_vGatewayIRQHandlerRX0(CAN_GatewayType * pxGateway)
+{
+    CAN_prvGatewayReceive(pxGateway, 0);
+}
+
+/**
+ * @brief CAN receive FIFO 1 interrupt handler of the gateway input.
+ *        Forwards the routed frames, and passes the rest to the local reception.
+ * @param pxGateway: pointer to the CAN gateway
+ */
+void CAN_vGatewayIRQHandlerRX1(CAN_GatewayType * pxGateway)
+{
+    CAN_prvGatewayReceive(pxGateway, 1);
+}
+
+/** @} */
+
 /** @defgroup CAN_Exported_Functions_Filter CAN Filter Management Functions
  *  @brief    CAN frame reception filters management
  *  @details  These functions provide API for frame reception filtering.
@@ -895,10 +2366,12 @@ XPD_ReturnType CAN_eFilterConfig(
 
                 /* Advance to the next filter */
                 i++;
-                type = axFilters[i].FIFO
-                    | (axFilters[i].Mode         & CAN_FILTER_MATCH)
-                    | (axFilters[i].Pattern.Type & CAN_IDTYPE_EXT_DATA);
-
+                if (i < ucFilterCount)
+                {
+                    type = axFilters[i].FIFO
+                        | (axFilters[i].Mode         & CAN_FILTER_MATCH)
+                        | (axFilters[i].Pattern.Type & CAN_IDTYPE_EXT_DATA);
+                }
             } while (i < ucFilterCount);
 
             /* If the last bank was not filled completely */
@@ -923,6 +2396,285 @@ XPD_ReturnType CAN_eFilterConfig(
     return eResult;
 }
 
+/**
+ * @brief Calculates a filter list for an identifier whitelist that fits in the available
+ *        filter banks. Identifiers are merged into mask filters where the least
+ *        not whitelisted identifiers are admitted, the rest are matched exactly.
+ *        The solved filters can be applied by @ref CAN_eFilterConfig, and the frames
+ *        passing the mask filters can be checked with @ref CAN_bPostFilter.
+ * @note  The calculation has cubic complexity with the whitelist size,
+ *        it is intended for initialization time or host-side table generation.
+ *        The reported acceptance counts are exact for standard identifiers,
+ *        and upper bounds for overlapping extended identifier mask filters.
+ * @param pxSolver: pointer to the filter solver structure
+ * @param axFilters: filter list to fill, with at least four times BankCount elements
+ * @param pucFilterCount: set to the number of solved filters
+ * @return ERROR if no filter banks are available, OK if the whitelist is solved
+ */
+XPD_ReturnType CAN_eFilterSolve(
+        CAN_FilterSolverType *  pxSolver,
+        CAN_FilterType          axFilters[],
+        uint8_t *               pucFilterCount)
+{
+    XPD_ReturnType eResult = XPD_ERROR;
+    CAN_FilterGroupType * axGroups = pxSolver->Groups;
+    uint32_t * aulIds = pxSolver->Ids;
+    boolean_t bExtended = (pxSolver->IdType & CAN_IDTYPE_EXT_DATA) != 0;
+    uint32_t ulIdMask = (bExtended) ? 0x1FFFFFFF : 0x7FF;
+    /* Filter space demand in quarter banks */
+    uint16_t usMatchUnits = (bExtended) ? 2 : 1;
+    uint16_t usMaskUnits  = (bExtended) ? 4 : 2;
+    uint16_t usMatchDemand, usMaskDemand = 0;
+    uint16_t i, j, usCount = 0;
+
+    /* Sort the whitelist */
+    for (i = 0; i < pxSolver->IdCount; i++)
+    {
+        uint32_t ulId = aulIds[i] & ulIdMask;
+
+        for (j = i; (j > 0) && (aulIds[j - 1] > ulId); j--)
+        {
+            aulIds[j] = aulIds[j - 1];
+        }
+        aulIds[j] = ulId;
+    }
+
+    /* Remove duplicates, start with single identifier groups */
+    for (i = 0; i < pxSolver->IdCount; i++)
+    {
+        if ((usCount == 0) || (aulIds[i] != aulIds[usCount - 1]))
+        {
+            aulIds[usCount] = aulIds[i];
+            axGroups[usCount].Pattern = aulIds[i];
+            axGroups[usCount].Mask    = ulIdMask;
+            axGroups[usCount].Count   = 1;
+            axGroups[usCount].Leader  = usCount;
+            usCount++;
+        }
+    }
+    pxSolver->IdCount = usCount;
+    usMatchDemand = usCount * usMatchUnits;
+
+    /* Merge groups until the filters fit in the banks */
+    while (((usMatchDemand + 3) / 4 + (usMaskDemand + 3) / 4) > pxSolver->BankCount)
+    {
+        uint16_t usA = 0, usB = 0;
+        int32_t lBestGrowth = 0x7FFFFFFF, lBestSaving = 0;
+        uint32_t ulMask;
+
+        /* Find the pair of groups which admits the least new identifiers */
+        for (i = 0; i < usCount; i++)
+        {
+            if (axGroups[i].Leader != i)
+            {
+                continue;
+            }
+            for (j = i + 1; j < usCount; j++)
+            {
+                uint16_t usMerged = axGroups[i].Count + axGroups[j].Count;
+                uint32_t ulOverlap = 0;
+                int32_t lGrowth, lSaving;
+
+                if (axGroups[j].Leader != j)
+                {
+                    continue;
+                }
+                ulMask = axGroups[i].Mask & axGroups[j].Mask
+                       & ~(axGroups[i].Pattern ^ axGroups[j].Pattern);
+
+                /* The spans of the groups may intersect */
+                if (((axGroups[i].Pattern ^ axGroups[j].Pattern)
+                        & axGroups[i].Mask & axGroups[j].Mask) == 0)
+                {
+                    ulOverlap = CAN_prvFilterSpan(axGroups[i].Mask | axGroups[j].Mask, ulIdMask);
+                }
+
+                /* Number of identifiers newly accepted by the merged group */
+                lGrowth = (int32_t)(CAN_prvFilterSpan(ulMask, ulIdMask)
+                        - CAN_prvFilterSpan(axGroups[i].Mask, ulIdMask)
+                        - CAN_prvFilterSpan(axGroups[j].Mask, ulIdMask)
+                        + ulOverlap);
+
+                /* Groups are matched exactly as long as it needs no more space */
+                lSaving = ((axGroups[i].Count * usMatchUnits > usMaskUnits) ?
+                            usMaskUnits : axGroups[i].Count * usMatchUnits)
+                        + ((axGroups[j].Count * usMatchUnits > usMaskUnits) ?
+                            usMaskUnits : axGroups[j].Count * usMatchUnits)
+                        - ((usMerged * usMatchUnits > usMaskUnits) ?
+                            usMaskUnits : usMerged * usMatchUnits);
+
+                if ((lGrowth < lBestGrowth) ||
+                   ((lGrowth == lBestGrowth) && (lSaving > lBestSaving)))
+                {
+                    lBestGrowth = lGrowth;
+                    lBestSaving = lSaving;
+                    usA = i;
+                    usB = j;
+                }
+            }
+        }
+
+        /* Single group left */
+        if (usA == usB)
+        {
+            break;
+        }
+
+        ulMask = axGroups[usA].Mask & axGroups[usB].Mask
+               & ~(axGroups[usA].Pattern ^ axGroups[usB].Pattern);
+        axGroups[usA].Mask    = ulMask;
+        axGroups[usA].Pattern &= ulMask;
+        CAN_prvGroupJoin(pxSolver, usA, usB);
+
+        /* Absorb the groups which are covered by the merged group */
+        for (i = 0; i < usCount; i++)
+        {
+            if ((axGroups[i].Leader == i) && (i != usA) &&
+                ((axGroups[i].Pattern & ulMask) == axGroups[usA].Pattern) &&
+                ((axGroups[i].Mask & ulMask) == ulMask))
+            {
+                CAN_prvGroupJoin(pxSolver, usA, i);
+            }
+        }
+
+        /* Recalculate the space demand */
+        usMatchDemand = usMaskDemand = 0;
+        for (i = 0; i < usCount; i++)
+        {
+            if (axGroups[i].Leader != i)
+            {}
+            else if ((axGroups[i].Count * usMatchUnits) > usMaskUnits)
+            {
+                usMaskDemand += usMaskUnits;
+            }
+            else
+            {
+                usMatchDemand += axGroups[i].Count * usMatchUnits;
+            }
+        }
+    }
+
+    if (((usMatchDemand + 3) / 4 + (usMaskDemand + 3) / 4) <= pxSolver->BankCount)
+    {
+        uint8_t ucFilterCount = 0;
+
+        pxSolver->Accepted     = 0;
+        pxSolver->FalseAccepts = 0;
+
+        for (i = 0; i < usCount; i++)
+        {
+            uint16_t usLeader = axGroups[i].Leader;
+            CAN_FilterType * pxFilter = &axFilters[ucFilterCount];
+
+            pxFilter->Pattern.Type = pxSolver->IdType;
+            pxFilter->FIFO         = pxSolver->FIFO;
+
+            /* Exact match filter for each identifier of the group */
+            if ((axGroups[usLeader].Count * usMatchUnits) <= usMaskUnits)
+            {
+                pxFilter->Pattern.Value = aulIds[i];
+                pxFilter->Mask          = ulIdMask;
+                pxFilter->Mode          = CAN_FILTER_MATCH;
+                ucFilterCount++;
+                pxSolver->Accepted++;
+            }
+            /* Single mask filter for the group */
+            else if (usLeader == i)
+            {
+                pxFilter->Pattern.Value = axGroups[i].Pattern;
+                pxFilter->Mask          = axGroups[i].Mask;
+                pxFilter->Mode          = CAN_FILTER_MASK;
+                ucFilterCount++;
+
+                pxSolver->Accepted += CAN_prvFilterSpan(axGroups[i].Mask, ulIdMask);
+                pxSolver->FalseAccepts += CAN_prvFilterSpan(axGroups[i].Mask, ulIdMask)
+                                        - axGroups[i].Count;
+            }
+        }
+
+        /* Standard identifiers are few enough to count the overlaps exactly */
+        if (!bExtended && (pxSolver->FalseAccepts > 0))
+        {
+            uint32_t ulId;
+
+            pxSolver->Accepted     = 0;
+            pxSolver->FalseAccepts = 0;
+
+            for (ulId = 0; ulId <= ulIdMask; ulId++)
+            {
+                for (j = 0; j < ucFilterCount; j++)
+                {
+                    if ((ulId & axFilters[j].Mask) == axFilters[j].Pattern.Value)
+                    {
+                        pxSolver->Accepted++;
+                        if (!CAN_bPostFilter(pxSolver, ulId))
+                        {
+                            pxSolver->FalseAccepts++;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        *pucFilterCount = ucFilterCount;
+        eResult = XPD_OK;
+    }
+
+    return eResult;
+}
+
+/**
+ * @brief Checks a received identifier against the whitelist of a solved filter list.
+ *        Only needed for the frames matched by mask filters,
+ *        when the solver reports false accepts.
+ * @param pxSolver: pointer to the filter solver structure, after @ref CAN_eFilterSolve
+ * @param ulId: the received identifier
+ * @return TRUE if the identifier is whitelisted, FALSE otherwise
+ */
+boolean_t CAN_bPostFilter(const CAN_FilterSolverType * pxSolver, uint32_t ulId)
+{
+    uint16_t usLow = 0, usHigh = pxSolver->IdCount;
+
+    /* Binary search in the sorted whitelist */
+    while (usLow < usHigh)
+    {
+        uint16_t usMid = (usLow + usHigh) / 2;
+
+        if (pxSolver->Ids[usMid] < ulId)
+        {
+            usLow = usMid + 1;
+        }
+        else
+        {
+            usHigh = usMid;
+        }
+    }
+    return (usLow < pxSolver->IdCount) && (pxSolver->Ids[usLow] == ulId);
+}
+
+/**
+ * @brief Builds a bitmap of a solved standard identifier whitelist
+ *        for constant time post-filtering with @ref CAN_bPostFilterBitmap.
+ * @param pxSolver: pointer to the filter solver structure, after @ref CAN_eFilterSolve
+ * @param aulBitmap: the bitmap to fill with one bit per standard identifier
+ */
+void CAN_vPostFilterBitmap(const CAN_FilterSolverType * pxSolver, uint32_t aulBitmap[64])
+{
+    uint16_t i;
+
+    for (i = 0; i < 64; i++)
+    {
+        aulBitmap[i] = 0;
+    }
+    for (i = 0; i < pxSolver->IdCount; i++)
+    {
+        uint32_t ulId = pxSolver->Ids[i] & 0x7FF;
+
+        aulBitmap[ulId >> 5] |= 1UL << (ulId & 31);
+    }
+}
+
 /**
  * @brief Sets the filter bank size for the CAN peripheral.
  * @note  This operation resets the filter configuration for the slave CAN controller.
@@ -0,0 +1,644 @@
+/**
+  ******************************************************************************
+  * @file    xpd_can_tp.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers CAN Transport Protocol Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_can_tp.h>
+#include <xpd_utils.h>
+
+#if defined(CAN) || defined(CAN1)
+
+/** @addtogroup CAN_TP
+ * @{ */
+
+/* Protocol control information types */
+#define CANTP_PCI_SF            0x00
+#define CANTP_PCI_FF            0x10
+#define CANTP_PCI_CF            0x20
+#define CANTP_PCI_FC            0x30
+
+/* Flow control flow status */
+#define CANTP_FS_CTS            0
+#define CANTP_FS_WAIT           1
+#define CANTP_FS_OVFLW          2
+#define CANTP_FS_NONE           0xFF
+
+/* Transmitter states */
+#define CANTP_TX_IDLE           0
+#define CANTP_TX_WAIT_FC        1
+#define CANTP_TX_SEND_CF        2
+#define CANTP_TX_WAIT_SENT      3
+#define CANTP_TX_START          4
+
+/* Receiver states */
+#define CANTP_RX_IDLE           0
+#define CANTP_RX_RECEIVE_CF     1
+
+/* Maximal message length with 12 bit FF_DL */
+#define CANTP_MAX_LENGTH        4095
+
+/** @defgroup CAN_TP_Private_Functions CAN Transport Protocol Private Functions
+ * @{ */
+
+/**
+ * @brief Sets up the identifier and padding of a frame of the session.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ * @param pxFrame: pointer to the frame to set up
+ * @param ucLength: the number of used data bytes
+ */
+static void CANTP_prvFrameInit(
+        CANTP_HandleType *  pxTP,
+        CANTP_SessionType * pxSession,
+        CAN_FrameType *     pxFrame,
+        uint8_t             ucLength)
+{
+    pxFrame->Id = pxSession->TxId;
+    pxFrame->Data.Word[0] = pxFrame->Data.Word[1] = 0x01010101UL * pxTP->PadValue;
+    pxFrame->DLC = (pxTP->Padding != DISABLE) ? 8 : ucLength;
+}
+
+/**
+ * @brief Converts an ISO 15765-2 separation time to ticks.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param ucSTmin: the encoded separation time
+ * @return The minimal number of ticks between consecutive frames
+ */
+static uint16_t CANTP_prvSTminTicks(CANTP_HandleType * pxTP, uint8_t ucSTmin)
+{
+    uint32_t ulSTmin_us, ulTicks;
+
+    if (ucSTmin <= 0x7F)
+    {
+        ulSTmin_us = (uint32_t)ucSTmin * 1000;
+    }
+    else if ((ucSTmin >= 0xF1) && (ucSTmin <= 0xF9))
+    {
+        ulSTmin_us = (uint32_t)(ucSTmin - 0xF0) * 100;
+    }
+    else
+    {
+        /* Reserved values are treated as the longest time */
+        ulSTmin_us = 127000;
+    }
+
+    ulTicks = (ulSTmin_us + pxTP->TickPeriod_us - 1) / pxTP->TickPeriod_us;
+
+    /* The first tick may arrive at any time, so one more is needed */
+    if (ulTicks > 0)
+    {
+        ulTicks++;
+    }
+
+    /* Short tick periods are limited to the timer range */
+    return (ulTicks > 0xFFFF) ? 0xFFFF : (uint16_t)ulTicks;
+}
+
+/**
+ * @brief Aborts the session's transfers in the given direction and reports the error.
+ * @param pxSession: pointer to the session
+ * @param bTx: TRUE to abort the transmission, FALSE to abort the reception
+ * @param eError: the error type
+ */
+static void CANTP_prvAbort(CANTP_SessionType * pxSession, boolean_t bTx, CANTP_ErrorType eError)
+{
+    if (bTx)
+    {
+        pxSession->Tx.State = CANTP_TX_IDLE;
+    }
+    else
+    {
+        pxSession->Rx.State = CANTP_RX_IDLE;
+    }
+    pxSession->Error = eError;
+
+    XPD_SAFE_CALLBACK(pxSession->Callbacks.Error, pxSession);
+}
+
+/**
+ * @brief Sends the pending flow control frame of the session's receiver.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ */
+static void CANTP_prvSendFlowControl(CANTP_HandleType * pxTP, CANTP_SessionType * pxSession)
+{
+    CAN_FrameType xFrame;
+
+    CANTP_prvFrameInit(pxTP, pxSession, &xFrame, 3);
+    xFrame.Data.Byte[0] = CANTP_PCI_FC | pxSession->Rx.FlowStatus;
+    xFrame.Data.Byte[1] = pxSession->BlockSize;
+    xFrame.Data.Byte[2] = pxSession->STmin;
+
+    /* When the transmit queue is full, retry on next processing */
+    if (CAN_eEnqueue(pxTP->Link, &xFrame) == XPD_OK)
+    {
+        pxSession->Rx.FlowStatus = CANTP_FS_NONE;
+    }
+}
+
+/**
+ * @brief Sends the consecutive frames of the session's transmitter
+ *        that are permitted by the flow control.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ */
+static void CANTP_prvSendConsecutive(CANTP_HandleType * pxTP, CANTP_SessionType * pxSession)
+{
+    while ((pxSession->Tx.State == CANTP_TX_SEND_CF) && (pxSession->Tx.Timer == 0))
+    {
+        CAN_FrameType xFrame;
+        uint16_t usRemaining = pxSession->Tx.Length - pxSession->Tx.Index;
+        uint8_t i, ucCount = (usRemaining > 7) ? 7 : usRemaining;
+
+        /* Frame is filled directly from the message buffer */
+        CANTP_prvFrameInit(pxTP, pxSession, &xFrame, ucCount + 1);
+        xFrame.Data.Byte[0] = CANTP_PCI_CF | pxSession->Tx.SN;
+        for (i = 0; i < ucCount; i++)
+        {
+            xFrame.Data.Byte[1 + i] = pxSession->Tx.Buffer[pxSession->Tx.Index + i];
+        }
+
+        /* When the transmit queue is full, continue on next processing */
+        if (CAN_eEnqueue(pxTP->Link, &xFrame) != XPD_OK)
+        {
+            break;
+        }
+
+        pxSession->Tx.Index += ucCount;
+        pxSession->Tx.SN = (pxSession->Tx.SN + 1) & 0xF;
+
+        if (pxSession->Tx.Index >= pxSession->Tx.Length)
+        {
+            /* Completion is reported when the last frame leaves the queue */
+            pxSession->Tx.State = CANTP_TX_WAIT_SENT;
+            pxSession->Tx.Timer = pxTP->TimeoutTicks;
+        }
+        else if ((pxSession->Tx.BlockSize > 0) && (--pxSession->Tx.BlockCount == 0))
+        {
+            /* End of block, wait for the next flow control */
+            pxSession->Tx.State = CANTP_TX_WAIT_FC;
+            pxSession->Tx.Timer = pxTP->TimeoutTicks;
+        }
+        else
+        {
+            pxSession->Tx.Timer = pxSession->Tx.STminTicks;
+        }
+    }
+}
+
+/**
+ * @brief Reports the completion of the session's transmission
+ *        when its last frame has been transmitted on the bus.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ */
+static void CANTP_prvTransmitComplete(CANTP_HandleType * pxTP, CANTP_SessionType * pxSession)
+{
+    if ((pxSession->Tx.State == CANTP_TX_WAIT_SENT) &&
+        !CAN_bTxPending(pxTP->Link, &pxSession->TxId))
+    {
+        pxSession->Tx.State = CANTP_TX_IDLE;
+
+        XPD_SAFE_CALLBACK(pxSession->Callbacks.Transmit, pxSession);
+    }
+}
+
+/**
+ * @brief Processes a received flow control frame.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ * @param pxFrame: pointer to the received frame
+ */
+static void CANTP_prvReceiveFlowControl(
+        CANTP_HandleType *      pxTP,
+        CANTP_SessionType *     pxSession,
+        const CAN_FrameType *   pxFrame)
+{
+    if (pxSession->Tx.State == CANTP_TX_WAIT_FC)
+    {
+        switch (pxFrame->Data.Byte[0] & 0xF)
+        {
+            case CANTP_FS_CTS:
+                pxSession->Tx.BlockSize  = pxFrame->Data.Byte[1];
+                pxSession->Tx.BlockCount = pxFrame->Data.Byte[1];
+                pxSession->Tx.STminTicks = CANTP_prvSTminTicks(pxTP, pxFrame->Data.Byte[2]);
+                pxSession->Tx.Timer      = 0;
+                pxSession->Tx.State      = CANTP_TX_SEND_CF;
+                break;
+
+            case CANTP_FS_WAIT:
+                pxSession->Tx.Timer = pxTP->TimeoutTicks;
+                break;
+
+            case CANTP_FS_OVFLW:
+                CANTP_prvAbort(pxSession, TRUE, CANTP_ERROR_OVERFLOW);
+                break;
+
+            default:
+                CANTP_prvAbort(pxSession, TRUE, CANTP_ERROR_INVALID_FS);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Processes a received single, first or consecutive frame.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ * @param pxFrame: pointer to the received frame
+ */
+static void CANTP_prvReceiveData(
+        CANTP_HandleType *      pxTP,
+        CANTP_SessionType *     pxSession,
+        const CAN_FrameType *   pxFrame)
+{
+    const uint8_t * pucData = pxFrame->Data.Byte;
+    uint8_t ucPCI = pucData[0] & 0xF0;
+    uint8_t i, ucCount, ucOffset;
+
+    if (ucPCI == CANTP_PCI_CF)
+    {
+        if (pxSession->Rx.State != CANTP_RX_RECEIVE_CF)
+        {
+            /* Unexpected consecutive frames are ignored */
+            return;
+        }
+        if ((pucData[0] & 0xF) != pxSession->Rx.SN)
+        {
+            CANTP_prvAbort(pxSession, FALSE, CANTP_ERROR_WRONG_SN);
+            return;
+        }
+        ucOffset = 1;
+        ucCount  = ((pxSession->Rx.Length - pxSession->Rx.Index) > 7) ?
+                7 : (pxSession->Rx.Length - pxSession->Rx.Index);
+
+        if (pxFrame->DLC < (1 + ucCount))
+        {
+            CANTP_prvAbort(pxSession, FALSE, CANTP_ERROR_WRONG_DL);
+            return;
+        }
+    }
+    else
+    {
+        /* New message terminates the ongoing reception */
+        if (pxSession->Rx.State != CANTP_RX_IDLE)
+        {
+            CANTP_prvAbort(pxSession, FALSE, CANTP_ERROR_UNEXP_PDU);
+        }
+
+        if (ucPCI == CANTP_PCI_SF)
+        {
+            pxSession->Rx.Length = pucData[0] & 0xF;
+            ucOffset = 1;
+            ucCount  = pxSession->Rx.Length;
+
+            if ((ucCount == 0) || (ucCount > 7) || (ucCount >= pxFrame->DLC))
+            {
+                return;
+            }
+        }
+        else
+        {
+            pxSession->Rx.Length = ((uint16_t)(pucData[0] & 0xF) << 8) | pucData[1];
+            ucOffset = 2;
+            ucCount  = 6;
+
+            if ((pxSession->Rx.Length < 8) || (pxFrame->DLC < 8))
+            {
+                return;
+            }
+        }
+
+        if (pxSession->Rx.Length > pxSession->Rx.Size)
+        {
+            /* Reject the message with overflow status */
+            if (ucPCI == CANTP_PCI_FF)
+            {
+                pxSession->Rx.FlowStatus = CANTP_FS_OVFLW;
+                CANTP_prvSendFlowControl(pxTP, pxSession);
+            }
+            pxSession->Error = CANTP_ERROR_OVERFLOW;
+            return;
+        }
+
+        pxSession->Rx.Index = 0;
+        pxSession->Rx.SN    = 1;
+    }
+
+    /* Payload is copied directly to the reception buffer */
+    for (i = 0; i < ucCount; i++)
+    {
+        pxSession->Rx.Buffer[pxSession->Rx.Index + i] = pucData[ucOffset + i];
+    }
+    pxSession->Rx.Index += ucCount;
+
+    if (pxSession->Rx.Index >= pxSession->Rx.Length)
+    {
+        pxSession->Rx.State = CANTP_RX_IDLE;
+
+        XPD_SAFE_CALLBACK(pxSession->Callbacks.Receive, pxSession);
+    }
+    else if (ucPCI == CANTP_PCI_FF)
+    {
+        pxSession->Rx.State      = CANTP_RX_RECEIVE_CF;
+        pxSession->Rx.BlockCount = pxSession->BlockSize;
+        pxSession->Rx.Timer      = pxTP->TimeoutTicks;
+        pxSession->Rx.FlowStatus = CANTP_FS_CTS;
+        CANTP_prvSendFlowControl(pxTP, pxSession);
+    }
+    else
+    {
+        pxSession->Rx.SN    = (pxSession->Rx.SN + 1) & 0xF;
+        pxSession->Rx.Timer = pxTP->TimeoutTicks;
+
+        /* End of block, allow the next one */
+        if ((pxSession->BlockSize > 0) && (--pxSession->Rx.BlockCount == 0))
+        {
+            pxSession->Rx.BlockCount = pxSession->BlockSize;
+            pxSession->Rx.FlowStatus = CANTP_FS_CTS;
+            CANTP_prvSendFlowControl(pxTP, pxSession);
+        }
+    }
+}
+
+/** @} */
+
+/** @defgroup CAN_TP_Exported_Functions CAN Transport Protocol Exported Functions
+ *  @brief    ISO 15765-2 message transfer over CAN
+ *  @details  The transport layer segments the transmitted messages directly from
+ *            and reassembles the received messages directly into the session buffers.
+ *            The frames are transmitted through the CAN transmit priority queue,
+ *            which has to be attached to the CAN handle with @ref CAN_eTransmitQueue_IT.
+ *            The received frames of the CAN handle are passed to @ref CANTP_vReceive.
+ *            Time is measured by @ref CANTP_vTick, which is to be called
+ *            from a periodic TIM update callback.
+ *            @ref CANTP_vReceive, @ref CANTP_vProcess and @ref CANTP_vTick
+ *            shall not preempt each other, e.g. call them from interrupts
+ *            of the same priority.
+ * @{
+ */
+
+/**
+ * @brief Initializes the CAN transport protocol handle and resets its sessions.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @return ERROR if the timeout is shorter than a tick period or exceeds 65535 ticks,
+ *         OK otherwise
+ */
+XPD_ReturnType CANTP_eInit(CANTP_HandleType * pxTP)
+{
+    XPD_ReturnType eResult = XPD_ERROR;
+    uint32_t ulTicks = 0;
+    uint8_t i;
+
+    if (pxTP->TickPeriod_us > 0)
+    {
+        ulTicks = ((uint32_t)pxTP->Timeout_ms * 1000) / pxTP->TickPeriod_us;
+    }
+
+    if ((ulTicks > 0) && (ulTicks <= 0xFFFF))
+    {
+        pxTP->TimeoutTicks = ulTicks;
+
+        for (i = 0; i < pxTP->SessionCount; i++)
+        {
+            pxTP->Sessions[i].Tx.State      = CANTP_TX_IDLE;
+            pxTP->Sessions[i].Rx.State      = CANTP_RX_IDLE;
+            pxTP->Sessions[i].Rx.FlowStatus = CANTP_FS_NONE;
+            pxTP->Sessions[i].Error         = CANTP_ERROR_NONE;
+        }
+        eResult = XPD_OK;
+    }
+
+    return eResult;
+}
+
+/**
+ * @brief Starts the transmission of a message on the session.
+ *        The message buffer is read during the transmission, therefore it has to be
+ *        kept unchanged until the Transmit or Error callback is called.
+ *        The Transmit callback is called when the last frame of the message
+ *        is transmitted on the bus.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxSession: pointer to the session
+ * @param pucData: pointer to the message
+ * @param usLength: the length of the message [1 .. 4095]
+ * @return ERROR if the length is invalid or no transmit queue is attached,
+ *         BUSY if the session is transmitting or the transmit queue is full,
+ *         OK if the transmission is started
+ */
+XPD_ReturnType CANTP_eSend(
+        CANTP_HandleType *  pxTP,
+        CANTP_SessionType * pxSession,
+        const uint8_t *     pucData,
+        uint16_t            usLength)
+{
+    XPD_ReturnType eResult = XPD_ERROR;
+
+    if ((usLength > 0) && (usLength <= CANTP_MAX_LENGTH))
+    {
+        boolean_t bClaimed = FALSE;
+
+        eResult = XPD_BUSY;
+
+        /* The transmitter is claimed here, the frame is enqueued outside of the section */
+        XPD_ENTER_CRITICAL(pxTP);
+
+        if (pxSession->Tx.State == CANTP_TX_IDLE)
+        {
+            pxSession->Tx.Timer = 0;
+            pxSession->Tx.State = CANTP_TX_START;
+            bClaimed = TRUE;
+        }
+
+        XPD_EXIT_CRITICAL(pxTP);
+
+        if (bClaimed)
+        {
+            CAN_FrameType xFrame;
+            uint8_t i, ucOffset, ucCount;
+
+            if (usLength <= 7)
+            {
+                /* Single frame */
+                CANTP_prvFrameInit(pxTP, pxSession, &xFrame, usLength + 1);
+                xFrame.Data.Byte[0] = CANTP_PCI_SF | usLength;
+                ucOffset = 1;
+                ucCount  = usLength;
+            }
+            else
+            {
+                /* First frame */
+                CANTP_prvFrameInit(pxTP, pxSession, &xFrame, 8);
+                xFrame.Data.Byte[0] = CANTP_PCI_FF | (usLength >> 8);
+                xFrame.Data.Byte[1] = usLength & 0xFF;
+                ucOffset = 2;
+                ucCount  = 6;
+            }
+            for (i = 0; i < ucCount; i++)
+            {
+                xFrame.Data.Byte[ucOffset + i] = pucData[i];
+            }
+
+            pxSession->Tx.Buffer = pucData;
+            pxSession->Tx.Length = usLength;
+            pxSession->Tx.Index  = ucCount;
+            pxSession->Tx.SN     = 1;
+            pxSession->Tx.Timer  = pxTP->TimeoutTicks;
+
+            /* The flow control may arrive as soon as the first frame is enqueued,
+             * while a single frame is only waited for once it is in the queue */
+            if (usLength > 7)
+            {
+                pxSession->Tx.State = CANTP_TX_WAIT_FC;
+            }
+
+            eResult = CAN_eEnqueue(pxTP->Link, &xFrame);
+
+            if (eResult != XPD_OK)
+            {
+                pxSession->Tx.State = CANTP_TX_IDLE;
+            }
+            else if (usLength <= 7)
+            {
+                pxSession->Tx.State = CANTP_TX_WAIT_SENT;
+            }
+        }
+    }
+
+    return eResult;
+}
+
+/**
+ * @brief Abandons the ongoing transfers of the session without notification.
+ * @param pxSession: pointer to the session
+ */
+void CANTP_vAbort(CANTP_SessionType * pxSession)
+{
+    pxSession->Tx.State      = CANTP_TX_IDLE;
+    pxSession->Rx.State      = CANTP_RX_IDLE;
+    pxSession->Rx.FlowStatus = CANTP_FS_NONE;
+}
+
+/**
+ * @brief Processes a received CAN frame. Frames which don't match
+ *        the receive identifier of any session are ignored.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ * @param pxFrame: pointer to the received frame
+ */
+void CANTP_vReceive(CANTP_HandleType * pxTP, const CAN_FrameType * pxFrame)
+{
+    uint8_t i;
+
+    for (i = 0; i < pxTP->SessionCount; i++)
+    {
+        CANTP_SessionType * pxSession = &pxTP->Sessions[i];
+
+        if ((pxFrame->Id.Value == pxSession->RxId.Value) &&
+            (pxFrame->Id.Type  == pxSession->RxId.Type) &&
+            (pxFrame->DLC > 0))
+        {
+            if ((pxFrame->Data.Byte[0] & 0xF0) == CANTP_PCI_FC)
+            {
+                CANTP_prvReceiveFlowControl(pxTP, pxSession, pxFrame);
+            }
+            else if ((pxFrame->Data.Byte[0] & 0xF0) <= CANTP_PCI_CF)
+            {
+                CANTP_prvReceiveData(pxTP, pxSession, pxFrame);
+            }
+
+            /* Flow control may permit consecutive frames */
+            CANTP_prvSendConsecutive(pxTP, pxSession);
+            CANTP_prvTransmitComplete(pxTP, pxSession);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Sends the frames of the sessions which are ready for transmission,
+ *        and reports the completed message transmissions.
+ *        Call this function from the CAN Transmit callback to refill the transmit queue
+ *        as soon as space is available.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ */
+void CANTP_vProcess(CANTP_HandleType * pxTP)
+{
+    uint8_t i;
+
+    for (i = 0; i < pxTP->SessionCount; i++)
+    {
+        CANTP_SessionType * pxSession = &pxTP->Sessions[i];
+
+        if (pxSession->Rx.FlowStatus != CANTP_FS_NONE)
+        {
+            CANTP_prvSendFlowControl(pxTP, pxSession);
+        }
+
+        CANTP_prvSendConsecutive(pxTP, pxSession);
+        CANTP_prvTransmitComplete(pxTP, pxSession);
+    }
+}
+
+/**
+ * @brief Advances the session timers by one tick, and handles timeouts
+ *        and separation time expiry. Call this function periodically
+ *        with TickPeriod_us period, e.g. from a TIM Update callback.
+ * @param pxTP: pointer to the CAN transport protocol handle
+ */
+void CANTP_vTick(CANTP_HandleType * pxTP)
+{
+    uint8_t i;
+
+    for (i = 0; i < pxTP->SessionCount; i++)
+    {
+        CANTP_SessionType * pxSession = &pxTP->Sessions[i];
+
+        /* The separation time starts when the previous consecutive frame is transmitted */
+        if ((pxSession->Tx.State != CANTP_TX_IDLE) && (pxSession->Tx.Timer > 0) &&
+            ((pxSession->Tx.State != CANTP_TX_SEND_CF) ||
+             !CAN_bTxPending(pxTP->Link, &pxSession->TxId)))
+        {
+            pxSession->Tx.Timer--;
+
+            if ((pxSession->Tx.Timer == 0) && (pxSession->Tx.State == CANTP_TX_WAIT_FC))
+            {
+                CANTP_prvAbort(pxSession, TRUE, CANTP_ERROR_TIMEOUT_BS);
+            }
+            else if ((pxSession->Tx.Timer == 0) && (pxSession->Tx.State == CANTP_TX_WAIT_SENT))
+            {
+                CANTP_prvAbort(pxSession, TRUE, CANTP_ERROR_TIMEOUT_AS);
+            }
+        }
+
+        if ((pxSession->Rx.State != CANTP_RX_IDLE) && (pxSession->Rx.Timer > 0) &&
+            (--pxSession->Rx.Timer == 0))
+        {
+            CANTP_prvAbort(pxSession, FALSE, CANTP_ERROR_TIMEOUT_CR);
+        }
+    }
+
+    CANTP_vProcess(pxTP);
+}
+
+/** @} */
+
+/** @} */
+
+#endif /* defined(CAN) || defined(CAN1) */
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file    xpd_adc_multi.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers ADC Interleaved Capture Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_ADC_MULTI_H_
+#define __XPD_ADC_MULTI_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_adc.h>
+
+#ifdef ADC123_COMMON
+
+/** @ingroup ADC
+ * @defgroup ADC_Interleaved ADC Interleaved Capture
+ * @brief    High rate capture with dual or triple interleaved ADCs through the common data register.
+ *           The captured half-words are in time order (ADC1, ADC2, [ADC3,] ADC1, ...),
+ *           the per ADC sample arrays are produced by the de-interleave kernel.
+ * @{ */
+
+/** @defgroup ADC_Interleaved_Exported_Functions ADC Interleaved Capture Exported Functions
+ * @{ */
+void            ADCMULTI_vInit          (ADC_HandleType * pxADC, uint8_t ucADCs,
+                                         uint8_t ucConversionCycles);
+
+XPD_ReturnType  ADCMULTI_eStart_DMA     (ADC_HandleType * pxADC, uint16_t * pusBuffer,
+                                         uint16_t usSamples);
+void            ADCMULTI_vStop_DMA      (ADC_HandleType * pxADC);
+
+void            ADCMULTI_vDeinterleave  (const uint16_t * pusInput, uint16_t usLength,
+                                         uint8_t ucStreams, uint16_t * const apusOutput[]);
+/** @} */
+
+/** @} */
+
+#endif /* ADC123_COMMON */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_ADC_MULTI_H_ */
@@ -57,6 +57,25 @@ typedef struct
     uint8_t  SJW;       /*!< Synchronization jump width. Permitted values: @arg 1 .. 4 */
 }CAN_TimingConfigType;
 
+/** @brief CAN bit timing search target structure */
+typedef struct
+{
+    uint32_t ClockFreq_Hz;          /*!< CAN peripheral input clock frequency */
+    uint32_t Bitrate;               /*!< Target bitrate [bit/s] */
+    uint32_t BitrateTolerance;      /*!< Permitted bitrate error [ppm] */
+    uint16_t SamplePoint;           /*!< Target sample point [per mille of the bit time], e.g. 875 for CANopen */
+    uint16_t SamplePointTolerance;  /*!< Permitted sample point deviation [per mille of the bit time] */
+}CAN_TimingTargetType;
+
+/** @brief CAN bit timing search result structure */
+typedef struct
+{
+    CAN_TimingConfigType Timing;    /*!< Bit timing configuration */
+    int32_t  BitrateError;          /*!< Bitrate error of the configuration [ppm] */
+    uint16_t SamplePoint;           /*!< Sample point of the configuration [per mille of the bit time] */
+    uint16_t OscTolerance;          /*!< Oscillator tolerance of the configuration [ppm] */
+}CAN_TimingCandidateType;
+
 /** @brief CAN setup structure */
 typedef struct
 {
@@ -104,6 +123,12 @@ typedef struct
                                      @arg Received frames: Filter Match Index,
                                           for pairing with acceptance filter
                                      @arg Transmitted frames: Mailbox Index */
+#ifdef __XPD_CAN_TIMESTAMP
+    uint64_t                Timestamp; /*!< Start of frame time in bit times, extended from
+                                            the Time Triggered Communication Mode counter:
+                                     @arg Received frames: set on reception
+                                     @arg Transmitted frames: set by @ref CAN_eSend on completion */
+#endif
 }CAN_FrameType;
 
 /** @brief CAN Error types */
@@ -140,6 +165,124 @@ typedef struct
     uint8_t                 FIFO;    /*!< The selected receive FIFO [0 .. 1]*/
 }CAN_FilterType;
 
+/** @brief CAN filter solver identifier group structure */
+typedef struct
+{
+    uint32_t          Pattern;          /*!< [Internal] Identifier bits common to the group */
+    uint32_t          Mask;             /*!< [Internal] Identifier bits identical in the group */
+    uint16_t          Count;            /*!< [Internal] Number of whitelisted identifiers in the group */
+    uint16_t          Leader;           /*!< [Internal] Index of the group's leading identifier */
+}CAN_FilterGroupType;
+
+/** @brief CAN filter solver structure */
+typedef struct
+{
+    uint32_t *            Ids;          /*!< Identifier whitelist, sorted in place by the solver */
+    CAN_FilterGroupType * Groups;       /*!< Work area with IdCount elements */
+    uint16_t              IdCount;      /*!< Number of whitelisted identifiers,
+                                             reduced to the unique identifiers by the solver */
+    CAN_IdType            IdType;       /*!< Identifier type of the whitelist */
+    uint8_t               FIFO;         /*!< The selected receive FIFO [0 .. 1] */
+    uint8_t               BankCount;    /*!< Number of filter banks available for the whitelist */
+    uint32_t              Accepted;     /*!< Number of identifiers passing the solved filters */
+    uint32_t              FalseAccepts; /*!< Number of passing identifiers that are not whitelisted */
+}CAN_FilterSolverType;
+
+/** @brief CAN receive software FIFO structure */
+typedef struct
+{
+    CAN_FrameType *   Frames;           /*!< Frame storage array */
+    uint16_t          Size;             /*!< Number of frames in the storage, must be a power of 2 */
+    volatile uint16_t Head;             /*!< [Internal] Free-running write index (interrupt side) */
+    volatile uint16_t Tail;             /*!< [Internal] Free-running read index (application side) */
+    volatile uint16_t Overruns;         /*!< Number of frames dropped due to full software FIFO */
+    volatile uint16_t HwOverruns;       /*!< Number of hardware FIFO overrun events */
+}CAN_RxQueueType;
+
+/** @brief CAN transmit software FIFO entry structure */
+typedef struct
+{
+    CAN_FrameType     Frame;            /*!< Frame to transmit */
+    uint32_t          Key;              /*!< [Internal] Arbitration field value, lower value wins */
+    uint16_t          Seq;              /*!< [Internal] Enqueueing order among frames with equal keys */
+}CAN_TxEntryType;
+
+/** @brief CAN transmit priority queue structure */
+typedef struct
+{
+    CAN_TxEntryType * Entries;          /*!< Entry storage array, ordered as a binary min-heap */
+    uint16_t          Size;             /*!< Number of entries in the storage */
+    uint16_t          Count;            /*!< [Internal] Number of queued entries */
+    uint16_t          NextSeq;          /*!< [Internal] Sequence number for the next entry */
+    uint8_t           Loaded;           /*!< [Internal] Mailboxes loaded from the queue */
+    uint8_t           Aborting;         /*!< [Internal] Mailboxes aborted for a more urgent frame */
+    CAN_TxEntryType   Mailbox[3];       /*!< [Internal] Entries currently loaded in the mailboxes */
+    volatile uint16_t Preemptions;      /*!< Number of mailboxes aborted for a more urgent frame */
+    volatile uint16_t Failures;         /*!< Number of frames dropped due to transmission failure */
+}CAN_TxQueueType;
+
+/** @brief CAN bus states */
+typedef enum
+{
+    CAN_BUSSTATE_ACTIVE     = 0, /*!< Error active state */
+    CAN_BUSSTATE_WARNING    = 1, /*!< Error warning state */
+    CAN_BUSSTATE_PASSIVE    = 2, /*!< Error passive state */
+    CAN_BUSSTATE_OFF        = 3, /*!< Bus off state */
+}CAN_BusStateType;
+
+/** @brief CAN statistics identifier entry structure */
+typedef struct
+{
+    uint32_t          Key;              /*!< Identifier value, with bit 31 set for extended identifiers */
+    uint32_t          Frames;           /*!< Number of received and transmitted frames */
+    uint16_t          WindowFrames;     /*!< [Internal] Number of frames in the current window */
+    uint16_t          Rate;             /*!< Number of frames in the last completed window */
+}CAN_StatsEntryType;
+
+/** @brief CAN statistics structure */
+typedef struct
+{
+    CAN_StatsEntryType * Entries;       /*!< Identifier hash table storage */
+    uint16_t          Size;             /*!< Number of entries in the storage, must be a power of 2 */
+    uint16_t          WindowTicks;      /*!< Length of the measurement window [ticks] */
+    uint16_t          TickPeriod_us;    /*!< The period of @ref CAN_vStatsTick calls */
+    uint32_t          Bitrate;          /*!< The bitrate of the bus */
+    volatile uint32_t Ticks;            /*!< Elapsed time since statistics start [ticks] */
+    volatile uint32_t RxFrames;         /*!< Number of received frames */
+    volatile uint32_t TxFrames;         /*!< Number of transmitted frames */
+    volatile uint32_t Untracked;        /*!< Number of frames with identifiers not fitting in the table */
+    volatile uint32_t Errors[8];        /*!< Number of bus errors, indexed by @ref CAN_ErrorType >> 4 */
+    uint16_t          BusLoad;          /*!< Bus load in the last completed window [per mille] */
+    uint16_t          PeakBusLoad;      /*!< Highest bus load of all windows [per mille] */
+    uint16_t          PeakErrorBurst;   /*!< Highest number of bus errors within a window */
+    uint16_t          StateChanges;     /*!< Number of bus state transitions */
+    uint8_t           TEC;              /*!< Transmit error counter at the end of the last window */
+    uint8_t           REC;              /*!< Receive error counter at the end of the last window */
+    uint8_t           PeakTEC;          /*!< Highest transmit error counter observed */
+    uint8_t           PeakREC;          /*!< Highest receive error counter observed */
+    CAN_BusStateType  BusState;         /*!< Current bus state */
+    uint32_t          StateTicks[4];    /*!< Time of the last transition to each bus state [ticks] */
+    volatile uint32_t WindowBits;       /*!< [Internal] Bus time used in the current window [bits] */
+    volatile uint16_t WindowErrors;     /*!< [Internal] Bus errors in the current window */
+    uint16_t          WindowTimer;      /*!< [Internal] Ticks until the end of the current window */
+    uint32_t          WindowCapacity;   /*!< [Internal] Bits of a window per mille */
+}CAN_StatsType;
+
+#ifdef __XPD_CAN_TIMESTAMP
+/** @brief CAN timestamp time base structure (requires TTCM enabled in @ref CAN_InitType) */
+typedef struct
+{
+    uint64_t Time;                      /*!< The latest extended frame timestamp [bit times] */
+    uint64_t TxTime[3];                 /*!< The timestamp of the last completed transmission
+                                             of each mailbox [bit times] */
+#ifdef DWT
+    uint32_t Cycles;                    /*!< CPU cycle counter value when Time was captured */
+    uint32_t CyclesPerBit;              /*!< [Internal] CPU cycles of a bit time in 16.16 format */
+    uint32_t BitsPerCycle;              /*!< [Internal] Bit times of a CPU cycle in 0.32 format */
+#endif
+}CAN_TimebaseType;
+#endif
+
 /** @brief CAN Handle structure */
 typedef struct
 {
@@ -155,10 +298,40 @@ typedef struct
         XPD_HandleCallbackType Error;      /*!< Error detection callback */
     } Callbacks;                           /*   Handle Callbacks */
     CAN_FrameType * RxFrame[2];            /*!< [Internal] Pointers to where the received frames will be stored */
+    CAN_RxQueueType * RxQueue[2];          /*!< [Internal] Pointers to the attached receive software FIFOs */
+    CAN_TxQueueType * TxQueue;             /*!< [Internal] Pointer to the attached transmit priority queue */
+    CAN_StatsType * Stats;                 /*!< [Internal] Pointer to the attached statistics */
+#ifdef __XPD_CAN_TIMESTAMP
+    CAN_TimebaseType Timebase;             /*!< Frame timestamp extension state */
+#endif
     RCC_PositionType CtrlPos;              /*!< Relative position for reset and clock control */
     volatile uint8_t State;                /*!< [Internal] CAN interrupt-controlled communication state */
 }CAN_HandleType;
 
+/** @brief CAN gateway route structure */
+typedef struct
+{
+    CAN_IdentifierFieldType Id;         /*!< Identifier to match */
+    uint32_t          Mask;             /*!< Identifier bits that have to match (the type always has to match) */
+    CAN_HandleType *  Output;           /*!< The CAN controller to forward the matching frames to */
+    uint32_t          RewriteMask;      /*!< Identifier bits to replace in the forwarded frames */
+    uint32_t          RewriteValue;     /*!< Replacement value of the identifier bits under RewriteMask */
+    uint32_t          Forwarded;        /*!< Number of forwarded frames */
+    uint32_t          Dropped;          /*!< Number of frames dropped due to no free space in the output */
+    uint32_t          Key;              /*!< [Internal] Identifier register pattern */
+    uint32_t          KeyMask;          /*!< [Internal] Identifier register mask */
+}CAN_RouteType;
+
+/** @brief CAN gateway structure */
+typedef struct
+{
+    CAN_HandleType *  Input;            /*!< The CAN controller whose received frames are routed */
+    CAN_RouteType *   Routes;           /*!< Routing table, the first matching route applies */
+    uint8_t           RouteCount;       /*!< The number of routes */
+    uint32_t          Local;            /*!< Number of unrouted frames passed to the local reception */
+    uint32_t          Discarded;        /*!< Number of unrouted frames without active local reception */
+}CAN_GatewayType;
+
 /** @} */
 
 /** @defgroup CAN_Exported_Macros CAN Exported Macros
@@ -369,6 +542,8 @@ typedef struct
  * @{ */
 
 XPD_ReturnType  CAN_eBitrateConfig      (uint32_t ulBitrate, CAN_TimingConfigType * pxTimingConfig);
+uint8_t         CAN_ucTimingSearch      (const CAN_TimingTargetType * pxTarget,
+                                         CAN_TimingCandidateType axCandidates[], uint8_t ucMaxCount);
 
 /** @addtogroup CAN_Exported_Functions_State
  * @{ */
@@ -380,6 +555,19 @@ XPD_ReturnType  CAN_eWakeUp             (CAN_HandleType * pxCAN);
 
 CAN_ErrorType   CAN_eGetError           (CAN_HandleType * pxCAN);
 
+void            CAN_vStatsStart         (CAN_HandleType * pxCAN, CAN_StatsType * pxStats);
+void            CAN_vStatsStop          (CAN_HandleType * pxCAN);
+void            CAN_vStatsTick          (CAN_HandleType * pxCAN);
+CAN_StatsEntryType * CAN_pxStatsLookup  (CAN_StatsType * pxStats, const CAN_IdentifierFieldType * pxId);
+
+#ifdef __XPD_CAN_TIMESTAMP
+void            CAN_vTimestampStart     (CAN_HandleType * pxCAN);
+#ifdef DWT
+uint64_t        CAN_ullTimestampNow     (CAN_HandleType * pxCAN);
+uint32_t        CAN_ulTimestampToCycles (CAN_HandleType * pxCAN, uint64_t ullTimestamp);
+#endif
+#endif
+
 void            CAN_vIRQHandlerSCE      (CAN_HandleType * pxCAN);
 /** @} */
 
@@ -388,6 +576,22 @@ void            CAN_vIRQHandlerSCE      (CAN_HandleType * pxCAN);
 XPD_ReturnType  CAN_eFilterBankConfig   (CAN_HandleType * pxCAN, uint8_t ucNewSize);
 XPD_ReturnType  CAN_eFilterConfig       (CAN_HandleType * pxCAN, const CAN_FilterType axFilters[],
                                          uint8_t aucMatchIndexes[], uint8_t ucFilterCount);
+
+XPD_ReturnType  CAN_eFilterSolve        (CAN_FilterSolverType * pxSolver, CAN_FilterType axFilters[],
+                                         uint8_t * pucFilterCount);
+boolean_t       CAN_bPostFilter         (const CAN_FilterSolverType * pxSolver, uint32_t ulId);
+void            CAN_vPostFilterBitmap   (const CAN_FilterSolverType * pxSolver, uint32_t aulBitmap[64]);
+
+/**
+ * @brief Determines if a standard identifier is set in a post-filter bitmap.
+ * @param aulBitmap: the bitmap built by @ref CAN_vPostFilterBitmap
+ * @param ulId: the received standard identifier
+ * @return TRUE if the identifier is whitelisted, FALSE otherwise
+ */
+__STATIC_INLINE boolean_t CAN_bPostFilterBitmap(const uint32_t aulBitmap[64], uint32_t ulId)
+{
+    return (aulBitmap[(ulId >> 5) & 63] >> (ulId & 31)) & 1;
+}
 /** @} */
 
 /** @addtogroup CAN_Exported_Functions_Transmit
@@ -398,6 +602,11 @@ XPD_ReturnType  CAN_eSend               (CAN_HandleType * pxCAN, CAN_FrameType *
                                          uint32_t ulTimeout);
 XPD_ReturnType  CAN_eSend_IT            (CAN_HandleType * pxCAN, CAN_FrameType * pxFrame);
 
+XPD_ReturnType  CAN_eTransmitQueue_IT   (CAN_HandleType * pxCAN, CAN_TxQueueType * pxQueue);
+void            CAN_vTransmitQueueStop  (CAN_HandleType * pxCAN);
+XPD_ReturnType  CAN_eEnqueue            (CAN_HandleType * pxCAN, const CAN_FrameType * pxFrame);
+boolean_t       CAN_bTxPending          (CAN_HandleType * pxCAN, const CAN_IdentifierFieldType * pxId);
+
 void            CAN_vIRQHandlerTX       (CAN_HandleType * pxCAN);
 /** @} */
 
@@ -408,8 +617,33 @@ XPD_ReturnType  CAN_eReceive            (CAN_HandleType * pxCAN, CAN_FrameType *
 XPD_ReturnType  CAN_eReceive_IT         (CAN_HandleType * pxCAN, CAN_FrameType * pxFrame,
                                          uint8_t ucFIFONumber);
 
+XPD_ReturnType  CAN_eReceiveQueue_IT    (CAN_HandleType * pxCAN, CAN_RxQueueType * pxQueue,
+                                         uint8_t ucFIFONumber);
+void            CAN_vReceiveQueueStop   (CAN_HandleType * pxCAN, uint8_t ucFIFONumber);
+uint16_t        CAN_usDequeue           (CAN_RxQueueType * pxQueue, CAN_FrameType axFrames[],
+                                         uint16_t usMaxCount);
+
 void            CAN_vIRQHandlerRX0      (CAN_HandleType * pxCAN);
 void            CAN_vIRQHandlerRX1      (CAN_HandleType * pxCAN);
+
+/**
+ * @brief Gets the number of frames waiting in the receive software FIFO.
+ * @param pxQueue: pointer to the receive software FIFO
+ * @return The number of frames available for dequeueing
+ */
+__STATIC_INLINE uint16_t CAN_usQueueCount(CAN_RxQueueType * pxQueue)
+{
+    return (uint16_t)(pxQueue->Head - pxQueue->Tail);
+}
+/** @} */
+
+/** @addtogroup CAN_Exported_Functions_Gateway
+ * @{ */
+void            CAN_vGatewayStart       (CAN_GatewayType * pxGateway);
+void            CAN_vGatewayStop        (CAN_GatewayType * pxGateway);
+
+void            CAN_vGatewayIRQHandlerRX0(CAN_GatewayType * pxGateway);
+void            CAN_vGatewayIRQHandlerRX1(CAN_GatewayType * pxGateway);
 /** @} */
 
 /** @} */
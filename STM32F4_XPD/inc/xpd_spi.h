@@ -93,6 +93,9 @@ typedef struct
                                              @arg @ref ClockDividerType::CLK_DIV64
                                              @arg @ref ClockDividerType::CLK_DIV128
                                              @arg @ref ClockDividerType::CLK_DIV256 */
+        uint32_t         MaxFreq_Hz;/*!< When nonzero, the Prescaler is ignored, and instead the fastest
+                                         setting is used which keeps the SCK frequency at or below
+                                         this value with the current peripheral clock. */
     } Clock;
 #ifdef __XPD_SPI_ERROR_DETECT
     uint8_t  CRC_Length;            /*!< Specifies the CRC length in bits. Permitted values: @arg 8, 16 */
@@ -133,6 +136,15 @@ typedef struct
     }DMA;                                    /*   DMA handle references */
     DataStreamType RxStream;                 /*!< Data reception stream */
     DataStreamType TxStream;                 /*!< Data transmission stream */
+    struct {
+        void *   TxBuffer[2];                /*!< [Internal] Response buffers: one is served while the other is loaded */
+        void *   RxBuffer[2];                /*!< [Internal] Reception buffers: alternated at each frame end */
+        uint16_t Length;                     /*!< [Internal] Capacity of each buffer in data transfers */
+        uint16_t RxCount;                    /*!< Amount of data received in the last completed frame */
+        uint8_t  TxIndex;                    /*!< [Internal] Index of the response buffer being served */
+        uint8_t  RxIndex;                    /*!< [Internal] Index of the reception buffer being filled */
+        volatile uint8_t TxCommit;           /*!< [Internal] Set when the loaded response buffer is ready */
+    }Slave;                                  /*   Double-buffered slave transfer context */
     RCC_PositionType CtrlPos;                /*!< Relative position for reset and clock control */
 #if defined(__XPD_SPI_ERROR_DETECT) || defined(__XPD_DMA_ERROR_DETECT)
     volatile SPI_ErrorType Errors;           /*!< Transfer errors */
@@ -270,6 +282,11 @@ void            SPI_vInit               (SPI_HandleType * pxSPI,
 
 void            SPI_vDeinit             (SPI_HandleType * pxSPI);
 
+ClockDividerType SPI_eCalcPrescaler     (SPI_HandleType * pxSPI,
+                                         uint32_t ulMaxFreq_Hz);
+XPD_ReturnType  SPI_eSetMaxFrequency    (SPI_HandleType * pxSPI,
+                                         uint32_t ulMaxFreq_Hz);
+
 XPD_ReturnType  SPI_eGetStatus          (SPI_HandleType * pxSPI);
 XPD_ReturnType  SPI_ePollStatus         (SPI_HandleType * pxSPI,
                                          uint32_t ulTimeout);
@@ -322,6 +339,44 @@ XPD_ReturnType  SPI_eSendReceive_DMA    (SPI_HandleType * pxSPI,
                                          uint16_t usLength);
 
 void            SPI_vStop_DMA           (SPI_HandleType * pxSPI);
+
+
+XPD_ReturnType  SPI_eSlaveStart_DMA     (SPI_HandleType * pxSPI,
+                                         void * apvTxBuffers[2],
+                                         void * apvRxBuffers[2],
+                                         uint16_t usLength);
+
+void            SPI_vSlaveCommitResponse(SPI_HandleType * pxSPI);
+
+void            SPI_vSlaveNssHandler    (SPI_HandleType * pxSPI);
+
+/**
+ * @brief Provides the response buffer which is not served by the DMA,
+ *        and therefore can be loaded with the next response.
+ * @param pxSPI: pointer to the SPI handle structure
+ * @return Pointer to the next response buffer, or NULL if the previously
+ *         committed response hasn't been swapped in yet
+ */
+__STATIC_INLINE void * SPI_pvSlaveGetResponse(SPI_HandleType * pxSPI)
+{
+    void * pvResponse = NULL;
+
+    if (pxSPI->Slave.TxCommit == 0)
+    {
+        pvResponse = pxSPI->Slave.TxBuffer[pxSPI->Slave.TxIndex ^ 1];
+    }
+    return pvResponse;
+}
+
+/**
+ * @brief Provides the reception buffer of the last completed slave frame.
+ * @param pxSPI: pointer to the SPI handle structure
+ * @return Pointer to the last received data, its length is in Slave.RxCount
+ */
+__STATIC_INLINE void * SPI_pvSlaveGetReception(SPI_HandleType * pxSPI)
+{
+    return pxSPI->Slave.RxBuffer[pxSPI->Slave.RxIndex ^ 1];
+}
 /** @} */
 
 /** @} */
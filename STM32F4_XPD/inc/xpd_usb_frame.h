@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_frame.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB Frame Scheduler Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_USB_FRAME_H_
+#define __XPD_USB_FRAME_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_usb.h>
+
+#if defined(USB) || defined(USB_OTG_FS)
+
+/** @ingroup USB
+ * @defgroup USB_Frame USB Frame Scheduler
+ * @brief    Periodic jobs executed on the SOF of the USB (micro)frames,
+ *           aligned to the host polling of interrupt and isochronous endpoints
+ * @{ */
+
+/** @defgroup USB_Frame_Exported_Types USB Frame Scheduler Exported Types
+ * @{ */
+
+/** @brief USB frame job structure */
+typedef struct USBFRAME_JobType
+{
+    XPD_HandleCallbackType Callback;        /*!< Job function (receives the job pointer) */
+    uint16_t Interval;                      /*!< Job period [(micro)frames], shall be at least 1 */
+    uint16_t Countdown;                     /*!< [Internal] (Micro)frames until the next run */
+    uint32_t Runs;                          /*!< Number of executions */
+    uint32_t Misses;                        /*!< Number of missed deadlines: skipped (micro)frames
+                                                 of the job, or executions overrunning their frame */
+    struct USBFRAME_JobType * Next;         /*!< [Internal] Next job of the scheduler */
+}USBFRAME_JobType;
+
+/** @brief USB frame scheduler handle structure */
+typedef struct
+{
+    USB_HandleType * Link;                  /*!< The USB handle providing the SOF */
+    USBFRAME_JobType * Jobs;                /*!< [Internal] List of the scheduled jobs */
+    uint32_t LostFrames;                    /*!< Number of (micro)frames without SOF processing */
+    uint16_t Frame;                         /*!< [Internal] Last processed (micro)frame number */
+    uint8_t Valid;                          /*!< [Internal] The last frame number is valid */
+}USBFRAME_HandleType;
+
+/** @} */
+
+/** @defgroup USB_Frame_Exported_Functions USB Frame Scheduler Exported Functions
+ * @{ */
+void            USBFRAME_vInit          (USBFRAME_HandleType * pxSched, USB_HandleType * pxUSB);
+
+void            USBFRAME_vAddJob        (USBFRAME_HandleType * pxSched, USBFRAME_JobType * pxJob);
+void            USBFRAME_vRemoveJob     (USBFRAME_HandleType * pxSched, USBFRAME_JobType * pxJob);
+
+void            USBFRAME_vSOF           (USBFRAME_HandleType * pxSched);
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB) || defined(USB_OTG_FS) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_USB_FRAME_H_ */
@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_host.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB OTG Host Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_USB_HOST_H_
+#define __XPD_USB_HOST_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_usb.h>
+
+#if defined(USB_OTG_FS)
+
+/** @ingroup USB
+ * @defgroup USB_Host USB OTG Host
+ * @brief    Host role of the USB OTG cores: root port control and host channels
+ *           for control, bulk and interrupt transfers
+ * @{ */
+
+/** @defgroup USB_Host_Exported_Macros USB OTG Host Exported Macros
+ * @{ */
+
+/** @brief Maximal number of host channels of the available OTG cores */
+#ifdef USB_OTG_HS
+#define USBHOST_MAX_CHANNEL_COUNT   USB_OTG_HS_HOST_MAX_CHANNEL_NBR
+#else
+#define USBHOST_MAX_CHANNEL_COUNT   USB_OTG_FS_HOST_MAX_CHANNEL_NBR
+#endif
+
+/** @brief Channel allocation failure return value */
+#define USBHOST_INVALID_CHANNEL     0xFF
+
+/** @} */
+
+/** @defgroup USB_Host_Exported_Types USB OTG Host Exported Types
+ * @{ */
+
+/** @brief USB host port speed types */
+typedef enum
+{
+    USBHOST_SPEED_HIGH = 0, /*!< High speed device */
+    USBHOST_SPEED_FULL = 1, /*!< Full speed device */
+    USBHOST_SPEED_LOW  = 2, /*!< Low speed device */
+}USBHOST_SpeedType;
+
+/** @brief USB host channel status types */
+typedef enum
+{
+    USBHOST_CH_IDLE  = 0, /*!< No transfer was requested */
+    USBHOST_CH_BUSY  = 1, /*!< Transfer in progress */
+    USBHOST_CH_DONE  = 2, /*!< Transfer completed */
+    USBHOST_CH_NAK   = 3, /*!< Endpoint NAKed, the transfer shall be requested again */
+    USBHOST_CH_STALL = 4, /*!< Endpoint STALLed */
+    USBHOST_CH_ERROR = 5, /*!< Transaction error or device disconnected */
+}USBHOST_ChannelStatusType;
+
+/** @brief USB host channel handle structure */
+typedef struct
+{
+    struct {
+        uint8_t *Data;                      /*!< Current data element of transfer */
+        uint16_t Length;                    /*!< Represents the actual transferred (acknowledged) length,
+                                                 also when the transfer ends unsuccessfully */
+        uint16_t Progress;                  /*!< [Internal] Remaining data to write to the FIFO */
+        uint16_t Size;                      /*!< [Internal] Programmed transfer size */
+    }Transfer;                              /*!< Channel data transfer context */
+    XPD_HandleCallbackType Complete;        /*!< Transfer finished callback (receives the channel pointer) */
+    uint16_t MaxPacketSize;                 /*!< Endpoint Max packet size */
+    uint8_t DevAddress;                     /*!< Device address */
+    uint8_t EpAddress;                      /*!< Endpoint address */
+    USB_EndPointType Type;                  /*!< Endpoint type */
+    uint8_t Toggle;                         /*!< [Internal] Data PID of the next transfer */
+    uint8_t ErrorCount;                     /*!< Number of consecutive failed transfers */
+    uint8_t Allocated;                      /*!< [Internal] The channel is in use */
+    volatile USBHOST_ChannelStatusType Status; /*!< Status of the last requested transfer */
+}USBHOST_ChannelType;
+
+/** @brief USB host handle structure */
+typedef struct
+{
+    USB_OTG_TypeDef * Inst;                 /*!< The address of the peripheral instance used by the handle */
+    struct {
+        XPD_HandleCallbackType DepInit;     /*!< Initialize module dependencies */
+        XPD_HandleCallbackType DepDeinit;   /*!< Restore module dependencies */
+        XPD_HandleCallbackType Connect;     /*!< Device connected, the port shall be reset */
+        XPD_HandleCallbackType Disconnect;  /*!< Device disconnected */
+        XPD_HandleCallbackType PortEnabled; /*!< Port reset finished, enumeration can start */
+        XPD_HandleCallbackType SOF;         /*!< Start Of Frame */
+    }Callbacks;                             /*   Handle Callbacks */
+    USBHOST_ChannelType Channel[USBHOST_MAX_CHANNEL_COUNT]; /*!< Host channels */
+    struct {
+        volatile uint8_t Connected;         /*!< A device is attached to the port */
+        volatile uint8_t Enabled;           /*!< The port is reset and enabled */
+        USBHOST_SpeedType Speed;            /*!< Speed of the attached device */
+    }Port;                                  /*   Root port status */
+}USBHOST_HandleType;
+
+/** @} */
+
+/** @defgroup USB_Host_Exported_Functions USB OTG Host Exported Functions
+ * @{ */
+void            USBHOST_vInit           (USBHOST_HandleType * pxHost, FunctionalState eDMA);
+void            USBHOST_vDeinit         (USBHOST_HandleType * pxHost);
+
+void            USBHOST_vStart_IT       (USBHOST_HandleType * pxHost);
+void            USBHOST_vStop_IT        (USBHOST_HandleType * pxHost);
+
+void            USBHOST_vPortPower      (USBHOST_HandleType * pxHost, FunctionalState eNewState);
+void            USBHOST_vPortReset      (USBHOST_HandleType * pxHost);
+
+uint8_t         USBHOST_ucChannelAlloc  (USBHOST_HandleType * pxHost);
+void            USBHOST_vChannelFree    (USBHOST_HandleType * pxHost, uint8_t ucChNum);
+
+void            USBHOST_vChannelOpen    (USBHOST_HandleType * pxHost, uint8_t ucChNum,
+                                         uint8_t ucDevAddress, uint8_t ucEpAddress,
+                                         USB_EndPointType eType, uint16_t usMaxPacketSize);
+void            USBHOST_vChannelClose   (USBHOST_HandleType * pxHost, uint8_t ucChNum);
+
+void            USBHOST_vChannelSetup   (USBHOST_HandleType * pxHost, uint8_t ucChNum,
+                                         const uint8_t * pucSetup);
+void            USBHOST_vChannelTransfer(USBHOST_HandleType * pxHost, uint8_t ucChNum,
+                                         uint8_t * pucData, uint16_t usLength);
+
+void            USBHOST_vIRQHandler     (USBHOST_HandleType * pxHost);
+
+/**
+ * @brief Sets the data toggle of the next transfer on the channel.
+ *        Control transfer stages shall set it explicitly (DATA1 for the data and status stages),
+ *        bulk and interrupt channels keep track of it on their own.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ * @param ucToggle: 0 for DATA0, 1 for DATA1
+ */
+__STATIC_INLINE void USBHOST_vChannelSetToggle(
+        USBHOST_HandleType * pxHost, uint8_t ucChNum, uint8_t ucToggle)
+{
+    pxHost->Channel[ucChNum].Toggle = (ucToggle != 0) ? 2 : 0;
+}
+
+/**
+ * @brief Returns the status of the last transfer of the channel.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ * @return The channel status
+ */
+__STATIC_INLINE USBHOST_ChannelStatusType USBHOST_eChannelStatus(
+        USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    return pxHost->Channel[ucChNum].Status;
+}
+
+/**
+ * @brief Returns the current (micro)frame number of the host.
+ * @param pxHost: pointer to the USB host handle structure
+ * @return The frame number
+ */
+__STATIC_INLINE uint16_t USBHOST_usFrameNumber(USBHOST_HandleType * pxHost)
+{
+    return pxHost->Inst->HFNUM.b.FRNUM;
+}
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB_OTG_FS) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_USB_HOST_H_ */
@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_stream.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB Bulk Stream Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_USB_STREAM_H_
+#define __XPD_USB_STREAM_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_usb.h>
+
+#if defined(USB) || defined(USB_OTG_FS)
+
+/** @ingroup USB
+ * @defgroup USB_Stream USB Bulk Stream
+ * @brief    Ring buffered byte stream over a bulk IN and OUT endpoint pair,
+ *           the data interface of a CDC-ACM function
+ * @{ */
+
+/** @defgroup USB_Stream_Exported_Types USB Bulk Stream Exported Types
+ * @{ */
+
+/** @brief USB bulk stream handle structure */
+typedef struct
+{
+    USB_HandleType * Link;                  /*!< The USB handle of the endpoints */
+    uint8_t InEpAddress;                    /*!< Address of the bulk IN endpoint */
+    uint8_t OutEpAddress;                   /*!< Address of the bulk OUT endpoint */
+    struct {
+        XPD_HandleCallbackType Transmit;    /*!< Transmit ring space freed up callback */
+        XPD_HandleCallbackType Receive;     /*!< Data received callback */
+    }Callbacks;                             /*   Stream Callbacks (receive the stream pointer) */
+    struct {
+        uint8_t * Buffer;                   /*!< Transmit ring buffer */
+        uint16_t Size;                      /*!< Transmit ring buffer size */
+        volatile uint16_t Head;             /*!< [Internal] Write index of the application */
+        volatile uint16_t Tail;             /*!< [Internal] Start index of the ongoing transfer */
+        uint16_t Length;                    /*!< [Internal] Length of the ongoing transfer */
+        volatile uint8_t Busy;              /*!< [Internal] IN transfer in progress */
+    }Tx;
+    struct {
+        uint8_t * Buffer;                   /*!< Receive ring buffer (its size shall be
+                                                 at least twice the max packet size) */
+        uint16_t Size;                      /*!< Receive ring buffer size */
+        volatile uint16_t Head;             /*!< [Internal] Start index of the ongoing transfer */
+        volatile uint16_t Tail;             /*!< [Internal] Read index of the application */
+        volatile uint16_t End;              /*!< [Internal] End of valid data before wrapping */
+        volatile uint8_t Busy;              /*!< [Internal] OUT transfer in progress */
+    }Rx;
+    volatile uint8_t Active;                /*!< [Internal] The endpoints are open */
+}USBSTREAM_HandleType;
+
+/** @} */
+
+/** @defgroup USB_Stream_Exported_Functions USB Bulk Stream Exported Functions
+ * @{ */
+void            USBSTREAM_vStart        (USBSTREAM_HandleType * pxStream);
+void            USBSTREAM_vStop         (USBSTREAM_HandleType * pxStream);
+
+uint16_t        USBSTREAM_usWrite       (USBSTREAM_HandleType * pxStream,
+                                         const uint8_t * pucData, uint16_t usLength);
+uint16_t        USBSTREAM_usRead        (USBSTREAM_HandleType * pxStream,
+                                         uint8_t * pucData, uint16_t usLength);
+
+uint16_t        USBSTREAM_usWritable    (USBSTREAM_HandleType * pxStream);
+uint16_t        USBSTREAM_usReadable    (USBSTREAM_HandleType * pxStream);
+
+void            USBSTREAM_vDataIn       (USBSTREAM_HandleType * pxStream);
+void            USBSTREAM_vDataOut      (USBSTREAM_HandleType * pxStream);
+
+/**
+ * @brief Determines if the stream has untransmitted data.
+ * @param pxStream: pointer to the USB bulk stream handle
+ * @return TRUE if the transmitter is busy, FALSE otherwise
+ */
+__STATIC_INLINE boolean_t USBSTREAM_bTxBusy(USBSTREAM_HandleType * pxStream)
+{
+    return pxStream->Tx.Busy != 0;
+}
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB) || defined(USB_OTG_FS) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_USB_STREAM_H_ */
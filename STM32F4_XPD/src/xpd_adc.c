@@ -519,18 +519,20 @@ void ADC_vIRQHandler(ADC_HandleType * pxADC)
 }
 
 /**
- * @brief Sets up and enables a DMA transfer for the ADC regular conversions.
+ * @brief Sets up and enables a DMA transfer of the given number of ADC regular conversions.
+ *        With a circular DMA the conversion data storage can hold multiple sequences.
  * @param pxADC: pointer to the ADC handle structure
  * @param pvAddress: memory address to the conversion data storage
+ * @param usLength: the number of conversions to transfer
  * @return BUSY if the DMA is used by other peripheral, OK otherwise
  */
-XPD_ReturnType ADC_eStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
+XPD_ReturnType ADC_eStartBuffer_DMA(ADC_HandleType * pxADC, void * pvAddress, uint16_t usLength)
 {
     XPD_ReturnType eResult;
 
         /* Set up DMA for transfer */
         eResult = DMA_eStart_IT(pxADC->DMA.Conversion,
-                (void *)&pxADC->Inst->DR, pvAddress, pxADC->Inst->SQR1.b.L + 1);
+                (void *)&pxADC->Inst->DR, pvAddress, usLength);
 
         /* If the DMA is currently used, return with error */
         if (eResult == XPD_OK)
@@ -557,6 +559,17 @@ XPD_ReturnType ADC_eStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
     return eResult;
 }
 
+/**
+ * @brief Sets up and enables a DMA transfer for the ADC regular conversions.
+ * @param pxADC: pointer to the ADC handle structure
+ * @param pvAddress: memory address to the conversion data storage
+ * @return BUSY if the DMA is used by other peripheral, OK otherwise
+ */
+XPD_ReturnType ADC_eStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
+{
+    return ADC_eStartBuffer_DMA(pxADC, pvAddress, pxADC->Inst->SQR1.b.L + 1);
+}
+
 /**
  * @brief Disables the ADC and its DMA transfer.
  * @param pxADC: pointer to the ADC handle structure
@@ -812,18 +825,21 @@ void ADC_vMultiModeInit(ADC_HandleType * pxADC, const ADC_MultiModeInitType * px
 }
 
 /**
- * @brief Sets up and enables a DMA transfer for the multi ADC regular conversions.
+ * @brief Sets up and enables a DMA transfer of the given number of multi ADC regular conversions.
+ *        With a circular DMA the conversion data storage can hold multiple sequences.
  * @param pxADC: pointer to the ADC handle structure
  * @param pvAddress: memory address to the conversion data storage
+ * @param usLength: the number of common data transfers
  * @return BUSY if the DMA is used by other peripheral, OK otherwise
  */
-XPD_ReturnType ADC_eMultiModeStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
+XPD_ReturnType ADC_eMultiModeStartBuffer_DMA(ADC_HandleType * pxADC, void * pvAddress,
+        uint16_t usLength)
 {
     XPD_ReturnType eResult;
 
         /* Set up DMA for transfer */
         eResult = DMA_eStart_IT(pxADC->DMA.Conversion,
-                (void *)&ADC_COMMON(pxADC)->CDR.w, pvAddress, pxADC->Inst->SQR1.b.L + 1);
+                (void *)&ADC_COMMON(pxADC)->CDR.w, pvAddress, usLength);
 
         /* If the DMA is currently used, return with error */
         if (eResult == XPD_OK)
@@ -853,6 +869,17 @@ XPD_ReturnType ADC_eMultiModeStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
     return eResult;
 }
 
+/**
+ * @brief Sets up and enables a DMA transfer for the multi ADC regular conversions.
+ * @param pxADC: pointer to the ADC handle structure
+ * @param pvAddress: memory address to the conversion data storage
+ * @return BUSY if the DMA is used by other peripheral, OK otherwise
+ */
+XPD_ReturnType ADC_eMultiModeStart_DMA(ADC_HandleType * pxADC, void * pvAddress)
+{
+    return ADC_eMultiModeStartBuffer_DMA(pxADC, pvAddress, pxADC->Inst->SQR1.b.L + 1);
+}
+
 /**
  * @brief Disables the ADC and the common DMA transfer.
  * @param pxADC: pointer to the ADC handle structure
@@ -0,0 +1,229 @@
+/**
+  ******************************************************************************
+  * @file    xpd_adc_ring.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers ADC Acquisition Ring Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_adc_ring.h>
+#include <xpd_utils.h>
+
+/** @addtogroup ADC_Ring
+ * @{ */
+
+/** @defgroup ADC_Ring_Private_Functions ADC Acquisition Ring Private Functions
+ * @{ */
+
+/**
+ * @brief Publishes the ring half which the DMA has filled.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ * @param ucBlock: index of the filled block
+ */
+static void ADCRING_prvBlockComplete(ADCRING_HandleType * pxRing, uint8_t ucBlock)
+{
+    ADCRING_BlockType * pxBlock = &pxRing->Block[ucBlock];
+    uint8_t ucMask = 1 << ucBlock;
+
+    if ((pxRing->Ready & ucMask) != 0)
+    {
+        /* The DMA has overwritten the block before its release */
+        pxRing->Dropped++;
+    }
+
+    pxBlock->Sequence  = pxRing->Sequence++;
+    pxBlock->Overrun   = pxRing->Restarted;
+    pxRing->Restarted  = 0;
+
+    if (pxRing->Clock != NULL)
+    {
+        pxBlock->Timestamp = pxRing->Clock();
+    }
+    else
+    {
+        pxBlock->Timestamp = pxRing->Conversions;
+    }
+    pxRing->Conversions += pxRing->BlockLength;
+
+    pxRing->Ready |= ucMask;
+
+    XPD_SAFE_CALLBACK(pxRing->BlockComplete, pxRing);
+}
+
+/* DMA half transfer complete -> first block */
+static void ADCRING_prvDmaHalfRedirect(void * pxDMA)
+{
+    ADCRING_prvBlockComplete((ADCRING_HandleType*) ((DMA_HandleType*) pxDMA)->Owner, 0);
+}
+
+/* DMA transfer complete -> second block */
+static void ADCRING_prvDmaCompleteRedirect(void * pxDMA)
+{
+    ADCRING_prvBlockComplete((ADCRING_HandleType*) ((DMA_HandleType*) pxDMA)->Owner, 1);
+}
+
+#ifdef __XPD_DMA_ERROR_DETECT
+/* DMA error -> ADC error */
+static void ADCRING_prvDmaErrorRedirect(void * pxDMA)
+{
+    ADC_HandleType * pxADC = ((ADCRING_HandleType*) ((DMA_HandleType*) pxDMA)->Owner)->Link;
+
+    /* Update error code */
+    pxADC->Errors |= ADC_ERROR_DMA;
+
+    XPD_SAFE_CALLBACK(pxADC->Callbacks.Error, pxADC);
+}
+#endif
+
+/**
+ * @brief Starts the DMA transfer of the whole ring, with the DMA callbacks redirected to the ring.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ * @return BUSY if the DMA is used by other peripheral, OK otherwise
+ */
+static XPD_ReturnType ADCRING_prvStart(ADCRING_HandleType * pxRing)
+{
+    DMA_HandleType * pxDMA = pxRing->Link->DMA.Conversion;
+    XPD_ReturnType eResult;
+
+    eResult = ADC_eStartBuffer_DMA(pxRing->Link, pxRing->Buffer, 2 * pxRing->BlockLength);
+
+    if (eResult == XPD_OK)
+    {
+        /* Set the callback owner */
+        pxDMA->Owner = pxRing;
+
+        /* Set the DMA transfer callbacks */
+        pxDMA->Callbacks.HalfComplete = ADCRING_prvDmaHalfRedirect;
+        pxDMA->Callbacks.Complete     = ADCRING_prvDmaCompleteRedirect;
+#ifdef __XPD_DMA_ERROR_DETECT
+        pxDMA->Callbacks.Error        = ADCRING_prvDmaErrorRedirect;
+#endif
+
+        DMA_IT_ENABLE(pxDMA, HT);
+    }
+    return eResult;
+}
+
+/** @} */
+
+/** @defgroup ADC_Ring_Exported_Functions ADC Acquisition Ring Exported Functions
+ * @{ */
+
+/**
+ * @brief Starts the continuous acquisition into the ring buffer.
+ * @note  The ADC shall be initialized with external trigger (by a timer for constant sample rate)
+ *        and continuous DMA requests, its DMA with circular mode. The trigger source shall be
+ *        started after this call.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ * @return BUSY if the DMA is used by other peripheral, OK otherwise
+ */
+XPD_ReturnType ADCRING_eStart(ADCRING_HandleType * pxRing)
+{
+    pxRing->Block[0].Data   = pxRing->Buffer;
+    pxRing->Block[0].Length = pxRing->BlockLength;
+    pxRing->Block[1].Data   = &pxRing->Buffer[pxRing->BlockLength];
+    pxRing->Block[1].Length = pxRing->BlockLength;
+
+    pxRing->Sequence    = 0;
+    pxRing->Conversions = 0;
+    pxRing->Ready       = 0;
+    pxRing->Restarted   = 0;
+    pxRing->Overruns    = 0;
+    pxRing->Dropped     = 0;
+
+    return ADCRING_prvStart(pxRing);
+}
+
+/**
+ * @brief Stops the acquisition. The unreleased blocks remain available.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ */
+void ADCRING_vStop(ADCRING_HandleType * pxRing)
+{
+    ADC_vStop_DMA(pxRing->Link);
+}
+
+/**
+ * @brief Provides the oldest unreleased block of the ring.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ * @return Pointer to the block, or NULL if no block is ready
+ */
+const ADCRING_BlockType * ADCRING_pxGetBlock(ADCRING_HandleType * pxRing)
+{
+    const ADCRING_BlockType * pxBlock = NULL;
+
+    XPD_ENTER_CRITICAL(pxRing);
+
+    switch (pxRing->Ready)
+    {
+        case 1:
+            pxBlock = &pxRing->Block[0];
+            break;
+
+        case 2:
+            pxBlock = &pxRing->Block[1];
+            break;
+
+        case 3:
+            pxBlock = ((int32_t)(pxRing->Block[1].Sequence - pxRing->Block[0].Sequence) > 0) ?
+                    &pxRing->Block[0] : &pxRing->Block[1];
+            break;
+
+        default:
+            break;
+    }
+
+    XPD_EXIT_CRITICAL(pxRing);
+
+    return pxBlock;
+}
+
+/**
+ * @brief Hands the block back to the DMA. The block data shall be processed
+ *        within a block period after its completion, or it is dropped.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ * @param pxBlock: pointer to the processed block
+ */
+void ADCRING_vReleaseBlock(ADCRING_HandleType * pxRing, const ADCRING_BlockType * pxBlock)
+{
+    XPD_ENTER_CRITICAL(pxRing);
+
+    pxRing->Ready &= ~(1 << (pxBlock - pxRing->Block));
+
+    XPD_EXIT_CRITICAL(pxRing);
+}
+
+/**
+ * @brief Restarts the acquisition after an ADC overrun, and flags the next block.
+ *        Shall be called from the ADC Error callback when the ADC_ERROR_OVERRUN is set.
+ * @note  The conversions missed during the restart aren't included in the
+ *        conversion index based timestamps.
+ * @param pxRing: pointer to the ADC acquisition ring handle
+ */
+void ADCRING_vOverrun(ADCRING_HandleType * pxRing)
+{
+    ADC_vStop_DMA(pxRing->Link);
+
+    pxRing->Overruns++;
+    pxRing->Restarted = 1;
+
+    (void) ADCRING_prvStart(pxRing);
+}
+
+/** @} */
+
+/** @} */
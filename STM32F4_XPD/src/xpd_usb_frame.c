@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_frame.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB Frame Scheduler Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_usb_frame.h>
+#include <xpd_utils.h>
+
+#if defined(USB) || defined(USB_OTG_FS)
+
+/** @addtogroup USB_Frame
+ * @{ */
+
+/** @defgroup USB_Frame_Exported_Functions USB Frame Scheduler Exported Functions
+ * @{ */
+
+/**
+ * @brief Initializes the frame scheduler without any jobs.
+ * @param pxSched: pointer to the USB frame scheduler handle
+ * @param pxUSB: pointer to the USB handle providing the SOF
+ */
+void USBFRAME_vInit(USBFRAME_HandleType * pxSched, USB_HandleType * pxUSB)
+{
+    pxSched->Link       = pxUSB;
+    pxSched->Jobs       = NULL;
+    pxSched->LostFrames = 0;
+    pxSched->Valid      = 0;
+}
+
+/**
+ * @brief Adds a job to the scheduler, its first run is in Interval (micro)frames.
+ * @param pxSched: pointer to the USB frame scheduler handle
+ * @param pxJob: pointer to the job to schedule
+ */
+void USBFRAME_vAddJob(USBFRAME_HandleType * pxSched, USBFRAME_JobType * pxJob)
+{
+    pxJob->Countdown = pxJob->Interval;
+    pxJob->Runs      = 0;
+    pxJob->Misses    = 0;
+
+    XPD_ENTER_CRITICAL(pxSched);
+
+    pxJob->Next = pxSched->Jobs;
+    pxSched->Jobs = pxJob;
+
+    XPD_EXIT_CRITICAL(pxSched);
+}
+
+/**
+ * @brief Removes a job from the scheduler.
+ * @param pxSched: pointer to the USB frame scheduler handle
+ * @param pxJob: pointer to the scheduled job
+ */
+void USBFRAME_vRemoveJob(USBFRAME_HandleType * pxSched, USBFRAME_JobType * pxJob)
+{
+    USBFRAME_JobType ** ppxLink;
+
+    XPD_ENTER_CRITICAL(pxSched);
+
+    for (ppxLink = &pxSched->Jobs; *ppxLink != NULL; ppxLink = &(*ppxLink)->Next)
+    {
+        if (*ppxLink == pxJob)
+        {
+            *ppxLink = pxJob->Next;
+            break;
+        }
+    }
+
+    XPD_EXIT_CRITICAL(pxSched);
+}
+
+/**
+ * @brief Runs the jobs that are due in the current (micro)frame.
+ *        Shall be called from the USB SOF callback (the SOF interrupt has to be enabled).
+ * @param pxSched: pointer to the USB frame scheduler handle
+ */
+void USBFRAME_vSOF(USBFRAME_HandleType * pxSched)
+{
+    USBFRAME_JobType * pxJob;
+    uint16_t usFrame = USB_usFrameNumber(pxSched->Link);
+    uint16_t usElapsed = 1;
+
+    if (pxSched->Valid != 0)
+    {
+        usElapsed = (usFrame - pxSched->Frame) & USB_FRAME_NUMBER_MASK(pxSched->Link);
+    }
+    pxSched->Frame = usFrame;
+    pxSched->Valid = 1;
+
+    if (usElapsed > 1)
+    {
+        /* The SOF processing was delayed beyond the next SOF */
+        pxSched->LostFrames += usElapsed - 1;
+    }
+
+    for (pxJob = pxSched->Jobs; (usElapsed > 0) && (pxJob != NULL); pxJob = pxJob->Next)
+    {
+        if (pxJob->Countdown > usElapsed)
+        {
+            pxJob->Countdown -= usElapsed;
+        }
+        else
+        {
+            /* Keep the phase of the job if it is late */
+            uint16_t usLate = (usElapsed - pxJob->Countdown) % pxJob->Interval;
+
+            if (pxJob->Countdown < usElapsed)
+            {
+                pxJob->Misses++;
+            }
+            pxJob->Countdown = pxJob->Interval - usLate;
+
+            XPD_SAFE_CALLBACK(pxJob->Callback, pxJob);
+            pxJob->Runs++;
+
+            /* The job shall finish within its frame */
+            if (USB_usFrameNumber(pxSched->Link) != usFrame)
+            {
+                pxJob->Misses++;
+            }
+        }
+    }
+}
+
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB) || defined(USB_OTG_FS) */
@@ -0,0 +1,879 @@
+/**
+  ******************************************************************************
+  * @file    xpd_usb_host.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers USB OTG Host Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_usb_host.h>
+#include <xpd_rcc.h>
+#include <xpd_utils.h>
+
+#if defined(USB_OTG_FS)
+
+/** @addtogroup USB_Host
+ * @{ */
+
+#ifdef USB_OTG_HS
+#define IS_USB_OTG_HS(INST)         ((uint32_t)(INST) == USB_OTG_HS_PERIPH_BASE)
+#define USBHOST_CHANNEL_COUNT(HANDLE) (IS_USB_OTG_HS((HANDLE)->Inst) ?      \
+        USB_OTG_HS_HOST_MAX_CHANNEL_NBR : USB_OTG_FS_HOST_MAX_CHANNEL_NBR)
+#define USBHOST_DMA_CONFIG(HANDLE)  USB_REG_BIT((HANDLE),GAHBCFG,DMAEN)
+#else
+#define IS_USB_OTG_HS(INST)         0
+#define USBHOST_CHANNEL_COUNT(HANDLE) USB_OTG_FS_HOST_MAX_CHANNEL_NBR
+#define USBHOST_DMA_CONFIG(HANDLE)  0
+#endif
+
+/* FIFO sizes in words: receive, non-periodic transmit, periodic transmit */
+#define USBHOST_FS_FIFO_SIZES       0x80, 0x60, 0x40
+#define USBHOST_HS_FIFO_SIZES       0x200, 0x100, 0xE0
+
+#define USBHOST_PID_DATA0           0
+#define USBHOST_PID_DATA1           2
+#define USBHOST_PID_SETUP           3
+
+#define USBHOST_PORT_RESET_ms       20
+#define USBHOST_MODE_CHANGE_ms      50
+
+#define STS_IN_DATA_UPDT            (2 << USB_OTG_GRXSTSP_PKTSTS_Pos)
+
+/* HPRT bits which are cleared by writing 1, masked out when modifying the register */
+#define USBHOST_HPRT_RC_MASK        (USB_OTG_HPRT_PENA | USB_OTG_HPRT_PCDET | \
+                                     USB_OTG_HPRT_PENCHNG | USB_OTG_HPRT_POCCHNG)
+
+#define USBHOST_IS_PERIODIC(CH)     (((CH)->Type == USB_EP_TYPE_INTERRUPT) || \
+                                     ((CH)->Type == USB_EP_TYPE_ISOCHRONOUS))
+
+/* Reads the port register without its change flags */
+__STATIC_INLINE uint32_t USBHOST_prvPortStatus(USBHOST_HandleType * pxHost)
+{
+    return pxHost->Inst->HPRT.w & ~USBHOST_HPRT_RC_MASK;
+}
+
+/* Resets the USB OTG core */
+static void USBHOST_prvReset(USBHOST_HandleType * pxHost)
+{
+    if (USB_REG_BIT(pxHost,GRSTCTL,AHBIDL) != 0)
+    {
+        USB_REG_BIT(pxHost,GRSTCTL,CSRST) = 1;
+    }
+}
+
+/* Sets the FIFO sizes and flushes all FIFOs */
+static void USBHOST_prvFifoInit(USBHOST_HandleType * pxHost,
+        uint16_t usRxSize, uint16_t usNpTxSize, uint16_t usPTxSize)
+{
+    pxHost->Inst->GRXFSIZ = usRxSize;
+    pxHost->Inst->DIEPTXF0_HNPTXFSIZ.w = ((uint32_t)usNpTxSize << 16) | usRxSize;
+    pxHost->Inst->HPTXFSIZ.w = ((uint32_t)usPTxSize << 16) | (usRxSize + usNpTxSize);
+
+    pxHost->Inst->GRSTCTL.w = USB_OTG_GRSTCTL_TXFFLSH | (0x10 << USB_OTG_GRSTCTL_TXFNUM_Pos);
+    while (USB_REG_BIT(pxHost,GRSTCTL,TXFFLSH) != 0);
+
+    pxHost->Inst->GRSTCTL.w = USB_OTG_GRSTCTL_RXFFLSH;
+    while (USB_REG_BIT(pxHost,GRSTCTL,RXFFLSH) != 0);
+}
+
+/* Push packet data to the channel's transmit FIFO */
+static void USBHOST_prvWriteFifo(USBHOST_HandleType * pxHost,
+        uint8_t ucChNum, const uint8_t * pucData, uint16_t usLength)
+{
+    __IO uint32_t * pulFifo = &pxHost->Inst->DFIFO[ucChNum].DR;
+    uint16_t usWordCount = usLength / sizeof(uint32_t);
+
+    for (; usWordCount > 0; usWordCount--, pucData += 4)
+    {
+        *pulFifo = __UNALIGNED_UINT32_READ(pucData);
+    }
+
+    /* Last partial word, without reading past the end of the data */
+    usLength &= 3;
+    if (usLength > 0)
+    {
+        uint32_t ulWord = 0;
+        uint8_t ucByte;
+
+        for (ucByte = 0; ucByte < usLength; ucByte++)
+        {
+            ulWord |= (uint32_t)pucData[ucByte] << (ucByte * 8);
+        }
+        *pulFifo = ulWord;
+    }
+}
+
+/* Pop packet data from the receive FIFO */
+static void USBHOST_prvReadFifo(USBHOST_HandleType * pxHost,
+        uint8_t * pucData, uint16_t usLength)
+{
+    __IO uint32_t * pulFifo = &pxHost->Inst->DFIFO[0].DR;
+    uint16_t usWordCount = usLength / sizeof(uint32_t);
+
+    for (; usWordCount > 0; usWordCount--, pucData += 4)
+    {
+        __UNALIGNED_UINT32_WRITE(pucData, *pulFifo);
+    }
+
+    /* Last partial word, without writing past the end of the buffer */
+    usLength &= 3;
+    if (usLength > 0)
+    {
+        uint32_t ulWord = *pulFifo;
+
+        for (; usLength > 0; usLength--, ulWord >>= 8)
+        {
+            *pucData++ = (uint8_t)ulWord;
+        }
+    }
+}
+
+/* Writes the OUT packets of the channel while there is space in the transmit FIFO */
+static void USBHOST_prvWritePackets(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+    boolean_t bPeriodic = USBHOST_IS_PERIODIC(pxCh);
+
+    while (pxCh->Transfer.Progress > 0)
+    {
+        uint16_t usPacket = (pxCh->Transfer.Progress > pxCh->MaxPacketSize) ?
+                pxCh->MaxPacketSize : pxCh->Transfer.Progress;
+        uint16_t usSpace = (bPeriodic) ? pxHost->Inst->HPTXSTS.b.PTXFSAVL :
+                (*(__IO uint32_t *)&pxHost->Inst->HNPTXSTS & USB_OTG_GNPTXSTS_NPTXFSAV_Msk);
+
+        if (usSpace < ((usPacket + 3) / 4))
+        {
+            /* Continue when the FIFO is empty */
+            if (bPeriodic)
+            {
+                USB_IT_ENABLE(pxHost, PTXFE);
+            }
+            else
+            {
+                USB_IT_ENABLE(pxHost, NPTXFE);
+            }
+            break;
+        }
+
+        USBHOST_prvWriteFifo(pxHost, ucChNum, pxCh->Transfer.Data, usPacket);
+        pxCh->Transfer.Data     += usPacket;
+        pxCh->Transfer.Progress -= usPacket;
+    }
+}
+
+/* Requests the channel to stop, the channel halted interrupt confirms it */
+static void USBHOST_prvChannelHalt(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USB_OTG_HostChannelTypeDef * pxHC = &pxHost->Inst->HC[ucChNum];
+
+    if (pxHC->HCCHAR.b.CHENA != 0)
+    {
+        pxHC->HCCHAR.w |= USB_OTG_HCCHAR_CHDIS | USB_OTG_HCCHAR_CHENA;
+    }
+}
+
+/* Re-enables the channel to continue the transfer */
+static void USBHOST_prvChannelResume(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USB_OTG_HostChannelTypeDef * pxHC = &pxHost->Inst->HC[ucChNum];
+    uint32_t ulHCCHAR = pxHC->HCCHAR.w;
+
+    ulHCCHAR &= ~USB_OTG_HCCHAR_CHDIS;
+    ulHCCHAR |= USB_OTG_HCCHAR_CHENA;
+    pxHC->HCCHAR.w = ulHCCHAR;
+}
+
+/* Programs the channel for the transfer and enables it */
+static void USBHOST_prvChannelStart(USBHOST_HandleType * pxHost, uint8_t ucChNum, uint8_t ucPID)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+    USB_OTG_HostChannelTypeDef * pxHC = &pxHost->Inst->HC[ucChNum];
+    uint32_t ulPackets = (pxCh->Transfer.Size + pxCh->MaxPacketSize - 1) / pxCh->MaxPacketSize;
+    uint32_t ulHCCHAR;
+
+    /* A zero length packet is a packet as well */
+    if (ulPackets == 0)
+    {
+        ulPackets = 1;
+    }
+    /* IN transfers receive whole packets */
+    if ((pxCh->EpAddress & 0x80) != 0)
+    {
+        pxCh->Transfer.Size = ulPackets * pxCh->MaxPacketSize;
+    }
+
+    pxCh->Transfer.Length = 0;
+    pxCh->Status = USBHOST_CH_BUSY;
+
+    pxHC->HCTSIZ.w = pxCh->Transfer.Size |
+            (ulPackets << USB_OTG_HCTSIZ_PKTCNT_Pos) |
+            ((uint32_t)ucPID << USB_OTG_HCTSIZ_DPID_Pos);
+
+#ifdef USB_OTG_HS
+    if (USBHOST_DMA_CONFIG(pxHost) != 0)
+    {
+        pxHC->HCDMA = (uint32_t)pxCh->Transfer.Data;
+    }
+#endif
+
+    ulHCCHAR = pxHC->HCCHAR.w & ~(USB_OTG_HCCHAR_CHDIS | USB_OTG_HCCHAR_ODDFRM);
+
+    /* Periodic transfers are scheduled for the next frame */
+    if (USBHOST_IS_PERIODIC(pxCh) && ((pxHost->Inst->HFNUM.b.FRNUM & 1) == 0))
+    {
+        ulHCCHAR |= USB_OTG_HCCHAR_ODDFRM;
+    }
+    pxHC->HCCHAR.w = ulHCCHAR | USB_OTG_HCCHAR_CHENA;
+
+    /* Slave mode OUT data is pushed to the FIFO by the CPU */
+    if (((pxCh->EpAddress & 0x80) == 0) && (USBHOST_DMA_CONFIG(pxHost) == 0))
+    {
+        USBHOST_prvWritePackets(pxHost, ucChNum);
+    }
+}
+
+/* Saves the data toggle and the acknowledged length of the stopped transfer */
+static void USBHOST_prvChannelSaveState(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+    USB_OTG_HostChannelTypeDef * pxHC = &pxHost->Inst->HC[ucChNum];
+
+    /* The core maintains the data toggle during the transfer */
+    if (pxCh->Type != USB_EP_TYPE_CONTROL)
+    {
+        pxCh->Toggle = pxHC->HCTSIZ.b.DPID;
+    }
+
+    if ((pxCh->EpAddress & 0x80) == 0)
+    {
+        uint32_t ulPackets = (pxCh->Transfer.Size + pxCh->MaxPacketSize - 1) / pxCh->MaxPacketSize;
+        uint32_t ulLength;
+
+        if (ulPackets == 0)
+        {
+            ulPackets = 1;
+        }
+
+        /* The packet count is only decremented by acknowledged packets */
+        ulLength = (ulPackets - pxHC->HCTSIZ.b.PKTCNT) * pxCh->MaxPacketSize;
+        if (ulLength > pxCh->Transfer.Size)
+        {
+            ulLength = pxCh->Transfer.Size;
+        }
+        pxCh->Transfer.Length = ulLength;
+    }
+    else if (USBHOST_DMA_CONFIG(pxHost) != 0)
+    {
+        /* The remaining size is left in the register */
+        pxCh->Transfer.Length = pxCh->Transfer.Size - pxHC->HCTSIZ.b.XFRSIZ;
+    }
+}
+
+/* Ends the current transfer of the channel with the given status */
+static void USBHOST_prvChannelFinish(USBHOST_HandleType * pxHost, uint8_t ucChNum,
+        USBHOST_ChannelStatusType eStatus)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+
+    /* In slave mode the channel has to be stopped by the application */
+    if ((eStatus != USBHOST_CH_DONE) || (USBHOST_DMA_CONFIG(pxHost) == 0))
+    {
+        USBHOST_prvChannelHalt(pxHost, ucChNum);
+    }
+
+    pxCh->Transfer.Progress = 0;
+    pxCh->Status = eStatus;
+
+    XPD_SAFE_CALLBACK(pxCh->Complete, pxCh);
+}
+
+/* Handles the interrupts of a host channel */
+static void USBHOST_prvChannelEventHandler(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+    USB_OTG_HostChannelTypeDef * pxHC = &pxHost->Inst->HC[ucChNum];
+    uint32_t ulHCINT = pxHC->HCINT.w & pxHC->HCINTMSK.w;
+
+    /* Clear the handled flags */
+    pxHC->HCINT.w = ulHCINT;
+
+    if (pxCh->Status != USBHOST_CH_BUSY)
+    {
+        /* Halt confirmation or late events are ignored */
+    }
+    else if ((ulHCINT & USB_OTG_HCINT_XFRC) != 0)
+    {
+        pxCh->ErrorCount = 0;
+
+        USBHOST_prvChannelSaveState(pxHost, ucChNum);
+        USBHOST_prvChannelFinish(pxHost, ucChNum, USBHOST_CH_DONE);
+    }
+    else if ((ulHCINT & USB_OTG_HCINT_STALL) != 0)
+    {
+        USBHOST_prvChannelSaveState(pxHost, ucChNum);
+        USBHOST_prvChannelFinish(pxHost, ucChNum, USBHOST_CH_STALL);
+    }
+    else if ((ulHCINT & (USB_OTG_HCINT_TXERR | USB_OTG_HCINT_BBERR |
+            USB_OTG_HCINT_DTERR | USB_OTG_HCINT_FRMOR | USB_OTG_HCINT_AHBERR)) != 0)
+    {
+        pxCh->ErrorCount++;
+
+        /* Keep the progress of the acknowledged packets for the retry */
+        USBHOST_prvChannelSaveState(pxHost, ucChNum);
+        USBHOST_prvChannelFinish(pxHost, ucChNum, USBHOST_CH_ERROR);
+    }
+    else if ((ulHCINT & USB_OTG_HCINT_NAK) != 0)
+    {
+        if (((pxCh->EpAddress & 0x80) != 0) && !USBHOST_IS_PERIODIC(pxCh))
+        {
+            /* Keep polling the non-periodic IN endpoint */
+            USBHOST_prvChannelResume(pxHost, ucChNum);
+        }
+        else
+        {
+            /* Periodic endpoints are polled again in a later frame,
+             * OUT data has to be pushed again from the first unacknowledged packet */
+            USBHOST_prvChannelSaveState(pxHost, ucChNum);
+            USBHOST_prvChannelFinish(pxHost, ucChNum, USBHOST_CH_NAK);
+        }
+    }
+}
+
+/* Handles the root port events */
+static void USBHOST_prvPortEventHandler(USBHOST_HandleType * pxHost)
+{
+    uint32_t ulHPRT = pxHost->Inst->HPRT.w;
+    uint32_t ulChanges = ulHPRT &
+            (USB_OTG_HPRT_PCDET | USB_OTG_HPRT_PENCHNG | USB_OTG_HPRT_POCCHNG);
+
+    /* Acknowledge the changes without disabling the port */
+    pxHost->Inst->HPRT.w = (ulHPRT & ~USBHOST_HPRT_RC_MASK) | ulChanges;
+
+    if ((ulChanges & USB_OTG_HPRT_PCDET) != 0)
+    {
+        pxHost->Port.Connected = 1;
+
+        XPD_SAFE_CALLBACK(pxHost->Callbacks.Connect, pxHost);
+    }
+
+    if ((ulChanges & USB_OTG_HPRT_PENCHNG) != 0)
+    {
+        if ((ulHPRT & USB_OTG_HPRT_PENA) != 0)
+        {
+            USBHOST_SpeedType eSpeed = (ulHPRT & USB_OTG_HPRT_PSPD_Msk) >> USB_OTG_HPRT_PSPD_Pos;
+            uint8_t ucClockSel = (eSpeed == USBHOST_SPEED_LOW) ? 2 : 1;
+
+            pxHost->Port.Speed = eSpeed;
+
+            if (pxHost->Inst->HCFG.b.FSLSPCS != ucClockSel)
+            {
+                /* The PHY clock is selected by the device speed,
+                 * the port has to be reset again after the change */
+                pxHost->Inst->HCFG.b.FSLSPCS = ucClockSel;
+                pxHost->Inst->HFIR = (eSpeed == USBHOST_SPEED_LOW) ? 6000 : 48000;
+
+                XPD_SAFE_CALLBACK(pxHost->Callbacks.Connect, pxHost);
+            }
+            else
+            {
+                pxHost->Port.Enabled = 1;
+
+                XPD_SAFE_CALLBACK(pxHost->Callbacks.PortEnabled, pxHost);
+            }
+        }
+        else
+        {
+            pxHost->Port.Enabled = 0;
+        }
+    }
+}
+
+/** @defgroup USB_Host_Exported_Functions USB OTG Host Exported Functions
+ * @{ */
+
+/**
+ * @brief Initializes the USB OTG peripheral in host mode with the embedded full speed PHY.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param eDMA: use the dedicated DMA of the HS core (transfer buffers shall be word aligned),
+ *              ignored on FS cores
+ */
+void USBHOST_vInit(USBHOST_HandleType * pxHost, FunctionalState eDMA)
+{
+    uint8_t ucChNum;
+
+    /* Enable peripheral clock */
+#ifdef USB_OTG_HS
+    if (IS_USB_OTG_HS(pxHost->Inst))
+    {
+        RCC_vClockEnable(RCC_POS_OTG_HS);
+    }
+    else
+#endif
+    {
+        RCC_vClockEnable(RCC_POS_OTG_FS);
+    }
+
+    /* Disable interrupts */
+    USB_REG_BIT(pxHost,GAHBCFG,GINT) = 0;
+
+    /* Initialize dependencies (pins, IRQ lines, VBUS switch) */
+    XPD_SAFE_CALLBACK(pxHost->Callbacks.DepInit, pxHost);
+
+    /* Select FS Embedded PHY */
+    USB_REG_BIT(pxHost,GUSBCFG,PHYSEL) = 1;
+
+    USBHOST_prvReset(pxHost);
+
+    pxHost->Inst->GCCFG.w = USB_OTG_GCCFG_PWRDWN;
+
+#ifdef USB_OTG_HS
+    /* Set dedicated DMA */
+    if (IS_USB_OTG_HS(pxHost->Inst) && (eDMA != DISABLE))
+    {
+        SET_BIT(pxHost->Inst->GAHBCFG.w,
+                USB_OTG_GAHBCFG_HBSTLEN_2 | USB_OTG_GAHBCFG_DMAEN);
+    }
+#endif
+
+    /* Set Host Mode */
+    MODIFY_REG(pxHost->Inst->GUSBCFG.w,
+            USB_OTG_GUSBCFG_FHMOD | USB_OTG_GUSBCFG_FDMOD,
+            USB_OTG_GUSBCFG_FHMOD);
+    XPD_vDelay_ms(USBHOST_MODE_CHANGE_ms);
+
+    /* VBUS is supplied by the application */
+#ifdef USB_OTG_GCCFG_VBDEN
+    USB_REG_BIT(pxHost,GCCFG,VBDEN) = 0;
+#else
+    USB_REG_BIT(pxHost,GCCFG,NOVBUSSENS) = 1;
+#endif
+
+    /* Restart the Phy Clock */
+    pxHost->Inst->PCGCCTL.w = 0;
+
+    /* FS and LS devices only, 48 MHz PHY clock */
+    pxHost->Inst->HCFG.w = USB_OTG_HCFG_FSLSS | USB_OTG_HCFG_FSLSPCS_0;
+
+#ifdef USB_OTG_HS
+    if (IS_USB_OTG_HS(pxHost->Inst))
+    {
+        USBHOST_prvFifoInit(pxHost, USBHOST_HS_FIFO_SIZES);
+    }
+    else
+#endif
+    {
+        USBHOST_prvFifoInit(pxHost, USBHOST_FS_FIFO_SIZES);
+    }
+
+    /* Reset the channels */
+    for (ucChNum = 0; ucChNum < USBHOST_CHANNEL_COUNT(pxHost); ucChNum++)
+    {
+        pxHost->Inst->HC[ucChNum].HCINTMSK.w = 0;
+        pxHost->Inst->HC[ucChNum].HCINT.w = 0xFFFFFFFF;
+
+        pxHost->Channel[ucChNum].Allocated = 0;
+        pxHost->Channel[ucChNum].Status = USBHOST_CH_IDLE;
+    }
+    pxHost->Inst->HAINTMSK = 0;
+
+    pxHost->Port.Connected = 0;
+    pxHost->Port.Enabled = 0;
+}
+
+/**
+ * @brief Restores the USB peripheral to its default inactive state
+ * @param pxHost: pointer to the USB host handle structure
+ */
+void USBHOST_vDeinit(USBHOST_HandleType * pxHost)
+{
+    USBHOST_vStop_IT(pxHost);
+
+    /* Deinitialize dependencies */
+    XPD_SAFE_CALLBACK(pxHost->Callbacks.DepDeinit, pxHost);
+
+    /* Disable peripheral clock */
+#ifdef USB_OTG_HS
+    if (IS_USB_OTG_HS(pxHost->Inst))
+    {
+        RCC_vClockDisable(RCC_POS_OTG_HS);
+    }
+    else
+#endif
+    {
+        RCC_vClockDisable(RCC_POS_OTG_FS);
+    }
+}
+
+/**
+ * @brief Starts the USB host operation: enables the interrupts and powers the port.
+ * @param pxHost: pointer to the USB host handle structure
+ */
+void USBHOST_vStart_IT(USBHOST_HandleType * pxHost)
+{
+    uint32_t ulGINTMSK;
+
+    /* Clear any pending interrupts except SRQ */
+    pxHost->Inst->GINTSTS.w = ~USB_OTG_GINTSTS_SRQINT;
+
+    /* Enable interrupts matching to the Host mode ONLY */
+    ulGINTMSK = USB_OTG_GINTMSK_PRTIM | USB_OTG_GINTMSK_HCIM |
+                USB_OTG_GINTMSK_DISCINT;
+
+    /* When DMA is used, Rx data isn't read by IRQHandler */
+    if (USBHOST_DMA_CONFIG(pxHost) == 0)
+    {
+        SET_BIT(ulGINTMSK, USB_OTG_GINTMSK_RXFLVLM);
+    }
+
+    /* Apply interrupts selection */
+    pxHost->Inst->GINTMSK.w = ulGINTMSK;
+
+    USBHOST_vPortPower(pxHost, ENABLE);
+
+    /* Enable global interrupts */
+    USB_REG_BIT(pxHost,GAHBCFG,GINT) = 1;
+}
+
+/**
+ * @brief Stops the USB host operation: stops the channels and removes the port power.
+ * @param pxHost: pointer to the USB host handle structure
+ */
+void USBHOST_vStop_IT(USBHOST_HandleType * pxHost)
+{
+    uint8_t ucChNum;
+
+    /* Disable global interrupts */
+    USB_REG_BIT(pxHost,GAHBCFG,GINT) = 0;
+
+    for (ucChNum = 0; ucChNum < USBHOST_CHANNEL_COUNT(pxHost); ucChNum++)
+    {
+        USBHOST_prvChannelHalt(pxHost, ucChNum);
+        pxHost->Inst->HC[ucChNum].HCINTMSK.w = 0;
+        pxHost->Inst->HC[ucChNum].HCINT.w = 0xFFFFFFFF;
+    }
+    pxHost->Inst->HAINTMSK = 0;
+
+    /* Clear interrupt masks */
+    pxHost->Inst->GINTMSK.w = 0;
+    pxHost->Inst->GINTSTS.w = ~USB_OTG_GINTSTS_SRQINT;
+
+    USBHOST_vPortPower(pxHost, DISABLE);
+
+    pxHost->Port.Connected = 0;
+    pxHost->Port.Enabled = 0;
+}
+
+/**
+ * @brief Sets the root port power state.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param eNewState: the port power state to set
+ */
+void USBHOST_vPortPower(USBHOST_HandleType * pxHost, FunctionalState eNewState)
+{
+    uint32_t ulHPRT = USBHOST_prvPortStatus(pxHost);
+
+    if (eNewState != DISABLE)
+    {
+        ulHPRT |= USB_OTG_HPRT_PPWR;
+    }
+    else
+    {
+        ulHPRT &= ~USB_OTG_HPRT_PPWR;
+    }
+    pxHost->Inst->HPRT.w = ulHPRT;
+}
+
+/**
+ * @brief Drives reset signaling on the root port. The port enabled callback
+ *        is called when the device is ready for enumeration.
+ * @note  This function blocks for the reset duration, so it shall not be called
+ *        from the connect callback in interrupt context.
+ * @param pxHost: pointer to the USB host handle structure
+ */
+void USBHOST_vPortReset(USBHOST_HandleType * pxHost)
+{
+    uint32_t ulHPRT = USBHOST_prvPortStatus(pxHost);
+
+    pxHost->Port.Enabled = 0;
+
+    pxHost->Inst->HPRT.w = ulHPRT | USB_OTG_HPRT_PRST;
+    XPD_vDelay_ms(USBHOST_PORT_RESET_ms);
+    pxHost->Inst->HPRT.w = ulHPRT & ~USB_OTG_HPRT_PRST;
+}
+
+/**
+ * @brief Reserves a free host channel.
+ * @param pxHost: pointer to the USB host handle structure
+ * @return The allocated channel number, or USBHOST_INVALID_CHANNEL if none is free
+ */
+uint8_t USBHOST_ucChannelAlloc(USBHOST_HandleType * pxHost)
+{
+    uint8_t ucChNum;
+
+    for (ucChNum = 0; ucChNum < USBHOST_CHANNEL_COUNT(pxHost); ucChNum++)
+    {
+        if (pxHost->Channel[ucChNum].Allocated == 0)
+        {
+            pxHost->Channel[ucChNum].Allocated = 1;
+            return ucChNum;
+        }
+    }
+    return USBHOST_INVALID_CHANNEL;
+}
+
+/**
+ * @brief Closes and releases a host channel.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ */
+void USBHOST_vChannelFree(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USBHOST_vChannelClose(pxHost, ucChNum);
+
+    pxHost->Channel[ucChNum].Allocated = 0;
+}
+
+/**
+ * @brief Configures a host channel to communicate with a device endpoint.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ * @param ucDevAddress: the device address
+ * @param ucEpAddress: the endpoint address (the MSB is set for IN endpoints)
+ * @param eType: the endpoint type
+ * @param usMaxPacketSize: the endpoint max packet size
+ */
+void USBHOST_vChannelOpen(
+        USBHOST_HandleType *    pxHost,
+        uint8_t                 ucChNum,
+        uint8_t                 ucDevAddress,
+        uint8_t                 ucEpAddress,
+        USB_EndPointType        eType,
+        uint16_t                usMaxPacketSize)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+    USB_OTG_HostChannelTypeDef * pxHC = &pxHost->Inst->HC[ucChNum];
+    uint32_t ulHCINTMSK = USB_OTG_HCINTMSK_XFRCM  | USB_OTG_HCINTMSK_CHHM   |
+                          USB_OTG_HCINTMSK_STALLM | USB_OTG_HCINTMSK_TXERRM |
+                          USB_OTG_HCINTMSK_BBERRM | USB_OTG_HCINTMSK_DTERRM |
+                          USB_OTG_HCINTMSK_AHBERR;
+    uint32_t ulHCCHAR;
+
+    pxCh->DevAddress    = ucDevAddress;
+    pxCh->EpAddress     = ucEpAddress;
+    pxCh->Type          = eType;
+    pxCh->MaxPacketSize = usMaxPacketSize;
+    pxCh->Toggle        = USBHOST_PID_DATA0;
+    pxCh->ErrorCount    = 0;
+    pxCh->Status        = USBHOST_CH_IDLE;
+
+    /* The DMA retries NAKed transactions on its own */
+    if (USBHOST_DMA_CONFIG(pxHost) == 0)
+    {
+        ulHCINTMSK |= USB_OTG_HCINTMSK_NAKM;
+    }
+    if (USBHOST_IS_PERIODIC(pxCh))
+    {
+        ulHCINTMSK |= USB_OTG_HCINTMSK_FRMORM;
+    }
+
+    pxHC->HCINT.w    = 0xFFFFFFFF;
+    pxHC->HCINTMSK.w = ulHCINTMSK;
+    SET_BIT(pxHost->Inst->HAINTMSK, 1 << ucChNum);
+
+    ulHCCHAR = (usMaxPacketSize & USB_OTG_HCCHAR_MPSIZ) |
+            ((uint32_t)(ucEpAddress & 0xF) << USB_OTG_HCCHAR_EPNUM_Pos) |
+            ((uint32_t)eType << USB_OTG_HCCHAR_EPTYP_Pos) |
+            ((uint32_t)ucDevAddress << USB_OTG_HCCHAR_DAD_Pos) |
+            USB_OTG_HCCHAR_MC_0;
+
+    if ((ucEpAddress & 0x80) != 0)
+    {
+        ulHCCHAR |= USB_OTG_HCCHAR_EPDIR;
+    }
+    if (pxHost->Port.Speed == USBHOST_SPEED_LOW)
+    {
+        ulHCCHAR |= USB_OTG_HCCHAR_LSDEV;
+    }
+    pxHC->HCCHAR.w = ulHCCHAR;
+}
+
+/**
+ * @brief Stops any ongoing transfer of the host channel, and disables its interrupts.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ */
+void USBHOST_vChannelClose(USBHOST_HandleType * pxHost, uint8_t ucChNum)
+{
+    USBHOST_prvChannelHalt(pxHost, ucChNum);
+
+    CLEAR_BIT(pxHost->Inst->HAINTMSK, 1 << ucChNum);
+    pxHost->Inst->HC[ucChNum].HCINTMSK.w = 0;
+
+    pxHost->Channel[ucChNum].Transfer.Progress = 0;
+    pxHost->Channel[ucChNum].Status = USBHOST_CH_IDLE;
+}
+
+/**
+ * @brief Sends a setup packet on a control OUT channel.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ * @param pucSetup: pointer to the 8 byte setup packet
+ */
+void USBHOST_vChannelSetup(USBHOST_HandleType * pxHost, uint8_t ucChNum, const uint8_t * pucSetup)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+
+    pxCh->Transfer.Data     = (uint8_t*)pucSetup;
+    pxCh->Transfer.Size     = 8;
+    pxCh->Transfer.Progress = 8;
+
+    USBHOST_prvChannelStart(pxHost, ucChNum, USBHOST_PID_SETUP);
+}
+
+/**
+ * @brief Starts a data transfer on the host channel. The status of the channel
+ *        changes from busy when the transfer is finished.
+ * @param pxHost: pointer to the USB host handle structure
+ * @param ucChNum: the channel number
+ * @param pucData: pointer to the data (the buffer of IN transfers shall be
+ *                 a multiple of the max packet size)
+ * @param usLength: the length of the data
+ */
+void USBHOST_vChannelTransfer(
+        USBHOST_HandleType *    pxHost,
+        uint8_t                 ucChNum,
+        uint8_t *               pucData,
+        uint16_t                usLength)
+{
+    USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+
+    pxCh->Transfer.Data     = pucData;
+    pxCh->Transfer.Size     = usLength;
+    pxCh->Transfer.Progress = usLength;
+
+    USBHOST_prvChannelStart(pxHost, ucChNum, pxCh->Toggle);
+}
+
+/**
+ * @brief USB host interrupt handler that provides port and channel event notifications.
+ * @param pxHost: pointer to the USB host handle structure
+ */
+void USBHOST_vIRQHandler(USBHOST_HandleType * pxHost)
+{
+    uint32_t ulGINT = pxHost->Inst->GINTSTS.w & pxHost->Inst->GINTMSK.w;
+
+    /* Rx FIFO level reached */
+    if ((ulGINT & USB_OTG_GINTSTS_RXFLVL) != 0)
+    {
+        uint32_t ulGRXSTSP  = pxHost->Inst->GRXSTSP.w;
+        uint16_t usDataCount= (ulGRXSTSP & USB_OTG_GRXSTSP_BCNT_Msk)
+                                        >> USB_OTG_GRXSTSP_BCNT_Pos;
+        uint8_t  ucChNum    = (ulGRXSTSP & USB_OTG_GRXSTSP_EPNUM_Msk)
+                                        >> USB_OTG_GRXSTSP_EPNUM_Pos;
+        USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+
+        if (((ulGRXSTSP & USB_OTG_GRXSTSP_PKTSTS_Msk) == STS_IN_DATA_UPDT) && (usDataCount > 0))
+        {
+            /* IN data packet received */
+            USBHOST_prvReadFifo(pxHost, pxCh->Transfer.Data, usDataCount);
+            pxCh->Transfer.Data   += usDataCount;
+            pxCh->Transfer.Length += usDataCount;
+
+            /* Request the next packet */
+            if (pxHost->Inst->HC[ucChNum].HCTSIZ.b.PKTCNT > 0)
+            {
+                USBHOST_prvChannelResume(pxHost, ucChNum);
+            }
+        }
+    }
+
+    /* Host channel interrupts */
+    if ((ulGINT & USB_OTG_GINTSTS_HCINT) != 0)
+    {
+        uint32_t ulHAINT = pxHost->Inst->HAINT & pxHost->Inst->HAINTMSK;
+        uint8_t ucChNum;
+
+        for (ucChNum = 0; ulHAINT != 0; ucChNum++, ulHAINT >>= 1)
+        {
+            if ((ulHAINT & 1) != 0)
+            {
+                USBHOST_prvChannelEventHandler(pxHost, ucChNum);
+            }
+        }
+    }
+
+    /* Transmit FIFOs have space for the pending OUT data */
+    if ((ulGINT & (USB_OTG_GINTSTS_NPTXFE | USB_OTG_GINTSTS_PTXFE)) != 0)
+    {
+        uint8_t ucChNum;
+
+        USB_IT_DISABLE(pxHost, NPTXFE);
+        USB_IT_DISABLE(pxHost, PTXFE);
+
+        for (ucChNum = 0; ucChNum < USBHOST_CHANNEL_COUNT(pxHost); ucChNum++)
+        {
+            USBHOST_ChannelType * pxCh = &pxHost->Channel[ucChNum];
+
+            if ((pxCh->Status == USBHOST_CH_BUSY) && (pxCh->Transfer.Progress > 0))
+            {
+                USBHOST_prvWritePackets(pxHost, ucChNum);
+            }
+        }
+    }
+
+    /* Root port events */
+    if ((ulGINT & USB_OTG_GINTSTS_HPRTINT) != 0)
+    {
+        USBHOST_prvPortEventHandler(pxHost);
+    }
+
+    /* Device disconnected */
+    if ((ulGINT & USB_OTG_GINTSTS_DISCINT) != 0)
+    {
+        uint8_t ucChNum;
+
+        USB_FLAG_CLEAR(pxHost, DISCINT);
+
+        pxHost->Port.Connected = 0;
+        pxHost->Port.Enabled = 0;
+
+        /* Fail the ongoing transfers */
+        for (ucChNum = 0; ucChNum < USBHOST_CHANNEL_COUNT(pxHost); ucChNum++)
+        {
+            if (pxHost->Channel[ucChNum].Status == USBHOST_CH_BUSY)
+            {
+                USBHOST_prvChannelFinish(pxHost, ucChNum, USBHOST_CH_ERROR);
+            }
+        }
+
+        XPD_SAFE_CALLBACK(pxHost->Callbacks.Disconnect, pxHost);
+    }
+
+    /* Handle SOF Interrupt */
+    if ((ulGINT & USB_OTG_GINTSTS_SOF) != 0)
+    {
+        USB_FLAG_CLEAR(pxHost, SOF);
+
+        XPD_SAFE_CALLBACK(pxHost->Callbacks.SOF, pxHost);
+    }
+}
+
+/** @} */
+
+/** @} */
+
+#endif /* defined(USB_OTG_FS) */
@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file    xpd_adc_ring.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers ADC Acquisition Ring Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_ADC_RING_H_
+#define __XPD_ADC_RING_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_adc.h>
+
+/** @ingroup ADC
+ * @defgroup ADC_Ring ADC Acquisition Ring
+ * @brief    Continuous acquisition of triggered regular conversions into a circular DMA buffer,
+ *           which is handed over to the application in sequenced and timestamped half blocks
+ * @{ */
+
+/** @defgroup ADC_Ring_Exported_Types ADC Acquisition Ring Exported Types
+ * @{ */
+
+/** @brief ADC acquisition block structure */
+typedef struct
+{
+    const uint16_t * Data;                  /*!< Conversion data of the block (in the ring buffer) */
+    uint16_t Length;                        /*!< Number of conversions in the block */
+    uint8_t Overrun;                        /*!< The acquisition was restarted after an overrun
+                                                 since the previous block */
+    uint32_t Sequence;                      /*!< Sequence number of the block since the start */
+    uint64_t Timestamp;                     /*!< Completion time of the block from the Clock source,
+                                                 or the index of its first conversion without a Clock */
+}ADCRING_BlockType;
+
+/** @brief ADC acquisition ring handle structure */
+typedef struct
+{
+    ADC_HandleType * Link;                  /*!< The ADC handle performing the conversions */
+    uint16_t * Buffer;                      /*!< Ring buffer of two blocks */
+    uint16_t BlockLength;                   /*!< Number of conversions in a block,
+                                                 shall be a multiple of the regular sequence length */
+    uint64_t (*Clock)(void);                /*!< Optional timestamp source, sampled on block completion */
+    XPD_HandleCallbackType BlockComplete;   /*!< Block ready callback (receives the ring pointer) */
+    ADCRING_BlockType Block[2];             /*!< [Internal] Block views of the ring halves */
+    uint32_t Sequence;                      /*!< [Internal] Sequence number of the next block */
+    uint64_t Conversions;                   /*!< Number of acquired conversions */
+    volatile uint8_t Ready;                 /*!< [Internal] Mask of the unreleased blocks */
+    uint8_t Restarted;                      /*!< [Internal] Overrun restart before the next block */
+    uint32_t Overruns;                      /*!< Number of acquisition restarts due to ADC overrun */
+    uint32_t Dropped;                       /*!< Number of blocks overwritten before their release */
+}ADCRING_HandleType;
+
+/** @} */
+
+/** @defgroup ADC_Ring_Exported_Functions ADC Acquisition Ring Exported Functions
+ * @{ */
+XPD_ReturnType  ADCRING_eStart          (ADCRING_HandleType * pxRing);
+void            ADCRING_vStop           (ADCRING_HandleType * pxRing);
+
+const ADCRING_BlockType * ADCRING_pxGetBlock(ADCRING_HandleType * pxRing);
+void            ADCRING_vReleaseBlock   (ADCRING_HandleType * pxRing,
+                                         const ADCRING_BlockType * pxBlock);
+
+void            ADCRING_vOverrun        (ADCRING_HandleType * pxRing);
+/** @} */
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_ADC_RING_H_ */
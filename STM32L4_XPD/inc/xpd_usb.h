@@ -59,6 +59,21 @@ typedef enum
     USB_BCD_NOT_SUPPORTED            = 0xFF /*!< Battery Charge Detection is not supported on the device */
 }USB_ChargerType;
 
+/** @brief USB packet memory layout report structure */
+typedef struct
+{
+    uint16_t InAddress[USBD_MAX_EP_COUNT];  /*!< Packet memory address of each IN endpoint buffer
+                                                 (the second buffer follows if double buffered) */
+    uint16_t InSize[USBD_MAX_EP_COUNT];     /*!< Buffer size of each IN endpoint [bytes] */
+    uint16_t OutAddress[USBD_MAX_EP_COUNT]; /*!< Packet memory address of each OUT endpoint buffer
+                                                 (the second buffer follows if double buffered) */
+    uint16_t OutSize[USBD_MAX_EP_COUNT];    /*!< Buffer size of each OUT endpoint [bytes] */
+    uint16_t TableSize;                     /*!< Buffer descriptor table size [bytes] */
+    uint16_t Used;                          /*!< Packet memory required by the layout [bytes] */
+    uint16_t Available;                     /*!< Packet memory available for USB [bytes] */
+    uint8_t  RegCount;                      /*!< Number of endpoint registers required */
+}USB_PmaLayoutType;
+
 /** @defgroup USB_Exported_Macros USB Exported Macros
  * @{ */
 
@@ -165,6 +180,9 @@ typedef enum
 /** @brief USB Wake up line number */
 #define         USB_WAKEUP_EXTI_LINE            18
 
+/** @brief USB frame number range */
+#define         USB_FRAME_NUMBER_MASK(HANDLE)   0x7FF
+
 /** @} */
 
 /** @addtogroup USB_Exported_Functions
@@ -178,15 +196,15 @@ void            USB_vStop_IT            (USB_HandleType * pxUSB);
 void            USB_vSetAddress         (USB_HandleType * pxUSB, uint8_t ucAddress);
 void            USB_vCtrlEpOpen         (USB_HandleType * pxUSB);
 
-void            USB_vEpOpen             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
+XPD_ReturnType  USB_eEpOpen             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
                                          USB_EndPointType eType, uint16_t usMaxPacketSize);
 void            USB_vEpClose            (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 void            USB_vEpSetStall         (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 void            USB_vEpClearStall       (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 
-void            USB_vEpSend             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
+XPD_ReturnType  USB_eEpSend             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
                                          const uint8_t * pucData, uint16_t usLength);
-void            USB_vEpReceive          (USB_HandleType * pxUSB, uint8_t ucEpAddress,
+XPD_ReturnType  USB_eEpReceive          (USB_HandleType * pxUSB, uint8_t ucEpAddress,
                                          uint8_t * pucData, uint16_t usLength);
 
 void            USB_vSetRemoteWakeup    (USB_HandleType * pxUSB);
@@ -196,8 +214,66 @@ void            USB_vIRQHandler         (USB_HandleType * pxUSB);
 
 USB_ChargerType USB_eChargerDetect      (USB_HandleType * pxUSB);
 
+XPD_ReturnType  USB_ePmaAllocate        (USB_HandleType * pxUSB, USB_PmaLayoutType * pxLayout);
+
 /* Used internally, has a weak definition */
 void            USB_vAllocateEPs        (USB_HandleType * pxUSB);
+
+/**
+ * @brief Opens an endpoint, ignoring the request's result.
+ * @note  Kept for compatibility, use @ref USB_eEpOpen to be notified
+ *        when the endpoint cannot be opened.
+ * @param pxUSB: pointer to the USB handle structure
+ * @param ucEpAddress: endpoint address
+ * @param eType: endpoint type
+ * @param usMaxPacketSize: endpoint maximum data packet size
+ */
+__STATIC_INLINE void USB_vEpOpen(USB_HandleType * pxUSB, uint8_t ucEpAddress,
+        USB_EndPointType eType, uint16_t usMaxPacketSize)
+{
+    (void) USB_eEpOpen(pxUSB, ucEpAddress, eType, usMaxPacketSize);
+}
+
+/**
+ * @brief Starts an IN transfer on the endpoint, ignoring the request's result.
+ * @note  Kept for compatibility, use @ref USB_eEpSend to be notified
+ *        when the transfer cannot be started.
+ * @param pxUSB: pointer to the USB handle structure
+ * @param ucEpAddress: endpoint address
+ * @param pucData: pointer to the data buffer
+ * @param usLength: amount of data bytes to transfer
+ */
+__STATIC_INLINE void USB_vEpSend(USB_HandleType * pxUSB, uint8_t ucEpAddress,
+        const uint8_t * pucData, uint16_t usLength)
+{
+    (void) USB_eEpSend(pxUSB, ucEpAddress, pucData, usLength);
+}
+
+/**
+ * @brief Starts an OUT transfer on the endpoint, ignoring the request's result.
+ * @note  Kept for compatibility, use @ref USB_eEpReceive to be notified
+ *        when the transfer cannot be started.
+ * @param pxUSB: pointer to the USB handle structure
+ * @param ucEpAddress: endpoint address
+ * @param pucData: pointer to the data buffer
+ * @param usLength: amount of data bytes to transfer
+ */
+__STATIC_INLINE void USB_vEpReceive(USB_HandleType * pxUSB, uint8_t ucEpAddress,
+        uint8_t * pucData, uint16_t usLength)
+{
+    (void) USB_eEpReceive(pxUSB, ucEpAddress, pucData, usLength);
+}
+
+/**
+ * @brief Returns the frame number of the last received SOF.
+ * @param pxUSB: pointer to the USB handle structure
+ * @return The frame number (see @ref USB_FRAME_NUMBER_MASK())
+ */
+__STATIC_INLINE uint16_t USB_usFrameNumber(USB_HandleType * pxUSB)
+{
+    return USB->FNR.w & USB_FNR_FN;
+}
+
 /** @} */
 
 /** @} */
@@ -49,6 +49,26 @@ typedef enum
     USB_BCD_PS2_PROPRIETARY_PORT     = 4, /*!< PS2 or proprietary charging port detected */
     USB_BCD_NOT_SUPPORTED            = 0xFF /*!< Battery Charge Detection is not supported on the device */
 }USB_ChargerType;
+
+/** @brief USB FIFO buffering request structure */
+typedef struct
+{
+    uint8_t RxDepth;                        /*!< Number of max size OUT packets the shared receive FIFO
+                                                 shall hold, 0 selects the default (2) */
+    uint8_t TxDepth[USBD_MAX_EP_COUNT];     /*!< Number of packets each IN endpoint FIFO shall hold,
+                                                 0 selects the default by endpoint type:
+                                                 @arg 2 for bulk and isochronous endpoints
+                                                 @arg 1 for control and interrupt endpoints */
+}USB_FifoRequestType;
+
+/** @brief USB FIFO layout report structure */
+typedef struct
+{
+    uint16_t RxSize;                        /*!< Shared receive FIFO size [words] */
+    uint16_t TxSize[USBD_MAX_EP_COUNT];     /*!< Transmit FIFO size of each IN endpoint [words] */
+    uint16_t Required;                      /*!< FIFO RAM needed for the requested depths [words] */
+    uint16_t Available;                     /*!< Total FIFO RAM of the peripheral [words] */
+}USB_FifoLayoutType;
 /** @} */
 
 
@@ -133,6 +153,11 @@ typedef enum
 /** @brief USB OTG HS Wake up line number */
 #define USB_OTG_HS_WAKEUP_EXTI_LINE     20
 
+/** @brief USB (micro)frame number range of the enumerated speed
+ *         (high speed counts microframes, full speed counts frames) */
+#define USB_FRAME_NUMBER_MASK(HANDLE)   \
+    (((HANDLE)->Speed == USB_SPEED_HIGH) ? 0x3FFF : 0x7FF)
+
 
 #define USB_OTG_GINTMSK_SOF             USB_OTG_GINTMSK_SOFM
 #define USB_OTG_GINTMSK_MMIS            USB_OTG_GINTMSK_MMISM
@@ -167,15 +192,15 @@ void            USB_vDevStop_IT         (USB_HandleType * pxUSB);
 void            USB_vSetAddress         (USB_HandleType * pxUSB, uint8_t ucAddress);
 void            USB_vCtrlEpOpen         (USB_HandleType * pxUSB);
 
-void            USB_vEpOpen             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
+XPD_ReturnType  USB_eEpOpen             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
                                          USB_EndPointType eType, uint16_t usMaxPacketSize);
 void            USB_vEpClose            (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 void            USB_vEpSetStall         (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 void            USB_vEpClearStall       (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 
-void            USB_vEpSend             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
+XPD_ReturnType  USB_eEpSend             (USB_HandleType * pxUSB, uint8_t ucEpAddress,
                                          const uint8_t * pucData, uint16_t usLength);
-void            USB_vEpReceive          (USB_HandleType * pxUSB, uint8_t ucEpAddress,
+XPD_ReturnType  USB_eEpReceive          (USB_HandleType * pxUSB, uint8_t ucEpAddress,
                                          uint8_t * pucData, uint16_t usLength);
 void            USB_vEpFlush            (USB_HandleType * pxUSB, uint8_t ucEpAddress);
 
@@ -188,6 +213,10 @@ USB_ChargerType USB_eChargerDetect      (USB_HandleType * pxUSB);
 
 void            USB_vDevIRQHandler      (USB_HandleType * pxUSB);
 
+XPD_ReturnType  USB_eFifoAllocate       (USB_HandleType * pxUSB,
+                                         const USB_FifoRequestType * pxRequest,
+                                         USB_FifoLayoutType * pxLayout);
+
 /* Used internally, has a weak definition */
 void            USB_vAllocateEPs        (USB_HandleType * pxUSB);
 
@@ -201,6 +230,61 @@ __STATIC_INLINE void USB_vPhyClockCtrl(USB_HandleType * pxUSB, FunctionalState N
     USB_REG_BIT(pxUSB, PCGCCTL, STOPCLK) = ~NewState;
 }
 
+/**
+ * @brief Opens an endpoint, ignoring the request's result.
+ * @note  Kept for compatibility, use @ref USB_eEpOpen to be notified
+ *        when the endpoint cannot be opened.
+ * @param pxUSB: pointer to the USB handle structure
+ * @param ucEpAddress: endpoint address
+ * @param eType: endpoint type
+ * @param usMaxPacketSize: endpoint maximum data packet size
+ */
+__STATIC_INLINE void USB_vEpOpen(USB_HandleType * pxUSB, uint8_t ucEpAddress,
+        USB_EndPointType eType, uint16_t usMaxPacketSize)
+{
+    (void) USB_eEpOpen(pxUSB, ucEpAddress, eType, usMaxPacketSize);
+}
+
+/**
+ * @brief Starts an IN transfer on the endpoint, ignoring the request's result.
+ * @note  Kept for compatibility, use @ref USB_eEpSend to be notified
+ *        when the transfer cannot be started.
+ * @param pxUSB: pointer to the USB handle structure
+ * @param ucEpAddress: endpoint address
+ * @param pucData: pointer to the data buffer
+ * @param usLength: amount of data bytes to transfer
+ */
+__STATIC_INLINE void USB_vEpSend(USB_HandleType * pxUSB, uint8_t ucEpAddress,
+        const uint8_t * pucData, uint16_t usLength)
+{
+    (void) USB_eEpSend(pxUSB, ucEpAddress, pucData, usLength);
+}
+
+/**
+ * @brief Starts an OUT transfer on the endpoint, ignoring the request's result.
+ * @note  Kept for compatibility, use @ref USB_eEpReceive to be notified
+ *        when the transfer cannot be started.
+ * @param pxUSB: pointer to the USB handle structure
+ * @param ucEpAddress: endpoint address
+ * @param pucData: pointer to the data buffer
+ * @param usLength: amount of data bytes to transfer
+ */
+__STATIC_INLINE void USB_vEpReceive(USB_HandleType * pxUSB, uint8_t ucEpAddress,
+        uint8_t * pucData, uint16_t usLength)
+{
+    (void) USB_eEpReceive(pxUSB, ucEpAddress, pucData, usLength);
+}
+
+/**
+ * @brief Returns the (micro)frame number of the last received SOF.
+ * @param pxUSB: pointer to the USB handle structure
+ * @return The (micro)frame number (see @ref USB_FRAME_NUMBER_MASK())
+ */
+__STATIC_INLINE uint16_t USB_usFrameNumber(USB_HandleType * pxUSB)
+{
+    return pxUSB->Inst->DSTS.b.FNSOF;
+}
+
 /** @} */
 
 #define XPD_USB_API
@@ -0,0 +1,295 @@
+/**
+  ******************************************************************************
+  * @file    xpd_adc_filter.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers ADC Decimation Filters Module
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_adc_filter.h>
+
+/** @addtogroup ADC_Filter
+ * @{ */
+
+/** @defgroup ADC_Filter_Private_Functions ADC Decimation Filters Private Functions
+ * @{ */
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+
+/* Reads two consecutive 16 bit elements, the first one to the lower half */
+#define ADCFILT_READ2(PTR)              __UNALIGNED_UINT32_READ(PTR)
+
+/* Dual signed 16 bit multiply with 32 bit accumulation */
+#define ADCFILT_SMLAD(X, Y, ACC)        __SMLAD(X, Y, ACC)
+
+/* Unsigned 16 bit saturation */
+#define ADCFILT_USAT16(X)               __USAT(X, 16)
+
+#else
+
+#define ADCFILT_READ2(PTR)              ADCFILT_prvRead2((const uint16_t *)(PTR))
+#define ADCFILT_SMLAD(X, Y, ACC)        ADCFILT_prvSMLAD(X, Y, ACC)
+#define ADCFILT_USAT16(X)               ADCFILT_prvUSAT16(X)
+
+/* Portable equivalent of the unaligned dual halfword read */
+__STATIC_INLINE uint32_t ADCFILT_prvRead2(const uint16_t * pusData)
+{
+    return (uint32_t)pusData[0] | ((uint32_t)pusData[1] << 16);
+}
+
+/* Portable equivalent of SMLAD, wraps around the same way */
+__STATIC_INLINE uint32_t ADCFILT_prvSMLAD(uint32_t ulX, uint32_t ulY, uint32_t ulAcc)
+{
+    return ulAcc
+         + (uint32_t)((int32_t)(int16_t)ulX         * (int16_t)ulY)
+         + (uint32_t)((int32_t)(int16_t)(ulX >> 16) * (int16_t)(ulY >> 16));
+}
+
+/* Portable equivalent of USAT #16 */
+__STATIC_INLINE uint32_t ADCFILT_prvUSAT16(int32_t lX)
+{
+    return (lX < 0) ? 0 : ((lX > 0xFFFF) ? 0xFFFF : (uint32_t)lX);
+}
+
+#endif
+
+/**
+ * @brief Adds the samples to the sum.
+ * @param pusData: the samples (at most 15 bits wide)
+ * @param usLength: the number of samples
+ * @param ulSum: the initial sum
+ * @return The sum of the samples
+ */
+static uint32_t ADCFILT_prvSum(const uint16_t * pusData, uint16_t usLength, uint32_t ulSum)
+{
+    for (; usLength > 1; usLength -= 2, pusData += 2)
+    {
+        ulSum = ADCFILT_SMLAD(ADCFILT_READ2(pusData), 0x00010001, ulSum);
+    }
+    if (usLength > 0)
+    {
+        ulSum += *pusData;
+    }
+    return ulSum;
+}
+
+/**
+ * @brief Calculates the dot product of the samples and the coefficients.
+ * @param pusData: the samples (at most 15 bits wide)
+ * @param psCoeffs: the Q15 coefficients
+ * @param usTaps: the number of coefficients
+ * @return The Q15 scaled dot product
+ */
+static int32_t ADCFILT_prvDot(const uint16_t * pusData, const int16_t * psCoeffs, uint16_t usTaps)
+{
+    uint32_t ulAcc = 0;
+
+    for (; usTaps > 1; usTaps -= 2, pusData += 2, psCoeffs += 2)
+    {
+        ulAcc = ADCFILT_SMLAD(ADCFILT_READ2(pusData), ADCFILT_READ2(psCoeffs), ulAcc);
+    }
+    if (usTaps > 0)
+    {
+        ulAcc += (uint32_t)((int32_t)(int16_t)*pusData * *psCoeffs);
+    }
+    return (int32_t)ulAcc;
+}
+
+/** @} */
+
+/** @defgroup ADC_Filter_Exported_Functions ADC Decimation Filters Exported Functions
+ * @{ */
+
+/**
+ * @brief Clears the moving average decimator state.
+ * @param pxAvg: pointer to the moving average decimator
+ */
+void ADCFILT_vAverageInit(ADCFILT_AverageType * pxAvg)
+{
+    pxAvg->Count = 0;
+    pxAvg->Sum   = 0;
+}
+
+/**
+ * @brief Decimates the samples by averaging each Ratio consecutive samples.
+ *        The state is kept between calls, so the input can be of any length.
+ * @param pxAvg: pointer to the moving average decimator
+ * @param pusInput: the input samples (at most 15 bits wide)
+ * @param usLength: the number of input samples
+ * @param pusOutput: the output samples (at least usLength / Ratio + 1 long)
+ * @return The number of output samples
+ */
+uint16_t ADCFILT_usAverage(ADCFILT_AverageType * pxAvg, const uint16_t * pusInput,
+        uint16_t usLength, uint16_t * pusOutput)
+{
+    uint16_t usOutputs = 0;
+    uint16_t usCount = pxAvg->Count;
+    uint32_t ulSum = pxAvg->Sum;
+
+    while (usLength > 0)
+    {
+        uint16_t usStep = pxAvg->Ratio - usCount;
+
+        if (usStep > usLength)
+        {
+            usStep = usLength;
+        }
+        ulSum = ADCFILT_prvSum(pusInput, usStep, ulSum);
+        pusInput += usStep;
+        usLength -= usStep;
+        usCount  += usStep;
+
+        if (usCount == pxAvg->Ratio)
+        {
+            pusOutput[usOutputs++] = (uint16_t)(ulSum >> pxAvg->Shift);
+            usCount = 0;
+            ulSum   = 0;
+        }
+    }
+
+    pxAvg->Count = usCount;
+    pxAvg->Sum   = ulSum;
+
+    return usOutputs;
+}
+
+/**
+ * @brief Clears the CIC decimator state.
+ * @param pxCIC: pointer to the CIC decimator
+ */
+void ADCFILT_vCICInit(ADCFILT_CICType * pxCIC)
+{
+    uint8_t ucStage;
+
+    for (ucStage = 0; ucStage < ADCFILT_CIC_MAX_ORDER; ucStage++)
+    {
+        pxCIC->Integrator[ucStage] = 0;
+        pxCIC->Comb[ucStage]       = 0;
+    }
+    pxCIC->Count = 0;
+}
+
+/**
+ * @brief Decimates the samples with a cascaded integrator-comb filter.
+ *        The state is kept between calls, so the input can be of any length.
+ * @note  The stages wrap around in 32 bits, which is exact as long as
+ *        the sample width + Order * log2(Ratio) doesn't exceed 32 bits.
+ * @param pxCIC: pointer to the CIC decimator
+ * @param pusInput: the input samples
+ * @param usLength: the number of input samples
+ * @param pusOutput: the output samples (at least usLength / Ratio + 1 long)
+ * @return The number of output samples
+ */
+uint16_t ADCFILT_usCIC(ADCFILT_CICType * pxCIC, const uint16_t * pusInput,
+        uint16_t usLength, uint16_t * pusOutput)
+{
+    uint16_t usOutputs = 0;
+    uint16_t usCount = pxCIC->Count;
+    uint8_t ucOrder = pxCIC->Order;
+    uint8_t ucStage;
+
+    for (; usLength > 0; usLength--)
+    {
+        uint32_t ulValue = *pusInput++;
+
+        for (ucStage = 0; ucStage < ucOrder; ucStage++)
+        {
+            ulValue += pxCIC->Integrator[ucStage];
+            pxCIC->Integrator[ucStage] = ulValue;
+        }
+
+        if (++usCount == pxCIC->Ratio)
+        {
+            for (ucStage = 0; ucStage < ucOrder; ucStage++)
+            {
+                uint32_t ulDelayed = pxCIC->Comb[ucStage];
+
+                pxCIC->Comb[ucStage] = ulValue;
+                ulValue -= ulDelayed;
+            }
+            pusOutput[usOutputs++] = (uint16_t)(ulValue >> pxCIC->Shift);
+            usCount = 0;
+        }
+    }
+
+    pxCIC->Count = usCount;
+
+    return usOutputs;
+}
+
+/**
+ * @brief Clears the FIR decimator delay line.
+ * @param pxFIR: pointer to the FIR decimator
+ */
+void ADCFILT_vFIRInit(ADCFILT_FIRType * pxFIR)
+{
+    uint16_t usIndex;
+
+    for (usIndex = 0; usIndex < ADCFILT_FIR_STATE_SIZE(pxFIR->Taps); usIndex++)
+    {
+        pxFIR->State[usIndex] = 0;
+    }
+    pxFIR->Index = 0;
+    pxFIR->Count = 0;
+}
+
+/**
+ * @brief Filters the samples and outputs every Ratio-th result, saturated to 16 bits.
+ *        The state is kept between calls, so the input can be of any length.
+ * @note  The accumulation is done in 32 bits, the sum of the absolute
+ *        products shall stay below 2^31.
+ * @param pxFIR: pointer to the FIR decimator
+ * @param pusInput: the input samples (at most 15 bits wide)
+ * @param usLength: the number of input samples
+ * @param pusOutput: the output samples (at least usLength / Ratio + 1 long)
+ * @return The number of output samples
+ */
+uint16_t ADCFILT_usFIR(ADCFILT_FIRType * pxFIR, const uint16_t * pusInput,
+        uint16_t usLength, uint16_t * pusOutput)
+{
+    uint16_t usOutputs = 0;
+    uint16_t usIndex = pxFIR->Index;
+    uint16_t usCount = pxFIR->Count;
+
+    for (; usLength > 0; usLength--)
+    {
+        /* The sample is stored twice, so the last Taps samples are always contiguous */
+        pxFIR->State[usIndex] = pxFIR->State[usIndex + pxFIR->Taps] = *pusInput++;
+
+        if (++usIndex == pxFIR->Taps)
+        {
+            usIndex = 0;
+        }
+
+        if (++usCount == pxFIR->Ratio)
+        {
+            int32_t lResult = ADCFILT_prvDot(&pxFIR->State[usIndex], pxFIR->Coeffs, pxFIR->Taps);
+
+            pusOutput[usOutputs++] = ADCFILT_USAT16(lResult >> 15);
+            usCount = 0;
+        }
+    }
+
+    pxFIR->Index = usIndex;
+    pxFIR->Count = usCount;
+
+    return usOutputs;
+}
+
+/** @} */
+
+/** @} */
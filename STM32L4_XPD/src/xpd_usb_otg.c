@@ -168,11 +168,51 @@ static void USB_prvClearEpInts(USB_HandleType * pxUSB)
 static void USB_prvWriteFifo(USB_HandleType * pxUSB,
         uint8_t ucFIFOx, uint8_t * pucData, uint16_t usLength)
 {
-    uint16_t usWordCount = (usLength + 3) / 4;
+    __IO uint32_t * pulFifo = &pxUSB->Inst->DFIFO[ucFIFOx].DR;
+    uint16_t usWordCount = usLength / sizeof(uint32_t);
 
-    for (; usWordCount > 0; usWordCount--, pucData += 4)
+    if (((uint32_t)pucData & 3) == 0)
     {
-        pxUSB->Inst->DFIFO[ucFIFOx].DR = *((__packed uint32_t *) pucData);
+        /* Word aligned source, burst loads of 4 words */
+        const uint32_t * pulData = (const uint32_t *)pucData;
+
+        for (; usWordCount >= 4; usWordCount -= 4, pulData += 4)
+        {
+            uint32_t ulW0 = pulData[0], ulW1 = pulData[1],
+                     ulW2 = pulData[2], ulW3 = pulData[3];
+
+            *pulFifo = ulW0;
+            *pulFifo = ulW1;
+            *pulFifo = ulW2;
+            *pulFifo = ulW3;
+        }
+        for (; usWordCount > 0; usWordCount--)
+        {
+            *pulFifo = *pulData++;
+        }
+        pucData = (uint8_t *)pulData;
+    }
+    else
+    {
+        /* Unaligned source, single word loads are handled by the core */
+        for (; usWordCount > 0; usWordCount--, pucData += 4)
+        {
+            *pulFifo = __UNALIGNED_UINT32_READ(pucData);
+        }
+    }
+
+    /* Last partial word, without reading past the end of the data */
+    usLength &= 3;
+    if (usLength > 0)
+    {
+        uint32_t ulWord = 0;
+        uint8_t ucByte;
+
+        for (ucByte = 0; ucByte < usLength; ucByte++)
+        {
+            ulWord |= (uint32_t)pucData[ucByte] << (ucByte * 8);
+        }
+        *pulFifo = ulWord;
     }
 }
 
@@ -180,11 +220,49 @@ static void USB_prvWriteFifo(USB_HandleType * pxUSB,
 static void USB_prvReadFifo(USB_HandleType * pxUSB,
         uint8_t * pucData, uint16_t usLength)
 {
-    uint16_t usWordCount = (usLength + 3) / 4;
+    __IO uint32_t * pulFifo = &pxUSB->Inst->DFIFO[0].DR;
+    uint16_t usWordCount = usLength / sizeof(uint32_t);
+
+    if (((uint32_t)pucData & 3) == 0)
+    {
+        /* Word aligned destination, burst stores of 4 words */
+        uint32_t * pulData = (uint32_t *)pucData;
+
+        for (; usWordCount >= 4; usWordCount -= 4, pulData += 4)
+        {
+            uint32_t ulW0 = *pulFifo, ulW1 = *pulFifo,
+                     ulW2 = *pulFifo, ulW3 = *pulFifo;
+
+            pulData[0] = ulW0;
+            pulData[1] = ulW1;
+            pulData[2] = ulW2;
+            pulData[3] = ulW3;
+        }
+        for (; usWordCount > 0; usWordCount--)
+        {
+            *pulData++ = *pulFifo;
+        }
+        pucData = (uint8_t *)pulData;
+    }
+    else
+    {
+        /* Unaligned destination, single word stores are handled by the core */
+        for (; usWordCount > 0; usWordCount--, pucData += 4)
+        {
+            __UNALIGNED_UINT32_WRITE(pucData, *pulFifo);
+        }
+    }
 
-    for (; usWordCount > 0; usWordCount--, pucData += 4)
+    /* Last partial word, without writing past the end of the buffer */
+    usLength &= 3;
+    if (usLength > 0)
     {
-        *(__packed uint32_t *) pucData = pxUSB->Inst->DFIFO[0].DR;
+        uint32_t ulWord = *pulFifo;
+
+        for (; usLength > 0; usLength--, ulWord >>= 8)
+        {
+            *pucData++ = (uint8_t)ulWord;
+        }
     }
 }
 
@@ -212,17 +290,30 @@ static uint16_t USB_prvNextPacketSize(USB_EndPointHandleType * pxEP)
 static void USB_prvTransmitPacket(USB_HandleType * pxUSB, uint8_t ucEpNum)
 {
     USB_EndPointHandleType * pxEP = &pxUSB->EP.IN[ucEpNum];
-    uint32_t ulFifoSpace = pxUSB->Inst->IEP[ucEpNum].DTXFSTS * sizeof(uint32_t);
     uint32_t ulEpFlag = 1 << ucEpNum;
 
-    /* If there is enough space in the FIFO for a packet, fill immediately */
-    if (ulFifoSpace >= (uint32_t)pxEP->MaxPacketSize)
+    /* Fill the FIFO with as many packets as it has space for */
+    while (pxEP->Transfer.Progress > 0)
     {
-        uint16_t usPacketLength = USB_prvNextPacketSize(pxEP);
+        uint32_t ulFifoSpace = pxUSB->Inst->IEP[ucEpNum].DTXFSTS * sizeof(uint32_t);
+        uint16_t usPacketLength;
+
+        if (ulFifoSpace < (uint32_t)pxEP->MaxPacketSize)
+        {
+            break;
+        }
+
+        usPacketLength = USB_prvNextPacketSize(pxEP);
 
         /* Write a packet to the FIFO */
         USB_prvWriteFifo(pxUSB, ucEpNum, pxEP->Transfer.Data, usPacketLength);
         pxEP->Transfer.Data += usPacketLength;
+
+        /* EP0 transfers are limited to a single packet */
+        if (ucEpNum == 0)
+        {
+            break;
+        }
     }
 
     if ((pxEP->Transfer.Progress == 0) || (ucEpNum == 0))
@@ -237,6 +328,126 @@ static void USB_prvTransmitPacket(USB_HandleType * pxUSB, uint8_t ucEpNum)
     }
 }
 
+#if (USB_OTG_DMA_SUPPORT != 0)
+/* Copy data between the bounce buffer and the caller's buffer */
+static void USB_prvDmaCopy(uint8_t * pucDest, const uint8_t * pucSrc, uint16_t usLength)
+{
+    for (; usLength > 0; usLength--)
+    {
+        *pucDest++ = *pucSrc++;
+    }
+}
+
+/* Check if the DMA can carry the transfer, directly or through the bounce buffer */
+static boolean_t USB_prvDmaCapable(const USB_EndPointHandleType * pxEP, boolean_t bBounce)
+{
+    boolean_t bCapable;
+
+    if (pxEP->Dma.Buffer != NULL)
+    {
+        /* The bounce buffer has to be word aligned and hold at least a packet */
+        bCapable = (((uint32_t)pxEP->Dma.Buffer & 3) == 0)
+                && (pxEP->Dma.Size >= pxEP->MaxPacketSize);
+    }
+    else
+    {
+        bCapable = !bBounce;
+    }
+    return bCapable;
+}
+
+/* Set the DMA address of the next IN transfer, returns the transferable length */
+static uint16_t USB_prvDmaTxLoad(USB_EndPointHandleType * pxEP,
+        USB_OTG_GenEndpointType * pxDEP, uint16_t usLength)
+{
+    /* DMA can only access word aligned memory directly */
+    if ((((uint32_t)pxEP->Transfer.Data & 3) == 0) || (pxEP->Dma.Buffer == NULL))
+    {
+        pxEP->Dma.Bounced = FALSE;
+        pxDEP->DxEPDMA = (uint32_t)pxEP->Transfer.Data;
+    }
+    else
+    {
+        /* Only the last chunk may end with a short packet */
+        uint16_t usLimit = pxEP->Dma.Size - (pxEP->Dma.Size % pxEP->MaxPacketSize);
+
+        if (usLength > usLimit)
+        {
+            usLength = usLimit;
+        }
+        USB_prvDmaCopy(pxEP->Dma.Buffer, pxEP->Transfer.Data, usLength);
+
+        pxEP->Dma.Bounced = TRUE;
+        pxDEP->DxEPDMA = (uint32_t)pxEP->Dma.Buffer;
+    }
+    pxEP->Dma.Chunk = usLength;
+
+    return usLength;
+}
+
+/* Set the DMA address of the next OUT transfer, returns the packet aligned transfer size */
+static uint16_t USB_prvDmaRxLoad(USB_EndPointHandleType * pxEP,
+        USB_OTG_GenEndpointType * pxDEP, uint16_t usPktCnt)
+{
+    uint16_t usRemaining = pxEP->Transfer.Progress - pxEP->Transfer.Length;
+    uint16_t usLength = usPktCnt * pxEP->MaxPacketSize;
+    uint16_t usFit = usRemaining - (usRemaining % pxEP->MaxPacketSize);
+
+    /* DMA writes whole packets, which the caller's buffer has to fit */
+    if ((((uint32_t)pxEP->Transfer.Data & 3) == 0) && (usFit > 0))
+    {
+        if (usLength > usFit)
+        {
+            usLength = usFit;
+        }
+        pxEP->Dma.Bounced = FALSE;
+        pxDEP->DxEPDMA = (uint32_t)pxEP->Transfer.Data;
+    }
+    else if (pxEP->Dma.Buffer == NULL)
+    {
+        /* Only a zero length transfer can get here */
+        pxEP->Dma.Bounced = FALSE;
+        pxDEP->DxEPDMA = (uint32_t)pxEP->Transfer.Data;
+    }
+    else
+    {
+        uint16_t usLimit = pxEP->Dma.Size - (pxEP->Dma.Size % pxEP->MaxPacketSize);
+
+        if (usLength > usLimit)
+        {
+            usLength = usLimit;
+        }
+        pxEP->Dma.Bounced = TRUE;
+        pxDEP->DxEPDMA = (uint32_t)pxEP->Dma.Buffer;
+    }
+    pxEP->Dma.Chunk = usLength;
+
+    return usLength;
+}
+
+/* Account the data of a completed OUT transfer, returns the received length */
+static uint16_t USB_prvDmaRxStore(USB_EndPointHandleType * pxEP,
+        USB_OTG_GenEndpointType * pxDEP)
+{
+    /* XFRSIZ holds the unfilled byte count after the transfer is complete */
+    uint16_t usReceived = pxEP->Dma.Chunk - pxDEP->DxEPTSIZ.b.XFRSIZ;
+    uint16_t usLength = pxEP->Transfer.Progress - pxEP->Transfer.Length;
+
+    if (usLength > usReceived)
+    {
+        usLength = usReceived;
+    }
+    if (pxEP->Dma.Bounced != FALSE)
+    {
+        USB_prvDmaCopy(pxEP->Transfer.Data, pxEP->Dma.Buffer, usLength);
+    }
+    pxEP->Transfer.Length += usLength;
+    pxEP->Transfer.Data += usLength;
+
+    return usReceived;
+}
+#endif
+
 /* Internal handling of EP transmission */
 static void USB_prvEpSend(USB_HandleType * pxUSB, uint8_t ucEpNum)
 {
@@ -244,23 +455,33 @@ static void USB_prvEpSend(USB_HandleType * pxUSB, uint8_t ucEpNum)
     USB_OTG_GenEndpointType * pxDEP = USB_IEPR(pxUSB, ucEpNum);
     uint16_t usTransferSize = pxEP->Transfer.Progress;
 
-    if (pxEP->Transfer.Progress == 0)
+    /* EP0 has limited transfer size */
+    if ((ucEpNum == 0) && (usTransferSize > pxEP->MaxPacketSize))
     {
-        /* 1 transfer with 0 length */
-        pxDEP->DxEPTSIZ.w = 1 << USB_OTG_DIEPTSIZ_PKTCNT_Pos;
+        usTransferSize = pxEP->MaxPacketSize;
     }
-    /* EP0 has limited transfer size */
-    else if ((ucEpNum == 0) && (pxEP->Transfer.Progress > pxEP->MaxPacketSize))
+
+#if (USB_OTG_DMA_SUPPORT != 0)
+    if (USB_DMA_CONFIG(pxUSB) != 0)
     {
-        pxDEP->DxEPTSIZ.b.PKTCNT = 1;
-        pxDEP->DxEPTSIZ.b.XFRSIZ = usTransferSize = pxEP->MaxPacketSize;
+        /* Set DMA start address */
+        usTransferSize = USB_prvDmaTxLoad(pxEP, pxDEP, usTransferSize);
+        pxEP->Transfer.Data += usTransferSize;
+        pxEP->Transfer.Progress -= usTransferSize;
+    }
+#endif
+
+    if (usTransferSize == 0)
+    {
+        /* 1 transfer with 0 length */
+        pxDEP->DxEPTSIZ.w = 1 << USB_OTG_DIEPTSIZ_PKTCNT_Pos;
     }
     else
     {
-        uint16_t usPktCnt = (pxEP->Transfer.Progress + pxEP->MaxPacketSize - 1)
+        uint16_t usPktCnt = (usTransferSize + pxEP->MaxPacketSize - 1)
                 / pxEP->MaxPacketSize;
         pxDEP->DxEPTSIZ.b.PKTCNT = usPktCnt;
-        pxDEP->DxEPTSIZ.b.XFRSIZ = pxEP->Transfer.Progress;
+        pxDEP->DxEPTSIZ.b.XFRSIZ = usTransferSize;
 
         if (pxEP->Type == USB_EP_TYPE_ISOCHRONOUS)
         {
@@ -280,15 +501,6 @@ static void USB_prvEpSend(USB_HandleType * pxUSB, uint8_t ucEpNum)
         }
     }
 
-#if (USB_OTG_DMA_SUPPORT != 0)
-    if (USB_DMA_CONFIG(pxUSB) != 0)
-    {
-        /* Set DMA start address */
-        pxDEP->DxEPDMA = (uint32_t)pxEP->Transfer.Data;
-        pxEP->Transfer.Data += usTransferSize;
-        pxEP->Transfer.Progress -= usTransferSize;
-    }
-#endif
     /* EP enable */
     SET_BIT(pxDEP->DxEPCTL.w, USB_OTG_DIEPCTL_CNAK | USB_OTG_DIEPCTL_EPENA);
 
@@ -306,27 +518,36 @@ static void USB_prvEpReceive(USB_HandleType * pxUSB, uint8_t ucEpNum)
     USB_EndPointHandleType * pxEP = &pxUSB->EP.OUT[ucEpNum];
     USB_OTG_GenEndpointType * pxDEP = USB_OEPR(pxUSB, ucEpNum);
 
+    uint16_t usRemaining = pxEP->Transfer.Progress - pxEP->Transfer.Length;
+
     /* Zero Length Packet or EP0 with limited transfer size */
-    if ((pxEP->Transfer.Progress == 0) || (ucEpNum == 0))
+    if ((usRemaining == 0) || (ucEpNum == 0))
     {
         pxDEP->DxEPTSIZ.b.PKTCNT = 1;
         pxDEP->DxEPTSIZ.b.XFRSIZ = pxEP->MaxPacketSize;
+#if (USB_OTG_DMA_SUPPORT != 0)
+        if (USB_DMA_CONFIG(pxUSB) != 0)
+        {
+            /* Set DMA start address */
+            (void) USB_prvDmaRxLoad(pxEP, pxDEP, 1);
+        }
+#endif
     }
     else
     {
-        uint16_t usPktCnt = (pxEP->Transfer.Progress + pxEP->MaxPacketSize - 1)
+        uint16_t usPktCnt = (usRemaining + pxEP->MaxPacketSize - 1)
                 / pxEP->MaxPacketSize;
-        pxDEP->DxEPTSIZ.b.PKTCNT = usPktCnt;
-        pxDEP->DxEPTSIZ.b.XFRSIZ = pxEP->Transfer.Progress;
-    }
-
 #if (USB_OTG_DMA_SUPPORT != 0)
-    if (USB_DMA_CONFIG(pxUSB) != 0)
-    {
-        /* Set DMA start address */
-        pxDEP->DxEPDMA = (uint32_t)pxEP->Transfer.Data;
-    }
+        if (USB_DMA_CONFIG(pxUSB) != 0)
+        {
+            /* Set DMA start address, the transfer size is packet aligned */
+            usRemaining = USB_prvDmaRxLoad(pxEP, pxDEP, usPktCnt);
+            usPktCnt = usRemaining / pxEP->MaxPacketSize;
+        }
 #endif
+        pxDEP->DxEPTSIZ.b.PKTCNT = usPktCnt;
+        pxDEP->DxEPTSIZ.b.XFRSIZ = usRemaining;
+    }
 
     /* Set DATA PID parity */
     if (pxEP->Type == USB_EP_TYPE_ISOCHRONOUS)
@@ -397,8 +618,17 @@ static void USB_prvInEpEventHandler(USB_HandleType * pxUSB, uint8_t ucEpNum)
 
         if (ucEpNum > 0)
         {
-            /* Transmission complete */
-            USB_vDataInCallback(pxUSB, pxEP);
+            if ((USB_DMA_CONFIG(pxUSB) != 0) &&
+                (pxEP->Transfer.Progress > 0))
+            {
+                /* Transfer next bounce buffer chunk */
+                USB_prvEpSend(pxUSB, ucEpNum);
+            }
+            else
+            {
+                /* Transmission complete */
+                USB_vDataInCallback(pxUSB, pxEP);
+            }
         }
         else /* EP0 packetization requires software handling */
         {
@@ -442,6 +672,21 @@ static void USB_prvOutEpEventHandler(USB_HandleType * pxUSB, uint8_t ucEpNum)
         /* Clear IT flag */
         pxDEP->DxEPINT.w = USB_OTG_DOEPINT_STUP;
 
+#if (USB_OTG_DMA_SUPPORT != 0)
+        if (USB_DMA_CONFIG(pxUSB) != 0)
+        {
+            /* DMA stores back-to-back SETUP packets consecutively,
+             * the last one is valid */
+            uint8_t ucLast = 2 - ((pxDEP->DxEPTSIZ.w & USB_OTG_DOEPTSIZ_STUPCNT)
+                    >> USB_OTG_DOEPTSIZ_STUPCNT_Pos);
+
+            if ((ucLast > 0) && (ucLast < 3))
+            {
+                USB_prvDmaCopy(pxUSB->Setup, &pxUSB->Setup[8 * ucLast], 8);
+            }
+        }
+#endif
+
         /* Process SETUP Packet */
         USB_vSetupCallback(pxUSB);
     }
@@ -455,30 +700,28 @@ static void USB_prvOutEpEventHandler(USB_HandleType * pxUSB, uint8_t ucEpNum)
 
         if (ucEpNum > 0)
         {
-            if (USB_DMA_CONFIG(pxUSB) != 0)
+#if (USB_OTG_DMA_SUPPORT != 0)
+            if ((USB_DMA_CONFIG(pxUSB) != 0) &&
+                (USB_prvDmaRxStore(pxEP, pxDEP) == pxEP->Dma.Chunk) &&
+                (pxEP->Transfer.Length < pxEP->Transfer.Progress))
             {
-                /* XFRSIZ holds the unfilled byte count
-                 * after the transfer is complete */
-                uint16_t usTransferSize =
-                        pxEP->Transfer.Progress - pxDEP->DxEPTSIZ.b.XFRSIZ;
-                pxEP->Transfer.Length = usTransferSize;
-                pxEP->Transfer.Data += usTransferSize;
+                /* Transfer next chunk, as no short packet has ended the transfer */
+                USB_prvEpReceive(pxUSB, ucEpNum);
+            }
+            else
+#endif
+            {
+                /* Reception finished */
+                USB_vDataOutCallback(pxUSB, pxEP);
             }
-
-            /* Reception finished */
-            USB_vDataOutCallback(pxUSB, pxEP);
         }
         else /* EP0 packetization requires software handling */
         {
+#if (USB_OTG_DMA_SUPPORT != 0)
             if (USB_DMA_CONFIG(pxUSB) != 0)
             {
-                /* XFRSIZ holds the unfilled byte count
-                 * after the transfer is complete;
-                 * EP0 transfers are limited to MPS */
-                uint16_t usTransferSize =
-                        pxEP->MaxPacketSize - pxDEP->DxEPTSIZ.b.XFRSIZ;
-                pxEP->Transfer.Length += usTransferSize;
-                pxEP->Transfer.Data += usTransferSize;
+                /* EP0 transfers are limited to MPS */
+                (void) USB_prvDmaRxStore(pxEP, pxDEP);
 
                 if (pxEP->Transfer.Length == 0)
                 {
@@ -486,6 +729,7 @@ static void USB_prvOutEpEventHandler(USB_HandleType * pxUSB, uint8_t ucEpNum)
                     USB_prvPrepareSetup(pxUSB);
                 }
             }
+#endif
 
             if (pxEP->Transfer.Progress == pxEP->Transfer.Length)
             {
@@ -924,44 +1168,63 @@ void USB_vCtrlEpOpen(USB_HandleType * pxUSB)
  * @param ucEpAddress: endpoint address
  * @param eType: endpoint type
  * @param usMaxPacketSize: endpoint maximum data packet size
+ * @return ERROR if the IN endpoint's packets don't fit in its allocated FIFO,
+ *         OK if the endpoint is opened
  */
-void USB_vEpOpen(
+XPD_ReturnType USB_eEpOpen(
         USB_HandleType *    pxUSB,
         uint8_t             ucEpAddress,
         USB_EndPointType    eType,
         uint16_t            usMaxPacketSize)
 {
+    XPD_ReturnType eResult = XPD_OK;
     USB_OTG_GenEndpointType * pxDEP = USB_EPR(pxUSB, ucEpAddress);
     USB_EndPointHandleType * pxEP = USB_GET_EP_AT(pxUSB, ucEpAddress);
     uint8_t ucEpNum = ucEpAddress & 0xF;
 
-    pxEP->MaxPacketSize = usMaxPacketSize;
-    pxEP->Type = eType;
-
-    /* Activate Endpoint interrupts */
     if (ucEpAddress > 0x7F)
     {
-        SET_BIT(pxUSB->Inst->DAINTMSK.w,
-                1 << (ucEpNum + USB_OTG_DAINTMSK_IEPM_Pos));
-    }
-    else
-    {
-        SET_BIT(pxUSB->Inst->DAINTMSK.w,
-                1 << (ucEpNum + USB_OTG_DAINTMSK_OEPM_Pos));
+        uint32_t ulTxFifo = (ucEpNum == 0) ?
+                pxUSB->Inst->DIEPTXF0_HNPTXFSIZ.w : pxUSB->Inst->DIEPTXF[ucEpNum - 1].w;
+
+        /* The endpoint is left disabled if a packet would overflow its FIFO [words] */
+        if (usMaxPacketSize > (4 * (ulTxFifo >> USB_OTG_DIEPTXF_INEPTXFD_Pos)))
+        {
+            eResult = XPD_ERROR;
+        }
     }
 
-    /* Check if currently inactive */
-    if (pxDEP->DxEPCTL.b.USBAEP == 0)
+    if (eResult == XPD_OK)
     {
-        pxDEP->DxEPCTL.b.MPSIZ  = pxEP->MaxPacketSize;
-        pxDEP->DxEPCTL.b.EPTYP  = pxEP->Type;
+        pxEP->MaxPacketSize = usMaxPacketSize;
+        pxEP->Type = eType;
+
+        /* Activate Endpoint interrupts */
+        if (ucEpAddress > 0x7F)
+        {
+            SET_BIT(pxUSB->Inst->DAINTMSK.w,
+                    1 << (ucEpNum + USB_OTG_DAINTMSK_IEPM_Pos));
+        }
+        else
+        {
+            SET_BIT(pxUSB->Inst->DAINTMSK.w,
+                    1 << (ucEpNum + USB_OTG_DAINTMSK_OEPM_Pos));
+        }
 
-        /* Only valid for IN EP, the field is reserved for OUT EPs */
-        pxDEP->DxEPCTL.b.TXFNUM = ucEpNum;
+        /* Check if currently inactive */
+        if (pxDEP->DxEPCTL.b.USBAEP == 0)
+        {
+            pxDEP->DxEPCTL.b.MPSIZ  = pxEP->MaxPacketSize;
+            pxDEP->DxEPCTL.b.EPTYP  = pxEP->Type;
 
-        pxDEP->DxEPCTL.b.SD0PID_SEVNFRM = 1;
-        pxDEP->DxEPCTL.b.USBAEP = 1;
+            /* Only valid for IN EP, the field is reserved for OUT EPs */
+            pxDEP->DxEPCTL.b.TXFNUM = ucEpNum;
+
+            pxDEP->DxEPCTL.b.SD0PID_SEVNFRM = 1;
+            pxDEP->DxEPCTL.b.USBAEP = 1;
+        }
     }
+    return eResult;
 }
 
 /**
@@ -1068,49 +1331,82 @@ void USB_vEpFlush(USB_HandleType * pxUSB, uint8_t ucEpAddress)
 
 /**
  * @brief Initiates data reception on the OUT endpoint.
+ * @note  With DMA enabled, the endpoint needs a bounce buffer
+ *        if the data isn't word aligned or the length isn't a multiple of MaxPacketSize.
  * @param pxUSB: pointer to the USB handle structure
  * @param ucEpAddress: endpoint address
  * @param pucData: pointer to the data buffer
  * @param usLength: amount of data bytes to transfer
+ * @return ERROR if the DMA cannot carry the transfer, OK if the reception is started
  */
-void USB_vEpReceive(
+XPD_ReturnType USB_eEpReceive(
         USB_HandleType *    pxUSB,
         uint8_t             ucEpAddress,
         uint8_t *           pucData,
         uint16_t            usLength)
 {
+    XPD_ReturnType eResult = XPD_OK;
     USB_EndPointHandleType * pxEP = &pxUSB->EP.OUT[ucEpAddress];
 
-    /* setup transfer */
-    pxEP->Transfer.Data       = pucData;
-    pxEP->Transfer.Progress   = usLength;
-    pxEP->Transfer.Length     = 0;
+#if (USB_OTG_DMA_SUPPORT != 0)
+    /* DMA writes whole packets to word aligned addresses */
+    if ((USB_DMA_CONFIG(pxUSB) != 0) && ((pxEP->MaxPacketSize == 0) ||
+        !USB_prvDmaCapable(pxEP, ((((uint32_t)pucData & 3) != 0) && (usLength > 0))
+                || ((usLength % pxEP->MaxPacketSize) != 0))))
+    {
+        eResult = XPD_ERROR;
+    }
+    else
+#endif
+    {
+        /* setup transfer */
+        pxEP->Transfer.Data       = pucData;
+        pxEP->Transfer.Progress   = usLength;
+        pxEP->Transfer.Length     = 0;
 
-    USB_prvEpReceive(pxUSB, ucEpAddress);
+        USB_prvEpReceive(pxUSB, ucEpAddress);
+    }
+    return eResult;
 }
 
 /**
  * @brief Initiates data transmission on the IN endpoint.
+ * @note  With DMA enabled, the endpoint needs a bounce buffer
+ *        if the data isn't word aligned.
  * @param pxUSB: pointer to the USB handle structure
  * @param ucEpAddress: endpoint address
  * @param pucData: pointer to the data buffer
  * @param usLength: amount of data bytes to transfer
+ * @return ERROR if the DMA cannot carry the transfer, OK if the transmission is started
  */
-void USB_vEpSend(
+XPD_ReturnType USB_eEpSend(
         USB_HandleType *    pxUSB,
         uint8_t             ucEpAddress,
         const uint8_t *     pucData,
         uint16_t            usLength)
 {
+    XPD_ReturnType eResult = XPD_OK;
     uint8_t ucEpNum = ucEpAddress & 0xF;
     USB_EndPointHandleType * pxEP = &pxUSB->EP.IN[ucEpNum];
 
-    /* setup and start the transfer */
-    pxEP->Transfer.Data       = (uint8_t*)pucData;
-    pxEP->Transfer.Progress   = usLength;
-    pxEP->Transfer.Length     = usLength;
+#if (USB_OTG_DMA_SUPPORT != 0)
+    /* DMA reads from word aligned addresses */
+    if ((USB_DMA_CONFIG(pxUSB) != 0) && !USB_prvDmaCapable(pxEP,
+            (((uint32_t)pucData & 3) != 0) && (usLength > 0)))
+    {
+        eResult = XPD_ERROR;
+    }
+    else
+#endif
+    {
+        /* setup and start the transfer */
+        pxEP->Transfer.Data       = (uint8_t*)pucData;
+        pxEP->Transfer.Progress   = usLength;
+        pxEP->Transfer.Length     = usLength;
 
-    USB_prvEpSend(pxUSB, ucEpNum);
+        USB_prvEpSend(pxUSB, ucEpNum);
+    }
+    return eResult;
 }
 
 /**
@@ -1153,8 +1449,7 @@ void USB_vDevIRQHandler(USB_HandleType * pxUSB)
 
                 case STS_SETUP_UPDT:
                     /* Setup packet received */
-                    USB_prvReadFifo(pxUSB, (uint8_t *)&pxUSB->Setup,
-                            sizeof(pxUSB->Setup));
+                    USB_prvReadFifo(pxUSB, pxUSB->Setup, 8);
                     break;
 
                 default:
@@ -1440,71 +1735,225 @@ USB_SpeedType USB_eDevSpeed(USB_HandleType * pxUSB)
 }
 
 /**
- * @brief Configure peripheral FIFO allocation for endpoints
- *        after device initialization and before starting the USB operation.
+ * @brief Calculates and applies the FIFO RAM layout for the endpoints
+ *        based on their types, maximum packet sizes and the requested buffering depth.
+ *        Each endpoint gets a single packet buffer at first,
+ *        then the buffers are deepened towards the requested depth
+ *        in isochronous, bulk, interrupt, control endpoint order.
+ *        The remaining FIFO RAM is distributed among the bulk endpoints.
+ *        Each transmit FIFO is at least 16 words deep.
+ * @note  The endpoint types and maximum packet sizes of the handle are used,
+ *        endpoints with zero maximum packet size (except EP0) only receive the minimal
+ *        transmit FIFO, so they shall be opened with at most 64 byte packets,
+ *        or the allocation shall be repeated once their packet size is known.
  * @param pxUSB: pointer to the USB handle structure
+ * @param pxRequest: pointer to the requested buffering depths (NULL selects the defaults)
+ * @param pxLayout: pointer to the layout report (optional, can be NULL)
+ * @return ERROR if the requested depths do not fit in the FIFO RAM, OK otherwise
+ *         (the FIFOs are only configured if at least single packet buffers fit)
  */
-__weak void USB_vAllocateEPs(USB_HandleType * pxUSB)
+XPD_ReturnType USB_eFifoAllocate(
+        USB_HandleType *            pxUSB,
+        const USB_FifoRequestType * pxRequest,
+        USB_FifoLayoutType *        pxLayout)
 {
+    /* Default depths indexed by USB_EndPointType */
+    static const uint8_t aucDefaultDepth[] = { 1, 2, 2, 1 };
+    static const USB_EndPointType aeGrowOrder[] = {
+            USB_EP_TYPE_ISOCHRONOUS, USB_EP_TYPE_BULK,
+            USB_EP_TYPE_INTERRUPT, USB_EP_TYPE_CONTROL };
+    const uint8_t ucClassCount = sizeof(aeGrowOrder) / sizeof(aeGrowOrder[0]);
+    const uint16_t usMinFifoSize = 16;
+
     XPD_ReturnType eResult = XPD_OK;
-    uint8_t ucEpNum;
-    uint8_t ucEpCount = USB_ENDPOINT_COUNT(pxUSB);
-    uint32_t ulMinFifoSizeVal = 16;
-    uint32_t ulFifoSize = ulMinFifoSizeVal * sizeof(uint32_t);
-    uint32_t ulFifoOffset;
-    uint32_t ulFifoLimit = USB_TOTAL_FIFO_SIZE(pxUSB);
+    USB_FifoLayoutType xLayout;
+    uint16_t ausPacket[USBD_MAX_EP_COUNT];
+    uint16_t ausDepth[USBD_MAX_EP_COUNT], ausTarget[USBD_MAX_EP_COUNT];
+    uint8_t ucEpNum, ucEpCount = USB_ENDPOINT_COUNT(pxUSB);
+    uint16_t usRxDepth = 1, usRxTarget = 2;
+    uint8_t ucClass;
+    uint16_t usRxBase, usRxPacket = usMinFifoSize, usUsed;
+    boolean_t bBulkOut = FALSE, bGrown;
+
+    xLayout.Available = USB_TOTAL_FIFO_SIZE(pxUSB) / sizeof(uint32_t);
+
+    /* The receive FIFO is shared, sized for the largest OUT packet */
+    for (ucEpNum = 0; ucEpNum < ucEpCount; ucEpNum++)
+    {
+        USB_EndPointHandleType * pxEP = &pxUSB->EP.OUT[ucEpNum];
+        uint16_t usPacket = (pxEP->MaxPacketSize + 3) / sizeof(uint32_t);
+
+        if (usPacket > usRxPacket)
+        {
+            usRxPacket = usPacket;
+        }
+        if ((pxEP->Type == USB_EP_TYPE_BULK) && (pxEP->MaxPacketSize > 0))
+        {
+            bBulkOut = TRUE;
+        }
+    }
+    /* Receive FIFO according to RM0431: each packet gets status info as well */
+    usRxPacket += 1;
+    usRxBase = 10                   /* to receive SETUP packets on the control endpoint */
+            + (ucEpCount * 2)       /* transfer complete status is also stored with the last packet */
+            + 1;                    /* for Global OUT NAK */
+
+    if ((pxRequest != NULL) && (pxRequest->RxDepth > 0))
+    {
+        usRxTarget = pxRequest->RxDepth;
+    }
+
+    /* Single packet buffers at first */
+    usUsed = usRxBase + usRxPacket;
+    xLayout.Required = usRxBase + usRxTarget * usRxPacket;
 
-    /* Configure the global Receive FIFO based on the largest requested OUT EP size */
     for (ucEpNum = 0; ucEpNum < ucEpCount; ucEpNum++)
     {
-        if (pxUSB->EP.OUT[ucEpNum].MaxPacketSize > ulFifoSize)
+        USB_EndPointHandleType * pxEP = &pxUSB->EP.IN[ucEpNum];
+
+        ausPacket[ucEpNum] = (pxEP->MaxPacketSize + 3) / sizeof(uint32_t);
+
+        if ((ucEpNum > 0) && (pxEP->MaxPacketSize == 0))
         {
-            ulFifoSize = pxUSB->EP.OUT[ucEpNum].MaxPacketSize;
+            /* unused endpoint, only gets the minimal FIFO */
+            ausDepth[ucEpNum] = ausTarget[ucEpNum] = 0;
+            usUsed += usMinFifoSize;
+        }
+        else
+        {
+            ausTarget[ucEpNum] = aucDefaultDepth[pxEP->Type];
+            if ((pxRequest != NULL) && (pxRequest->TxDepth[ucEpNum] > 0))
+            {
+                ausTarget[ucEpNum] = pxRequest->TxDepth[ucEpNum];
+            }
+            ausDepth[ucEpNum] = 1;
+            usUsed += (ausPacket[ucEpNum] < usMinFifoSize) ? usMinFifoSize : ausPacket[ucEpNum];
         }
     }
 
-    /* FIFO sizes are in words */
-    ulFifoSize = (ulFifoSize + 3) >> 2;
+    /* Deepen the buffers by one packet at a time, in class priority order,
+     * then give the remaining space to the bulk endpoints */
+    for (ucClass = 0; ucClass <= ucClassCount; ucClass++)
+    {
+        boolean_t bSpare = ucClass == ucClassCount;
 
-    /* Global RX FIFO according to RM0431: */
-    ulFifoOffset = 10           /* to receive SETUP packets on the control endpoint */
-            + (ulFifoSize + 1)  /* each packet gets status info as well */
-            + (ucEpCount * 2)   /* transfer complete status is also stored with the last packet */
-            + 1;                /* for Global OUT NAK */
-    pxUSB->Inst->GRXFSIZ = ulFifoOffset;
+        do {
+            bGrown = FALSE;
 
-    /* EP0 TX FIFO */
-    ulFifoSize = (pxUSB->EP.IN[0].MaxPacketSize + 3) >> 2;
-    if (ulFifoSize < ulMinFifoSizeVal)
-    {   ulFifoSize = ulMinFifoSizeVal; }
+            for (ucEpNum = 0; ucEpNum < ucEpCount; ucEpNum++)
+            {
+                USB_EndPointHandleType * pxEP = &pxUSB->EP.IN[ucEpNum];
+                uint16_t usSize, usNextSize;
+
+                if ((ausDepth[ucEpNum] == 0) || (bSpare ?
+                        (pxEP->Type != USB_EP_TYPE_BULK) :
+                        ((pxEP->Type != aeGrowOrder[ucClass]) ||
+                         (ausDepth[ucEpNum] >= ausTarget[ucEpNum]))))
+                {
+                    continue;
+                }
+
+                usSize     = ausDepth[ucEpNum] * ausPacket[ucEpNum];
+                usNextSize = usSize + ausPacket[ucEpNum];
+                if (usSize < usMinFifoSize)
+                {   usSize = usMinFifoSize; }
+                if (usNextSize < usMinFifoSize)
+                {   usNextSize = usMinFifoSize; }
+
+                if ((usUsed + usNextSize - usSize) <= xLayout.Available)
+                {
+                    usUsed += usNextSize - usSize;
+                    ausDepth[ucEpNum]++;
+                    bGrown = TRUE;
+                }
+            }
 
-    pxUSB->Inst->DIEPTXF0_HNPTXFSIZ.w =
-            (ulFifoSize   << USB_OTG_DIEPTXF_INEPTXFD_Pos) |
-            (ulFifoOffset << USB_OTG_DIEPTXF_INEPTXSA_Pos);
+            if ((!bSpare && (aeGrowOrder[ucClass] == USB_EP_TYPE_BULK) &&
+                 (usRxDepth < usRxTarget)) || (bSpare && bBulkOut))
+            {
+                if ((usUsed + usRxPacket) <= xLayout.Available)
+                {
+                    usUsed += usRxPacket;
+                    usRxDepth++;
+                    bGrown = TRUE;
+                }
+            }
+        } while (bGrown);
+    }
 
-    for (ucEpNum = 1; ucEpNum < ucEpCount; ucEpNum++)
+    /* Create the layout report */
+    xLayout.RxSize = usRxBase + usRxDepth * usRxPacket;
+    if (usRxDepth < usRxTarget)
+    {
+        eResult = XPD_ERROR;
+    }
+    for (ucEpNum = 0; ucEpNum < ucEpCount; ucEpNum++)
     {
-        /* Increase offset with the FIFO size */
-        ulFifoOffset += ulFifoSize;
+        uint16_t usSize = ausTarget[ucEpNum] * ausPacket[ucEpNum];
+
+        if (usSize < usMinFifoSize)
+        {   usSize = usMinFifoSize; }
+        xLayout.Required += usSize;
 
-        /* FIFO sizes are in words */
-        ulFifoSize = (pxUSB->EP.IN[ucEpNum].MaxPacketSize + 3) >> 2;
-        if (ulFifoSize < ulMinFifoSizeVal)
-        {   ulFifoSize = ulMinFifoSizeVal; }
+        usSize = ausDepth[ucEpNum] * ausPacket[ucEpNum];
+        if (usSize < usMinFifoSize)
+        {   usSize = usMinFifoSize; }
+        xLayout.TxSize[ucEpNum] = usSize;
 
-        /* EPx TX FIFOs */
-        pxUSB->Inst->DIEPTXF[ucEpNum - 1].w =
-                (ulFifoSize   << USB_OTG_DIEPTXF_INEPTXFD_Pos) |
-                (ulFifoOffset << USB_OTG_DIEPTXF_INEPTXSA_Pos);
+        if (ausDepth[ucEpNum] < ausTarget[ucEpNum])
+        {
+            eResult = XPD_ERROR;
+        }
+    }
+    for (; ucEpNum < USBD_MAX_EP_COUNT; ucEpNum++)
+    {
+        xLayout.TxSize[ucEpNum] = 0;
     }
 
-    /* Total FIFO use shouldn't exceed available size */
-    if (ulFifoLimit < (ulFifoOffset + ulFifoSize))
+    /* Configure the FIFOs if single packet buffers fit */
+    if (usUsed > xLayout.Available)
     {
         eResult = XPD_ERROR;
     }
+    else
+    {
+        uint16_t usOffset = xLayout.RxSize;
+
+        pxUSB->Inst->GRXFSIZ = xLayout.RxSize;
 
-    (void) eResult;
+        pxUSB->Inst->DIEPTXF0_HNPTXFSIZ.w =
+                ((uint32_t)xLayout.TxSize[0] << USB_OTG_DIEPTXF_INEPTXFD_Pos) |
+                ((uint32_t)usOffset          << USB_OTG_DIEPTXF_INEPTXSA_Pos);
+
+        for (ucEpNum = 1; ucEpNum < ucEpCount; ucEpNum++)
+        {
+            /* Increase offset with the FIFO size */
+            usOffset += xLayout.TxSize[ucEpNum - 1];
+
+            pxUSB->Inst->DIEPTXF[ucEpNum - 1].w =
+                    ((uint32_t)xLayout.TxSize[ucEpNum] << USB_OTG_DIEPTXF_INEPTXFD_Pos) |
+                    ((uint32_t)usOffset                << USB_OTG_DIEPTXF_INEPTXSA_Pos);
+        }
+    }
+
+    if (pxLayout != NULL)
+    {
+        *pxLayout = xLayout;
+    }
+    return eResult;
+}
+
+/**
+ * @brief Configure peripheral FIFO allocation for endpoints
+ *        after device initialization and before starting the USB operation.
+ *        The default implementation applies the default buffering depths
+ *        with @ref USB_eFifoAllocate. Override it to request specific depths
+ *        and to handle the allocation result.
+ * @param pxUSB: pointer to the USB handle structure
+ */
+__weak void USB_vAllocateEPs(USB_HandleType * pxUSB)
+{
+    (void) USB_eFifoAllocate(pxUSB, NULL, NULL);
 }
 
 /** @} */
@@ -0,0 +1,249 @@
+/**
+  ******************************************************************************
+  * @file    adc_filter_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   ADC decimation filter test and benchmark
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TEST_CYCLES()           __rdtsc()
+#endif
+#include <xpd_adc_filter.h>
+#include "xpd_test.h"
+
+#define TEST_LENGTH             4096
+#define TEST_MAX_BLOCK          97
+#define TEST_MAX_TAPS           32
+#define TEST_BENCH_BLOCK        1024
+#define TEST_BENCH_ROUNDS       2000
+
+static uint16_t ausInput[TEST_LENGTH];
+static uint16_t ausOutput[TEST_LENGTH + 1];
+static uint16_t ausExpected[TEST_LENGTH];
+static uint32_t ulRandom = 1;
+
+static uint32_t TEST_ulRandom(void)
+{
+    ulRandom = ulRandom * 1103515245 + 12345;
+    return ulRandom >> 8;
+}
+
+/* 12 bit conversion results, with full-scale runs to reach the limits */
+static void TEST_vInput(uint16_t usMax)
+{
+    uint16_t i;
+
+    for (i = 0; i < TEST_LENGTH; i++)
+    {
+        ausInput[i] = ((i & 0x300) == 0x300) ? usMax : (uint16_t)(TEST_ulRandom() % (usMax + 1));
+    }
+}
+
+/* Runs the filter on blocks of random length, the state is kept between the calls */
+#define TEST_BLOCKWISE(FILTER, HANDLE, COUNT)                               \
+    do {                                                                    \
+        uint16_t usDone = 0;                                                \
+        (COUNT) = 0;                                                        \
+        while (usDone < TEST_LENGTH) {                                      \
+            uint16_t usBlock = 1 + TEST_ulRandom() % TEST_MAX_BLOCK;        \
+            if (usBlock > (TEST_LENGTH - usDone)) {                         \
+                usBlock = TEST_LENGTH - usDone; }                           \
+            (COUNT) += FILTER(HANDLE, &ausInput[usDone], usBlock,           \
+                    &ausOutput[COUNT]);                                     \
+            usDone += usBlock; }                                            \
+    } while (0)
+
+/* Reference: each output is the scaled sum of Ratio consecutive samples */
+static void TEST_vAverage(uint16_t usRatio, uint8_t ucShift, uint16_t usMax)
+{
+    ADCFILT_AverageType xAvg = { .Ratio = usRatio, .Shift = ucShift };
+    uint16_t usCount, usOutputs = TEST_LENGTH / usRatio, i, j;
+
+    TEST_vInput(usMax);
+    for (i = 0; i < usOutputs; i++)
+    {
+        uint32_t ulSum = 0;
+
+        for (j = 0; j < usRatio; j++)
+        {
+            ulSum += ausInput[i * usRatio + j];
+        }
+        ausExpected[i] = (uint16_t)(ulSum >> ucShift);
+    }
+
+    ADCFILT_vAverageInit(&xAvg);
+    TEST_BLOCKWISE(ADCFILT_usAverage, &xAvg, usCount);
+
+    XPD_TEST_CHECK(usCount == usOutputs);
+    XPD_TEST_CHECK(memcmp(ausOutput, ausExpected, usOutputs * sizeof(uint16_t)) == 0);
+}
+
+/* Reference: Order cascaded boxcar filters of Ratio length, sampled at every Ratio-th input */
+static void TEST_vCIC(uint16_t usRatio, uint8_t ucOrder)
+{
+    static uint64_t aullStage[TEST_LENGTH];
+    ADCFILT_CICType xCIC = { .Ratio = usRatio, .Order = ucOrder };
+    uint16_t usCount, usOutputs = TEST_LENGTH / usRatio, i, j;
+    uint8_t ucStage;
+
+    while ((1u << xCIC.Shift) < usRatio)
+    {
+        xCIC.Shift++;
+    }
+    xCIC.Shift *= ucOrder;
+
+    TEST_vInput(0xFFF);
+    for (i = 0; i < TEST_LENGTH; i++)
+    {
+        aullStage[i] = ausInput[i];
+    }
+    for (ucStage = 0; ucStage < ucOrder; ucStage++)
+    {
+        /* in place from the end, the samples before the start are zero */
+        for (i = TEST_LENGTH; i > 0; i--)
+        {
+            uint64_t ullSum = 0;
+
+            for (j = 0; (j < usRatio) && (j < i); j++)
+            {
+                ullSum += aullStage[i - 1 - j];
+            }
+            aullStage[i - 1] = ullSum;
+        }
+    }
+    for (i = 0; i < usOutputs; i++)
+    {
+        ausExpected[i] = (uint16_t)(aullStage[(i + 1) * usRatio - 1] >> xCIC.Shift);
+    }
+
+    ADCFILT_vCICInit(&xCIC);
+    TEST_BLOCKWISE(ADCFILT_usCIC, &xCIC, usCount);
+
+    XPD_TEST_CHECK(usCount == usOutputs);
+    XPD_TEST_CHECK(memcmp(ausOutput, ausExpected, usOutputs * sizeof(uint16_t)) == 0);
+}
+
+/* Reference: direct convolution with 64 bit accumulation, saturated to 16 bits */
+static void TEST_vFIR(uint16_t usTaps, uint16_t usRatio)
+{
+    static uint16_t ausState[ADCFILT_FIR_STATE_SIZE(TEST_MAX_TAPS)];
+    int16_t asCoeffs[TEST_MAX_TAPS];
+    ADCFILT_FIRType xFIR = { .Coeffs = asCoeffs, .State = ausState, .Taps = usTaps, .Ratio = usRatio };
+    uint16_t usCount, usOutputs = TEST_LENGTH / usRatio, i, j;
+
+    /* negative taps as well, so the output saturates at zero */
+    for (i = 0; i < usTaps; i++)
+    {
+        asCoeffs[i] = (int16_t)(TEST_ulRandom() % 8192) - 3072;
+    }
+
+    TEST_vInput(0xFFF);
+    for (i = 0; i < usOutputs; i++)
+    {
+        int32_t lLast = (i + 1) * usRatio - 1;
+        int64_t llAcc = 0;
+
+        for (j = 0; j < usTaps; j++)
+        {
+            int32_t lSample = lLast - (usTaps - 1) + j;
+
+            if (lSample >= 0)
+            {
+                llAcc += (int64_t)asCoeffs[j] * ausInput[lSample];
+            }
+        }
+        llAcc >>= 15;
+        ausExpected[i] = (llAcc < 0) ? 0 : ((llAcc > 0xFFFF) ? 0xFFFF : (uint16_t)llAcc);
+    }
+
+    ADCFILT_vFIRInit(&xFIR);
+    TEST_BLOCKWISE(ADCFILT_usFIR, &xFIR, usCount);
+
+    XPD_TEST_CHECK(usCount == usOutputs);
+    XPD_TEST_CHECK(memcmp(ausOutput, ausExpected, usOutputs * sizeof(uint16_t)) == 0);
+}
+
+#ifdef TEST_CYCLES
+/* Input samples processed per host TSC cycle */
+static void TEST_vBenchmark(void)
+{
+    static uint16_t ausState[ADCFILT_FIR_STATE_SIZE(TEST_MAX_TAPS)];
+    static const int16_t asCoeffs[TEST_MAX_TAPS] = { 1024 };
+    ADCFILT_AverageType xAvg = { .Ratio = 16, .Shift = 4 };
+    ADCFILT_CICType xCIC = { .Ratio = 16, .Order = 3, .Shift = 12 };
+    ADCFILT_FIRType xFIR = { .Coeffs = asCoeffs, .State = ausState, .Taps = TEST_MAX_TAPS, .Ratio = 4 };
+    uint64_t ullAvg, ullCIC, ullFIR;
+    uint32_t i;
+
+    TEST_vInput(0xFFF);
+    ADCFILT_vAverageInit(&xAvg);
+    ADCFILT_vCICInit(&xCIC);
+    ADCFILT_vFIRInit(&xFIR);
+
+    ullAvg = TEST_CYCLES();
+    for (i = 0; i < TEST_BENCH_ROUNDS; i++)
+    {
+        ADCFILT_usAverage(&xAvg, ausInput, TEST_BENCH_BLOCK, ausOutput);
+    }
+    ullAvg = TEST_CYCLES() - ullAvg;
+
+    ullCIC = TEST_CYCLES();
+    for (i = 0; i < TEST_BENCH_ROUNDS; i++)
+    {
+        ADCFILT_usCIC(&xCIC, ausInput, TEST_BENCH_BLOCK, ausOutput);
+    }
+    ullCIC = TEST_CYCLES() - ullCIC;
+
+    ullFIR = TEST_CYCLES();
+    for (i = 0; i < TEST_BENCH_ROUNDS; i++)
+    {
+        ADCFILT_usFIR(&xFIR, ausInput, TEST_BENCH_BLOCK, ausOutput);
+    }
+    ullFIR = TEST_CYCLES() - ullFIR;
+
+    printf("average /16: %.2f, CIC3 /16: %.2f, FIR%u /4: %.2f samples/cycle\n",
+           (double)TEST_BENCH_BLOCK * TEST_BENCH_ROUNDS / ullAvg,
+           (double)TEST_BENCH_BLOCK * TEST_BENCH_ROUNDS / ullCIC, TEST_MAX_TAPS,
+           (double)TEST_BENCH_BLOCK * TEST_BENCH_ROUNDS / ullFIR);
+}
+#endif
+
+int main(void)
+{
+    /* even and odd ratios, so the dual sample reads start at odd positions as well */
+    TEST_vAverage(16, 4, 0xFFF);
+    TEST_vAverage(5, 0, 0xFFF);
+    TEST_vAverage(256, 8, 0x7FFF);
+
+    TEST_vCIC(8, 1);
+    TEST_vCIC(16, 3);
+    TEST_vCIC(16, 4);
+    TEST_vCIC(10, 2);
+
+    TEST_vFIR(31, 4);
+    TEST_vFIR(32, 3);
+    TEST_vFIR(1, 1);
+
+#ifdef TEST_CYCLES
+    TEST_vBenchmark();
+#endif
+
+    return XPD_TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+/**
+  ******************************************************************************
+  * @file    adc_multi_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   ADC interleaved capture test and de-interleave benchmark
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TEST_CYCLES()           __rdtsc()
+#endif
+#include <xpd_adc_multi.h>
+#include "xpd_test.h"
+
+#define TEST_MAX_STREAMS        4
+#define TEST_MAX_LENGTH         515
+#define TEST_BENCH_LENGTH       1024
+#define TEST_BENCH_ROUNDS       2000
+
+static uint16_t ausInput[TEST_MAX_STREAMS * TEST_MAX_LENGTH + 1];
+static uint16_t aausOutput[TEST_MAX_STREAMS][TEST_MAX_LENGTH + 2];
+static uint32_t ulRandom = 1;
+
+static ADC_MultiModeInitType xMultiConfig;
+static void * pvDMAAddress;
+static uint16_t usDMALength;
+
+static uint32_t TEST_ulRandom(void)
+{
+    ulRandom = ulRandom * 1103515245 + 12345;
+    return ulRandom >> 8;
+}
+
+/* The common ADC driver functions only record the requested setup */
+void ADC_vMultiModeInit(ADC_HandleType * pxADC, const ADC_MultiModeInitType * pxConfig)
+{
+    xMultiConfig = *pxConfig;
+}
+
+XPD_ReturnType ADC_eMultiModeStartBuffer_DMA(ADC_HandleType * pxADC, void * pvAddress,
+        uint16_t usLength)
+{
+    pvDMAAddress = pvAddress;
+    usDMALength = usLength;
+    return XPD_OK;
+}
+
+void ADC_vMultiModeStop_DMA(ADC_HandleType * pxADC)
+{
+}
+
+static void TEST_vInit(uint8_t ucADCs, uint8_t ucCycles, ADC_MultiModeType eMode, uint8_t ucDelay)
+{
+    memset(&xMultiConfig, 0, sizeof(xMultiConfig));
+    ADCMULTI_vInit(NULL, ucADCs, ucCycles);
+
+    XPD_TEST_CHECK(xMultiConfig.Mode == eMode);
+    XPD_TEST_CHECK(xMultiConfig.DMAAccessMode == ADC_DMAACCESSMODE_2);
+    XPD_TEST_CHECK(xMultiConfig.InterSamplingDelay == ucDelay);
+}
+
+/* Each stream gets a distinct tag in the upper bits, the lower bits are random */
+static void TEST_vDeinterleave(uint8_t ucStreams, uint16_t usLength, uint8_t ucInOffset,
+        uint8_t ucOutOffset)
+{
+    uint16_t * apusOutput[TEST_MAX_STREAMS];
+    uint16_t * pusInput = &ausInput[ucInOffset];
+    uint16_t i;
+    uint8_t ucStream;
+
+    for (i = 0; i < usLength; i++)
+    {
+        for (ucStream = 0; ucStream < ucStreams; ucStream++)
+        {
+            pusInput[i * ucStreams + ucStream] =
+                    (uint16_t)((ucStream << 12) | (TEST_ulRandom() & 0xFFF));
+        }
+    }
+    for (ucStream = 0; ucStream < ucStreams; ucStream++)
+    {
+        memset(aausOutput[ucStream], 0xA5, sizeof(aausOutput[ucStream]));
+        apusOutput[ucStream] = &aausOutput[ucStream][ucOutOffset];
+    }
+
+    ADCMULTI_vDeinterleave(pusInput, usLength, ucStreams, apusOutput);
+
+    for (ucStream = 0; ucStream < ucStreams; ucStream++)
+    {
+        boolean_t bMatch = TRUE;
+
+        for (i = 0; i < usLength; i++)
+        {
+            bMatch &= apusOutput[ucStream][i] == pusInput[i * ucStreams + ucStream];
+        }
+        XPD_TEST_CHECK(bMatch);
+
+        /* nothing is written past the end of the stream */
+        XPD_TEST_CHECK(apusOutput[ucStream][usLength] == 0xA5A5);
+        XPD_TEST_CHECK((ucOutOffset == 0) || (aausOutput[ucStream][0] == 0xA5A5));
+    }
+}
+
+#ifdef TEST_CYCLES
+/* Samples de-interleaved per host TSC cycle */
+static double TEST_dBenchmark(uint8_t ucStreams)
+{
+    uint16_t * apusOutput[TEST_MAX_STREAMS];
+    uint64_t ullCycles;
+    uint32_t i;
+    uint8_t ucStream;
+
+    for (ucStream = 0; ucStream < ucStreams; ucStream++)
+    {
+        apusOutput[ucStream] = aausOutput[ucStream];
+    }
+
+    ullCycles = TEST_CYCLES();
+    for (i = 0; i < TEST_BENCH_ROUNDS; i++)
+    {
+        ADCMULTI_vDeinterleave(ausInput, TEST_BENCH_LENGTH / ucStreams, ucStreams, apusOutput);
+    }
+    ullCycles = TEST_CYCLES() - ullCycles;
+
+    return (double)(TEST_BENCH_LENGTH / ucStreams) * ucStreams * TEST_BENCH_ROUNDS / ullCycles;
+}
+#endif
+
+int main(void)
+{
+    static const uint16_t ausLengths[] = { 0, 1, 2, 3, 64, 511, TEST_MAX_LENGTH };
+    uint8_t ucStreams, ucLength, ucOffsets;
+
+    /* 7.2 MSPS of 3 ADCs: 5 cycles apart; the delay is rounded up and clamped */
+    TEST_vInit(3, 3 + 12, ADC_MULTIMODE_TRIPLE_INTERLEAVED, 5);
+    TEST_vInit(2, 3 + 12, ADC_MULTIMODE_DUAL_INTERLEAVED, 8);
+    TEST_vInit(3, 3 + 6, ADC_MULTIMODE_TRIPLE_INTERLEAVED, 5);
+    TEST_vInit(2, 56 + 12, ADC_MULTIMODE_DUAL_INTERLEAVED, 20);
+
+    /* the DMA transfers are words of two samples */
+    XPD_TEST_CHECK(ADCMULTI_eStart_DMA(NULL, ausInput, 3 * 2 * 100) == XPD_OK);
+    XPD_TEST_CHECK((pvDMAAddress == ausInput) && (usDMALength == 3 * 100));
+
+    /* odd lengths for the single group tails, and half-word offsets for the unaligned word accesses */
+    for (ucStreams = 1; ucStreams <= TEST_MAX_STREAMS; ucStreams++)
+    {
+        for (ucLength = 0; ucLength < sizeof(ausLengths) / sizeof(ausLengths[0]); ucLength++)
+        {
+            for (ucOffsets = 0; ucOffsets < 4; ucOffsets++)
+            {
+                TEST_vDeinterleave(ucStreams, ausLengths[ucLength], ucOffsets & 1, ucOffsets >> 1);
+            }
+        }
+    }
+
+#ifdef TEST_CYCLES
+    printf("de-interleave x2: %.2f, x3: %.2f, x4: %.2f samples/cycle\n",
+           TEST_dBenchmark(2), TEST_dBenchmark(3), TEST_dBenchmark(4));
+#endif
+
+    return XPD_TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    can_sim_driver.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers CAN driver build for the bus simulator
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_can_sim.h>
+
+/* The simulated register blocks have no side effects on access,
+ * so the register bit and write-one-to-clear accesses are forwarded to the simulator */
+#undef  CAN_REG_BIT
+#define CAN_REG_BIT(HANDLE, REG_NAME, BIT_NAME)         \
+    (CANSIM_pxRegBit((HANDLE), &(HANDLE)->Inst->REG_NAME.w)->REG_NAME.b.BIT_NAME)
+
+#undef  CAN_RXFLAG_CLEAR
+#define CAN_RXFLAG_CLEAR(HANDLE, FIFO, FLAG_NAME)       \
+    CANSIM_vFlagClear((HANDLE), &(HANDLE)->Inst->RFR[FIFO].w, CAN_RF0R_##FLAG_NAME##0)
+
+#undef  CAN_TXFLAG_CLEAR
+#define CAN_TXFLAG_CLEAR(HANDLE, MB, FLAG_NAME)         \
+    CANSIM_vFlagClear((HANDLE), &(HANDLE)->Inst->TSR.w, CAN_TSR_##FLAG_NAME##0 << (8 * (MB)))
+
+#undef  CAN_ERRFLAG_CLEAR
+#define CAN_ERRFLAG_CLEAR(HANDLE, FLAG_NAME)            \
+    CANSIM_vFlagClear((HANDLE), &(HANDLE)->Inst->ESR.w, CAN_ESR_##FLAG_NAME##F)
+
+#undef  CAN_FLAG_CLEAR
+#define CAN_FLAG_CLEAR(HANDLE, FLAG_NAME)               \
+    CANSIM_vFlagClear((HANDLE), &(HANDLE)->Inst->MSR.w, CAN_MSR_##FLAG_NAME)
+
+/* Each simulated controller is a master with its own filter banks */
+#undef  CAN
+#define CAN                             ((pxCAN)->Inst)
+
+/* The simulated interrupts are only raised between bus events */
+#define __get_PRIMASK()                 0
+#define __set_PRIMASK(PRIMASK)          ((void)(PRIMASK))
+#define __disable_irq()                 ((void)0)
+#define __DMB()                         __sync_synchronize()
+
+#include <xpd_can.c>
+
+/* Host replacements of the clock and time services the driver relies on */
+
+void RCC_vClockEnable(RCC_PositionType PeriphPos)
+{
+    (void)PeriphPos;
+}
+
+void RCC_vClockDisable(RCC_PositionType PeriphPos)
+{
+    (void)PeriphPos;
+}
+
+uint32_t RCC_ulClockFreq_Hz(RCC_ClockType eSelectedClock)
+{
+    (void)eSelectedClock;
+    return 36000000;
+}
+
+static void CANSIM_prvTimerInit(uint32_t ulCoreFreq_Hz)
+{
+    (void)ulCoreFreq_Hz;
+}
+
+static void CANSIM_prvBlock(uint32_t ulBlocktime_ms)
+{
+    (void)ulBlocktime_ms;
+}
+
+/* The simulated registers only change with bus events, so waiting is pointless */
+static XPD_ReturnType CANSIM_prvMatch(volatile uint32_t * pulVarAddress,
+        uint32_t ulBitSelector, uint32_t ulMatch, uint32_t * pulTimeout)
+{
+    (void)pulTimeout;
+    return ((*pulVarAddress & ulBitSelector) == ulMatch) ? XPD_OK : XPD_TIMEOUT;
+}
+
+static XPD_ReturnType CANSIM_prvDiff(volatile uint32_t * pulVarAddress,
+        uint32_t ulBitSelector, uint32_t ulMatch, uint32_t * pulTimeout)
+{
+    (void)pulTimeout;
+    return ((*pulVarAddress & ulBitSelector) != ulMatch) ? XPD_OK : XPD_TIMEOUT;
+}
+
+static const XPD_TimeServiceType cansim_xTimeService = {
+        .Init           = CANSIM_prvTimerInit,
+        .Block_ms       = CANSIM_prvBlock,
+        .MatchBlock_ms  = CANSIM_prvMatch,
+        .DiffBlock_ms   = CANSIM_prvDiff,
+};
+
+const XPD_TimeServiceType* XPD_pxTimeService(void)
+{
+    return &cansim_xTimeService;
+}
@@ -0,0 +1,961 @@
+/**
+  ******************************************************************************
+  * @file    xpd_can_sim.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host-side CAN Bus Simulator
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <xpd_can_sim.h>
+
+/** @addtogroup CAN_Sim
+ * @{ */
+
+/* Number of filter banks of a simulated controller */
+#define CANSIM_FILTERBANKS          14
+
+/* CRC delimiter, ACK slot and delimiter, end of frame, intermission [bits] */
+#define CANSIM_FRAME_TAIL_BITS      13
+/* Error flag, error delimiter, intermission [bits] */
+#define CANSIM_ERROR_FRAME_BITS     17
+/* Suspend transmission of error passive transmitters [bits] */
+#define CANSIM_SUSPEND_BITS         8
+/* Bus-off recovery: 128 occurrences of 11 recessive bits */
+#define CANSIM_RECOVERY_BITS        (128 * 11)
+/* Bus-off recovery is waiting for the initialization request */
+#define CANSIM_RECOVERY_ON_REQUEST  (~(uint64_t)0)
+
+/* Last error codes */
+#define CANSIM_LEC_STUFF            1
+#define CANSIM_LEC_ACK              3
+#define CANSIM_LEC_BITDOMINANT      5
+
+/* Interrupt handler rounds after a bus event */
+#define CANSIM_IRQ_ROUNDS           4
+
+/* Mailbox status flags, in mailbox 0 position */
+#define CANSIM_TSR_MB_FLAGS         (CAN_TSR_RQCP0 | CAN_TSR_TXOK0 | CAN_TSR_ALST0 | CAN_TSR_TERR0)
+
+/** @defgroup CAN_Sim_Private_Functions CAN Bus Simulator Private Functions
+ * @{ */
+
+/**
+ * @brief Gets the simulated controller of the CAN handle.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @return Pointer to the simulated controller
+ */
+__STATIC_INLINE CANSIM_NodeType * CANSIM_prvNode(CAN_HandleType * pxCAN)
+{
+    /* the register block is the first member of the node */
+    return (CANSIM_NodeType *) pxCAN->Inst;
+}
+
+/**
+ * @brief Determines if the node takes part in the bus communication.
+ * @param pxNode: pointer to the simulated controller
+ * @return TRUE if the node is connected and in normal operation, FALSE otherwise
+ */
+static boolean_t CANSIM_prvActive(const CANSIM_NodeType * pxNode)
+{
+    return (pxNode->Handle != NULL) && pxNode->Connected
+        && ((pxNode->Regs.MSR.w & (CAN_MSR_INAK | CAN_MSR_SLAK)) == 0)
+        && ((pxNode->Regs.ESR.w & CAN_ESR_BOFF) == 0);
+}
+
+/**
+ * @brief Updates the mailbox empty flags and the next empty mailbox code.
+ * @param pxNode: pointer to the simulated controller
+ */
+static void CANSIM_prvUpdateTSR(CANSIM_NodeType * pxNode)
+{
+    uint32_t ulTSR = pxNode->Regs.TSR.w & ~(CAN_TSR_TME | CAN_TSR_CODE | CAN_TSR_ABRQ0
+            | CAN_TSR_ABRQ1 | CAN_TSR_ABRQ2);
+    uint8_t ucMb;
+
+    for (ucMb = 0; ucMb < 3; ucMb++)
+    {
+        if ((pxNode->Pending & (1 << ucMb)) == 0)
+        {
+            /* the lowest numbered empty mailbox is offered */
+            if ((ulTSR & CAN_TSR_TME) == 0)
+            {
+                ulTSR |= (uint32_t)ucMb << CAN_TSR_CODE_Pos;
+            }
+            ulTSR |= CAN_TSR_TME0 << ucMb;
+        }
+    }
+    pxNode->Regs.TSR.w = ulTSR;
+}
+
+/**
+ * @brief Presents the output frame and the frame count of the receive FIFO.
+ * @param pxNode: pointer to the simulated controller
+ * @param ucFIFO: the receive FIFO [0 .. 1]
+ */
+static void CANSIM_prvUpdateFIFO(CANSIM_NodeType * pxNode, uint8_t ucFIFO)
+{
+    uint8_t ucCount = pxNode->FifoCount[ucFIFO];
+    uint32_t ulRFR = pxNode->Regs.RFR[ucFIFO].w & (CAN_RF0R_FULL0 | CAN_RF0R_FOVR0);
+
+    if (ucCount > 0)
+    {
+        const CAN_FIFOMailBox_TypeDef * pxOutput = &pxNode->Fifo[ucFIFO][0];
+
+        pxNode->Regs.sFIFOMailBox[ucFIFO].RIR.w  = pxOutput->RIR.w;
+        pxNode->Regs.sFIFOMailBox[ucFIFO].RDTR.w = pxOutput->RDTR.w;
+        pxNode->Regs.sFIFOMailBox[ucFIFO].RDLR.w = pxOutput->RDLR.w;
+        pxNode->Regs.sFIFOMailBox[ucFIFO].RDHR.w = pxOutput->RDHR.w;
+    }
+    pxNode->Regs.RFR[ucFIFO].w = ulRFR | ucCount;
+}
+
+/**
+ * @brief Completes the transmission request of the mailbox.
+ * @param pxNode: pointer to the simulated controller
+ * @param ucMb: the mailbox index
+ * @param ulStatus: the TXOK0, ALST0 and TERR0 flags of the result
+ */
+static void CANSIM_prvTxComplete(CANSIM_NodeType * pxNode, uint8_t ucMb, uint32_t ulStatus)
+{
+    pxNode->Regs.sTxMailBox[ucMb].TIR.w &= ~CAN_TI0R_TXRQ;
+    CLEAR_BIT(pxNode->Pending, 1 << ucMb);
+    SET_BIT(pxNode->Regs.TSR.w, (CAN_TSR_RQCP0 | ulStatus) << (8 * ucMb));
+
+    CANSIM_prvUpdateTSR(pxNode);
+}
+
+/**
+ * @brief Picks up the mode and transmission requests written to the registers.
+ * @param pxNode: pointer to the simulated controller
+ */
+static void CANSIM_prvSync(CANSIM_NodeType * pxNode)
+{
+    uint32_t ulMSR = pxNode->Regs.MSR.w & ~(CAN_MSR_INAK | CAN_MSR_SLAK);
+    uint8_t ucMb;
+
+    /* mode requests are acknowledged at once */
+    if ((pxNode->Regs.MCR.w & CAN_MCR_INRQ) != 0)
+    {
+        ulMSR |= CAN_MSR_INAK;
+
+        /* initialization request starts the bus-off recovery */
+        if (((pxNode->Regs.ESR.w & CAN_ESR_BOFF) != 0) &&
+            (pxNode->RecoverTime == CANSIM_RECOVERY_ON_REQUEST))
+        {
+            pxNode->RecoverTime = 0;
+        }
+    }
+    else if ((pxNode->Regs.MCR.w & CAN_MCR_SLEEP) != 0)
+    {
+        ulMSR |= CAN_MSR_SLAK;
+    }
+    pxNode->Regs.MSR.w = ulMSR;
+
+    for (ucMb = 0; ucMb < 3; ucMb++)
+    {
+        if (((pxNode->Regs.sTxMailBox[ucMb].TIR.w & CAN_TI0R_TXRQ) != 0) &&
+            ((pxNode->Pending & (1 << ucMb)) == 0))
+        {
+            /* new request clears the result of the previous one */
+            CLEAR_BIT(pxNode->Regs.TSR.w, CANSIM_TSR_MB_FLAGS << (8 * ucMb));
+            SET_BIT(pxNode->Pending, 1 << ucMb);
+            pxNode->TxSeq[ucMb] = pxNode->NextSeq++;
+        }
+    }
+    CANSIM_prvUpdateTSR(pxNode);
+}
+
+/**
+ * @brief Updates the error status register from the error counters,
+ *        and sets the error interrupt flag for the enabled conditions.
+ * @param pxBus: pointer to the simulated CAN bus
+ * @param pxNode: pointer to the simulated controller
+ * @param ucLEC: the new last error code, 0 to keep the current
+ */
+static void CANSIM_prvErrorState(CANSIM_BusType * pxBus, CANSIM_NodeType * pxNode, uint8_t ucLEC)
+{
+    uint32_t ulOld = pxNode->Regs.ESR.w;
+    uint32_t ulIER = pxNode->Regs.IER.w;
+    uint32_t ulESR = (ulOld & CAN_ESR_LEC)
+            | ((uint32_t)((pxNode->TEC > 255) ? 255 : pxNode->TEC) << CAN_ESR_TEC_Pos)
+            | ((uint32_t)pxNode->REC << CAN_ESR_REC_Pos);
+    uint32_t ulRaised;
+
+    if (ucLEC != 0)
+    {
+        ulESR = (ulESR & ~CAN_ESR_LEC) | ((uint32_t)ucLEC << CAN_ESR_LEC_Pos);
+    }
+    if (pxNode->TEC > 255)
+    {
+        ulESR |= CAN_ESR_BOFF | CAN_ESR_EPVF | CAN_ESR_EWGF;
+    }
+    else if ((pxNode->TEC > 127) || (pxNode->REC > 127))
+    {
+        ulESR |= CAN_ESR_EPVF | CAN_ESR_EWGF;
+    }
+    else if ((pxNode->TEC >= 96) || (pxNode->REC >= 96))
+    {
+        ulESR |= CAN_ESR_EWGF;
+    }
+    pxNode->Regs.ESR.w = ulESR;
+
+    /* entering bus-off starts the recovery */
+    if ((ulESR & ~ulOld & CAN_ESR_BOFF) != 0)
+    {
+        pxNode->RecoverTime = ((pxNode->Regs.MCR.w & CAN_MCR_ABOM) != 0) ?
+                pxBus->Time + CANSIM_RECOVERY_BITS : CANSIM_RECOVERY_ON_REQUEST;
+    }
+
+    ulRaised = ulESR & ~ulOld;
+    if (    (((ulRaised & CAN_ESR_EWGF) != 0) && ((ulIER & CAN_IER_EWGIE) != 0))
+         || (((ulRaised & CAN_ESR_EPVF) != 0) && ((ulIER & CAN_IER_EPVIE) != 0))
+         || (((ulRaised & CAN_ESR_BOFF) != 0) && ((ulIER & CAN_IER_BOFIE) != 0))
+         || ((ucLEC != 0) && ((ulIER & CAN_IER_LECIE) != 0)))
+    {
+        SET_BIT(pxNode->Regs.MSR.w, CAN_MSR_ERRI);
+    }
+}
+
+/**
+ * @brief Accounts a failed transmission attempt of the mailbox.
+ * @param pxBus: pointer to the simulated CAN bus
+ * @param pxNode: pointer to the transmitting controller
+ * @param ucMb: the mailbox index
+ * @param ucLEC: the detected error
+ * @param bCount: TRUE if the transmit error counter is increased
+ */
+static void CANSIM_prvTxError(CANSIM_BusType * pxBus, CANSIM_NodeType * pxNode, uint8_t ucMb,
+        uint8_t ucLEC, boolean_t bCount)
+{
+    if (bCount)
+    {
+        pxNode->TEC += 8;
+    }
+
+    if ((pxNode->Regs.MCR.w & CAN_MCR_NART) != 0)
+    {
+        CANSIM_prvTxComplete(pxNode, ucMb, CAN_TSR_TERR0);
+    }
+    else
+    {
+        SET_BIT(pxNode->Regs.TSR.w, CAN_TSR_TERR0 << (8 * ucMb));
+    }
+
+    CANSIM_prvErrorState(pxBus, pxNode, ucLEC);
+}
+
+/**
+ * @brief Runs the frame through the acceptance filters of the node.
+ * @param pxNode: pointer to the receiving controller
+ * @param ulIR: the identifier register of the frame
+ * @param pucFIFO: set to the FIFO of the matching filter
+ * @param pucFMI: set to the filter match index
+ * @return TRUE if the frame is accepted, FALSE otherwise
+ */
+static boolean_t CANSIM_prvFilter(const CANSIM_NodeType * pxNode, uint32_t ulIR,
+        uint8_t * pucFIFO, uint8_t * pucFMI)
+{
+    const CAN_TypeDef * pxRegs = &pxNode->Regs;
+    uint32_t ulId32 = ulIR & ~CAN_TI0R_TXRQ;
+    uint32_t ulId16 = ((ulIR >> 16) & 0xFFE0) | ((ulIR << 3) & 0x10) | ((ulIR << 1) & 0x08)
+            | ((ulIR >> 18) & 0x7);
+    uint8_t aucNumber[2] = {0, 0};
+    uint8_t ucBank, ucBestRank = 0;
+    boolean_t bMatch = FALSE;
+
+    /* no reception during filter initialization */
+    if ((pxRegs->FMR.w & CAN_FMR_FINIT) != 0)
+    {
+        return FALSE;
+    }
+
+    for (ucBank = 0; ucBank < CANSIM_FILTERBANKS; ucBank++)
+    {
+        uint32_t ulBit  = 1UL << ucBank;
+        uint32_t ulFR1  = pxRegs->sFilterRegister[ucBank].FR1;
+        uint32_t ulFR2  = pxRegs->sFilterRegister[ucBank].FR2;
+        uint8_t ucFIFO  = ((pxRegs->FFA1R & ulBit) != 0) ? 1 : 0;
+        boolean_t bWide = (pxRegs->FS1R & ulBit) != 0;
+        boolean_t bList = (pxRegs->FM1R & ulBit) != 0;
+        uint8_t ucFilters = (bWide ? 1 : 2) * (bList ? 2 : 1);
+
+        /* 32 bit filters precede 16 bit ones, list mode precedes mask mode */
+        uint8_t ucRank = (bWide ? 2 : 0) + (bList ? 1 : 0);
+        uint8_t i;
+
+        for (i = 0; ((pxRegs->FA1R & ulBit) != 0) && (i < ucFilters); i++)
+        {
+            uint32_t ulReg = (i < (ucFilters / 2)) ? ulFR1 : ulFR2;
+            boolean_t bHit;
+
+            if (bWide && bList)
+            {
+                bHit = ((ulId32 ^ ulReg) & ~CAN_TI0R_TXRQ) == 0;
+            }
+            else if (bWide)
+            {
+                bHit = ((ulId32 ^ ulFR1) & ulFR2 & ~CAN_TI0R_TXRQ) == 0;
+            }
+            else if (bList)
+            {
+                bHit = ((ulReg >> (16 * (i & 1))) & 0xFFFF) == ulId16;
+            }
+            else
+            {
+                bHit = ((ulId16 ^ ulReg) & (ulReg >> 16) & 0xFFFF) == 0;
+            }
+
+            /* lower filter numbers win among equal ranks */
+            if (bHit && (!bMatch || (ucRank > ucBestRank)))
+            {
+                bMatch     = TRUE;
+                ucBestRank = ucRank;
+                *pucFIFO   = ucFIFO;
+                *pucFMI    = aucNumber[ucFIFO] + i;
+            }
+        }
+
+        /* filter numbers are assigned regardless of the activation */
+        aucNumber[ucFIFO] += ucFilters;
+    }
+    return bMatch;
+}
+
+/**
+ * @brief Stores the transferred frame in the receive FIFO selected by the filters.
+ * @param pxNode: pointer to the receiving controller
+ * @param pxFrame: pointer to the transmit mailbox of the frame
+ * @param usSOF: the start of frame time [bit times]
+ */
+static void CANSIM_prvReceive(CANSIM_NodeType * pxNode, const CAN_TxMailBox_TypeDef * pxFrame,
+        uint16_t usSOF)
+{
+    uint8_t ucFIFO, ucFMI;
+
+    if (CANSIM_prvFilter(pxNode, pxFrame->TIR.w, &ucFIFO, &ucFMI))
+    {
+        CAN_FIFOMailBox_TypeDef * pxSlot = NULL;
+        uint8_t ucCount = pxNode->FifoCount[ucFIFO];
+
+        if (ucCount < 3)
+        {
+            pxSlot = &pxNode->Fifo[ucFIFO][ucCount];
+            pxNode->FifoCount[ucFIFO] = ++ucCount;
+
+            if (ucCount == 3)
+            {
+                SET_BIT(pxNode->Regs.RFR[ucFIFO].w, CAN_RF0R_FULL0);
+            }
+        }
+        else
+        {
+            SET_BIT(pxNode->Regs.RFR[ucFIFO].w, CAN_RF0R_FOVR0);
+            pxNode->FifoOverruns++;
+
+            /* in unlocked mode the last frame is overwritten */
+            if ((pxNode->Regs.MCR.w & CAN_MCR_RFLM) == 0)
+            {
+                pxSlot = &pxNode->Fifo[ucFIFO][2];
+            }
+        }
+
+        if (pxSlot != NULL)
+        {
+            pxSlot->RIR.w  = pxFrame->TIR.w & ~CAN_TI0R_TXRQ;
+            pxSlot->RDTR.w = (pxFrame->TDTR.w & CAN_TDT0R_DLC)
+                    | ((uint32_t)ucFMI << CAN_RDT0R_FMI_Pos);
+            pxSlot->RDLR.w = pxFrame->TDLR.w;
+            pxSlot->RDHR.w = pxFrame->TDHR.w;
+
+            if ((pxNode->Regs.MCR.w & CAN_MCR_TTCM) != 0)
+            {
+                pxSlot->RDTR.w |= (uint32_t)usSOF << CAN_RDT0R_TIME_Pos;
+            }
+            pxNode->RxFrames++;
+        }
+        CANSIM_prvUpdateFIFO(pxNode, ucFIFO);
+    }
+}
+
+/**
+ * @brief Adds bits to the frame, with CRC calculation and bit stuffing.
+ * @param pusBits: the number of frame bits so far
+ * @param pusCRC: the CRC-15 register, NULL to exclude the bits from the CRC
+ * @param pucRun: the length and level (bit 7) of the last identical bits
+ * @param ulValue: the bits to add, MSB first
+ * @param ucCount: the number of bits to add
+ */
+static void CANSIM_prvFrameBits(uint16_t * pusBits, uint16_t * pusCRC, uint8_t * pucRun,
+        uint32_t ulValue, uint8_t ucCount)
+{
+    while (ucCount > 0)
+    {
+        uint8_t ucBit = (ulValue >> --ucCount) & 1;
+
+        if (pusCRC != NULL)
+        {
+            uint8_t ucFeedback = ucBit ^ ((*pusCRC >> 14) & 1);
+
+            *pusCRC = (*pusCRC << 1) & 0x7FFF;
+            if (ucFeedback != 0)
+            {
+                *pusCRC ^= 0x4599;
+            }
+        }
+
+        if ((*pucRun >> 7) == ucBit)
+        {
+            (*pucRun)++;
+        }
+        else
+        {
+            *pucRun = (ucBit << 7) | 1;
+        }
+        (*pusBits)++;
+
+        /* complementary stuff bit after 5 identical bits */
+        if ((*pucRun & 0x7F) == 5)
+        {
+            *pucRun = ((ucBit ^ 1) << 7) | 1;
+            (*pusBits)++;
+        }
+    }
+}
+
+/**
+ * @brief Calculates the bus time of the frame from the start of frame
+ *        to the end of the CRC sequence, including the stuff bits.
+ * @param pxFrame: pointer to the transmit mailbox of the frame
+ * @return The stuffed length of the frame [bits]
+ */
+static uint16_t CANSIM_prvStuffedLength(const CAN_TxMailBox_TypeDef * pxFrame)
+{
+    uint32_t ulIR = pxFrame->TIR.w;
+    uint8_t ucDLC = pxFrame->TDTR.w & CAN_TDT0R_DLC;
+    uint8_t ucRTR = (ulIR & CAN_TI0R_RTR) != 0 ? 1 : 0;
+    uint8_t ucBytes = (ucRTR != 0) ? 0 : ((ucDLC > 8) ? 8 : ucDLC);
+    uint16_t usBits = 0, usCRC = 0;
+    uint8_t ucRun = 0x80, i;
+
+    /* start of frame and base identifier */
+    CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, 0, 1);
+    CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, ulIR >> 21, 11);
+
+    if ((ulIR & CAN_TI0R_IDE) != 0)
+    {
+        /* SRR, IDE, extended identifier, RTR, r1, r0 */
+        CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, 3, 2);
+        CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, (ulIR >> 3) & 0x3FFFF, 18);
+        CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, (uint32_t)ucRTR << 2, 3);
+    }
+    else
+    {
+        /* RTR, IDE, r0 */
+        CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, (uint32_t)ucRTR << 2, 3);
+    }
+    CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, ucDLC, 4);
+
+    for (i = 0; i < ucBytes; i++)
+    {
+        uint32_t ulWord = (i < 4) ? pxFrame->TDLR.w : pxFrame->TDHR.w;
+
+        CANSIM_prvFrameBits(&usBits, &usCRC, &ucRun, ulWord >> (8 * (i & 3)), 8);
+    }
+
+    /* the CRC sequence is stuffed as well */
+    CANSIM_prvFrameBits(&usBits, NULL, &ucRun, usCRC, 15);
+
+    return usBits;
+}
+
+/**
+ * @brief Selects the mailbox of the node which competes for the bus.
+ * @param pxNode: pointer to the simulated controller
+ * @return The mailbox index, 3 if no transmission is pending
+ */
+static uint8_t CANSIM_prvNextMailbox(const CANSIM_NodeType * pxNode)
+{
+    uint8_t ucMb, ucNext = 3;
+
+    for (ucMb = 0; ucMb < 3; ucMb++)
+    {
+        if ((pxNode->Pending & (1 << ucMb)) == 0)
+        {
+        }
+        else if (ucNext == 3)
+        {
+            ucNext = ucMb;
+        }
+        else if ((pxNode->Regs.MCR.w & CAN_MCR_TXFP) != 0)
+        {
+            /* transmit FIFO priority: request order */
+            if ((int16_t)(pxNode->TxSeq[ucMb] - pxNode->TxSeq[ucNext]) < 0)
+            {
+                ucNext = ucMb;
+            }
+        }
+        else if ((pxNode->Regs.sTxMailBox[ucMb].TIR.w & ~CAN_TI0R_TXRQ) <
+                 (pxNode->Regs.sTxMailBox[ucNext].TIR.w & ~CAN_TI0R_TXRQ))
+        {
+            ucNext = ucMb;
+        }
+    }
+    return ucNext;
+}
+
+/**
+ * @brief Transfers the frame of the arbitration winner and updates all nodes.
+ * @param pxBus: pointer to the simulated CAN bus
+ * @param pxTx: pointer to the transmitting controller
+ * @param ucMb: the transmitted mailbox index
+ */
+static void CANSIM_prvTransfer(CANSIM_BusType * pxBus, CANSIM_NodeType * pxTx, uint8_t ucMb)
+{
+    CAN_TxMailBox_TypeDef * pxFrame = &pxTx->Regs.sTxMailBox[ucMb];
+    uint32_t ulBits = CANSIM_prvStuffedLength(pxFrame);
+    uint16_t usSOF = (uint16_t)pxBus->Time;
+    boolean_t bLoopback = (pxTx->Regs.BTR.w & CAN_BTR_LBKM) != 0;
+    boolean_t bSilent = (pxTx->Regs.BTR.w & CAN_BTR_SILM) != 0;
+    boolean_t bAck = bLoopback;
+    uint8_t i;
+
+    /* silent loopback frames aren't visible on the bus */
+    for (i = 0; !bSilent && (i < pxBus->NodeCount); i++)
+    {
+        CANSIM_NodeType * pxNode = &pxBus->Nodes[i];
+
+        if ((pxNode != pxTx) && CANSIM_prvActive(pxNode) &&
+            ((pxNode->Regs.BTR.w & CAN_BTR_SILM) == 0))
+        {
+            bAck = TRUE;
+        }
+    }
+
+    if (!bSilent && (pxBus->InjectErrors > 0))
+    {
+        /* bit error of the transmitter, the error flag violates the stuffing for the receivers */
+        pxBus->InjectErrors--;
+        pxBus->Errors++;
+        ulBits += CANSIM_ERROR_FRAME_BITS;
+
+        for (i = 0; i < pxBus->NodeCount; i++)
+        {
+            CANSIM_NodeType * pxNode = &pxBus->Nodes[i];
+
+            if ((pxNode != pxTx) && CANSIM_prvActive(pxNode))
+            {
+                if (pxNode->REC < 255)
+                {
+                    pxNode->REC++;
+                }
+                CANSIM_prvErrorState(pxBus, pxNode, CANSIM_LEC_STUFF);
+            }
+        }
+        CANSIM_prvTxError(pxBus, pxTx, ucMb, CANSIM_LEC_BITDOMINANT, TRUE);
+    }
+    else if (!bAck)
+    {
+        /* error passive transmitters don't count ACK errors, but suspend the transmission */
+        boolean_t bPassive = pxTx->TEC > 127;
+
+        pxBus->Errors++;
+        ulBits += 2 + CANSIM_ERROR_FRAME_BITS + (bPassive ? CANSIM_SUSPEND_BITS : 0);
+
+        CANSIM_prvTxError(pxBus, pxTx, ucMb, CANSIM_LEC_ACK, !bPassive);
+    }
+    else
+    {
+        pxBus->Frames++;
+        ulBits += CANSIM_FRAME_TAIL_BITS;
+
+        for (i = 0; !bSilent && (i < pxBus->NodeCount); i++)
+        {
+            CANSIM_NodeType * pxNode = &pxBus->Nodes[i];
+
+            if ((pxNode != pxTx) && CANSIM_prvActive(pxNode))
+            {
+                if (pxNode->REC > 127)
+                {
+                    pxNode->REC = 119;
+                }
+                else if (pxNode->REC > 0)
+                {
+                    pxNode->REC--;
+                }
+                /* error-free transfers clear the last error code */
+                CLEAR_BIT(pxNode->Regs.ESR.w, CAN_ESR_LEC);
+                CANSIM_prvErrorState(pxBus, pxNode, 0);
+                CANSIM_prvReceive(pxNode, pxFrame, usSOF);
+            }
+        }
+        if (bLoopback)
+        {
+            CANSIM_prvReceive(pxTx, pxFrame, usSOF);
+        }
+
+        if (pxTx->TEC > 0)
+        {
+            pxTx->TEC--;
+        }
+        pxTx->TxFrames++;
+
+        if ((pxTx->Regs.MCR.w & CAN_MCR_TTCM) != 0)
+        {
+            pxFrame->TDTR.w = (pxFrame->TDTR.w & ~CAN_TDT0R_TIME)
+                    | ((uint32_t)usSOF << CAN_TDT0R_TIME_Pos);
+        }
+        CANSIM_prvTxComplete(pxTx, ucMb, CAN_TSR_TXOK0);
+        CLEAR_BIT(pxTx->Regs.ESR.w, CAN_ESR_LEC);
+        CANSIM_prvErrorState(pxBus, pxTx, 0);
+    }
+
+    pxBus->Time     += ulBits;
+    pxBus->BusyBits += ulBits;
+}
+
+/**
+ * @brief Calls the interrupt handlers of the nodes with pending interrupt requests.
+ * @param pxBus: pointer to the simulated CAN bus
+ */
+static void CANSIM_prvDispatch(CANSIM_BusType * pxBus)
+{
+    boolean_t bRaised = TRUE;
+    uint8_t ucRound, i;
+
+    /* the handlers may raise further requests, e.g. by aborting a mailbox */
+    for (ucRound = 0; bRaised && (ucRound < CANSIM_IRQ_ROUNDS); ucRound++)
+    {
+        bRaised = FALSE;
+
+        for (i = 0; i < pxBus->NodeCount; i++)
+        {
+            CANSIM_NodeType * pxNode = &pxBus->Nodes[i];
+            CAN_TypeDef * pxRegs = &pxNode->Regs;
+
+            if (pxNode->Handle == NULL)
+            {
+                continue;
+            }
+
+            if (((pxRegs->IER.w & CAN_IER_TMEIE) != 0) &&
+                ((pxRegs->TSR.w & (CAN_TSR_RQCP0 | CAN_TSR_RQCP1 | CAN_TSR_RQCP2)) != 0))
+            {
+                bRaised = TRUE;
+                XPD_SAFE_CALLBACK(pxNode->IRQHandler.TX, pxNode->Handle);
+            }
+            if (    (((pxRegs->IER.w & CAN_IER_FMPIE0) != 0) && ((pxRegs->RFR[0].w & CAN_RF0R_FMP0) != 0))
+                 || (((pxRegs->IER.w & CAN_IER_FFIE0)  != 0) && ((pxRegs->RFR[0].w & CAN_RF0R_FULL0) != 0))
+                 || (((pxRegs->IER.w & CAN_IER_FOVIE0) != 0) && ((pxRegs->RFR[0].w & CAN_RF0R_FOVR0) != 0)))
+            {
+                bRaised = TRUE;
+                XPD_SAFE_CALLBACK(pxNode->IRQHandler.RX0, pxNode->Handle);
+            }
+            if (    (((pxRegs->IER.w & CAN_IER_FMPIE1) != 0) && ((pxRegs->RFR[1].w & CAN_RF0R_FMP0) != 0))
+                 || (((pxRegs->IER.w & CAN_IER_FFIE1)  != 0) && ((pxRegs->RFR[1].w & CAN_RF0R_FULL0) != 0))
+                 || (((pxRegs->IER.w & CAN_IER_FOVIE1) != 0) && ((pxRegs->RFR[1].w & CAN_RF0R_FOVR0) != 0)))
+            {
+                bRaised = TRUE;
+                XPD_SAFE_CALLBACK(pxNode->IRQHandler.RX1, pxNode->Handle);
+            }
+            if (    (((pxRegs->IER.w & CAN_IER_ERRIE) != 0) && ((pxRegs->MSR.w & CAN_MSR_ERRI) != 0))
+                 || (((pxRegs->IER.w & CAN_IER_WKUIE) != 0) && ((pxRegs->MSR.w & CAN_MSR_WKUI) != 0))
+                 || (((pxRegs->IER.w & CAN_IER_SLKIE) != 0) && ((pxRegs->MSR.w & CAN_MSR_SLAKI) != 0)))
+            {
+                bRaised = TRUE;
+                XPD_SAFE_CALLBACK(pxNode->IRQHandler.SCE, pxNode->Handle);
+            }
+        }
+    }
+}
+
+/** @} */
+
+/** @defgroup CAN_Sim_Exported_Functions CAN Bus Simulator Exported Functions
+ * @{ */
+
+/**
+ * @brief Resets the time and the statistics of the simulated bus.
+ *        The Nodes, NodeCount and Bitrate fields have to be set beforehand.
+ * @param pxBus: pointer to the simulated CAN bus
+ */
+void CANSIM_vInit(CANSIM_BusType * pxBus)
+{
+    pxBus->InjectErrors = 0;
+    pxBus->Time         = 0;
+    pxBus->BusyBits     = 0;
+    pxBus->Frames       = 0;
+    pxBus->Errors       = 0;
+}
+
+/**
+ * @brief Resets the simulated controller to the configured normal operation,
+ *        and binds the CAN handle to it. This replaces @ref CAN_eInit for the simulation.
+ *        The filters are configured afterwards with the driver.
+ * @param pxNode: pointer to the simulated controller
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pxConfig: pointer to CAN setup configuration
+ */
+void CANSIM_vAttach(CANSIM_NodeType * pxNode, CAN_HandleType * pxCAN,
+        const CAN_InitType * pxConfig)
+{
+    volatile uint32_t * pulReg = (volatile uint32_t *) &pxNode->Regs;
+    uint32_t i;
+
+    for (i = 0; i < (sizeof(CAN_TypeDef) / sizeof(uint32_t)); i++)
+    {
+        pulReg[i] = 0;
+    }
+
+    /* features and bit timing as set by CAN_eInit */
+    pxNode->Regs.MCR.w = pxConfig->wSettings & 0xFC;
+    pxNode->Regs.BTR.w = ((uint32_t)pxConfig->wSettings << 30)
+            | (((uint32_t)pxConfig->Timing.SJW - 1) << CAN_BTR_SJW_Pos)
+            | (((uint32_t)pxConfig->Timing.BS2 - 1) << CAN_BTR_TS2_Pos)
+            | (((uint32_t)pxConfig->Timing.BS1 - 1) << CAN_BTR_TS1_Pos)
+            | (((uint32_t)pxConfig->Timing.Prescaler - 1) << CAN_BTR_BRP_Pos);
+
+    /* filters are in initialization mode after reset */
+    pxNode->Regs.FMR.w = CAN_FMR_FINIT;
+
+    pxNode->Connected         = TRUE;
+    pxNode->TxFrames          = 0;
+    pxNode->RxFrames          = 0;
+    pxNode->ArbitrationLosses = 0;
+    pxNode->FifoOverruns      = 0;
+    pxNode->TEC               = 0;
+    pxNode->REC               = 0;
+    pxNode->Pending           = 0;
+    pxNode->NextSeq           = 0;
+    pxNode->FifoCount[0]      = 0;
+    pxNode->FifoCount[1]      = 0;
+    pxNode->RecoverTime       = 0;
+
+    pxNode->IRQHandler.TX  = CAN_vIRQHandlerTX;
+    pxNode->IRQHandler.RX0 = CAN_vIRQHandlerRX0;
+    pxNode->IRQHandler.RX1 = CAN_vIRQHandlerRX1;
+    pxNode->IRQHandler.SCE = CAN_vIRQHandlerSCE;
+
+    /* reset operation state */
+    pxCAN->Inst = &pxNode->Regs;
+    pxCAN->State = 0;
+    pxCAN->RxQueue[0] = pxCAN->RxQueue[1] = NULL;
+    pxCAN->TxQueue = NULL;
+    pxCAN->Stats = NULL;
+    pxNode->Handle = pxCAN;
+
+    CANSIM_prvSync(pxNode);
+}
+
+/**
+ * @brief Runs the simulated bus for the given time. A frame started within the time
+ *        is transferred as a whole, so the bus time may pass the requested end.
+ *        The interrupt handlers of the nodes are called after each frame.
+ * @param pxBus: pointer to the simulated CAN bus
+ * @param ulTime_us: the simulated time to run [us]
+ */
+void CANSIM_vRun(CANSIM_BusType * pxBus, uint32_t ulTime_us)
+{
+    uint64_t ullEnd = pxBus->Time + ((uint64_t)ulTime_us * pxBus->Bitrate) / 1000000;
+
+    while (pxBus->Time < ullEnd)
+    {
+        CANSIM_NodeType * pxTx = NULL;
+        uint64_t ullIdleEnd = ullEnd;
+        uint32_t ulKey = 0;
+        uint8_t ucTxMb = 3, i;
+
+        for (i = 0; i < pxBus->NodeCount; i++)
+        {
+            CANSIM_NodeType * pxNode = &pxBus->Nodes[i];
+
+            if (pxNode->Handle == NULL)
+            {
+                continue;
+            }
+            CANSIM_prvSync(pxNode);
+
+            /* bus-off recovery */
+            if (((pxNode->Regs.ESR.w & CAN_ESR_BOFF) != 0) &&
+                (pxNode->RecoverTime != CANSIM_RECOVERY_ON_REQUEST))
+            {
+                if (pxNode->RecoverTime == 0)
+                {
+                    pxNode->RecoverTime = pxBus->Time + CANSIM_RECOVERY_BITS;
+                }
+                if (pxNode->RecoverTime <= pxBus->Time)
+                {
+                    pxNode->TEC = 0;
+                    pxNode->REC = 0;
+                    CANSIM_prvErrorState(pxBus, pxNode, 0);
+                }
+                else if (pxNode->RecoverTime < ullIdleEnd)
+                {
+                    ullIdleEnd = pxNode->RecoverTime;
+                }
+            }
+
+            /* silent nodes can't start transmissions */
+            if (CANSIM_prvActive(pxNode) &&
+                ((pxNode->Regs.BTR.w & (CAN_BTR_SILM | CAN_BTR_LBKM)) != CAN_BTR_SILM))
+            {
+                uint8_t ucMb = CANSIM_prvNextMailbox(pxNode);
+
+                if (ucMb < 3)
+                {
+                    uint32_t ulNodeKey = pxNode->Regs.sTxMailBox[ucMb].TIR.w & ~CAN_TI0R_TXRQ;
+
+                    if ((pxTx == NULL) || (ulNodeKey < ulKey))
+                    {
+                        pxTx   = pxNode;
+                        ucTxMb = ucMb;
+                        ulKey  = ulNodeKey;
+                    }
+                }
+            }
+        }
+
+        if (pxTx == NULL)
+        {
+            /* idle until the end or the next recovery */
+            pxBus->Time = ullIdleEnd;
+            continue;
+        }
+
+        /* the other competing nodes lose the arbitration */
+        for (i = 0; i < pxBus->NodeCount; i++)
+        {
+            CANSIM_NodeType * pxNode = &pxBus->Nodes[i];
+            uint8_t ucMb;
+
+            if ((pxNode == pxTx) || !CANSIM_prvActive(pxNode) ||
+                ((pxNode->Regs.BTR.w & (CAN_BTR_SILM | CAN_BTR_LBKM)) != 0))
+            {
+                continue;
+            }
+            ucMb = CANSIM_prvNextMailbox(pxNode);
+
+            if (ucMb < 3)
+            {
+                pxNode->ArbitrationLosses++;
+
+                if ((pxNode->Regs.MCR.w & CAN_MCR_NART) != 0)
+                {
+                    CANSIM_prvTxComplete(pxNode, ucMb, CAN_TSR_ALST0);
+                }
+                else
+                {
+                    SET_BIT(pxNode->Regs.TSR.w, CAN_TSR_ALST0 << (8 * ucMb));
+                }
+            }
+        }
+
+        CANSIM_prvTransfer(pxBus, pxTx, ucTxMb);
+        CANSIM_prvDispatch(pxBus);
+    }
+}
+
+/**
+ * @brief Prepares the simulated controller for a register bit access of the CAN driver.
+ *        The transmit mailboxes are only bit accessed to request the transmission,
+ *        which is taken at once, so the driver finds the mailbox occupied afterwards.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pulReg: pointer to the accessed register
+ * @return The register block of the simulated controller
+ */
+CAN_TypeDef * CANSIM_pxRegBit(CAN_HandleType * pxCAN, volatile uint32_t * pulReg)
+{
+    CANSIM_NodeType * pxNode = CANSIM_prvNode(pxCAN);
+    uint8_t ucMb;
+
+    for (ucMb = 0; ucMb < 3; ucMb++)
+    {
+        if (pulReg == &pxNode->Regs.sTxMailBox[ucMb].TIR.w)
+        {
+            SET_BIT(*pulReg, CAN_TI0R_TXRQ);
+        }
+    }
+    CANSIM_prvSync(pxNode);
+
+    return &pxNode->Regs;
+}
+
+/**
+ * @brief Applies the write-one-to-clear register write of the CAN driver
+ *        to the simulated controller.
+ * @param pxCAN: pointer to the CAN handle structure
+ * @param pulReg: pointer to the written register
+ * @param ulFlags: the written value
+ */
+void CANSIM_vFlagClear(CAN_HandleType * pxCAN, volatile uint32_t * pulReg, uint32_t ulFlags)
+{
+    CANSIM_NodeType * pxNode = CANSIM_prvNode(pxCAN);
+    CAN_TypeDef * pxRegs = &pxNode->Regs;
+    uint8_t i;
+
+    /* requests written since the last access are seen by the controller */
+    CANSIM_prvSync(pxNode);
+
+    if (pulReg == &pxRegs->TSR.w)
+    {
+        for (i = 0; i < 3; i++)
+        {
+            uint32_t ulMbFlags = ulFlags >> (8 * i);
+
+            if ((ulMbFlags & CAN_TSR_RQCP0) != 0)
+            {
+                CLEAR_BIT(pxRegs->TSR.w, CANSIM_TSR_MB_FLAGS << (8 * i));
+            }
+
+            /* pending mailboxes aren't on the bus between the bus events */
+            if (((ulMbFlags & CAN_TSR_ABRQ0) != 0) && ((pxNode->Pending & (1 << i)) != 0))
+            {
+                CANSIM_prvTxComplete(pxNode, i, 0);
+            }
+        }
+        CANSIM_prvUpdateTSR(pxNode);
+    }
+    else if ((pulReg == &pxRegs->RFR[0].w) || (pulReg == &pxRegs->RFR[1].w))
+    {
+        uint8_t ucFIFO = (pulReg == &pxRegs->RFR[0].w) ? 0 : 1;
+
+        CLEAR_BIT(pxRegs->RFR[ucFIFO].w, ulFlags & (CAN_RF0R_FULL0 | CAN_RF0R_FOVR0));
+
+        /* release the output mailbox */
+        if (((ulFlags & CAN_RF0R_RFOM0) != 0) && (pxNode->FifoCount[ucFIFO] > 0))
+        {
+            for (i = 1; i < pxNode->FifoCount[ucFIFO]; i++)
+            {
+                pxNode->Fifo[ucFIFO][i - 1].RIR.w  = pxNode->Fifo[ucFIFO][i].RIR.w;
+                pxNode->Fifo[ucFIFO][i - 1].RDTR.w = pxNode->Fifo[ucFIFO][i].RDTR.w;
+                pxNode->Fifo[ucFIFO][i - 1].RDLR.w = pxNode->Fifo[ucFIFO][i].RDLR.w;
+                pxNode->Fifo[ucFIFO][i - 1].RDHR.w = pxNode->Fifo[ucFIFO][i].RDHR.w;
+            }
+            pxNode->FifoCount[ucFIFO]--;
+            CLEAR_BIT(pxRegs->RFR[ucFIFO].w, CAN_RF0R_FULL0);
+        }
+        CANSIM_prvUpdateFIFO(pxNode, ucFIFO);
+    }
+    else if (pulReg == &pxRegs->MSR.w)
+    {
+        CLEAR_BIT(pxRegs->MSR.w, ulFlags & (CAN_MSR_ERRI | CAN_MSR_WKUI | CAN_MSR_SLAKI));
+    }
+    /* the error status flags are read-only */
+}
+
+/** @} */
+
+/** @} */
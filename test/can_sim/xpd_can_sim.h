@@ -0,0 +1,132 @@
+/**
+  ******************************************************************************
+  * @file    xpd_can_sim.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host-side CAN Bus Simulator
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_CAN_SIM_H_
+#define __XPD_CAN_SIM_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_can.h>
+
+/** @defgroup CAN_Sim CAN Bus Simulator
+ * @brief    Host-side virtual bus of multiple CAN controllers for throughput and arbitration testing.
+ * @details  Each node is a simulated bxCAN register block, which is operated by the unmodified
+ *           CAN driver through its handle. The bus transfers the requested frames with
+ *           identifier arbitration and bit stuffed frame lengths at the bus bitrate,
+ *           applies the acceptance filters and FIFO rules of the receivers, keeps the error
+ *           counters (ACK errors, injected bit errors, bus-off and its recovery), and calls
+ *           the driver's interrupt handlers after each bus event.
+ *
+ *           The driver source is compiled by can_sim_driver.c, which routes the register
+ *           bit and write-one-to-clear accesses to the simulator, and gives each node
+ *           its own filter banks. Limitations of the simulated controllers:
+ *           @arg The nodes are set up by @ref CANSIM_vAttach instead of @ref CAN_eInit
+ *                and @ref CAN_vDeinit, the API functions which poll the hardware (CAN_eSleep,
+ *                CAN_eWakeUp, CAN_eSend, CAN_eReceive) cannot be used.
+ *           @arg Other register writes (e.g. mode requests) take effect at the next
+ *                register bit or flag access, or at the next bus event.
+ *           @arg Each node has 14 own filter banks, @ref CAN_eFilterBankConfig returns ERROR.
+ *           @arg Frames are transferred as a whole, the interrupts are raised between frames.
+ *           @arg Nodes starting identical identifiers are arbitrated by their index.
+ *           @arg __XPD_CAN_TIMESTAMP is not supported, as it reads the CPU cycle counter.
+ * @{ */
+
+/** @defgroup CAN_Sim_Exported_Types CAN Bus Simulator Exported Types
+ * @{ */
+
+/** @brief CAN simulator interrupt handler type */
+typedef void (*CANSIM_IRQHandlerType)(CAN_HandleType * pxCAN);
+
+/** @brief Simulated CAN controller structure */
+typedef struct
+{
+    CAN_TypeDef      Regs;                  /*!< [Internal] Register block, the handle's Inst points to it */
+    CAN_HandleType * Handle;                /*!< [Internal] The attached CAN handle */
+    struct {
+        CANSIM_IRQHandlerType TX;           /*!< Transmit interrupt handler */
+        CANSIM_IRQHandlerType RX0;          /*!< Receive FIFO 0 interrupt handler */
+        CANSIM_IRQHandlerType RX1;          /*!< Receive FIFO 1 interrupt handler */
+        CANSIM_IRQHandlerType SCE;          /*!< State change and error interrupt handler */
+    }IRQHandler;                            /*   Interrupt vectors, set to the CAN driver's handlers
+                                                 by @ref CANSIM_vAttach (replace RX handlers for gateways) */
+    boolean_t        Connected;             /*!< The node is connected to the bus (acknowledges and transmits) */
+    uint32_t         TxFrames;              /*!< Number of successfully transmitted frames */
+    uint32_t         RxFrames;              /*!< Number of frames stored in the receive FIFOs */
+    uint32_t         ArbitrationLosses;     /*!< Number of lost arbitrations */
+    uint32_t         FifoOverruns;          /*!< Number of frames lost due to full receive FIFO */
+    uint16_t         TEC;                   /*!< [Internal] Transmit error counter */
+    uint8_t          REC;                   /*!< [Internal] Receive error counter */
+    uint8_t          Pending;               /*!< [Internal] Mailboxes with pending transmission request */
+    uint16_t         TxSeq[3];              /*!< [Internal] Request order of the mailboxes */
+    uint16_t         NextSeq;               /*!< [Internal] Request order of the next request */
+    CAN_FIFOMailBox_TypeDef Fifo[2][3];     /*!< [Internal] Receive FIFO contents, output first */
+    uint8_t          FifoCount[2];          /*!< [Internal] Number of frames in the receive FIFOs */
+    uint64_t         RecoverTime;           /*!< [Internal] End of the bus-off recovery [bit times] */
+}CANSIM_NodeType;
+
+/** @brief Simulated CAN bus structure */
+typedef struct
+{
+    CANSIM_NodeType * Nodes;                /*!< The array of nodes */
+    uint8_t           NodeCount;            /*!< The number of nodes */
+    uint32_t          Bitrate;              /*!< The bitrate of the bus [bit/s] */
+    uint16_t          InjectErrors;         /*!< Number of upcoming frames to destroy with a bit error */
+    uint64_t          Time;                 /*!< Elapsed bus time [bit times] */
+    uint64_t          BusyBits;             /*!< Bus time used by frames and error frames [bit times] */
+    uint32_t          Frames;               /*!< Number of successfully transferred frames */
+    uint32_t          Errors;               /*!< Number of error frames */
+}CANSIM_BusType;
+
+/** @} */
+
+/** @defgroup CAN_Sim_Exported_Functions CAN Bus Simulator Exported Functions
+ * @{ */
+void            CANSIM_vInit            (CANSIM_BusType * pxBus);
+void            CANSIM_vAttach          (CANSIM_NodeType * pxNode, CAN_HandleType * pxCAN,
+                                         const CAN_InitType * pxConfig);
+void            CANSIM_vRun             (CANSIM_BusType * pxBus, uint32_t ulTime_us);
+
+CAN_TypeDef *   CANSIM_pxRegBit         (CAN_HandleType * pxCAN, volatile uint32_t * pulReg);
+void            CANSIM_vFlagClear       (CAN_HandleType * pxCAN, volatile uint32_t * pulReg,
+                                         uint32_t ulFlags);
+
+/**
+ * @brief Calculates the bus load of the simulation so far.
+ * @param pxBus: pointer to the simulated CAN bus
+ * @return The bus load [per mille]
+ */
+__STATIC_INLINE uint16_t CANSIM_usBusLoad(CANSIM_BusType * pxBus)
+{
+    return (pxBus->Time > 0) ? (uint16_t)((pxBus->BusyBits * 1000) / pxBus->Time) : 0;
+}
+/** @} */
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XPD_CAN_SIM_H_ */
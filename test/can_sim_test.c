@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    can_sim_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   CAN driver test on the simulated multi-node bus
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <string.h>
+#include <xpd_can_sim.h>
+#include "xpd_test.h"
+
+#define TEST_BITRATE            500000
+#define TEST_NODES              3
+#define TEST_FRAMES             20
+#define TEST_TX_QUEUE_SIZE      16
+#define TEST_RX_QUEUE_SIZE      64
+
+static CANSIM_NodeType axNodes[TEST_NODES];
+static CANSIM_BusType xBus = { axNodes, TEST_NODES, TEST_BITRATE };
+static CAN_HandleType axCAN[TEST_NODES];
+
+static CAN_TxEntryType axTxEntries[TEST_NODES][TEST_TX_QUEUE_SIZE];
+static CAN_TxQueueType axTxQueue[TEST_NODES];
+static CAN_FrameType axRxFrames[TEST_NODES][TEST_RX_QUEUE_SIZE];
+static CAN_RxQueueType axRxQueue[TEST_NODES];
+
+static uint32_t ulErrorEvents;
+
+static void TEST_vError(void * pvHandle) { ulErrorEvents++; }
+
+/* 500 kbit/s from the 36 MHz input clock: 4 * (1 + 13 + 4) = 72 clocks per bit */
+static void TEST_vSetup(uint8_t ucMode, boolean_t bABOM)
+{
+    CAN_InitType xConfig;
+    uint8_t i;
+
+    memset(&xConfig, 0, sizeof(xConfig));
+    xConfig.Timing.Prescaler = 4;
+    xConfig.Timing.BS1 = 13;
+    xConfig.Timing.BS2 = 4;
+    xConfig.Timing.SJW = 1;
+    xConfig.Settings.Mode = ucMode;
+    xConfig.Settings.ABOM = bABOM ? ENABLE : DISABLE;
+
+    CANSIM_vInit(&xBus);
+    ulErrorEvents = 0;
+
+    for (i = 0; i < TEST_NODES; i++)
+    {
+        const CAN_FilterType xAll = { 0, { 0, CAN_IDTYPE_STD_DATA }, CAN_FILTER_MASK_ANYTYPE, 0 };
+        uint8_t ucMatchIndex;
+
+        memset(&axCAN[i], 0, sizeof(axCAN[i]));
+        CANSIM_vAttach(&axNodes[i], &axCAN[i], &xConfig);
+        axCAN[i].Callbacks.Error = TEST_vError;
+
+        XPD_TEST_CHECK(CAN_eFilterConfig(&axCAN[i], &xAll, &ucMatchIndex, 1) == XPD_OK);
+
+        axTxQueue[i].Entries = axTxEntries[i];
+        axTxQueue[i].Size = TEST_TX_QUEUE_SIZE;
+        XPD_TEST_CHECK(CAN_eTransmitQueue_IT(&axCAN[i], &axTxQueue[i]) == XPD_OK);
+
+        axRxQueue[i].Frames = axRxFrames[i];
+        axRxQueue[i].Size = TEST_RX_QUEUE_SIZE;
+        XPD_TEST_CHECK(CAN_eReceiveQueue_IT(&axCAN[i], &axRxQueue[i], 0) == XPD_OK);
+    }
+}
+
+static void TEST_vEnqueue(uint8_t ucNode, uint32_t ulId, uint8_t ucDLC)
+{
+    CAN_FrameType xFrame;
+
+    memset(&xFrame, 0, sizeof(xFrame));
+    xFrame.Id.Value = ulId;
+    xFrame.Id.Type = CAN_IDTYPE_STD_DATA;
+    xFrame.DLC = ucDLC;
+    xFrame.Data.Word[0] = ulId;
+    XPD_TEST_CHECK(CAN_eEnqueue(&axCAN[ucNode], &xFrame) == XPD_OK);
+}
+
+/* Two nodes compete with interleaved identifiers, the third one listens */
+static void TEST_vArbitration(void)
+{
+    CAN_FrameType axFrames[TEST_RX_QUEUE_SIZE];
+    uint16_t i, usCount;
+    uint64_t ullIdle;
+
+    TEST_vSetup(CAN_MODE_NORMAL, FALSE);
+
+    /* the lower identifiers are enqueued last */
+    for (i = TEST_FRAMES / 2; i > 0; i--)
+    {
+        TEST_vEnqueue(0, 0x100 + 2 * i, 8);
+        TEST_vEnqueue(1, 0x101 + 2 * i, 8);
+    }
+
+    /* run until all frames are transferred, in 100 us steps */
+    for (i = 0; (xBus.Frames < TEST_FRAMES) && (i < 1000); i++)
+    {
+        CANSIM_vRun(&xBus, 100);
+    }
+    ullIdle = xBus.Time - xBus.BusyBits;
+
+    usCount = CAN_usDequeue(&axRxQueue[2], axFrames, TEST_RX_QUEUE_SIZE);
+    XPD_TEST_CHECK(usCount == TEST_FRAMES);
+    XPD_TEST_CHECK(xBus.Errors == 0);
+
+    /* the first frame is the most urgent of the initially loaded mailboxes (0x110..0x114),
+     * as the bus starts before the transmit interrupt could preempt them,
+     * afterwards the bus is shared in identifier order */
+    XPD_TEST_CHECK(axFrames[0].Id.Value == 0x110);
+    for (i = 0; i < usCount; i++)
+    {
+        XPD_TEST_CHECK((i < 2) || (axFrames[i].Id.Value > axFrames[i - 1].Id.Value));
+        XPD_TEST_CHECK(axFrames[i].Data.Word[0] == axFrames[i].Id.Value);
+        XPD_TEST_CHECK(axFrames[i].DLC == 8);
+    }
+    XPD_TEST_CHECK(axFrames[1].Id.Value == 0x102);
+    XPD_TEST_CHECK((axNodes[0].ArbitrationLosses > 0) && (axNodes[1].ArbitrationLosses > 0));
+
+    /* the frames follow each other without idle time, only the last run step has some */
+    XPD_TEST_CHECK(ullIdle < (TEST_BITRATE / 10000));
+
+    /* the senders receive each other's frames as well */
+    XPD_TEST_CHECK(CAN_usDequeue(&axRxQueue[0], axFrames, TEST_RX_QUEUE_SIZE) == TEST_FRAMES / 2);
+    XPD_TEST_CHECK(CAN_usDequeue(&axRxQueue[1], axFrames, TEST_RX_QUEUE_SIZE) == TEST_FRAMES / 2);
+
+    printf("arbitration: %u frames in %llu us, bus load %u.%u %%, arbitration losses %u + %u\n",
+           xBus.Frames, (unsigned long long)(xBus.BusyBits * 1000000 / TEST_BITRATE),
+           CANSIM_usBusLoad(&xBus) / 10, CANSIM_usBusLoad(&xBus) % 10,
+           axNodes[0].ArbitrationLosses, axNodes[1].ArbitrationLosses);
+}
+
+/* A node in loopback mode receives its own frames without acknowledgement */
+static void TEST_vLoopback(void)
+{
+    CAN_FrameType axFrames[TEST_RX_QUEUE_SIZE];
+    uint16_t i, usCount;
+
+    TEST_vSetup(CAN_MODE_LOOPBACK, FALSE);
+    axNodes[1].Connected = FALSE;
+    axNodes[2].Connected = FALSE;
+
+    for (i = 0; i < 5; i++)
+    {
+        TEST_vEnqueue(0, 0x200 + i, i);
+    }
+    CANSIM_vRun(&xBus, 5000);
+
+    usCount = CAN_usDequeue(&axRxQueue[0], axFrames, TEST_RX_QUEUE_SIZE);
+    XPD_TEST_CHECK(usCount == 5);
+    for (i = 0; i < usCount; i++)
+    {
+        XPD_TEST_CHECK((axFrames[i].Id.Value == (0x200 + i)) && (axFrames[i].DLC == i));
+    }
+    XPD_TEST_CHECK((xBus.Errors == 0) && (axNodes[0].TEC == 0));
+}
+
+/* A lone node gets no acknowledgement, bit errors lead to bus-off and recovery */
+static void TEST_vErrors(void)
+{
+    CAN_FrameType axFrames[TEST_RX_QUEUE_SIZE];
+
+    TEST_vSetup(CAN_MODE_NORMAL, TRUE);
+    CAN_IT_ENABLE(&axCAN[0], BOF);
+    CAN_IT_ENABLE(&axCAN[0], ERR);
+
+    /* ACK errors stop at error passive */
+    axNodes[1].Connected = FALSE;
+    axNodes[2].Connected = FALSE;
+    TEST_vEnqueue(0, 0x300, 1);
+    CANSIM_vRun(&xBus, 20000);
+    XPD_TEST_CHECK(xBus.Frames == 0);
+    XPD_TEST_CHECK((axNodes[0].TEC > 127) && (axNodes[0].TEC <= 255));
+    XPD_TEST_CHECK((axNodes[0].Regs.ESR.w & CAN_ESR_EPVF) != 0);
+
+    /* the pending frame is acknowledged once a receiver connects */
+    axNodes[1].Connected = TRUE;
+    CANSIM_vRun(&xBus, 1000);
+    XPD_TEST_CHECK(xBus.Frames == 1);
+    XPD_TEST_CHECK(CAN_usDequeue(&axRxQueue[1], axFrames, TEST_RX_QUEUE_SIZE) == 1);
+
+    /* bit errors take the transmitter to bus-off */
+    xBus.InjectErrors = 100;
+    TEST_vEnqueue(0, 0x301, 2);
+    CANSIM_vRun(&xBus, 3000);
+    XPD_TEST_CHECK((axNodes[0].Regs.ESR.w & CAN_ESR_BOFF) != 0);
+    XPD_TEST_CHECK(ulErrorEvents > 0);
+
+    /* automatic recovery after 128 * 11 recessive bits, then the frame is sent */
+    xBus.InjectErrors = 0;
+    CANSIM_vRun(&xBus, 5000);
+    XPD_TEST_CHECK((axNodes[0].Regs.ESR.w & CAN_ESR_BOFF) == 0);
+    XPD_TEST_CHECK(CAN_usDequeue(&axRxQueue[1], axFrames, TEST_RX_QUEUE_SIZE) == 1);
+    XPD_TEST_CHECK(axFrames[0].Id.Value == 0x301);
+}
+
+int main(void)
+{
+    TEST_vArbitration();
+    TEST_vLoopback();
+    TEST_vErrors();
+
+    return XPD_TEST_RESULT();
+}
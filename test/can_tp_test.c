@@ -0,0 +1,341 @@
+/**
+  ******************************************************************************
+  * @file    can_tp_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   CAN Transport Protocol loopback throughput and flow control test
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <string.h>
+#include <xpd_can_tp.h>
+#include "xpd_test.h"
+
+/* Two transport protocol nodes are connected by a loopback bus model, which replaces
+ * the transmit queues of the CAN driver. Each frame occupies the bus for its
+ * (unstuffed) length at the bitrate, the nodes arbitrate by identifier. */
+#define TEST_BITRATE            500000
+#define TEST_TICK_PERIOD_us     100
+#define TEST_TICK_BITS          ((TEST_BITRATE / 1000) * TEST_TICK_PERIOD_us / 1000)
+#define TEST_QUEUE_SIZE         8
+#define TEST_MAX_LENGTH         4095
+#define TEST_TIME_LIMIT_BITS    (10 * TEST_BITRATE)
+
+#define TEST_ID_A               0x7E0
+#define TEST_ID_B               0x7E8
+
+typedef struct
+{
+    CAN_FrameType Frames[TEST_QUEUE_SIZE];
+    uint8_t Count;
+}TEST_QueueType;
+
+static CAN_HandleType xCanA, xCanB;
+static CANTP_SessionType xSessionA, xSessionB;
+static CANTP_HandleType xTpA = { &xCanA, &xSessionA, 1, ENABLE, 0xCC, TEST_TICK_PERIOD_us, 1000 };
+static CANTP_HandleType xTpB = { &xCanB, &xSessionB, 1, ENABLE, 0xCC, TEST_TICK_PERIOD_us, 1000 };
+
+static struct {
+    TEST_QueueType Queue[2];
+    uint64_t Time;              /* [bit times] */
+    uint64_t Busy;              /* [bit times] */
+    uint64_t NextTick;          /* [bit times] */
+    uint32_t Frames;
+    uint64_t LastCF;            /* end of the last consecutive frame [bit times] */
+    uint64_t MinGapCF;          /* shortest idle time before consecutive frames [bit times] */
+    uint8_t  Immediate;         /* frames to transfer within the next enqueue */
+}xBus;
+
+static uint8_t aucMessage[TEST_MAX_LENGTH], aucReceived[TEST_MAX_LENGTH];
+static uint32_t ulTransmitted, ulReceived, ulErrors;
+
+static void TEST_vTransmitted(void * pvSession) { ulTransmitted++; }
+static void TEST_vReceived(void * pvSession)    { ulReceived++; }
+static void TEST_vError(void * pvSession)       { ulErrors++; }
+
+static uint8_t TEST_ucNode(CAN_HandleType * pxCAN)
+{
+    return (pxCAN == &xCanA) ? 0 : 1;
+}
+
+static boolean_t TEST_bBusStep(void);
+
+/* CAN driver transmit queue replacement */
+XPD_ReturnType CAN_eEnqueue(CAN_HandleType * pxCAN, const CAN_FrameType * pxFrame)
+{
+    TEST_QueueType * pxQueue = &xBus.Queue[TEST_ucNode(pxCAN)];
+    XPD_ReturnType eResult = XPD_BUSY;
+    uint8_t ucImmediate = xBus.Immediate;
+
+    if (pxQueue->Count < TEST_QUEUE_SIZE)
+    {
+        pxQueue->Frames[pxQueue->Count++] = *pxFrame;
+        eResult = XPD_OK;
+
+        /* Transfer the frame (and the answer to it) before the enqueue returns */
+        xBus.Immediate = 0;
+        for (; (ucImmediate > 0) && TEST_bBusStep(); ucImmediate--);
+    }
+    return eResult;
+}
+
+boolean_t CAN_bTxPending(CAN_HandleType * pxCAN, const CAN_IdentifierFieldType * pxId)
+{
+    TEST_QueueType * pxQueue = &xBus.Queue[TEST_ucNode(pxCAN)];
+    boolean_t bPending = FALSE;
+    uint8_t i;
+
+    for (i = 0; i < pxQueue->Count; i++)
+    {
+        if (pxQueue->Frames[i].Id.Value == pxId->Value)
+        {
+            bPending = TRUE;
+        }
+    }
+    return bPending;
+}
+
+/* Runs the ticks which are due until the given time */
+static void TEST_vRunTicks(uint64_t ullTime)
+{
+    while (ullTime >= xBus.NextTick)
+    {
+        xBus.NextTick += TEST_TICK_BITS;
+        CANTP_vTick(&xTpA);
+        CANTP_vTick(&xTpB);
+    }
+}
+
+/* Transfers the most urgent pending frame, returns FALSE if the bus is idle */
+static boolean_t TEST_bBusStep(void)
+{
+    TEST_QueueType * pxQueue;
+    CAN_FrameType xFrame;
+    uint8_t ucNode;
+    uint32_t ulBits;
+
+    if ((xBus.Queue[0].Count == 0) && (xBus.Queue[1].Count == 0))
+    {
+        return FALSE;
+    }
+    if (xBus.Queue[0].Count == 0)
+    {
+        ucNode = 1;
+    }
+    else if (xBus.Queue[1].Count == 0)
+    {
+        ucNode = 0;
+    }
+    else
+    {
+        ucNode = (xBus.Queue[0].Frames[0].Id.Value < xBus.Queue[1].Frames[0].Id.Value) ? 0 : 1;
+    }
+
+    pxQueue = &xBus.Queue[ucNode];
+    xFrame = pxQueue->Frames[0];
+
+    /* SOF, standard arbitration and control fields, data, CRC, ACK, EOF and intermission */
+    ulBits = 47 + 8 * xFrame.DLC;
+
+    if ((ucNode == 0) && ((xFrame.Data.Byte[0] & 0xF0) == 0x20))
+    {
+        uint64_t ullGap = xBus.Time - xBus.LastCF;
+
+        if ((xBus.LastCF > 0) && (ullGap < xBus.MinGapCF))
+        {
+            xBus.MinGapCF = ullGap;
+        }
+        xBus.LastCF = xBus.Time + ulBits;
+    }
+    else if (ucNode == 1)
+    {
+        /* The separation time is measured within the blocks */
+        xBus.LastCF = 0;
+    }
+
+    /* The frame is pending during its transmission */
+    TEST_vRunTicks(xBus.Time + ulBits - 1);
+
+    xBus.Time += ulBits;
+    xBus.Busy += ulBits;
+    xBus.Frames++;
+    memmove(&pxQueue->Frames[0], &pxQueue->Frames[1], --pxQueue->Count * sizeof(xFrame));
+
+    /* Reception on the other node, then the transmit callback of the sender */
+    CANTP_vReceive((ucNode == 0) ? &xTpB : &xTpA, &xFrame);
+    CANTP_vProcess((ucNode == 0) ? &xTpA : &xTpB);
+
+    TEST_vRunTicks(xBus.Time);
+    return TRUE;
+}
+
+/* Runs the bus until the transfer completes, fails, or the time limit is reached */
+static void TEST_vRun(void)
+{
+    while (((ulTransmitted == 0) || (ulReceived == 0)) && (ulErrors == 0) &&
+           (xBus.Time < TEST_TIME_LIMIT_BITS))
+    {
+        if (!TEST_bBusStep())
+        {
+            /* Idle until the next tick */
+            xBus.Time = xBus.NextTick;
+            TEST_vRunTicks(xBus.Time);
+        }
+    }
+}
+
+static void TEST_vSetup(uint8_t ucBlockSize, uint8_t ucSTmin, uint16_t usTickPeriod_us)
+{
+    memset(&xBus, 0, sizeof(xBus));
+    xBus.MinGapCF = ~0ULL;
+    xBus.NextTick = TEST_TICK_BITS;
+    memset(aucReceived, 0, sizeof(aucReceived));
+    ulTransmitted = ulReceived = ulErrors = 0;
+
+    memset(&xSessionA, 0, sizeof(xSessionA));
+    memset(&xSessionB, 0, sizeof(xSessionB));
+    xSessionA.TxId.Value = TEST_ID_A;
+    xSessionA.RxId.Value = TEST_ID_B;
+    xSessionB.TxId.Value = TEST_ID_B;
+    xSessionB.RxId.Value = TEST_ID_A;
+    xSessionB.BlockSize  = ucBlockSize;
+    xSessionB.STmin      = ucSTmin;
+    xSessionB.Rx.Buffer  = aucReceived;
+    xSessionB.Rx.Size    = sizeof(aucReceived);
+    xSessionA.Callbacks.Transmit = TEST_vTransmitted;
+    xSessionA.Callbacks.Error    = TEST_vError;
+    xSessionB.Callbacks.Receive  = TEST_vReceived;
+    xSessionB.Callbacks.Error    = TEST_vError;
+
+    xTpA.TickPeriod_us = usTickPeriod_us;
+    xTpA.Timeout_ms    = (usTickPeriod_us < 10) ? 50 : 1000;
+    XPD_TEST_CHECK(CANTP_eInit(&xTpA) == XPD_OK);
+    XPD_TEST_CHECK(CANTP_eInit(&xTpB) == XPD_OK);
+}
+
+/* The longest message without flow control limits gets close to the bus capacity */
+static void TEST_vThroughput(void)
+{
+    uint16_t usLength = TEST_MAX_LENGTH;
+    uint32_t ulFrames = 2 + (usLength - 6 + 6) / 7;
+    uint64_t ullMinTime = ulFrames * (47 + 8 * 8);
+
+    TEST_vSetup(0, 0, TEST_TICK_PERIOD_us);
+
+    XPD_TEST_CHECK(CANTP_eSend(&xTpA, &xSessionA, aucMessage, usLength) == XPD_OK);
+    TEST_vRun();
+
+    XPD_TEST_CHECK((ulTransmitted == 1) && (ulReceived == 1) && (ulErrors == 0));
+    XPD_TEST_CHECK(xSessionB.Rx.Length == usLength);
+    XPD_TEST_CHECK(memcmp(aucMessage, aucReceived, usLength) == 0);
+    XPD_TEST_CHECK(xBus.Frames == ulFrames);
+
+    /* All frames are back-to-back, the bus never waits for the transport layer */
+    XPD_TEST_CHECK(xBus.Time == ullMinTime);
+
+    printf("throughput: %u bytes in %u frames, %llu us, %llu bit/s payload at %u bit/s, "
+           "bus load %llu %%\n", usLength, xBus.Frames,
+           (unsigned long long)(xBus.Time * 1000000 / TEST_BITRATE),
+           (unsigned long long)((uint64_t)usLength * 8 * TEST_BITRATE / xBus.Time),
+           TEST_BITRATE, (unsigned long long)(xBus.Busy * 100 / xBus.Time));
+}
+
+/* Blocks and separation time requested by the receiver are kept */
+static void TEST_vFlowControl(void)
+{
+    uint16_t usLength = 1000;
+
+    TEST_vSetup(8, 1, TEST_TICK_PERIOD_us);
+
+    XPD_TEST_CHECK(CANTP_eSend(&xTpA, &xSessionA, aucMessage, usLength) == XPD_OK);
+    TEST_vRun();
+
+    XPD_TEST_CHECK((ulTransmitted == 1) && (ulReceived == 1) && (ulErrors == 0));
+    XPD_TEST_CHECK(memcmp(aucMessage, aucReceived, usLength) == 0);
+
+    /* STmin = 1 ms between consecutive frames */
+    XPD_TEST_CHECK(xBus.MinGapCF >= (TEST_BITRATE / 1000));
+
+    printf("flow control: BS 8, STmin 1 ms: %u frames, %llu us, shortest CF gap %llu us\n",
+           xBus.Frames, (unsigned long long)(xBus.Time * 1000000 / TEST_BITRATE),
+           (unsigned long long)(xBus.MinGapCF * 1000000 / TEST_BITRATE));
+}
+
+/* The flow control is accepted even if it arrives before the first frame's enqueue returns */
+static void TEST_vEarlyFlowControl(void)
+{
+    uint16_t usLength = 100;
+
+    TEST_vSetup(0, 0, TEST_TICK_PERIOD_us);
+
+    /* First frame and flow control */
+    xBus.Immediate = 2;
+    XPD_TEST_CHECK(CANTP_eSend(&xTpA, &xSessionA, aucMessage, usLength) == XPD_OK);
+    XPD_TEST_CHECK(xBus.Frames == 2);
+    TEST_vRun();
+
+    XPD_TEST_CHECK((ulTransmitted == 1) && (ulReceived == 1) && (ulErrors == 0));
+    XPD_TEST_CHECK(memcmp(aucMessage, aucReceived, usLength) == 0);
+}
+
+/* A failed enqueue releases the transmitter */
+static void TEST_vQueueFull(void)
+{
+    CAN_FrameType xFrame;
+
+    TEST_vSetup(0, 0, TEST_TICK_PERIOD_us);
+
+    memset(&xFrame, 0, sizeof(xFrame));
+    xFrame.Id.Value = 0x100;
+    while (CAN_eEnqueue(&xCanA, &xFrame) == XPD_OK);
+
+    XPD_TEST_CHECK(CANTP_eSend(&xTpA, &xSessionA, aucMessage, 100) == XPD_BUSY);
+    XPD_TEST_CHECK(!CANTP_bTxBusy(&xSessionA));
+    XPD_TEST_CHECK(CANTP_eSend(&xTpA, &xSessionA, aucMessage, 5) == XPD_BUSY);
+    XPD_TEST_CHECK(!CANTP_bTxBusy(&xSessionA));
+}
+
+/* Separation times longer than the tick range are limited */
+static void TEST_vSTminRange(void)
+{
+    TEST_vSetup(0, 0x7F, 1);
+
+    XPD_TEST_CHECK(CANTP_eSend(&xTpA, &xSessionA, aucMessage, 100) == XPD_OK);
+
+    /* First frame and flow control */
+    XPD_TEST_CHECK(TEST_bBusStep() && TEST_bBusStep());
+    XPD_TEST_CHECK(xSessionA.Tx.STminTicks == 0xFFFF);
+
+    CANTP_vAbort(&xSessionA);
+}
+
+int main(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < sizeof(aucMessage); i++)
+    {
+        aucMessage[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    TEST_vThroughput();
+    TEST_vFlowControl();
+    TEST_vEarlyFlowControl();
+    TEST_vQueueFull();
+    TEST_vSTminRange();
+
+    return XPD_TEST_RESULT();
+}
@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file    xpd_config.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host test configuration
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_CONFIG_H_
+#define __XPD_CONFIG_H_
+
+/* The device header is selected by the test target (see CMakeLists.txt) */
+#include XPD_TEST_DEVICE
+
+/* The host has no bit-band region, the registers are accessed by their bit fields */
+#undef CAN_BB
+
+#define VDD_VALUE_mV                   3000 /* Value of VDD in mV */
+#define VDDA_VALUE_mV                  3000 /* Value of VDD Analog in mV */
+
+#endif /* __XPD_CONFIG_H_ */
@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file    xpd_test.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host test utilities
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __XPD_TEST_H_
+#define __XPD_TEST_H_
+
+#include <stdio.h>
+
+/** @brief Number of failed checks of the test program */
+static unsigned int xpd_uiTestFailures = 0;
+
+/**
+ * @brief Checks a condition, and reports it on failure.
+ * @param COND: the condition expected to be true
+ */
+#define XPD_TEST_CHECK(COND)                                            \
+    do { if (!(COND)) {                                                 \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND); \
+        xpd_uiTestFailures++; } } while (0)
+
+/**
+ * @brief Ends the test program with the summary of the checks.
+ * @return The exit code of the test program
+ */
+#define XPD_TEST_RESULT()                                               \
+    ((xpd_uiTestFailures == 0) ? (printf("PASSED\n"), 0) :              \
+        (printf("FAILED: %u checks\n", xpd_uiTestFailures), 1))
+
+#endif /* __XPD_TEST_H_ */
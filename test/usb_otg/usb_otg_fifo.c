@@ -0,0 +1,238 @@
+/**
+  ******************************************************************************
+  * @file    usb_otg_fifo.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host-side USB OTG FIFO model
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <usb_otg_fifo.h>
+
+/* The registers and each FIFO are accessed through their own 4 kB window */
+#define OTGFIFO_WINDOW                  0x1000
+#define OTGFIFO_COUNT                   8
+#define OTGFIFO_REGS_WINDOW             0
+#define OTGFIFO_NO_WINDOW               -1
+
+/* x86 page fault error code: write access; EFLAGS: trap flag */
+#define OTGFIFO_PF_WRITE                0x2
+#define OTGFIFO_EFLAGS_TF               0x100
+
+OTGFIFO_ModelType xOtgFifo;
+
+static uint8_t * otgfifo_pucRegs;
+static OTGFIFO_RegHookType otgfifo_pfnRead, otgfifo_pfnWrite;
+
+static struct {
+    volatile uint32_t * Address;
+    int Window;
+    boolean_t Write;
+}otgfifo_xPending = { NULL, OTGFIFO_NO_WINDOW, FALSE };
+
+/* Window 0 holds the registers, window 1 + x the FIFO x */
+static int OTGFIFO_prvWindow(const void * pvAddress)
+{
+    const uint8_t * pucAddress = pvAddress;
+    int iWindow = OTGFIFO_NO_WINDOW;
+
+    if ((pucAddress >= otgfifo_pucRegs) &&
+        (pucAddress < (otgfifo_pucRegs + (1 + OTGFIFO_COUNT) * OTGFIFO_WINDOW)))
+    {
+        iWindow = (pucAddress - otgfifo_pucRegs) / OTGFIFO_WINDOW;
+
+        /* The registers are only trapped when the hooks are set */
+        if ((iWindow == OTGFIFO_REGS_WINDOW) &&
+            (otgfifo_pfnRead == NULL) && (otgfifo_pfnWrite == NULL))
+        {
+            iWindow = OTGFIFO_NO_WINDOW;
+        }
+    }
+    return iWindow;
+}
+
+/* The access faults: open the window for the single access */
+static void OTGFIFO_prvFault(int iSignal, siginfo_t * pxInfo, void * pvContext)
+{
+    ucontext_t * pxContext = pvContext;
+    int iWindow = OTGFIFO_prvWindow(pxInfo->si_addr);
+
+    if (iWindow == OTGFIFO_NO_WINDOW)
+    {
+        /* Not a modelled access, fault again with the default action */
+        signal(iSignal, SIG_DFL);
+    }
+    else
+    {
+        uint32_t ulOffset = ((uint8_t *)pxInfo->si_addr - otgfifo_pucRegs) & ~3;
+
+        otgfifo_xPending.Address = (volatile uint32_t *)(otgfifo_pucRegs + ulOffset);
+        otgfifo_xPending.Window = iWindow;
+        otgfifo_xPending.Write =
+                (pxContext->uc_mcontext.gregs[REG_ERR] & OTGFIFO_PF_WRITE) != 0;
+
+        if (iWindow == OTGFIFO_REGS_WINDOW)
+        {
+            /* The register value is updated before the access,
+             * read-modify-write instructions fault as writes */
+            if (otgfifo_pfnRead != NULL)
+            {
+                otgfifo_pfnRead(ulOffset);
+            }
+        }
+        else if (!otgfifo_xPending.Write)
+        {
+            /* The FIFO pops the next received word */
+            uint32_t ulWord = 0;
+
+            if (xOtgFifo.Rx.Index < xOtgFifo.Rx.Count)
+            {
+                ulWord = xOtgFifo.Rx.Words[xOtgFifo.Rx.Index];
+            }
+            xOtgFifo.Rx.Index++;
+            xOtgFifo.Alias[ulOffset / sizeof(uint32_t)] = ulWord;
+        }
+
+        mprotect(otgfifo_pucRegs + iWindow * OTGFIFO_WINDOW, OTGFIFO_WINDOW,
+                PROT_READ | PROT_WRITE);
+
+        /* Trap after the access is executed */
+        pxContext->uc_mcontext.gregs[REG_EFL] |= OTGFIFO_EFLAGS_TF;
+    }
+}
+
+/* The access is done: close the window, and process the written value */
+static void OTGFIFO_prvTrap(int iSignal, siginfo_t * pxInfo, void * pvContext)
+{
+    ucontext_t * pxContext = pvContext;
+    int iWindow = otgfifo_xPending.Window;
+
+    (void)iSignal;
+    (void)pxInfo;
+
+    if (iWindow != OTGFIFO_NO_WINDOW)
+    {
+        uint32_t ulOffset = (uint8_t *)otgfifo_xPending.Address - otgfifo_pucRegs;
+
+        mprotect(otgfifo_pucRegs + iWindow * OTGFIFO_WINDOW, OTGFIFO_WINDOW, PROT_NONE);
+        otgfifo_xPending.Window = OTGFIFO_NO_WINDOW;
+
+        if (!otgfifo_xPending.Write)
+        {
+            /* Reads have no side effects after the access */
+        }
+        else if (iWindow == OTGFIFO_REGS_WINDOW)
+        {
+            if (otgfifo_pfnWrite != NULL)
+            {
+                otgfifo_pfnWrite(ulOffset);
+            }
+        }
+        else
+        {
+            /* The word is pushed to the transmit FIFO */
+            uint8_t ucFIFOx = iWindow - 1;
+            uint16_t usCount = xOtgFifo.Tx[ucFIFOx].Count;
+
+            if (usCount < OTGFIFO_DEPTH)
+            {
+                xOtgFifo.Tx[ucFIFOx].Words[usCount] = xOtgFifo.Alias[ulOffset / sizeof(uint32_t)];
+            }
+            xOtgFifo.Tx[ucFIFOx].Count = usCount + 1;
+        }
+        if (iWindow != OTGFIFO_REGS_WINDOW)
+        {
+            xOtgFifo.Alias[ulOffset / sizeof(uint32_t)] = 0;
+        }
+    }
+    pxContext->uc_mcontext.gregs[REG_EFL] &= ~OTGFIFO_EFLAGS_TF;
+}
+
+/**
+ * @brief Allocates the register block with protected FIFO windows,
+ *        and installs the access handlers.
+ */
+void OTGFIFO_vInit(void)
+{
+    struct sigaction xAction;
+    size_t xSize = (sizeof(USB_OTG_TypeDef) + OTGFIFO_WINDOW - 1) & ~(size_t)(OTGFIFO_WINDOW - 1);
+    int iFile = memfd_create("usb_otg", 0);
+    uint8_t * pucRegs, * pucAlias;
+
+    /* The model accesses the same memory through an unprotected mapping */
+    if ((iFile < 0) || (ftruncate(iFile, xSize) != 0))
+    {
+        abort();
+    }
+    pucRegs  = mmap(NULL, xSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFile, 0);
+    pucAlias = mmap(NULL, xSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFile, 0);
+    if ((pucRegs == MAP_FAILED) || (pucAlias == MAP_FAILED))
+    {
+        abort();
+    }
+    xOtgFifo.Regs  = (USB_OTG_TypeDef *)pucRegs;
+    xOtgFifo.Alias = (volatile uint32_t *)pucAlias;
+    otgfifo_pucRegs = pucRegs;
+
+    memset(&xAction, 0, sizeof(xAction));
+    xAction.sa_flags = SA_SIGINFO;
+    xAction.sa_sigaction = OTGFIFO_prvFault;
+    sigaction(SIGSEGV, &xAction, NULL);
+    xAction.sa_sigaction = OTGFIFO_prvTrap;
+    sigaction(SIGTRAP, &xAction, NULL);
+
+    mprotect(pucRegs + offsetof(USB_OTG_TypeDef, DFIFO), OTGFIFO_COUNT * OTGFIFO_WINDOW, PROT_NONE);
+    OTGFIFO_vReset();
+}
+
+/**
+ * @brief Traps the register accesses as well, so a peripheral model can
+ *        maintain the register values with their side effects.
+ * @param pfnRead: called with the register offset before it is accessed
+ * @param pfnWrite: called with the register offset after it is written,
+ *                  the new value is available through the alias mapping
+ */
+void OTGFIFO_vRegisterHooks(OTGFIFO_RegHookType pfnRead, OTGFIFO_RegHookType pfnWrite)
+{
+    otgfifo_pfnRead  = pfnRead;
+    otgfifo_pfnWrite = pfnWrite;
+
+    mprotect(otgfifo_pucRegs, OTGFIFO_WINDOW,
+            ((pfnRead != NULL) || (pfnWrite != NULL)) ? PROT_NONE : (PROT_READ | PROT_WRITE));
+}
+
+/**
+ * @brief Empties the transmit and receive streams.
+ */
+void OTGFIFO_vReset(void)
+{
+    uint8_t ucFIFOx;
+
+    for (ucFIFOx = 0; ucFIFOx < OTGFIFO_COUNT; ucFIFOx++)
+    {
+        xOtgFifo.Tx[ucFIFOx].Count = 0;
+    }
+    xOtgFifo.Rx.Count = 0;
+    xOtgFifo.Rx.Index = 0;
+}
@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    usb_otg_fifo.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host-side USB OTG FIFO and register access model
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __USB_OTG_FIFO_H_
+#define __USB_OTG_FIFO_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_usb_otg.h>
+
+/** @defgroup USB_OTG_Fifo USB OTG FIFO Model
+ * @brief    Host-side model of the USB OTG data FIFOs and register accesses.
+ * @details  The OTG register block is placed in page aligned host memory, and the pages
+ *           of the DFIFO windows are protected. Each FIFO access faults, and the fault
+ *           handler lets the single access through with the trap flag set: a read gets
+ *           the next word of the receive stream, a written word is appended to the
+ *           transmit stream of the FIFO. The driver accesses the FIFOs unmodified.
+ *           With @ref OTGFIFO_vRegisterHooks the register page is trapped the same way,
+ *           so a peripheral model can provide the side effects of register accesses.
+ *           The memory is mapped a second time without protection (Alias),
+ *           the model accesses the registers through that view.
+ *           The model requires Linux on x86-64.
+ * @{ */
+
+/** @brief Number of words a modelled FIFO stream can hold */
+#define OTGFIFO_DEPTH                   1024
+
+/** @brief USB OTG FIFO model structure */
+typedef struct
+{
+    USB_OTG_TypeDef * Regs;                 /*!< The register block, the handle's Inst points to it */
+    volatile uint32_t * Alias;              /*!< Unprotected word view of the register block */
+    struct {
+        uint32_t Words[OTGFIFO_DEPTH];      /*!< The words written to the FIFO */
+        uint16_t Count;                     /*!< Number of written words */
+    }Tx[8];                                 /*   Transmit FIFO streams */
+    struct {
+        uint32_t Words[OTGFIFO_DEPTH];      /*!< The words to be read from the FIFO */
+        uint16_t Count;                     /*!< Number of available words */
+        uint16_t Index;                     /*!< Number of read words */
+    }Rx;                                    /*   Receive FIFO stream */
+}OTGFIFO_ModelType;
+
+/** @brief Register access hook, called with the byte offset of the accessed register */
+typedef void (*OTGFIFO_RegHookType)(uint32_t ulOffset);
+
+/** @brief The FIFO model, its register block is allocated by @ref OTGFIFO_vInit */
+extern OTGFIFO_ModelType xOtgFifo;
+
+void            OTGFIFO_vInit           (void);
+void            OTGFIFO_vReset          (void);
+
+void            OTGFIFO_vRegisterHooks  (OTGFIFO_RegHookType pfnRead,
+                                         OTGFIFO_RegHookType pfnWrite);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_OTG_FIFO_H_ */
@@ -0,0 +1,618 @@
+/**
+  ******************************************************************************
+  * @file    usb_otg_host_model.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host-side USB OTG host mode model
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <stddef.h>
+#include <string.h>
+#include <usb_otg_host_model.h>
+
+#define OTGHOST_REG(NAME)               offsetof(USB_OTG_TypeDef, NAME)
+#define OTGHOST_HC_REG(CH, NAME)        (OTGHOST_REG(HC) + (CH) * sizeof(USB_OTG_HostChannelTypeDef) \
+                                         + offsetof(USB_OTG_HostChannelTypeDef, NAME))
+#define OTGHOST_ALIAS(OFFSET)           (xOtgFifo.Alias[(OFFSET) / sizeof(uint32_t)])
+
+#define OTGHOST_HPRT_CHANGES            (USB_OTG_HPRT_PCDET | USB_OTG_HPRT_PENCHNG | USB_OTG_HPRT_POCCHNG)
+
+#define OTGHOST_PKTSTS_IN_DATA          (2 << USB_OTG_GRXSTSP_PKTSTS_Pos)
+#define OTGHOST_PKTSTS_IN_COMPLETE      (3 << USB_OTG_GRXSTSP_PKTSTS_Pos)
+
+#define OTGHOST_PID_DATA0               0
+#define OTGHOST_PID_DATA1               2
+#define OTGHOST_PID_SETUP               3
+
+#define OTGHOST_MAX_PACKET_SIZE         1024
+#define OTGHOST_RX_STATUS_DEPTH         32
+#define OTGHOST_REQUEST_QUEUE_DEPTH     8
+
+/* Full speed frames fit 19 bulk packets of 64 bytes */
+#define OTGHOST_FRAME_TRANSACTIONS      19
+
+/* Bounds the interrupt handler calls, if the driver fails to clear a flag */
+#define OTGHOST_IRQ_CALL_LIMIT          64
+
+typedef enum
+{
+    OTGHOST_CH_IDLE,    /* Disabled */
+    OTGHOST_CH_ACTIVE,  /* Enabled, executing transactions */
+    OTGHOST_CH_WAIT,    /* IN packet received, waiting for the channel to be enabled again */
+    OTGHOST_CH_DONE,    /* Transfer ended, waiting for the channel to be disabled */
+}OTGHOST_ChannelStateType;
+
+OTGHOST_ModelType xOtgHost;
+
+static struct {
+    uint32_t HPRT;                          /* Root port status */
+    uint32_t GINTSTS;                       /* Latched core interrupt flags */
+    struct {
+        uint32_t HCINT;                     /* Channel interrupt flags */
+        uint16_t TxIndex;                   /* Number of transmitted words of the channel's FIFO stream */
+        OTGHOST_ChannelStateType State;
+        boolean_t Served;                   /* No more transactions in the current frame */
+    }Channel[OTGHOST_CHANNEL_COUNT];
+    struct {
+        uint32_t Entries[OTGHOST_RX_STATUS_DEPTH];
+        uint8_t Head, Tail;
+    }RxStatus;                              /* Receive status queue */
+}otghost_xCore;
+
+static boolean_t OTGHOST_prvIsPeriodic(uint8_t ucChNum)
+{
+    uint32_t ulType = (OTGHOST_ALIAS(OTGHOST_HC_REG(ucChNum, HCCHAR)) & USB_OTG_HCCHAR_EPTYP)
+            >> USB_OTG_HCCHAR_EPTYP_Pos;
+
+    return (ulType == USB_EP_TYPE_ISOCHRONOUS) || (ulType == USB_EP_TYPE_INTERRUPT);
+}
+
+/* Number of words in the periodic or the non-periodic transmit FIFO */
+static uint32_t OTGHOST_prvTxPending(boolean_t bPeriodic)
+{
+    uint32_t ulWords = 0;
+    uint8_t ucChNum;
+
+    for (ucChNum = 0; ucChNum < OTGHOST_CHANNEL_COUNT; ucChNum++)
+    {
+        if (OTGHOST_prvIsPeriodic(ucChNum) == bPeriodic)
+        {
+            ulWords += xOtgFifo.Tx[ucChNum].Count - otghost_xCore.Channel[ucChNum].TxIndex;
+        }
+    }
+    return ulWords;
+}
+
+/* Transmit FIFO status: free space in words and free request queue entries */
+static uint32_t OTGHOST_prvTxStatus(uint32_t ulSizeReg, boolean_t bPeriodic)
+{
+    uint32_t ulSize = OTGHOST_ALIAS(ulSizeReg) >> 16;
+    uint32_t ulPending = OTGHOST_prvTxPending(bPeriodic);
+
+    return (OTGHOST_REQUEST_QUEUE_DEPTH << 16) | ((ulPending < ulSize) ? (ulSize - ulPending) : 0);
+}
+
+/* Releases the transmitted words of the channel's FIFO stream */
+static void OTGHOST_prvTxRelease(uint8_t ucChNum, uint16_t usWords)
+{
+    otghost_xCore.Channel[ucChNum].TxIndex += usWords;
+
+    if (otghost_xCore.Channel[ucChNum].TxIndex >= xOtgFifo.Tx[ucChNum].Count)
+    {
+        otghost_xCore.Channel[ucChNum].TxIndex = 0;
+        xOtgFifo.Tx[ucChNum].Count = 0;
+    }
+}
+
+static uint32_t OTGHOST_prvHAINT(void)
+{
+    uint32_t ulHAINT = 0;
+    uint8_t ucChNum;
+
+    for (ucChNum = 0; ucChNum < OTGHOST_CHANNEL_COUNT; ucChNum++)
+    {
+        if ((otghost_xCore.Channel[ucChNum].HCINT &
+                OTGHOST_ALIAS(OTGHOST_HC_REG(ucChNum, HCINTMSK))) != 0)
+        {
+            ulHAINT |= 1 << ucChNum;
+        }
+    }
+    return ulHAINT;
+}
+
+static uint32_t OTGHOST_prvGINTSTS(void)
+{
+    uint32_t ulGINTSTS = otghost_xCore.GINTSTS | USB_OTG_GINTSTS_CMOD;
+
+    if ((otghost_xCore.HPRT & OTGHOST_HPRT_CHANGES) != 0)
+    {
+        ulGINTSTS |= USB_OTG_GINTSTS_HPRTINT;
+    }
+    if (OTGHOST_prvHAINT() != 0)
+    {
+        ulGINTSTS |= USB_OTG_GINTSTS_HCINT;
+    }
+    if (otghost_xCore.RxStatus.Head < otghost_xCore.RxStatus.Tail)
+    {
+        ulGINTSTS |= USB_OTG_GINTSTS_RXFLVL;
+    }
+    if (OTGHOST_prvTxPending(FALSE) == 0)
+    {
+        ulGINTSTS |= USB_OTG_GINTSTS_NPTXFE;
+    }
+    if (OTGHOST_prvTxPending(TRUE) == 0)
+    {
+        ulGINTSTS |= USB_OTG_GINTSTS_PTXFE;
+    }
+    return ulGINTSTS;
+}
+
+static void OTGHOST_prvPushRxStatus(uint32_t ulStatus)
+{
+    if (otghost_xCore.RxStatus.Tail < OTGHOST_RX_STATUS_DEPTH)
+    {
+        otghost_xCore.RxStatus.Entries[otghost_xCore.RxStatus.Tail++] = ulStatus;
+    }
+}
+
+/* Reads the receive status queue, popping the entry raises the transfer completed flag */
+static uint32_t OTGHOST_prvReadRxStatus(boolean_t bPop)
+{
+    uint32_t ulStatus = 0;
+
+    if (otghost_xCore.RxStatus.Head < otghost_xCore.RxStatus.Tail)
+    {
+        ulStatus = otghost_xCore.RxStatus.Entries[otghost_xCore.RxStatus.Head];
+
+        if (bPop)
+        {
+            otghost_xCore.RxStatus.Head++;
+            if (otghost_xCore.RxStatus.Head == otghost_xCore.RxStatus.Tail)
+            {
+                otghost_xCore.RxStatus.Head = otghost_xCore.RxStatus.Tail = 0;
+            }
+
+            if ((ulStatus & USB_OTG_GRXSTSP_PKTSTS) == OTGHOST_PKTSTS_IN_COMPLETE)
+            {
+                otghost_xCore.Channel[ulStatus & USB_OTG_GRXSTSP_EPNUM].HCINT |= USB_OTG_HCINT_XFRC;
+            }
+        }
+    }
+    return ulStatus;
+}
+
+/* Root port register write: change flags, power, reset and disable */
+static void OTGHOST_prvPortWrite(uint32_t ulValue)
+{
+    uint32_t ulHPRT = otghost_xCore.HPRT;
+
+    /* Change flags are cleared by writing 1 */
+    ulHPRT &= ~(ulValue & OTGHOST_HPRT_CHANGES);
+
+    /* Writing 1 to the enabled flag disables the port */
+    if ((ulValue & ulHPRT & USB_OTG_HPRT_PENA) != 0)
+    {
+        ulHPRT &= ~USB_OTG_HPRT_PENA;
+        ulHPRT |= USB_OTG_HPRT_PENCHNG;
+    }
+
+    if ((ulValue & USB_OTG_HPRT_PPWR) == 0)
+    {
+        ulHPRT &= ~(USB_OTG_HPRT_PPWR | USB_OTG_HPRT_PCSTS | USB_OTG_HPRT_PENA | USB_OTG_HPRT_PRST);
+    }
+    else
+    {
+        /* An attached device is detected when the port is powered */
+        if (((ulHPRT & USB_OTG_HPRT_PPWR) == 0) && (xOtgHost.Device != NULL))
+        {
+            ulHPRT |= USB_OTG_HPRT_PCSTS | USB_OTG_HPRT_PCDET;
+        }
+        ulHPRT |= USB_OTG_HPRT_PPWR;
+
+        if ((ulValue & USB_OTG_HPRT_PRST) != 0)
+        {
+            ulHPRT |= USB_OTG_HPRT_PRST;
+            ulHPRT &= ~USB_OTG_HPRT_PENA;
+        }
+        else if ((ulHPRT & USB_OTG_HPRT_PRST) != 0)
+        {
+            /* The end of the reset enables the port with the speed of the device */
+            ulHPRT &= ~(USB_OTG_HPRT_PRST | USB_OTG_HPRT_PSPD);
+
+            if ((ulHPRT & USB_OTG_HPRT_PCSTS) != 0)
+            {
+                ulHPRT |= USB_OTG_HPRT_PENA | USB_OTG_HPRT_PENCHNG |
+                        (USBHOST_SPEED_FULL << USB_OTG_HPRT_PSPD_Pos);
+            }
+        }
+    }
+    otghost_xCore.HPRT = ulHPRT;
+}
+
+/* Channel characteristics register write: enable or disable */
+static void OTGHOST_prvChannelControl(uint8_t ucChNum, uint32_t ulHCCHAR)
+{
+    if ((ulHCCHAR & USB_OTG_HCCHAR_CHDIS) != 0)
+    {
+        /* The halted channel's data is dropped from the transmit FIFO */
+        otghost_xCore.Channel[ucChNum].State = OTGHOST_CH_IDLE;
+        otghost_xCore.Channel[ucChNum].HCINT |= USB_OTG_HCINT_CHH;
+        OTGHOST_prvTxRelease(ucChNum, xOtgFifo.Tx[ucChNum].Count);
+
+        OTGHOST_ALIAS(OTGHOST_HC_REG(ucChNum, HCCHAR)) =
+                ulHCCHAR & ~(USB_OTG_HCCHAR_CHENA | USB_OTG_HCCHAR_CHDIS);
+    }
+    else if (((ulHCCHAR & USB_OTG_HCCHAR_CHENA) != 0) &&
+             (otghost_xCore.Channel[ucChNum].State != OTGHOST_CH_DONE))
+    {
+        otghost_xCore.Channel[ucChNum].State = OTGHOST_CH_ACTIVE;
+    }
+}
+
+/* Register side effects before the access */
+static void OTGHOST_prvRead(uint32_t ulOffset)
+{
+    if (ulOffset == OTGHOST_REG(GINTSTS))
+    {
+        OTGHOST_ALIAS(ulOffset) = OTGHOST_prvGINTSTS();
+    }
+    else if (ulOffset == OTGHOST_REG(GRSTCTL))
+    {
+        OTGHOST_ALIAS(ulOffset) |= USB_OTG_GRSTCTL_AHBIDL;
+    }
+    else if ((ulOffset == OTGHOST_REG(GRXSTSR)) || (ulOffset == OTGHOST_REG(GRXSTSP)))
+    {
+        OTGHOST_ALIAS(ulOffset) = OTGHOST_prvReadRxStatus(ulOffset == OTGHOST_REG(GRXSTSP));
+    }
+    else if (ulOffset == OTGHOST_REG(HNPTXSTS))
+    {
+        OTGHOST_ALIAS(ulOffset) = OTGHOST_prvTxStatus(OTGHOST_REG(DIEPTXF0_HNPTXFSIZ), FALSE);
+    }
+    else if (ulOffset == OTGHOST_REG(HPTXSTS))
+    {
+        OTGHOST_ALIAS(ulOffset) = OTGHOST_prvTxStatus(OTGHOST_REG(HPTXFSIZ), TRUE);
+    }
+    else if (ulOffset == OTGHOST_REG(HAINT))
+    {
+        OTGHOST_ALIAS(ulOffset) = OTGHOST_prvHAINT();
+    }
+    else if (ulOffset == OTGHOST_REG(HPRT))
+    {
+        OTGHOST_ALIAS(ulOffset) = otghost_xCore.HPRT;
+    }
+    else if ((ulOffset >= OTGHOST_HC_REG(0, HCCHAR)) &&
+             (ulOffset <  OTGHOST_HC_REG(OTGHOST_CHANNEL_COUNT, HCCHAR)))
+    {
+        uint8_t ucChNum = (ulOffset - OTGHOST_REG(HC)) / sizeof(USB_OTG_HostChannelTypeDef);
+
+        if (ulOffset == OTGHOST_HC_REG(ucChNum, HCINT))
+        {
+            OTGHOST_ALIAS(ulOffset) = otghost_xCore.Channel[ucChNum].HCINT;
+        }
+    }
+}
+
+/* Register side effects after the write access */
+static void OTGHOST_prvWrite(uint32_t ulOffset)
+{
+    uint32_t ulValue = OTGHOST_ALIAS(ulOffset);
+
+    if (ulOffset == OTGHOST_REG(GINTSTS))
+    {
+        otghost_xCore.GINTSTS &= ~ulValue;
+    }
+    else if (ulOffset == OTGHOST_REG(GRSTCTL))
+    {
+        /* Resets and flushes are done immediately */
+        OTGHOST_ALIAS(ulOffset) = (ulValue & ~(USB_OTG_GRSTCTL_CSRST |
+                USB_OTG_GRSTCTL_TXFFLSH | USB_OTG_GRSTCTL_RXFFLSH)) | USB_OTG_GRSTCTL_AHBIDL;
+    }
+    else if (ulOffset == OTGHOST_REG(HPRT))
+    {
+        OTGHOST_prvPortWrite(ulValue);
+    }
+    else if ((ulOffset >= OTGHOST_HC_REG(0, HCCHAR)) &&
+             (ulOffset <  OTGHOST_HC_REG(OTGHOST_CHANNEL_COUNT, HCCHAR)))
+    {
+        uint8_t ucChNum = (ulOffset - OTGHOST_REG(HC)) / sizeof(USB_OTG_HostChannelTypeDef);
+
+        if (ulOffset == OTGHOST_HC_REG(ucChNum, HCINT))
+        {
+            otghost_xCore.Channel[ucChNum].HCINT &= ~ulValue;
+        }
+        else if (ulOffset == OTGHOST_HC_REG(ucChNum, HCCHAR))
+        {
+            OTGHOST_prvChannelControl(ucChNum, ulValue);
+        }
+    }
+}
+
+/* Places a received IN packet in the receive FIFO with its status entry */
+static void OTGHOST_prvReceive(uint8_t ucChNum, const uint8_t * pucData, uint16_t usLength, uint8_t ucPID)
+{
+    uint16_t i;
+
+    if (xOtgFifo.Rx.Index >= xOtgFifo.Rx.Count)
+    {
+        xOtgFifo.Rx.Index = xOtgFifo.Rx.Count = 0;
+    }
+    for (i = 0; i < usLength; i++)
+    {
+        if ((i & 3) == 0)
+        {
+            xOtgFifo.Rx.Words[xOtgFifo.Rx.Count++] = 0;
+        }
+        xOtgFifo.Rx.Words[xOtgFifo.Rx.Count - 1] |= (uint32_t)pucData[i] << (8 * (i & 3));
+    }
+
+    OTGHOST_prvPushRxStatus(ucChNum | ((uint32_t)usLength << USB_OTG_GRXSTSP_BCNT_Pos) |
+            ((uint32_t)ucPID << USB_OTG_GRXSTSP_DPID_Pos) | OTGHOST_PKTSTS_IN_DATA);
+}
+
+/* Executes the next transaction of the channel, returns whether the bus was used */
+static boolean_t OTGHOST_prvTransaction(uint8_t ucChNum)
+{
+    volatile uint32_t * pulHCCHAR = &OTGHOST_ALIAS(OTGHOST_HC_REG(ucChNum, HCCHAR));
+    volatile uint32_t * pulHCTSIZ = &OTGHOST_ALIAS(OTGHOST_HC_REG(ucChNum, HCTSIZ));
+    uint32_t ulHCCHAR = *pulHCCHAR, ulHCTSIZ = *pulHCTSIZ;
+    uint32_t ulPackets = (ulHCTSIZ & USB_OTG_HCTSIZ_PKTCNT) >> USB_OTG_HCTSIZ_PKTCNT_Pos;
+    uint32_t ulSize = ulHCTSIZ & USB_OTG_HCTSIZ_XFRSIZ;
+    uint8_t ucPID = (ulHCTSIZ & USB_OTG_HCTSIZ_DPID) >> USB_OTG_HCTSIZ_DPID_Pos;
+    uint8_t ucEpNum = (ulHCCHAR & USB_OTG_HCCHAR_EPNUM) >> USB_OTG_HCCHAR_EPNUM_Pos;
+    uint16_t usMaxPacketSize = ulHCCHAR & USB_OTG_HCCHAR_MPSIZ;
+    boolean_t bPeriodic = OTGHOST_prvIsPeriodic(ucChNum);
+    boolean_t bOddFrame = (OTGHOST_ALIAS(OTGHOST_REG(HFNUM)) & 1) != 0;
+    uint8_t aucPacket[OTGHOST_MAX_PACKET_SIZE];
+    uint16_t usLength;
+    OTGHOST_ResponseType eResponse;
+
+    if ((xOtgHost.Device == NULL) || ((otghost_xCore.HPRT & USB_OTG_HPRT_PENA) == 0) ||
+        (otghost_xCore.Channel[ucChNum].State != OTGHOST_CH_ACTIVE) ||
+        (otghost_xCore.Channel[ucChNum].Served) || (ulPackets == 0) ||
+        (usMaxPacketSize > OTGHOST_MAX_PACKET_SIZE))
+    {
+        return FALSE;
+    }
+    /* Periodic transfers are executed in the scheduled frame */
+    if (bPeriodic && (bOddFrame != ((ulHCCHAR & USB_OTG_HCCHAR_ODDFRM) != 0)))
+    {
+        return FALSE;
+    }
+
+    if ((ulHCCHAR & USB_OTG_HCCHAR_EPDIR) != 0)
+    {
+        usLength = usMaxPacketSize;
+        eResponse = xOtgHost.Device->In(ucEpNum, aucPacket, &usLength);
+
+        if (eResponse == OTGHOST_ACK)
+        {
+            if (ucPID != xOtgHost.Toggle[ucEpNum][1])
+            {
+                xOtgHost.ToggleErrors++;
+            }
+            xOtgHost.Toggle[ucEpNum][1] ^= OTGHOST_PID_DATA1;
+
+            OTGHOST_prvReceive(ucChNum, aucPacket, usLength, ucPID);
+            ulPackets--;
+            ulSize -= (usLength < ulSize) ? usLength : ulSize;
+            ucPID ^= OTGHOST_PID_DATA1;
+
+            if ((usLength < usMaxPacketSize) || (ulPackets == 0))
+            {
+                /* The transfer completed flag is raised when the status is popped */
+                OTGHOST_prvPushRxStatus(ucChNum | OTGHOST_PKTSTS_IN_COMPLETE);
+                otghost_xCore.Channel[ucChNum].State = OTGHOST_CH_DONE;
+            }
+            else
+            {
+                /* The next packet is requested by enabling the channel again */
+                otghost_xCore.Channel[ucChNum].State = OTGHOST_CH_WAIT;
+                *pulHCCHAR = ulHCCHAR & ~USB_OTG_HCCHAR_CHENA;
+            }
+        }
+    }
+    else
+    {
+        uint16_t usWords, i;
+
+        usLength = (ulSize < usMaxPacketSize) ? ulSize : usMaxPacketSize;
+        usWords = (usLength + 3) / 4;
+
+        /* The packet has to be in the transmit FIFO */
+        if ((xOtgFifo.Tx[ucChNum].Count - otghost_xCore.Channel[ucChNum].TxIndex) < usWords)
+        {
+            return FALSE;
+        }
+        for (i = 0; i < usLength; i++)
+        {
+            aucPacket[i] = (uint8_t)(xOtgFifo.Tx[ucChNum].Words[
+                    otghost_xCore.Channel[ucChNum].TxIndex + i / 4] >> (8 * (i & 3)));
+        }
+
+        if (ucPID == OTGHOST_PID_SETUP)
+        {
+            /* Setup packets are always acknowledged, and reset the control pipe toggles */
+            (void)xOtgHost.Device->Setup(aucPacket);
+            xOtgHost.Toggle[ucEpNum][0] = OTGHOST_PID_DATA1;
+            xOtgHost.Toggle[ucEpNum][1] = OTGHOST_PID_DATA1;
+            eResponse = OTGHOST_ACK;
+            ucPID = OTGHOST_PID_DATA1;
+        }
+        else if (ucPID != xOtgHost.Toggle[ucEpNum][0])
+        {
+            /* A repeated packet is acknowledged and discarded by the device */
+            xOtgHost.ToggleErrors++;
+            eResponse = OTGHOST_ACK;
+            ucPID ^= OTGHOST_PID_DATA1;
+        }
+        else
+        {
+            eResponse = xOtgHost.Device->Out(ucEpNum, aucPacket, usLength);
+            if (eResponse == OTGHOST_ACK)
+            {
+                xOtgHost.Toggle[ucEpNum][0] ^= OTGHOST_PID_DATA1;
+                ucPID ^= OTGHOST_PID_DATA1;
+            }
+        }
+
+        if (eResponse == OTGHOST_ACK)
+        {
+            OTGHOST_prvTxRelease(ucChNum, usWords);
+            ulPackets--;
+            ulSize -= usLength;
+
+            if (ulPackets == 0)
+            {
+                otghost_xCore.Channel[ucChNum].HCINT |= USB_OTG_HCINT_XFRC;
+                otghost_xCore.Channel[ucChNum].State = OTGHOST_CH_DONE;
+            }
+        }
+    }
+
+    if (eResponse == OTGHOST_ACK)
+    {
+        otghost_xCore.Channel[ucChNum].HCINT |= USB_OTG_HCINT_ACK;
+    }
+    else if (eResponse == OTGHOST_NAK)
+    {
+        /* The endpoint is retried in the next frame at the earliest */
+        otghost_xCore.Channel[ucChNum].HCINT |= USB_OTG_HCINT_NAK;
+        otghost_xCore.Channel[ucChNum].Served = TRUE;
+    }
+    else
+    {
+        otghost_xCore.Channel[ucChNum].HCINT |= USB_OTG_HCINT_STALL;
+        otghost_xCore.Channel[ucChNum].State = OTGHOST_CH_DONE;
+    }
+
+    /* Periodic endpoints are served once per frame */
+    if (bPeriodic)
+    {
+        otghost_xCore.Channel[ucChNum].Served = TRUE;
+    }
+
+    *pulHCTSIZ = (ulHCTSIZ & ~(USB_OTG_HCTSIZ_XFRSIZ | USB_OTG_HCTSIZ_PKTCNT | USB_OTG_HCTSIZ_DPID)) |
+            ulSize | (ulPackets << USB_OTG_HCTSIZ_PKTCNT_Pos) |
+            ((uint32_t)ucPID << USB_OTG_HCTSIZ_DPID_Pos);
+
+    xOtgHost.Transactions++;
+    return TRUE;
+}
+
+/* Calls the driver's interrupt handler while an enabled interrupt is pending */
+static void OTGHOST_prvServiceIRQ(void)
+{
+    uint8_t ucCalls;
+
+    for (ucCalls = 0; (ucCalls < OTGHOST_IRQ_CALL_LIMIT) &&
+            ((OTGHOST_ALIAS(OTGHOST_REG(GAHBCFG)) & USB_OTG_GAHBCFG_GINT) != 0) &&
+            ((OTGHOST_prvGINTSTS() & OTGHOST_ALIAS(OTGHOST_REG(GINTMSK))) != 0); ucCalls++)
+    {
+        USBHOST_vIRQHandler(xOtgHost.Host);
+    }
+}
+
+/**
+ * @brief Sets up the register model for the host driver handle.
+ *        The handle's register block is allocated by the model.
+ * @param pxHost: pointer to the USB host handle structure
+ */
+void OTGHOST_vInit(USBHOST_HandleType * pxHost)
+{
+    if (xOtgFifo.Regs == NULL)
+    {
+        OTGFIFO_vInit();
+    }
+    memset(&otghost_xCore, 0, sizeof(otghost_xCore));
+    memset(&xOtgHost, 0, sizeof(xOtgHost));
+    memset((void *)xOtgFifo.Alias, 0, sizeof(USB_OTG_TypeDef));
+    OTGFIFO_vReset();
+
+    xOtgHost.Host = pxHost;
+    pxHost->Inst = xOtgFifo.Regs;
+
+    OTGFIFO_vRegisterHooks(OTGHOST_prvRead, OTGHOST_prvWrite);
+}
+
+/**
+ * @brief Attaches a device to the root port.
+ * @param pxDevice: pointer to the device
+ */
+void OTGHOST_vAttach(const OTGHOST_DeviceType * pxDevice)
+{
+    xOtgHost.Device = pxDevice;
+    memset(xOtgHost.Toggle, OTGHOST_PID_DATA0, sizeof(xOtgHost.Toggle));
+
+    if ((otghost_xCore.HPRT & USB_OTG_HPRT_PPWR) != 0)
+    {
+        otghost_xCore.HPRT |= USB_OTG_HPRT_PCSTS | USB_OTG_HPRT_PCDET;
+    }
+}
+
+/**
+ * @brief Detaches the device from the root port.
+ */
+void OTGHOST_vDetach(void)
+{
+    xOtgHost.Device = NULL;
+
+    otghost_xCore.HPRT &= ~(USB_OTG_HPRT_PCSTS | USB_OTG_HPRT_PENA);
+    otghost_xCore.GINTSTS |= USB_OTG_GINTSTS_DISCINT;
+}
+
+/**
+ * @brief Runs the bus for the given number of frames.
+ *        The pending interrupts are handled at the start of each frame and after each transaction.
+ * @param ulFrames: the number of frames to run
+ */
+void OTGHOST_vRun(uint32_t ulFrames)
+{
+    for (; ulFrames > 0; ulFrames--)
+    {
+        uint32_t ulHFNUM = OTGHOST_ALIAS(OTGHOST_REG(HFNUM));
+        uint8_t ucBudget = OTGHOST_FRAME_TRANSACTIONS;
+        boolean_t bProgress = TRUE;
+        uint8_t ucChNum;
+
+        OTGHOST_ALIAS(OTGHOST_REG(HFNUM)) = (ulHFNUM & ~USB_OTG_HFNUM_FRNUM) |
+                ((ulHFNUM + 1) & USB_OTG_HFNUM_FRNUM);
+        otghost_xCore.GINTSTS |= USB_OTG_GINTSTS_SOF;
+
+        for (ucChNum = 0; ucChNum < OTGHOST_CHANNEL_COUNT; ucChNum++)
+        {
+            otghost_xCore.Channel[ucChNum].Served = FALSE;
+        }
+        OTGHOST_prvServiceIRQ();
+
+        /* The channels are served in turns until the frame is full or there is nothing to do */
+        while (bProgress && (ucBudget > 0))
+        {
+            bProgress = FALSE;
+
+            for (ucChNum = 0; (ucChNum < OTGHOST_CHANNEL_COUNT) && (ucBudget > 0); ucChNum++)
+            {
+                if (OTGHOST_prvTransaction(ucChNum))
+                {
+                    bProgress = TRUE;
+                    ucBudget--;
+
+                    OTGHOST_prvServiceIRQ();
+                }
+            }
+        }
+    }
+}
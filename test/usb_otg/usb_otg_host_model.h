@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    usb_otg_host_model.h
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   STM32 eXtensible Peripheral Drivers host-side USB OTG host mode model
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#ifndef __USB_OTG_HOST_MODEL_H_
+#define __USB_OTG_HOST_MODEL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <xpd_usb_host.h>
+#include <usb_otg_fifo.h>
+
+/** @defgroup USB_OTG_Host_Model USB OTG Host Mode Model
+ * @brief    Host-side model of the USB OTG core in slave (non-DMA) host mode,
+ *           with a full speed device attached to the root port.
+ * @details  The register side effects are provided through the register hooks of
+ *           @ref USB_OTG_Fifo : the root port with its reset and change flags,
+ *           the clear-on-write interrupt flags, the receive status queue and
+ *           the transmit FIFO space. The host channels execute the transactions
+ *           of the enabled transfers frame by frame, with the device endpoints
+ *           answering through callbacks. The device keeps track of the data toggles
+ *           on its own, so the mismatching data PIDs of the host are counted.
+ *           The driver's interrupt handler is called whenever an unmasked interrupt
+ *           is pending. The DMA mode of the HS core is not modelled.
+ * @{ */
+
+/** @brief Number of modelled host channels (the FS core's) */
+#define OTGHOST_CHANNEL_COUNT           8
+
+/** @brief Device handshake types */
+typedef enum
+{
+    OTGHOST_ACK   = 0, /*!< The transaction is accepted */
+    OTGHOST_NAK   = 1, /*!< The endpoint is not ready */
+    OTGHOST_STALL = 2, /*!< The endpoint is halted */
+}OTGHOST_ResponseType;
+
+/** @brief Modelled device structure */
+typedef struct
+{
+    OTGHOST_ResponseType (*Setup)(const uint8_t * pucSetup);
+    /*!< Receives a setup packet, always acknowledged on the bus */
+
+    OTGHOST_ResponseType (*In)   (uint8_t ucEpNum, uint8_t * pucData, uint16_t * pusLength);
+    /*!< Provides an IN packet, the length is the max packet size on entry */
+
+    OTGHOST_ResponseType (*Out)  (uint8_t ucEpNum, const uint8_t * pucData, uint16_t usLength);
+    /*!< Receives an OUT packet */
+}OTGHOST_DeviceType;
+
+/** @brief USB OTG host mode model structure */
+typedef struct
+{
+    USBHOST_HandleType * Host;              /*!< The driver handle, its interrupt handler is called */
+    const OTGHOST_DeviceType * Device;      /*!< The attached device, or NULL */
+    uint8_t Toggle[16][2];                  /*!< Device side data toggles of the OUT and IN endpoints */
+    uint32_t ToggleErrors;                  /*!< Number of data PID mismatches */
+    uint32_t Transactions;                  /*!< Number of executed transactions */
+}OTGHOST_ModelType;
+
+/** @brief The host mode model */
+extern OTGHOST_ModelType xOtgHost;
+
+void            OTGHOST_vInit           (USBHOST_HandleType * pxHost);
+
+void            OTGHOST_vAttach         (const OTGHOST_DeviceType * pxDevice);
+void            OTGHOST_vDetach         (void);
+
+void            OTGHOST_vRun            (uint32_t ulFrames);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_OTG_HOST_MODEL_H_ */
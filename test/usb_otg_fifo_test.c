@@ -0,0 +1,200 @@
+/**
+  ******************************************************************************
+  * @file    usb_otg_fifo_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   USB OTG FIFO copy kernel test and benchmark
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+#include <usb_otg_fifo.h>
+#include "xpd_test.h"
+
+/* The FIFO kernels are internal to the driver */
+#include <xpd_usb_otg.c>
+
+#define TEST_MAX_LENGTH         520
+#define TEST_GUARD              8
+#define TEST_GUARD_BYTE         0xA5
+#define TEST_BENCH_ROUNDS       20000
+
+static USB_HandleType xUSB;
+static uint8_t aucData[TEST_GUARD + TEST_MAX_LENGTH + TEST_GUARD];
+
+static uint8_t TEST_ucPattern(uint16_t usIndex)
+{
+    return (uint8_t)(usIndex * 7 + 1);
+}
+
+/* The FIFO words carry the data in little endian order, the last word padded with zeroes */
+static uint32_t TEST_ulWord(uint16_t usLength, uint16_t usWord)
+{
+    uint32_t ulWord = 0;
+    uint16_t i;
+
+    for (i = 0; (i < 4) && ((usWord * 4 + i) < usLength); i++)
+    {
+        ulWord |= (uint32_t)TEST_ucPattern(usWord * 4 + i) << (8 * i);
+    }
+    return ulWord;
+}
+
+/* Every length of a high-speed bulk packet, from every source alignment */
+static void TEST_vWriteFifo(void)
+{
+    uint16_t usLength, usWord;
+    uint8_t ucOffset, ucFIFOx = 0;
+
+    for (ucOffset = 0; ucOffset < 4; ucOffset++)
+    {
+        for (usLength = 0; usLength <= TEST_MAX_LENGTH; usLength++)
+        {
+            uint8_t * pucData = &aucData[TEST_GUARD + ucOffset];
+            uint16_t usWords = (usLength + 3) / 4;
+            boolean_t bMatch = TRUE;
+
+            for (usWord = 0; usWord < usLength; usWord++)
+            {
+                pucData[usWord] = TEST_ucPattern(usWord);
+            }
+            ucFIFOx = (ucFIFOx + 1) & 3;
+            OTGFIFO_vReset();
+
+            USB_prvWriteFifo(&xUSB, ucFIFOx, pucData, usLength);
+
+            for (usWord = 0; (usWord < usWords) && bMatch; usWord++)
+            {
+                bMatch = xOtgFifo.Tx[ucFIFOx].Words[usWord] == TEST_ulWord(usLength, usWord);
+            }
+            XPD_TEST_CHECK(xOtgFifo.Tx[ucFIFOx].Count == usWords);
+            XPD_TEST_CHECK(bMatch);
+        }
+    }
+}
+
+/* Every length to every destination alignment, without touching the bytes around */
+static void TEST_vReadFifo(void)
+{
+    uint16_t usLength, i;
+    uint8_t ucOffset;
+
+    for (ucOffset = 0; ucOffset < 4; ucOffset++)
+    {
+        for (usLength = 0; usLength <= TEST_MAX_LENGTH; usLength++)
+        {
+            uint8_t * pucData = &aucData[TEST_GUARD + ucOffset];
+            uint16_t usWords = (usLength + 3) / 4;
+            boolean_t bMatch = TRUE, bGuard = TRUE;
+
+            OTGFIFO_vReset();
+            for (i = 0; i < usWords; i++)
+            {
+                xOtgFifo.Rx.Words[i] = TEST_ulWord(usLength, i);
+            }
+            if ((usLength & 3) != 0)
+            {
+                /* the padding bytes of the last word are not to be stored */
+                xOtgFifo.Rx.Words[usWords - 1] |= 0xEEEEEEEE << (8 * (usLength & 3));
+            }
+            xOtgFifo.Rx.Count = usWords;
+            memset(aucData, TEST_GUARD_BYTE, sizeof(aucData));
+
+            USB_prvReadFifo(&xUSB, pucData, usLength);
+
+            for (i = 0; i < usLength; i++)
+            {
+                bMatch = bMatch && (pucData[i] == TEST_ucPattern(i));
+            }
+            for (i = 0; i < (TEST_GUARD + ucOffset); i++)
+            {
+                bGuard = bGuard && (aucData[i] == TEST_GUARD_BYTE);
+            }
+            for (i = TEST_GUARD + ucOffset + usLength; i < sizeof(aucData); i++)
+            {
+                bGuard = bGuard && (aucData[i] == TEST_GUARD_BYTE);
+            }
+            XPD_TEST_CHECK(xOtgFifo.Rx.Index == usWords);
+            XPD_TEST_CHECK(bMatch);
+            XPD_TEST_CHECK(bGuard);
+        }
+    }
+}
+
+/* Copy rate with a FIFO register in plain memory, in bytes per host TSC cycle */
+static void TEST_vBenchmark(void)
+{
+    static const uint16_t ausLengths[] = { 64, 512 };
+    USB_HandleType xBenchUSB;
+    uint8_t ucOffset, ucLength;
+
+    memset(&xBenchUSB, 0, sizeof(xBenchUSB));
+    xBenchUSB.Inst = calloc(1, sizeof(USB_OTG_TypeDef));
+
+    for (ucLength = 0; ucLength < 2; ucLength++)
+    {
+        for (ucOffset = 0; ucOffset < 2; ucOffset++)
+        {
+            uint8_t * pucData = &aucData[TEST_GUARD + ucOffset];
+            uint16_t usLength = ausLengths[ucLength];
+            uint64_t ullWrite, ullRead;
+            uint32_t i;
+
+            ullWrite = __rdtsc();
+            for (i = 0; i < TEST_BENCH_ROUNDS; i++)
+            {
+                USB_prvWriteFifo(&xBenchUSB, 1, pucData, usLength);
+            }
+            ullWrite = __rdtsc() - ullWrite;
+
+            ullRead = __rdtsc();
+            for (i = 0; i < TEST_BENCH_ROUNDS; i++)
+            {
+                USB_prvReadFifo(&xBenchUSB, pucData, usLength);
+            }
+            ullRead = __rdtsc() - ullRead;
+
+            printf("%3u bytes, %s: write %.2f, read %.2f bytes/cycle\n", usLength,
+                   (ucOffset == 0) ? "aligned  " : "unaligned",
+                   (double)usLength * TEST_BENCH_ROUNDS / ullWrite,
+                   (double)usLength * TEST_BENCH_ROUNDS / ullRead);
+        }
+    }
+    free(xBenchUSB.Inst);
+}
+
+/* The driver's callbacks and clock services are not used by the kernels */
+void USB_vResetCallback(USB_HandleType * pxUSB, USB_SpeedType eSpeed) { }
+void USB_vSetupCallback(USB_HandleType * pxUSB) { }
+void USB_vDataInCallback(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP) { }
+void USB_vDataOutCallback(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP) { }
+void RCC_vClockEnable(RCC_PositionType PeriphPos) { }
+void RCC_vClockDisable(RCC_PositionType PeriphPos) { }
+uint32_t RCC_ulClockFreq_Hz(RCC_ClockType eSelectedClock) { return 168000000; }
+
+int main(void)
+{
+    OTGFIFO_vInit();
+    xUSB.Inst = xOtgFifo.Regs;
+
+    TEST_vWriteFifo();
+    TEST_vReadFifo();
+    TEST_vBenchmark();
+
+    return XPD_TEST_RESULT();
+}
@@ -0,0 +1,371 @@
+/**
+  ******************************************************************************
+  * @file    usb_otg_host_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   USB OTG host driver test on the host mode register model
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <string.h>
+#include <xpd_rcc.h>
+#include <xpd_utils.h>
+#include <usb_otg_host_model.h>
+#include "xpd_test.h"
+
+#define TEST_TIMEOUT_FRAMES     1000
+#define TEST_BULK_IN_LENGTH     4096
+#define TEST_BULK_OUT_LENGTH    1000
+#define TEST_BULK_OUT_NAK_AT    8
+#define TEST_BULK_NAK_PERIOD    5
+#define TEST_INT_NAKS           2
+#define TEST_INT_LENGTH         4
+
+#define TEST_EP_BULK_IN         0x81
+#define TEST_EP_BULK_OUT        0x02
+#define TEST_EP_INT_IN          0x83
+
+static const uint8_t aucGetDescriptor[8] = { 0x80, 0x06, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00 };
+static const uint8_t aucDescriptor[18] = {
+        0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40,
+        0x83, 0x04, 0x40, 0x57, 0x00, 0x02, 0x01, 0x02, 0x03, 0x01 };
+
+static USBHOST_HandleType xHost;
+static uint8_t ucCtrlOut, ucCtrlIn, ucBulkIn, ucBulkOut, ucIntIn;
+static uint8_t aucBuffer[TEST_BULK_IN_LENGTH];
+
+/* The device's endpoint behavior and observations */
+static struct {
+    uint8_t Setup[8];
+    uint16_t StatusOut;
+    uint32_t BulkInCalls;
+    uint32_t BulkInNaks;
+    uint16_t BulkInIndex;
+    boolean_t BulkInNakAll;
+    boolean_t BulkInStall;
+    uint8_t BulkOut[TEST_BULK_OUT_LENGTH];
+    uint16_t BulkOutLength;
+    uint16_t BulkOutPackets;
+    uint16_t BulkOutNakAt;
+    uint16_t IntPolls;
+    uint16_t IntFrame;
+}xDev;
+
+static uint32_t ulConnects, ulDisconnects, ulPortEnables;
+
+static uint8_t TEST_ucPattern(uint16_t usIndex)
+{
+    return (uint8_t)(usIndex * 7 + 1);
+}
+
+static OTGHOST_ResponseType TEST_eDeviceSetup(const uint8_t * pucSetup)
+{
+    memcpy(xDev.Setup, pucSetup, sizeof(xDev.Setup));
+    return OTGHOST_ACK;
+}
+
+static OTGHOST_ResponseType TEST_eDeviceIn(uint8_t ucEpNum, uint8_t * pucData, uint16_t * pusLength)
+{
+    OTGHOST_ResponseType eResponse = OTGHOST_ACK;
+    uint16_t i;
+
+    if (ucEpNum == 0)
+    {
+        memcpy(pucData, aucDescriptor, sizeof(aucDescriptor));
+        *pusLength = sizeof(aucDescriptor);
+    }
+    else if (ucEpNum == (TEST_EP_BULK_IN & 0xF))
+    {
+        xDev.BulkInCalls++;
+
+        if (xDev.BulkInStall)
+        {
+            eResponse = OTGHOST_STALL;
+        }
+        else if (xDev.BulkInNakAll || ((xDev.BulkInCalls % TEST_BULK_NAK_PERIOD) == 0))
+        {
+            xDev.BulkInNaks++;
+            eResponse = OTGHOST_NAK;
+        }
+        else
+        {
+            for (i = 0; i < *pusLength; i++)
+            {
+                pucData[i] = TEST_ucPattern(xDev.BulkInIndex++);
+            }
+        }
+    }
+    else
+    {
+        xDev.IntPolls++;
+        xDev.IntFrame = USBHOST_usFrameNumber(&xHost);
+
+        if (xDev.IntPolls <= TEST_INT_NAKS)
+        {
+            eResponse = OTGHOST_NAK;
+        }
+        else
+        {
+            for (i = 0; i < TEST_INT_LENGTH; i++)
+            {
+                pucData[i] = TEST_ucPattern(i);
+            }
+            *pusLength = TEST_INT_LENGTH;
+        }
+    }
+    return eResponse;
+}
+
+static OTGHOST_ResponseType TEST_eDeviceOut(uint8_t ucEpNum, const uint8_t * pucData, uint16_t usLength)
+{
+    OTGHOST_ResponseType eResponse = OTGHOST_ACK;
+
+    if (ucEpNum == 0)
+    {
+        xDev.StatusOut++;
+    }
+    else if (xDev.BulkOutPackets == xDev.BulkOutNakAt)
+    {
+        /* Not ready once, in the middle of the transfer */
+        xDev.BulkOutNakAt = 0;
+        eResponse = OTGHOST_NAK;
+    }
+    else
+    {
+        memcpy(&xDev.BulkOut[xDev.BulkOutLength], pucData, usLength);
+        xDev.BulkOutLength += usLength;
+        xDev.BulkOutPackets++;
+    }
+    return eResponse;
+}
+
+static const OTGHOST_DeviceType xDevice = {
+        .Setup  = TEST_eDeviceSetup,
+        .In     = TEST_eDeviceIn,
+        .Out    = TEST_eDeviceOut,
+};
+
+static void TEST_vConnected(void * pvHandle)    { ulConnects++; }
+static void TEST_vDisconnected(void * pvHandle) { ulDisconnects++; }
+static void TEST_vPortEnabled(void * pvHandle)  { ulPortEnables++; }
+
+/* Runs the bus until the channel's transfer ends */
+static USBHOST_ChannelStatusType TEST_eWait(uint8_t ucChNum)
+{
+    uint16_t usFrames;
+
+    for (usFrames = 0; (USBHOST_eChannelStatus(&xHost, ucChNum) == USBHOST_CH_BUSY) &&
+            (usFrames < TEST_TIMEOUT_FRAMES); usFrames++)
+    {
+        OTGHOST_vRun(1);
+    }
+    return USBHOST_eChannelStatus(&xHost, ucChNum);
+}
+
+/* The device is detected, and enabled at full speed after the port reset */
+static void TEST_vPortReset(void)
+{
+    memset(&xHost, 0, sizeof(xHost));
+    xHost.Callbacks.Connect     = TEST_vConnected;
+    xHost.Callbacks.Disconnect  = TEST_vDisconnected;
+    xHost.Callbacks.PortEnabled = TEST_vPortEnabled;
+
+    OTGHOST_vInit(&xHost);
+    USBHOST_vInit(&xHost, DISABLE);
+    OTGHOST_vAttach(&xDevice);
+    USBHOST_vStart_IT(&xHost);
+
+    OTGHOST_vRun(1);
+    XPD_TEST_CHECK((ulConnects == 1) && (xHost.Port.Connected != 0));
+    XPD_TEST_CHECK((ulPortEnables == 0) && (xHost.Port.Enabled == 0));
+
+    USBHOST_vPortReset(&xHost);
+    OTGHOST_vRun(1);
+    XPD_TEST_CHECK((ulPortEnables == 1) && (xHost.Port.Enabled != 0));
+    XPD_TEST_CHECK(xHost.Port.Speed == USBHOST_SPEED_FULL);
+}
+
+/* GET_DESCRIPTOR: setup, IN data stage with DATA1, OUT status stage with DATA1 */
+static void TEST_vControl(void)
+{
+    ucCtrlOut = USBHOST_ucChannelAlloc(&xHost);
+    ucCtrlIn  = USBHOST_ucChannelAlloc(&xHost);
+    XPD_TEST_CHECK((ucCtrlOut != USBHOST_INVALID_CHANNEL) && (ucCtrlIn != USBHOST_INVALID_CHANNEL));
+
+    USBHOST_vChannelOpen(&xHost, ucCtrlOut, 0, 0x00, USB_EP_TYPE_CONTROL, 64);
+    USBHOST_vChannelOpen(&xHost, ucCtrlIn,  0, 0x80, USB_EP_TYPE_CONTROL, 64);
+
+    USBHOST_vChannelSetup(&xHost, ucCtrlOut, aucGetDescriptor);
+    XPD_TEST_CHECK(TEST_eWait(ucCtrlOut) == USBHOST_CH_DONE);
+    XPD_TEST_CHECK(memcmp(xDev.Setup, aucGetDescriptor, sizeof(aucGetDescriptor)) == 0);
+
+    USBHOST_vChannelSetToggle(&xHost, ucCtrlIn, 1);
+    USBHOST_vChannelTransfer(&xHost, ucCtrlIn, aucBuffer, 64);
+    XPD_TEST_CHECK(TEST_eWait(ucCtrlIn) == USBHOST_CH_DONE);
+    XPD_TEST_CHECK(xHost.Channel[ucCtrlIn].Transfer.Length == sizeof(aucDescriptor));
+    XPD_TEST_CHECK(memcmp(aucBuffer, aucDescriptor, sizeof(aucDescriptor)) == 0);
+
+    USBHOST_vChannelSetToggle(&xHost, ucCtrlOut, 1);
+    USBHOST_vChannelTransfer(&xHost, ucCtrlOut, NULL, 0);
+    XPD_TEST_CHECK(TEST_eWait(ucCtrlOut) == USBHOST_CH_DONE);
+    XPD_TEST_CHECK(xDev.StatusOut == 1);
+
+    XPD_TEST_CHECK(xOtgHost.ToggleErrors == 0);
+}
+
+/* A multi-packet bulk IN transfer, the channel keeps polling the NAKing endpoint */
+static void TEST_vBulkIn(void)
+{
+    uint16_t i;
+    boolean_t bMatch = TRUE;
+
+    ucBulkIn = USBHOST_ucChannelAlloc(&xHost);
+    USBHOST_vChannelOpen(&xHost, ucBulkIn, 0, TEST_EP_BULK_IN, USB_EP_TYPE_BULK, 64);
+
+    memset(aucBuffer, 0, sizeof(aucBuffer));
+    USBHOST_vChannelTransfer(&xHost, ucBulkIn, aucBuffer, TEST_BULK_IN_LENGTH);
+    XPD_TEST_CHECK(TEST_eWait(ucBulkIn) == USBHOST_CH_DONE);
+    XPD_TEST_CHECK(xHost.Channel[ucBulkIn].Transfer.Length == TEST_BULK_IN_LENGTH);
+
+    for (i = 0; i < TEST_BULK_IN_LENGTH; i++)
+    {
+        bMatch = bMatch && (aucBuffer[i] == TEST_ucPattern(i));
+    }
+    XPD_TEST_CHECK(bMatch);
+    XPD_TEST_CHECK(xDev.BulkInNaks > 0);
+    XPD_TEST_CHECK(xOtgHost.ToggleErrors == 0);
+}
+
+/* A bulk OUT transfer larger than the transmit FIFO, interrupted by a NAK:
+ * the acknowledged length and the data toggle allow continuing without loss or repetition */
+static void TEST_vBulkOut(void)
+{
+    USBHOST_ChannelStatusType eStatus;
+    uint16_t i, usSent = 0, usFirstLength = 0;
+    uint8_t ucNaks = 0;
+
+    for (i = 0; i < TEST_BULK_OUT_LENGTH; i++)
+    {
+        aucBuffer[i] = TEST_ucPattern(i);
+    }
+    xDev.BulkOutNakAt = TEST_BULK_OUT_NAK_AT;
+
+    ucBulkOut = USBHOST_ucChannelAlloc(&xHost);
+    USBHOST_vChannelOpen(&xHost, ucBulkOut, 0, TEST_EP_BULK_OUT, USB_EP_TYPE_BULK, 64);
+
+    USBHOST_vChannelTransfer(&xHost, ucBulkOut, aucBuffer, TEST_BULK_OUT_LENGTH);
+    while (((eStatus = TEST_eWait(ucBulkOut)) == USBHOST_CH_NAK) && (ucNaks < 4))
+    {
+        if (ucNaks++ == 0)
+        {
+            usFirstLength = xHost.Channel[ucBulkOut].Transfer.Length;
+        }
+        usSent += xHost.Channel[ucBulkOut].Transfer.Length;
+
+        USBHOST_vChannelTransfer(&xHost, ucBulkOut, &aucBuffer[usSent], TEST_BULK_OUT_LENGTH - usSent);
+    }
+    XPD_TEST_CHECK(eStatus == USBHOST_CH_DONE);
+    XPD_TEST_CHECK(ucNaks == 1);
+    XPD_TEST_CHECK(usFirstLength == (TEST_BULK_OUT_NAK_AT * 64));
+    XPD_TEST_CHECK(xDev.BulkOutLength == TEST_BULK_OUT_LENGTH);
+    XPD_TEST_CHECK(memcmp(xDev.BulkOut, aucBuffer, TEST_BULK_OUT_LENGTH) == 0);
+    XPD_TEST_CHECK(xOtgHost.ToggleErrors == 0);
+}
+
+/* Interrupt IN polls are executed in the frame following the request */
+static void TEST_vInterruptIn(void)
+{
+    USBHOST_ChannelStatusType eStatus;
+    boolean_t bScheduled = TRUE;
+    uint8_t ucAttempts = 0;
+    uint8_t i;
+
+    ucIntIn = USBHOST_ucChannelAlloc(&xHost);
+    USBHOST_vChannelOpen(&xHost, ucIntIn, 0, TEST_EP_INT_IN, USB_EP_TYPE_INTERRUPT, 8);
+
+    do
+    {
+        uint16_t usRequestFrame = USBHOST_usFrameNumber(&xHost);
+
+        USBHOST_vChannelTransfer(&xHost, ucIntIn, aucBuffer, 8);
+        OTGHOST_vRun(2);
+
+        eStatus = USBHOST_eChannelStatus(&xHost, ucIntIn);
+        bScheduled = bScheduled && (xDev.IntFrame == (uint16_t)(usRequestFrame + 1));
+    }
+    while ((eStatus == USBHOST_CH_NAK) && (++ucAttempts < 8));
+
+    XPD_TEST_CHECK(eStatus == USBHOST_CH_DONE);
+    XPD_TEST_CHECK(xDev.IntPolls == (TEST_INT_NAKS + 1));
+    XPD_TEST_CHECK(bScheduled);
+    XPD_TEST_CHECK(xHost.Channel[ucIntIn].Transfer.Length == TEST_INT_LENGTH);
+    for (i = 0; i < TEST_INT_LENGTH; i++)
+    {
+        XPD_TEST_CHECK(aucBuffer[i] == TEST_ucPattern(i));
+    }
+    XPD_TEST_CHECK(xOtgHost.ToggleErrors == 0);
+}
+
+/* A halted endpoint ends the transfer */
+static void TEST_vStall(void)
+{
+    xDev.BulkInStall = TRUE;
+    USBHOST_vChannelTransfer(&xHost, ucBulkIn, aucBuffer, 64);
+    XPD_TEST_CHECK(TEST_eWait(ucBulkIn) == USBHOST_CH_STALL);
+    xDev.BulkInStall = FALSE;
+}
+
+/* The ongoing transfers fail when the device is detached */
+static void TEST_vDisconnect(void)
+{
+    xDev.BulkInNakAll = TRUE;
+    USBHOST_vChannelTransfer(&xHost, ucBulkIn, aucBuffer, 64);
+    OTGHOST_vRun(3);
+    XPD_TEST_CHECK(USBHOST_eChannelStatus(&xHost, ucBulkIn) == USBHOST_CH_BUSY);
+
+    OTGHOST_vDetach();
+    OTGHOST_vRun(1);
+    XPD_TEST_CHECK(USBHOST_eChannelStatus(&xHost, ucBulkIn) == USBHOST_CH_ERROR);
+    XPD_TEST_CHECK(ulDisconnects == 1);
+    XPD_TEST_CHECK((xHost.Port.Connected == 0) && (xHost.Port.Enabled == 0));
+}
+
+/* The port reset delays are not needed by the model */
+static void TEST_vBlock_ms(uint32_t ulBlocktime_ms) { }
+
+static const XPD_TimeServiceType xTimeService = {
+        .Block_ms       = TEST_vBlock_ms,
+};
+
+const XPD_TimeServiceType * XPD_pxTimeService(void) { return &xTimeService; }
+void RCC_vClockEnable(RCC_PositionType PeriphPos) { }
+void RCC_vClockDisable(RCC_PositionType PeriphPos) { }
+
+int main(void)
+{
+    TEST_vPortReset();
+    TEST_vControl();
+    TEST_vBulkIn();
+    TEST_vBulkOut();
+    TEST_vInterruptIn();
+    TEST_vStall();
+    TEST_vDisconnect();
+
+    printf("host: %u transactions, %u toggle errors\n",
+           xOtgHost.Transactions, xOtgHost.ToggleErrors);
+
+    return XPD_TEST_RESULT();
+}
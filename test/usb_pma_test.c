@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    usb_pma_test.c
+  * @author  Benedek Kupper
+  * @version 0.1
+  * @date    2018-01-28
+  * @brief   USB packet memory copy kernel test
+  *
+  * Copyright (c) 2018 Benedek Kupper
+  *
+  * Licensed under the Apache License, Version 2.0 (the "License");
+  * you may not use this file except in compliance with the License.
+  * You may obtain a copy of the License at
+  *
+  *     http://www.apache.org/licenses/LICENSE-2.0
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+  */
+#include <string.h>
+#include <xpd_usb.h>
+#include "xpd_test.h"
+
+/* The packet memory is placed in host memory,
+ * its access scheme (1x16 or 2x16 bits) is selected by the device header */
+static uint32_t aulPma[512];
+
+#undef  USB_PMAADDR
+#define USB_PMAADDR             ((uintptr_t)aulPma)
+
+/* The PMA copy kernels are internal to the driver */
+#include <xpd_usb.c>
+
+#define TEST_MAX_LENGTH         300
+#define TEST_PMA_ADDRESS        64
+#define TEST_GUARD              8
+#define TEST_GUARD_BYTE         0xA5
+#define TEST_PMA_UNUSED         0xDEADDEAD
+
+#define TEST_PMA_SLOTS          (sizeof(aulPma) / sizeof(USB_PacketAddressType))
+
+static USB_PacketAddressType * const pxPma = (USB_PacketAddressType *)aulPma;
+static uint8_t aucData[TEST_GUARD + TEST_MAX_LENGTH + TEST_GUARD];
+
+static uint8_t TEST_ucPattern(uint16_t usIndex)
+{
+    return (uint8_t)(usIndex * 7 + 1);
+}
+
+/* Each packet memory halfword carries two data bytes in little endian order */
+static uint16_t TEST_usHalfword(uint16_t usLength, uint16_t usIndex)
+{
+    uint16_t usHalfword = TEST_ucPattern(2 * usIndex);
+
+    if ((2 * usIndex + 1) < usLength)
+    {
+        usHalfword |= (uint16_t)TEST_ucPattern(2 * usIndex + 1) << 8;
+    }
+    return usHalfword;
+}
+
+/* Every length from every source alignment, without writing other packet memory */
+static void TEST_vWritePMA(void)
+{
+    uint16_t usLength, i;
+    uint8_t ucOffset;
+
+    for (ucOffset = 0; ucOffset < 4; ucOffset++)
+    {
+        for (usLength = 0; usLength <= TEST_MAX_LENGTH; usLength++)
+        {
+            uint8_t * pucData = &aucData[TEST_GUARD + ucOffset];
+            uint16_t usFirst = TEST_PMA_ADDRESS / 2, usSlots = (usLength + 1) / 2;
+            boolean_t bMatch = TRUE, bGuard = TRUE;
+
+            for (i = 0; i < usLength; i++)
+            {
+                pucData[i] = TEST_ucPattern(i);
+            }
+            for (i = 0; i < TEST_PMA_SLOTS; i++)
+            {
+                pxPma[i] = (USB_PacketAddressType)TEST_PMA_UNUSED;
+            }
+
+            USB_prvWritePMA(pucData, TEST_PMA_ADDRESS, usLength);
+
+            for (i = 0; i < usSlots; i++)
+            {
+                bMatch = bMatch && (pxPma[usFirst + i] == TEST_usHalfword(usLength, i));
+            }
+            for (i = 0; i < TEST_PMA_SLOTS; i++)
+            {
+                if ((i < usFirst) || (i >= (usFirst + usSlots)))
+                {
+                    bGuard = bGuard && (pxPma[i] == (USB_PacketAddressType)TEST_PMA_UNUSED);
+                }
+            }
+            XPD_TEST_CHECK(bMatch);
+            XPD_TEST_CHECK(bGuard);
+        }
+    }
+}
+
+/* Every length to every destination alignment, without touching the bytes around */
+static void TEST_vReadPMA(void)
+{
+    uint16_t usLength, i;
+    uint8_t ucOffset;
+
+    for (ucOffset = 0; ucOffset < 4; ucOffset++)
+    {
+        for (usLength = 0; usLength <= TEST_MAX_LENGTH; usLength++)
+        {
+            uint8_t * pucData = &aucData[TEST_GUARD + ucOffset];
+            boolean_t bMatch = TRUE, bGuard = TRUE;
+
+            for (i = 0; i < TEST_PMA_SLOTS; i++)
+            {
+                /* the unused halves of the 2x16 scheme are not to be read */
+                pxPma[i] = (USB_PacketAddressType)TEST_PMA_UNUSED;
+            }
+            for (i = 0; i < ((usLength + 1) / 2); i++)
+            {
+                pxPma[TEST_PMA_ADDRESS / 2 + i] = (USB_PacketAddressType)(TEST_PMA_UNUSED & ~0xFFFF)
+                        | TEST_usHalfword(usLength, i);
+            }
+            if ((usLength & 1) != 0)
+            {
+                /* the byte after an odd length is not to be stored */
+                pxPma[TEST_PMA_ADDRESS / 2 + usLength / 2] |= 0xEE00;
+            }
+            memset(aucData, TEST_GUARD_BYTE, sizeof(aucData));
+
+            USB_prvReadPMA(pucData, TEST_PMA_ADDRESS, usLength);
+
+            for (i = 0; i < usLength; i++)
+            {
+                bMatch = bMatch && (pucData[i] == TEST_ucPattern(i));
+            }
+            for (i = 0; i < (TEST_GUARD + ucOffset); i++)
+            {
+                bGuard = bGuard && (aucData[i] == TEST_GUARD_BYTE);
+            }
+            for (i = TEST_GUARD + ucOffset + usLength; i < sizeof(aucData); i++)
+            {
+                bGuard = bGuard && (aucData[i] == TEST_GUARD_BYTE);
+            }
+            XPD_TEST_CHECK(bMatch);
+            XPD_TEST_CHECK(bGuard);
+        }
+    }
+}
+
+/* The driver's callbacks and services are not used by the kernels */
+void USB_vResetCallback(USB_HandleType * pxUSB, USB_SpeedType eSpeed) { }
+void USB_vSetupCallback(USB_HandleType * pxUSB) { }
+void USB_vDataInCallback(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP) { }
+void USB_vDataOutCallback(USB_HandleType * pxUSB, USB_EndPointHandleType * pxEP) { }
+void RCC_vClockEnable(RCC_PositionType PeriphPos) { }
+void RCC_vClockDisable(RCC_PositionType PeriphPos) { }
+const XPD_TimeServiceType * XPD_pxTimeService(void) { return NULL; }
+
+int main(void)
+{
+    printf("packet memory access scheme: %s\n",
+           (sizeof(USB_PacketAddressType) == 2) ? "1x16 bits" : "2x16 bits");
+
+    TEST_vWritePMA();
+    TEST_vReadPMA();
+
+    return XPD_TEST_RESULT();
+}